@@ -160,11 +160,12 @@ public:
 		abs_segdir.absify();
 		MathVector <T, 3> abs_diff(diff);
 		abs_diff.absify();
-		T f = size[0] + abs_segdir[0];
+		MathVector <T, 3> extent(size * 0.5);
+		T f = extent[0] + abs_segdir[0];
 		if (abs_diff[0] > f) return OUT;
-		f = size[1] + abs_segdir[1];
+		f = extent[1] + abs_segdir[1];
 		if (abs_diff[1] > f) return OUT;
-		f = size[2] + abs_segdir[2];
+		f = extent[2] + abs_segdir[2];
 		if (abs_diff[2] > f) return OUT;
 
 		MathVector <T, 3> cross(segdir.cross(diff));
@@ -172,13 +173,13 @@ public:
 		MathVector <T, 3> abs_cross(cross);
 		abs_cross.absify();
 
-		f = size[1]*abs_segdir[2] + size[2]*abs_segdir[1];
+		f = extent[1]*abs_segdir[2] + extent[2]*abs_segdir[1];
 		if ( abs_cross[0] > f ) return OUT;
 
-		f = size[2]*abs_segdir[0] + size[0]*abs_segdir[2];
+		f = extent[2]*abs_segdir[0] + extent[0]*abs_segdir[2];
 		if ( abs_cross[1] > f ) return OUT;
 
-		f = size[0]*abs_segdir[1] + size[1]*abs_segdir[0];
+		f = extent[0]*abs_segdir[1] + extent[1]*abs_segdir[0];
 		if ( abs_cross[2] > f ) return OUT;
 
 		return INTERSECT;
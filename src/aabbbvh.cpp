@@ -0,0 +1,121 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "aabbbvh.h"
+#include "unittest.h"
+
+#include <algorithm>
+#include <vector>
+
+QT_TEST(aabb_bvh_test)
+{
+	AabbBvh <int> bvh;
+	QT_CHECK_EQUAL(bvh.size(), 0);
+
+	std::vector <int> output;
+	bvh.Optimize();
+	bvh.Query(Aabb<float>::IntersectAlways(), output);
+	QT_CHECK(output.empty());
+
+	// grid of unit boxes, a few of them stacked on the same spot
+	std::vector <Aabb <float> > boxes;
+	for (int i = 0; i < 103; ++i)
+	{
+		Vec3 c1((i % 10) * 2.0, (i / 10) * 2.0, (i % 3) * 0.5);
+		if (i > 99) c1.Set(0, 0, 0);
+		Vec3 c2 = c1 + Vec3(1, 1, 1);
+		Aabb <float> box;
+		box.SetFromCorners(c1, c2);
+		boxes.push_back(box);
+		bvh.Add(i, box);
+	}
+	bvh.Optimize();
+	QT_CHECK_EQUAL(bvh.size(), boxes.size());
+	QT_CHECK(bvh.GetNodeCount() > 1);
+
+	output.clear();
+	bvh.Query(Aabb<float>::IntersectAlways(), output);
+	QT_CHECK_EQUAL(output.size(), boxes.size());
+
+	// rays must report the same objects as a linear search
+	for (int i = 0; i < 100; ++i)
+	{
+		Vec3 orig((i % 10) * 2.1 - 1, (i / 10) * 1.9 + 0.5, 10);
+		Vec3 dir(0.05 * (i % 7), -0.03 * (i % 5), -1);
+		dir = dir.Normalize();
+		Aabb<float>::Ray ray(orig, dir, 20);
+
+		std::vector <int> expected;
+		for (int n = 0; n < (int)boxes.size(); ++n)
+		{
+			if (boxes[n].Intersect(ray) != Aabb<float>::OUT)
+				expected.push_back(n);
+		}
+
+		output.clear();
+		bvh.Query(ray, output);
+		std::sort(output.begin(), output.end());
+		QT_CHECK(output == expected);
+	}
+
+	// frustum and box queries
+	float plane[6][4];
+	for (int i = 0; i < 6; ++i)
+	{
+		plane[i][0] = (i % 2) ? 1 : -1;
+		plane[i][1] = (i % 3) ? 0.5 : -0.5;
+		plane[i][2] = 0;
+		plane[i][3] = 10;
+	}
+	Frustum frustum(plane);
+	Aabb <float> box;
+	box.SetFromCorners(Vec3(3, 3, 0), Vec3(7, 9, 1));
+	std::vector <int> expected_frustum, expected_box;
+	for (int n = 0; n < (int)boxes.size(); ++n)
+	{
+		if (boxes[n].Intersect(frustum) != Aabb<float>::OUT)
+			expected_frustum.push_back(n);
+		if (boxes[n].Intersect(box) != Aabb<float>::OUT)
+			expected_box.push_back(n);
+	}
+	QT_CHECK(!expected_frustum.empty() && expected_frustum.size() < boxes.size());
+
+	output.clear();
+	bvh.Query(frustum, output);
+	std::sort(output.begin(), output.end());
+	QT_CHECK(output == expected_frustum);
+
+	output.clear();
+	bvh.Query(box, output);
+	std::sort(output.begin(), output.end());
+	QT_CHECK(output == expected_box);
+
+	// an object added after the build needs another Optimize
+	QT_CHECK(!bvh.IsDirty());
+	bvh.Add(boxes.size(), box);
+	QT_CHECK(bvh.IsDirty());
+	bvh.Optimize();
+	QT_CHECK(!bvh.IsDirty());
+	expected_box.push_back(boxes.size());
+
+	output.clear();
+	bvh.Query(box, output);
+	std::sort(output.begin(), output.end());
+	QT_CHECK(output == expected_box);
+}
@@ -0,0 +1,332 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _AABBBVH_H
+#define _AABBBVH_H
+
+#include "aabb.h"
+#include "mathvector.h"
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <ostream>
+
+/// Bounding volume hierarchy stored as a flat node array in depth first order.
+/// The first child of a node is the next node in the array, the skip index points
+/// past the node's subtree, so queries walk the array without recursion.
+/// Objects are sorted so that every subtree references a contiguous object range.
+/// Node and object bounds are packed into 32 byte records kept apart from the
+/// subtree ranges and object data, traversal only touches the bounds array.
+/// Objects are added, then Optimize builds the hierarchy, the tree is static afterwards.
+/// Adding an object drops the built tree, Optimize has to be called again before the
+/// next query. Queries on an outdated tree assert, they don't rebuild it because
+/// queries are const and may run on several threads at once.
+template <typename DataType, unsigned int ideal_objects_per_node = 2>
+class AabbBvh
+{
+public:
+	AabbBvh() : dirty(false) {}
+
+	void DebugPrint(std::ostream & output) const
+	{
+		output << "objects: " << object_data.size() << ", nodes: " << nodes.size() << ", aabb: ";
+		if (!nodes.empty()) nodes[0].bounds.GetAabb().DebugPrint(output);
+		else output << std::endl;
+	}
+
+	void Add(const DataType & object, const Aabb <float> & aabb)
+	{
+		objects.push_back(std::pair <DataType, Aabb <float> > (object, aabb));
+		Invalidate();
+		dirty = true;
+	}
+
+	/// build the hierarchy over all added objects
+	void Optimize()
+	{
+		Invalidate();
+		dirty = false;
+		if (objects.empty()) return;
+
+		nodes.reserve(2 * objects.size() / ideal_objects_per_node + 1);
+		ranges.reserve(nodes.capacity());
+		Build(0, objects.size());
+
+		object_bounds.reserve(objects.size());
+		object_data.reserve(objects.size());
+		for (typename objectlist_type::const_iterator i = objects.begin(); i != objects.end(); ++i)
+		{
+			object_bounds.push_back(Bounds(i->second));
+			object_data.push_back(i->first);
+		}
+	}
+
+	///run a query for objects that collide with the given shape
+	template <typename T, typename U>
+	void Query(const T & shape, U & outputlist) const
+	{
+		QueryBounds(shape, outputlist);
+	}
+
+	///ray query, segment terms are computed once per query instead of once per box
+	template <typename U>
+	void Query(const Aabb<float>::Ray & ray, U & outputlist) const
+	{
+		QueryBounds(Segment(ray), outputlist);
+	}
+
+	bool Empty() const {return objects.empty();}
+
+	void Clear() {objects.clear(); Invalidate(); dirty = false;}
+
+	/// true if objects were added since the last Optimize
+	bool IsDirty() const {return dirty;}
+
+	unsigned int size() const {return objects.size();}
+
+	unsigned int GetNodeCount() const {return nodes.size();}
+
+private:
+	/// Aabb reduced to what the intersection tests need
+	struct Bounds
+	{
+		float center[3];
+		float radius;
+		float extent[3]; ///< half size
+
+		Bounds() {}
+
+		Bounds(const Aabb <float> & aabb)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				center[i] = aabb.GetCenter()[i];
+				extent[i] = aabb.GetSize()[i] * 0.5;
+			}
+			radius = aabb.GetSize().Magnitude() * 0.5;
+		}
+
+		Aabb <float> GetAabb() const
+		{
+			Vec3 c(center[0], center[1], center[2]);
+			Vec3 e(extent[0], extent[1], extent[2]);
+			Aabb <float> aabb;
+			aabb.SetFromCorners(c - e, c + e);
+			return aabb;
+		}
+	};
+
+	struct Node
+	{
+		Bounds bounds;
+		unsigned int skip; ///< next node after the subtree
+	};
+
+	struct Range
+	{
+		unsigned int first; ///< first object of the subtree
+		unsigned int count; ///< object count of the subtree
+	};
+
+	/// ray segment terms shared by all box tests of a query, see Aabb::Intersect(Ray)
+	struct Segment
+	{
+		float center[3];
+		float dir[3];
+		float absdir[3];
+
+		Segment(const Aabb<float>::Ray & ray)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				dir[i] = ray.dir[i] * (0.5f * ray.seglen);
+				center[i] = ray.orig[i] + dir[i];
+				absdir[i] = std::abs(dir[i]);
+			}
+		}
+	};
+
+	struct CenterLess
+	{
+		int axis;
+		CenterLess(int value) : axis(value) {}
+		bool operator()(const std::pair <DataType, Aabb <float> > & a, const std::pair <DataType, Aabb <float> > & b) const
+		{
+			return a.second.GetCenter()[axis] < b.second.GetCenter()[axis];
+		}
+	};
+
+	typedef std::vector <std::pair <DataType, Aabb <float> > > objectlist_type;
+	objectlist_type objects; ///< build input, kept to allow rebuilds after Add
+	std::vector <Node> nodes;
+	std::vector <Range> ranges;
+	std::vector <Bounds> object_bounds;
+	std::vector <DataType> object_data;
+	bool dirty; ///< objects added after the tree was built
+
+	void Invalidate()
+	{
+		nodes.clear();
+		ranges.clear();
+		object_bounds.clear();
+		object_data.clear();
+	}
+
+	template <typename T, typename U>
+	void QueryBounds(const T & shape, U & outputlist) const
+	{
+		assert(!dirty && "AabbBvh queried without Optimize after Add");
+		unsigned int i = 0;
+		while (i < nodes.size())
+		{
+			const Node & node = nodes[i];
+			Aabb<float>::IntersectionEnum intersection = Intersect(node.bounds, shape);
+			if (intersection == Aabb<float>::OUT)
+			{
+				i = node.skip;
+				continue;
+			}
+
+			const Range & range = ranges[i];
+			if (intersection == Aabb<float>::IN)
+			{
+				// fully inside, take the whole subtree
+				for (unsigned int n = range.first; n < range.first + range.count; ++n)
+				{
+					outputlist.push_back(object_data[n]);
+				}
+				i = node.skip;
+				continue;
+			}
+
+			if (node.skip == i + 1)
+			{
+				// leaf node, test objects
+				for (unsigned int n = range.first; n < range.first + range.count; ++n)
+				{
+					if (Intersect(object_bounds[n], shape) != Aabb<float>::OUT)
+					{
+						outputlist.push_back(object_data[n]);
+					}
+				}
+			}
+			++i;
+		}
+	}
+
+	/// same test as Aabb::Intersect(Ray)
+	static Aabb<float>::IntersectionEnum Intersect(const Bounds & b, const Segment & s)
+	{
+		float diff[3], absdiff[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			diff[i] = s.center[i] - b.center[i];
+			absdiff[i] = std::abs(diff[i]);
+			if (absdiff[i] > b.extent[i] + s.absdir[i]) return Aabb<float>::OUT;
+		}
+
+		float cross0 = s.dir[1] * diff[2] - s.dir[2] * diff[1];
+		if (std::abs(cross0) > b.extent[1] * s.absdir[2] + b.extent[2] * s.absdir[1]) return Aabb<float>::OUT;
+
+		float cross1 = s.dir[2] * diff[0] - s.dir[0] * diff[2];
+		if (std::abs(cross1) > b.extent[2] * s.absdir[0] + b.extent[0] * s.absdir[2]) return Aabb<float>::OUT;
+
+		float cross2 = s.dir[0] * diff[1] - s.dir[1] * diff[0];
+		if (std::abs(cross2) > b.extent[0] * s.absdir[1] + b.extent[1] * s.absdir[0]) return Aabb<float>::OUT;
+
+		return Aabb<float>::INTERSECT;
+	}
+
+	/// same test as Aabb::Intersect(Frustum)
+	static Aabb<float>::IntersectionEnum Intersect(const Bounds & b, const Frustum & frustum)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			float rd = frustum.frustum[i][0] * b.center[0] +
+				frustum.frustum[i][1] * b.center[1] +
+				frustum.frustum[i][2] * b.center[2] +
+				frustum.frustum[i][3];
+			if (rd < -b.radius) return Aabb<float>::OUT;
+		}
+		return Aabb<float>::INTERSECT;
+	}
+
+	static Aabb<float>::IntersectionEnum Intersect(const Bounds & b, Aabb<float>::IntersectAlways always)
+	{
+		return Aabb<float>::IN;
+	}
+
+	/// other shapes go through Aabb
+	template <typename T>
+	static Aabb<float>::IntersectionEnum Intersect(const Bounds & b, const T & shape)
+	{
+		return b.GetAabb().Intersect(shape);
+	}
+
+	///recursively split objects at the median center along the axis of maximum center spread
+	void Build(unsigned int first, unsigned int last)
+	{
+		unsigned int index = nodes.size();
+		nodes.push_back(Node());
+		ranges.push_back(Range());
+
+		Aabb <float> bbox = objects[first].second;
+		Vec3 cmin = bbox.GetCenter(), cmax = bbox.GetCenter();
+		for (unsigned int i = first + 1; i < last; ++i)
+		{
+			const Aabb <float> & objbox = objects[i].second;
+			bbox.CombineWith(objbox);
+			for (int n = 0; n < 3; ++n)
+			{
+				cmin[n] = std::min(cmin[n], objbox.GetCenter()[n]);
+				cmax[n] = std::max(cmax[n], objbox.GetCenter()[n]);
+			}
+		}
+
+		Vec3 spread = cmax - cmin;
+		int axis = 0;
+		if (spread[1] > spread[axis]) axis = 1;
+		if (spread[2] > spread[axis]) axis = 2;
+
+		if (last - first > ideal_objects_per_node && spread[axis] > 0)
+		{
+			unsigned int mid = (first + last) / 2;
+			std::nth_element(objects.begin() + first, objects.begin() + mid, objects.begin() + last, CenterLess(axis));
+			Build(first, mid);
+			Build(mid, last);
+		}
+
+		// pad node bounds by a few ulp, so rounding never culls a node whose objects pass
+		Bounds & bounds = nodes[index].bounds;
+		bounds = Bounds(bbox);
+		for (int n = 0; n < 3; ++n)
+		{
+			bounds.extent[n] += (std::abs(bounds.center[n]) + bounds.extent[n]) * 1E-6f;
+		}
+		bounds.radius *= 1 + 1E-6f;
+		nodes[index].skip = nodes.size();
+		ranges[index].first = first;
+		ranges[index].count = last - first;
+	}
+};
+
+#endif // _AABBBVH_H
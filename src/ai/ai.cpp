@@ -18,14 +18,43 @@
 /************************************************************************/
 
 #include "ai.h"
+#include "ai_factory.h"
+#include "car.h"
+#include "roadstrip.h"
+#include "quickmp.h"
+#include "unittest.h"
 #include <cassert>
+#include <cmath>
 // AI implementations:
 #include "ai_car_standard.h"
 #include "ai_car_experimental.h"
 
 const std::string Ai::default_type = "aistd";
 
-Ai::Ai() : empty_input(CarInput::INVALID, 0.0)
+AiCarParams::AiCarParams() :
+	inv_mass(0), drag(0), lift(0), max_fx(0), max_fy(0), stall_rpm(0),
+	optimum_steering_angle(0), max_steering_angle(0)
+{
+	// ctor
+}
+
+AiCarParams::AiCarParams(const Car & car) :
+	inv_mass(car.GetInvMass()),
+	drag(car.GetAeordynamicDragCoefficient()),
+	lift(car.GetAerodynamicDownforceCoefficient()),
+	max_fx(0), max_fy(0),
+	stall_rpm(car.GetEngineStallRPM()),
+	optimum_steering_angle(car.GetOptimumSteeringAngle()),
+	max_steering_angle(car.GetMaxSteeringAngle())
+{
+	for (int i = 0; i < 4; i++)
+	{
+		max_fx += car.GetTireMaxFx(WheelPosition(i));
+		max_fy += car.GetTireMaxFy(WheelPosition(i));
+	}
+}
+
+Ai::Ai() : empty_input(CarInput::INVALID, 0.0), multithreaded(false)
 {
 	AddFactory("aistd", new AiCarStandardFactory());
 	AddFactory("aiexp", new AiCarExperimentalFactory());
@@ -45,7 +74,7 @@ Ai::~Ai()
 	AI_Factories.clear();
 }
 
-void Ai::add_car(Car * car, float difficulty, const std::string & type)
+void Ai::add_car(Car * car, float difficulty, const std::list <RoadStrip> & roads, const std::string & type)
 {
 	assert(car);
 	assert(AI_Factories.size() > 0);
@@ -55,6 +84,20 @@ void Ai::add_car(Car * car, float difficulty, const std::string & type)
 	AiFactory* factory = it->second;
 	AiCar* aicar = factory->create(car, difficulty);
 	AI_Cars.push_back(aicar);
+
+	AiSpeedProfile::Params params;
+	if (aicar->GetSpeedProfileParams(params))
+	{
+		SpeedProfileKey key(type, params);
+		std::map <SpeedProfileKey, AiSpeedProfile>::iterator profile = speed_profiles.find(key);
+		if (profile == speed_profiles.end())
+		{
+			profile = speed_profiles.insert(std::make_pair(key, AiSpeedProfile())).first;
+			profile->second.SetParams(params);
+			aicar->BuildSpeedProfile(roads, profile->second);
+		}
+		aicar->SetSpeedProfile(&profile->second);
+	}
 }
 
 void Ai::remove_car(Car * car)
@@ -80,17 +123,50 @@ void Ai::clear_cars()
 		delete AI_Cars[i];
 	}
 	AI_Cars.clear();
+	speed_profiles.clear();
+}
+
+void Ai::update(float dt, const std::list <Car> & othercars, float track_length)
+{
+	car_index.Update(othercars, track_length);
+	update(dt, car_index);
 }
 
-void Ai::update(float dt, const std::list <Car> & othercars)
+void Ai::update(float dt, const AiCarIndex & index)
 {
+	if (multithreaded && AI_Cars.size() > 1)
+	{
+		update_parallel(dt, index);
+		return;
+	}
+
 	int size = AI_Cars.size();
 	for (int i = 0; i < size; i++)
 	{
-		AI_Cars[i]->Update(dt, othercars);
+		AI_Cars[i]->Update(dt, index);
 	}
 }
 
+void Ai::update_parallel(float dt, const AiCarIndex & snapshot)
+{
+	AiCar ** cars = &AI_Cars[0];
+	const AiCarIndex * index = &snapshot;
+	QMP_SHARE(cars);
+	QMP_SHARE(index);
+	QMP_SHARE(dt);
+	QMP_PARALLEL_FOR(i, 0, AI_Cars.size())
+		QMP_USE_SHARED(cars, AiCar **);
+		QMP_USE_SHARED(index, const AiCarIndex *);
+		QMP_USE_SHARED(dt, float);
+		cars[i]->Update(dt, *index);
+	QMP_END_PARALLEL_FOR;
+}
+
+void Ai::SetMultithreaded(bool value)
+{
+	multithreaded = value;
+}
+
 const std::vector <float> & Ai::GetInputs(Car * car) const
 {
 	int size = AI_Cars.size();
@@ -132,3 +208,138 @@ void Ai::Visualize()
 #endif
 }
 
+/// creates AI cars with fixed car parameters, the cars are only used as keys
+template <class T>
+class AiCarTestFactory : public AiFactory
+{
+public:
+	AiCar * create(Car * car, float difficulty)
+	{
+		AiCarParams params;
+		params.inv_mass = 1 / 1200.0;
+		params.drag = 0.4;
+		params.lift = -1.2;
+		params.max_fx = 1.2 * 1200 * 9.81;
+		params.max_fy = 1.1 * 1200 * 9.81;
+		params.stall_rpm = 900;
+		params.optimum_steering_angle = 12;
+		params.max_steering_angle = 30;
+		return new T(car, difficulty, params);
+	}
+};
+
+/// a circuit of patches around a circle
+static void CreateTestRoad(std::list <RoadStrip> & roads, float & track_length)
+{
+	const int num_patches = 48;
+	const float radius = 120;
+	const float width = 12;
+	roads.push_back(RoadStrip());
+	std::vector <RoadPatch> & patches = roads.back().GetPatches();
+	patches.resize(num_patches);
+	for (int i = 0; i < num_patches; ++i)
+	{
+		// wobble the radius to get corners of different speed
+		float a0 = 2 * M_PI * i / num_patches;
+		float a1 = 2 * M_PI * (i + 1) / num_patches;
+		float r0 = radius + 10 * std::sin(3 * a0);
+		float r1 = radius + 10 * std::sin(3 * a1);
+		Vec3 d0(std::cos(a0), std::sin(a0), 0);
+		Vec3 d1(std::cos(a1), std::sin(a1), 0);
+		patches[i].GetPatch().SetFromCorners(
+			d1 * (r1 - width / 2), d1 * (r1 + width / 2),
+			d0 * (r0 - width / 2), d0 * (r0 + width / 2));
+		patches[i].SetRacingLine(d0 * (r0 + width * 0.3f * std::sin(5 * a0)));
+	}
+	track_length = 0;
+	for (int i = 0; i < num_patches; ++i)
+	{
+		Bezier & patch = patches[i].GetPatch();
+		Bezier & next = patches[(i + 1) % num_patches].GetPatch();
+		patch.Attach(next);
+		track_length += (next.GetPoint(3,0) + next.GetPoint(3,3) - patch.GetPoint(3,0) - patch.GetPoint(3,3)).Magnitude() * 0.5;
+	}
+}
+
+static std::vector <std::vector <float> > RunAiTest(bool multithreaded)
+{
+	std::list <RoadStrip> roads;
+	float track_length;
+	CreateTestRoad(roads, track_length);
+	const std::vector <RoadPatch> & patches = roads.back().GetPatches();
+
+	Ai ai;
+	ai.AddFactory("teststd", new AiCarTestFactory <AiCarStandard> ());
+	ai.AddFactory("testexp", new AiCarTestFactory <AiCarExperimental> ());
+	ai.SetMultithreaded(multithreaded);
+
+	// packs of cars close enough to see each other, one experimental car off the road
+	const int num_cars = 16;
+	std::list <Car> cars(num_cars);
+	std::vector <AiCarIndex::Entry> entries;
+	int n = 0;
+	for (std::list <Car>::iterator i = cars.begin(); i != cars.end(); ++i, ++n)
+	{
+		ai.add_car(&*i, 0.8f + 0.01f * n, roads, (n % 4 == 3) ? "testexp" : "teststd");
+
+		const Bezier & patch = patches[(n / 3) * 5 + n % 3].GetPatch();
+		Vec3 back = (patch.GetPoint(3,0) + patch.GetPoint(3,3)) * 0.5;
+		Vec3 front = (patch.GetPoint(0,0) + patch.GetPoint(0,3)) * 0.5;
+		Vec3 side = (patch.GetPoint(3,3) - patch.GetPoint(3,0)) * 0.5;
+		Vec3 forward = (front - back).Normalize();
+
+		AiCarIndex::Entry entry;
+		entry.car = &*i;
+		entry.patch = (n == 7) ? NULL : &patch;
+		entry.distance = patch.GetDistFromStart();
+		entry.position = back + side * (0.3f * (n % 3 - 1)) + Vec3(0, 0, 0.5);
+		entry.velocity = forward * (15.0f + 3 * n);
+		entry.orientation.Rotate(std::atan2(-forward[0], forward[1]) + 0.05f * (n % 5 - 2), 0, 0, 1);
+		entry.engine_rpm = (n == 5) ? 0 : 3000 + 200 * n;
+		entry.gear = (n == 2) ? 0 : 1 + n % 4;
+		entries.push_back(entry);
+	}
+
+	AiCarIndex index;
+	std::vector <std::vector <float> > inputs;
+	for (int step = 0; step < 20; ++step)
+	{
+		// advance the snapshot without physics, the cars follow their velocity
+		for (unsigned int i = 0; i < entries.size(); ++i)
+		{
+			entries[i].position = entries[i].position + entries[i].velocity * 0.01f;
+		}
+		index.Update(entries, track_length);
+		ai.update(0.01f, index);
+
+		for (std::list <Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+		{
+			inputs.push_back(ai.GetInputs(&*i));
+		}
+	}
+	return inputs;
+}
+
+QT_TEST(ai_test)
+{
+	unsigned int threads = QMP_GET_MAX_THREADS();
+	QMP_SET_NUM_THREADS(4);
+	std::vector <std::vector <float> > serial = RunAiTest(false);
+	std::vector <std::vector <float> > parallel = RunAiTest(true);
+	if (threads != 4)
+		QMP_SET_NUM_THREADS(threads);
+
+	QT_CHECK_EQUAL(serial.size(), parallel.size());
+	for (unsigned int i = 0; i < serial.size() && i < parallel.size(); ++i)
+	{
+		QT_CHECK(serial[i] == parallel[i]);
+	}
+
+	// the cars actually drive
+	bool driving = false;
+	for (unsigned int i = 0; i < serial.size(); ++i)
+	{
+		driving = driving || serial[i][CarInput::THROTTLE] > 0 || serial[i][CarInput::STEER_RIGHT] != 0;
+	}
+	QT_CHECK(driving);
+}
@@ -21,11 +21,14 @@
 #define _AI_H
 
 #include "ai_car.h"
+#include "ai_car_index.h"
 #include <string>
 #include <vector>
+#include <list>
 #include <map>
 
 class AiFactory;
+class RoadStrip;
 
 /// Manages all Ai cars.
 class Ai
@@ -34,15 +37,29 @@ private:
 	std::vector <AiCar*> AI_Cars;
 	std::map <std::string, AiFactory*> AI_Factories;
 	std::vector <float> empty_input;
+	AiCarIndex car_index;
+	bool multithreaded;
+
+	/// speed profiles of the track, shared by the cars of equal type and profile parameters
+	typedef std::pair <std::string, AiSpeedProfile::Params> SpeedProfileKey;
+	std::map <SpeedProfileKey, AiSpeedProfile> speed_profiles;
+
+	/// update the cars on the quickmp thread pool
+	void update_parallel(float dt, const AiCarIndex & index);
 
 public:
 	Ai();
 	~Ai();
 
-	void add_car(Car * car, float difficulty, const std::string & type = default_type);
+	/// the speed profile of the car is computed from the track roads here if no other car shares it
+	void add_car(Car * car, float difficulty, const std::list <RoadStrip> & roads, const std::string & type = default_type);
 	void remove_car(Car * car);
-	void clear_cars();
-	void update(float dt, const std::list <Car> & othercars);
+	void clear_cars(); ///< also drops the speed profiles of the track
+	/// track_length is the lap length of a circuit, zero for open roads
+	void update(float dt, const std::list <Car> & othercars, float track_length);
+	/// update the cars from a prepared index snapshot
+	void update(float dt, const AiCarIndex & index);
+	void SetMultithreaded(bool value); ///< the cars only read each other through the index snapshot, so results don't depend on the thread count
 	const std::vector <float>& GetInputs(Car * car) const; ///< Returns an empty vector if the car isn't AI-controlled.
 
 	void AddFactory(const std::string& type_name, AiFactory* factory);
@@ -21,11 +21,30 @@
 #define _AI_CAR_H
 
 #include "physics/carinput.h"
+#include "ai_speed_profile.h"
 
 #include <vector>
 #include <list>
 
 class Car;
+class AiCarIndex;
+class RoadStrip;
+
+/// Car constants the AI plans with, read once when the AI takes over the car.
+struct AiCarParams
+{
+	AiCarParams();
+	explicit AiCarParams(const Car & car);
+
+	float inv_mass;
+	float drag; ///< aerodynamic drag coefficient
+	float lift; ///< aerodynamic lift coefficient, negative for downforce
+	float max_fx; ///< sum of the peak longitudinal tire forces
+	float max_fy; ///< sum of the peak lateral tire forces
+	float stall_rpm;
+	float optimum_steering_angle;
+	float max_steering_angle;
+};
 
 /// AI Car controller interface.
 class AiCar
@@ -38,9 +57,12 @@ protected:
 	/// The vector is indexed by CARINPUT values.
 	std::vector <float> inputs;
 
+	/// Speed limits of the track roads, owned by the Ai manager.
+	const AiSpeedProfile * speed_profile;
+
 public:
 	AiCar(Car* _car, float _difficulty) :
-		car(_car), difficulty(_difficulty), inputs(CarInput::INVALID, 0.0)
+		car(_car), difficulty(_difficulty), inputs(CarInput::INVALID, 0.0), speed_profile(NULL)
 	{ }
 	virtual ~AiCar(){}
 
@@ -48,7 +70,16 @@ public:
 	float						GetDifficulty() { return difficulty; }
 	const std::vector<float>&	GetInputs() { return inputs; }
 
-	virtual void Update(float dt, const std::list<Car>& othercars) = 0;
+	virtual void Update(float dt, const AiCarIndex& othercars) = 0;
+
+	/// Return false if the car doesn't drive by a speed profile.
+	/// Cars of the same type with equal parameters share a profile.
+	virtual bool GetSpeedProfileParams(AiSpeedProfile::Params & /*params*/) const { return false; }
+
+	/// Add the roads to the profile, called once per track and profile parameters.
+	virtual void BuildSpeedProfile(const std::list <RoadStrip> & /*roads*/, AiSpeedProfile & /*profile*/) const { }
+
+	void SetSpeedProfile(const AiSpeedProfile * profile) { speed_profile = profile; }
 
 	/// This is optional for drawing debug stuff.
 	/// It will only be called, when VISUALIZE_AI_DEBUG macro is defined.
@@ -20,6 +20,7 @@
 #include "ai_car_experimental.h"
 #include "car.h"
 #include "bezier.h"
+#include "roadstrip.h"
 #include "track.h"
 #include "physics/carinput.h"
 #include "mathvector.h"
@@ -33,21 +34,23 @@
 #include <cmath>
 #include <ctime>
 #include <algorithm>
+#include <set>
 #include <iostream>
 
 AiCar* AiCarExperimentalFactory::create(Car * car, float difficulty){
-	return new AiCarExperimental(car, difficulty);
+	assert(car->GetTCSEnabled());
+	assert(car->GetABSEnabled());
+	car->SetAutoShift(true);
+	car->SetAutoClutch(true);
+	return new AiCarExperimental(car, difficulty, AiCarParams(*car));
 }
 
-AiCarExperimental::AiCarExperimental (Car * new_car, float newdifficulty) :
-	AiCar(new_car, newdifficulty), shift_time(0.0), longitude_mu(0.9),
+AiCarExperimental::AiCarExperimental (Car * new_car, float newdifficulty, const AiCarParams & new_params) :
+	AiCar(new_car, newdifficulty), params(new_params), shift_time(0.0), longitude_mu(0.9),
 	lateral_mu(0.9), last_patch(NULL), use_racingline(true),
 	isRecovering(false)
 {
-	assert(car->GetTCSEnabled());
-	assert(car->GetABSEnabled());
-	car->SetAutoShift(true);
-	car->SetAutoClutch(true);
+	calcMu();
 }
 AiCarExperimental::~AiCarExperimental ()
 {
@@ -111,15 +114,18 @@ float AiCarExperimental::RateLimit(float old_value, float new_value, float rate_
 		return new_value;
 }
 
-void AiCarExperimental::Update(float dt, const std::list <Car> & checkcars)
+void AiCarExperimental::Update(float dt, const AiCarIndex & checkcars)
 {
 	float lastThrottle = inputs[CarInput::THROTTLE];
 	float lastBreak = inputs[CarInput::BRAKE];
 	fill(inputs.begin(), inputs.end(), 0);
 
+	const AiCarIndex::Entry * mycar = checkcars.GetEntry(car);
+	if (!mycar) return;
+
 	analyzeOthers(dt, checkcars);
-	updateGasBrake();
-	updateSteer();
+	updateGasBrake(*mycar);
+	updateSteer(*mycar);
 	float rateLimit = THROTTLE_RATE_LIMIT * dt;
 	inputs[CarInput::THROTTLE] = RateLimit(lastThrottle, inputs[CarInput::THROTTLE],
 		rateLimit, rateLimit);
@@ -128,18 +134,6 @@ void AiCarExperimental::Update(float dt, const std::list <Car> & checkcars)
 		rateLimit, rateLimit);
 }
 
-const Bezier * AiCarExperimental::GetCurrentPatch(const Car *c)
-{
-	const Bezier *curr_patch = c->GetCurPatch(WheelPosition(0));
-	if (!curr_patch)
-	{
-		curr_patch = c->GetCurPatch(WheelPosition(1)); //let's try the other wheel
-		if (!curr_patch) return NULL;
-	}
-
-	return curr_patch;
-}
-
 Vec3 AiCarExperimental::GetPatchFrontCenter(const Bezier & patch)
 {
 	return (patch.GetPoint(0,0) + patch.GetPoint(0,3)) * 0.5;
@@ -229,7 +223,7 @@ void AiCarExperimental::TrimPatch(Bezier & patch, float trimleft_front, float tr
 	patch.SetFromCorners(newfl, newfr, newbl, newbr);
 }
 
-Bezier AiCarExperimental::RevisePatch(const Bezier * origpatch, bool use_racingline)
+Bezier AiCarExperimental::RevisePatch(const Bezier * origpatch, bool use_racingline) const
 {
 	Bezier patch = *origpatch;
 
@@ -300,7 +294,66 @@ Bezier AiCarExperimental::RevisePatch(const Bezier * origpatch, bool use_racingl
 	return patch;
 }
 
-void AiCarExperimental::updateGasBrake()
+void AiCarExperimental::AddRoadProfile(const Bezier * patch, AiSpeedProfile & profile) const
+{
+	//walk the road until it ends, joins a profiled road or loops back
+	std::vector <const Bezier *> road;
+	std::set <const Bezier *> visited;
+	const Bezier * next = patch;
+	while (next && !profile.Get(next) && visited.insert(next).second)
+	{
+		road.push_back(next);
+		next = next->GetNextPatch();
+	}
+
+	std::vector <AiSpeedProfile::Patch> patches(road.size());
+	Bezier curr_patch = RevisePatch(road[0], use_racingline);
+	for (unsigned int i = 0; i < road.size(); ++i)
+	{
+		Vec3 patch_direction = GetPatchDirection(curr_patch);
+		patches[i].length = patch_direction.Magnitude();
+		patches[i].direction = patch_direction.Normalize();
+
+		float width = GetPatchWidthVector(*road[i]).Magnitude();
+		if (!curr_patch.GetNextPatch())
+		{
+			patches[i].speed_limit = calcSpeedLimit(&curr_patch, NULL, lateral_mu, width);
+		}
+		else
+		{
+			Bezier next_patch = RevisePatch(curr_patch.GetNextPatch(), use_racingline);
+			patches[i].speed_limit = calcSpeedLimit(&curr_patch, &next_patch, lateral_mu, width);
+			curr_patch = next_patch;
+		}
+	}
+
+	profile.AddRoad(road, patches, next);
+}
+
+bool AiCarExperimental::GetSpeedProfileParams(AiSpeedProfile::Params & profile_params) const
+{
+	profile_params.friction = lateral_mu;
+	profile_params.lift = params.lift * params.inv_mass;
+	profile_params.brake_accel = longitude_mu * GRAVITY;
+	profile_params.brake_drag = 0.0;
+	profile_params.brake_scale = 1.4;
+	return true;
+}
+
+void AiCarExperimental::BuildSpeedProfile(const std::list <RoadStrip> & roads, AiSpeedProfile & profile) const
+{
+	for (std::list <RoadStrip>::const_iterator road = roads.begin(); road != roads.end(); ++road)
+	{
+		const std::vector <RoadPatch> & patches = road->GetPatches();
+		for (unsigned int i = 0; i < patches.size(); ++i)
+		{
+			if (!profile.Get(&patches[i].GetPatch()))
+				AddRoadProfile(&patches[i].GetPatch(), profile);
+		}
+	}
+}
+
+void AiCarExperimental::updateGasBrake(const AiCarIndex::Entry & mycar)
 {
 #ifdef VISUALIZE_AI_DEBUG
 	brakelook.clear();
@@ -311,46 +364,33 @@ void AiCarExperimental::updateGasBrake()
 	float gas_value = 0.5;
 	const float speed_percent = 1.0;
 
-	if (car->GetEngineRPM() < car->GetEngineStallRPM())
+	if (mycar.engine_rpm < params.stall_rpm)
 		inputs[CarInput::START_ENGINE] = 1.0;
 	else
 		inputs[CarInput::START_ENGINE] = 0.0;
 
-	calcMu();
+	const Bezier *curr_patch_ptr = mycar.patch;
+	const AiSpeedProfile::Patch * curr_profile = NULL;
+	if (curr_patch_ptr && speed_profile)
+		curr_profile = speed_profile->Get(curr_patch_ptr);
 
-	const Bezier *curr_patch_ptr = GetCurrentPatch(car);
 	//if car is not on track, just let it roll
-    if (!curr_patch_ptr)
+	if (!curr_profile)
 	{
 		inputs[CarInput::THROTTLE] = 0.8;
 		inputs[CarInput::BRAKE] = 0.0;
 		return;
 	}
 
-	Bezier curr_patch = RevisePatch(curr_patch_ptr, use_racingline);
-	//Bezier curr_patch = *curr_patch_ptr;
-
-	Vec3 patch_direction = GetPatchDirection(curr_patch);
-
 	//this version uses the velocity along tangent vector. it should calculate a lower current speed,
 	//hence higher gas value or lower brake value
 	//float currentspeed = car->chassis().cm_velocity().component(direction_vector);
-	float currentspeed = car->GetVelocity().dot(patch_direction.Normalize());
+	float currentspeed = mycar.velocity.dot(curr_profile->direction);
 	//this version just uses the velocity, do not care about the direction
 	//float currentspeed = car->chassis().cm_velocity().magnitude();
 
 	//check speed against speed limit of current patch
-	float speed_limit = 0;
-	if (!curr_patch.GetNextPatch())
-	{
-		speed_limit = calcSpeedLimit(&curr_patch, NULL, lateral_mu, GetPatchWidthVector(*curr_patch_ptr).Magnitude())*speed_percent;
-	}
-	else
-	{
-		Bezier next_patch = RevisePatch(curr_patch.GetNextPatch(), use_racingline);
-		speed_limit = calcSpeedLimit(&curr_patch, &next_patch, lateral_mu, GetPatchWidthVector(*curr_patch_ptr).Magnitude())*speed_percent;
-	}
-
+	float speed_limit = curr_profile->speed_limit * speed_percent;
 	speed_limit *= difficulty;
 
 	float speed_diff = speed_limit - currentspeed;
@@ -379,64 +419,27 @@ void AiCarExperimental::updateGasBrake()
 		brake_value = 0.0;
 	}
 
-	//check upto maxlookahead distance
-	float maxlookahead = calcBrakeDist(currentspeed, 0.0, longitude_mu)+10;
-	//maxlookahead = 0.1;
-	float dist_checked = 0.0;
-	float brake_dist = 0.0;
-	Bezier patch_to_check = curr_patch;
-
-#ifdef VISUALIZE_AI_DEBUG
-	brakelook.push_back(patch_to_check);
-#endif
-
-	while (dist_checked < maxlookahead)
+	//brake if we are too fast to slow down for the patches ahead
+	if (currentspeed > curr_profile->brake_speed)
 	{
-		Bezier * unmodified_patch_to_check = patch_to_check.GetNextPatch();
-
-		//if there is no next patch(probably a non-closed track, just let it roll
-		if (!patch_to_check.GetNextPatch())
-		{
-			brake_value = 0.0;
-			dist_checked = maxlookahead;
-			break;
-		}
-		else
-			patch_to_check = RevisePatch(patch_to_check.GetNextPatch(), use_racingline);
+		brake_value = 1.0;
+		gas_value = 0.0;
+	}
 
 #ifdef VISUALIZE_AI_DEBUG
-		brakelook.push_back(patch_to_check);
-#endif
-
-		//speed_limit = calcSpeedLimit(c, &patch_to_check, lateral_mu)*speed_percent;
-		if (!patch_to_check.GetNextPatch())
-		{
-			speed_limit = calcSpeedLimit(&patch_to_check, NULL, lateral_mu, GetPatchWidthVector(*unmodified_patch_to_check).Magnitude())*speed_percent;
-		}
-		else
-		{
-			Bezier next_patch = RevisePatch(patch_to_check.GetNextPatch(), use_racingline);
-			speed_limit = calcSpeedLimit(&patch_to_check, &next_patch, lateral_mu, GetPatchWidthVector(*unmodified_patch_to_check).Magnitude())*speed_percent;
-		}
-
-		dist_checked += GetPatchDirection(patch_to_check).Magnitude();
-		brake_dist = calcBrakeDist(currentspeed, speed_limit, longitude_mu) * 1.4;
-
-		//if (brake_dist + CORNER_BRAKE_OFFSET > dist_checked)
-		if (brake_dist > dist_checked)
-		{
-			//std::cout << "brake: limit " << speed_limit << ", cur " << currentspeed << ", brake " << brake_dist << ", dist " << dist_checked << std::endl;
-
-			/*brake_value = (brake_dist + CORNER_BRAKE_OFFSET - dist_checked)*CORNER_BRAKE_GAIN;
-			if (brake_value > 1.0) brake_value = 1.0;*/
-			brake_value = 1.0;
-			gas_value = 0.0;
-			break;
-		}
+	float maxlookahead = calcBrakeDist(currentspeed, 0.0, longitude_mu)+10;
+	float dist_checked = 0.0;
+	for (const Bezier * patch_to_check = curr_patch_ptr; patch_to_check && dist_checked < maxlookahead; patch_to_check = patch_to_check->GetNextPatch())
+	{
+		const AiSpeedProfile::Patch * profile_to_check = speed_profile->Get(patch_to_check);
+		if (!profile_to_check) break;
+		brakelook.push_back(RevisePatch(patch_to_check, use_racingline));
+		dist_checked += profile_to_check->length;
 	}
+#endif
 
-	std::cout << speed_limit << std::endl;
-	if (car->GetGear() == 0)
+	//std::cout << speed_limit << std::endl;
+	if (mycar.gear == 0)
 	{
 		inputs[CarInput::SHIFT_UP] = 1.0;
 		gas_value = 0.2;
@@ -459,23 +462,13 @@ void AiCarExperimental::updateGasBrake()
 
 void AiCarExperimental::calcMu()
 {
-	int i;
-	float long_friction = 0.0;
-	float lat_friction = 0.0;
-
-	for (i=0; i<4; i++)
-	{
-		long_friction += car->GetTireMaxFx(WheelPosition(i));
-		lat_friction += car->GetTireMaxFy(WheelPosition(i));
-	}
-
-	float long_mu = FRICTION_FACTOR_LONG * long_friction * car->GetInvMass() / GRAVITY;
-	float lat_mu = FRICTION_FACTOR_LAT * lat_friction * car->GetInvMass() / GRAVITY;
+	float long_mu = FRICTION_FACTOR_LONG * params.max_fx * params.inv_mass / GRAVITY;
+	float lat_mu = FRICTION_FACTOR_LAT * params.max_fy * params.inv_mass / GRAVITY;
 	if (!isnan(long_mu)) longitude_mu = long_mu;
 	if (!isnan(lat_mu)) lateral_mu = lat_mu;
 }
 
-float AiCarExperimental::calcSpeedLimit(const Bezier* patch, const Bezier * nextpatch, float friction, float extraradius=0)
+float AiCarExperimental::calcSpeedLimit(const Bezier* patch, const Bezier * nextpatch, float friction, float extraradius=0) const
 {
 	assert(patch);
 
@@ -496,7 +489,7 @@ float AiCarExperimental::calcSpeedLimit(const Bezier* patch, const Bezier * next
 	//float v1 = sqrt(friction * GRAVITY * adjusted_radius);
 
 	//take into account downforce
-	double denom = (1.0 - std::min(1.01, adjusted_radius * -(car->GetAerodynamicDownforceCoefficient()) * friction * car->GetInvMass()));
+	double denom = (1.0 - std::min(1.01, adjusted_radius * -params.lift * friction * params.inv_mass));
 	double real = (friction * GRAVITY * adjusted_radius) / denom;
 	double v2 = 1000.0; //some really big number
 	if (real > 0)
@@ -507,7 +500,7 @@ float AiCarExperimental::calcSpeedLimit(const Bezier* patch, const Bezier * next
 	return v2;
 }
 
-float AiCarExperimental::calcBrakeDist(float current_speed, float allowed_speed, float friction)
+float AiCarExperimental::calcBrakeDist(float current_speed, float allowed_speed, float friction) const
 {
 	// Old way, which returns very big breaking distances:
 	// float c = friction * GRAVITY;
@@ -528,10 +521,10 @@ float AiCarExperimental::calcBrakeDist(float current_speed, float allowed_speed,
 		return 0;
 	}
 }
-float AiCarExperimental::RayCastDistance( Vec3 direction, float max_length){
-	btVector3 pos = car->GetCarDynamics().GetPosition();
-	btVector3 dir = car->GetCarDynamics().LocalToWorld(ToBulletVector(direction));
-	dir -= pos;
+float AiCarExperimental::RayCastDistance(const AiCarIndex::Entry & mycar, Vec3 direction, float max_length){
+	btVector3 pos = ToBulletVector(mycar.position);
+	mycar.orientation.RotateVector(direction);
+	btVector3 dir = ToBulletVector(direction);
 	CollisionContact contact;
 	car->GetDynamicsWorld()->castRay(
 		pos,
@@ -551,34 +544,15 @@ float AiCarExperimental::RayCastDistance( Vec3 direction, float max_length){
 	return dist;
 }
 
-const Bezier* AiCarExperimental::getNearestPatch(const Bezier* helper)
+const Bezier* AiCarExperimental::getNearestPatch(const AiCarIndex::Entry & mycar)
 {
-	// At the moment this is very slow!
-	// TODO: Implement backward chaining for BEZIER, to just look around the helper if passed.
-	const Bezier* b;
-	const Bezier* b_end;
-	b_end = car->GetDynamicsWorld()->GetSectorPatch(0);
-	b = b_end->GetNextPatch();
-	const Bezier* b_nearest = 0;
-	float v_nearDist = 1000000.0f;
-	Vec3 c = car->GetPosition();
-	while(b != 0 && b != b_end)
-	{
-		Vec3 v(b->GetPoint(2,2));
-		v[0] -= c[1];
-		v[2] -= c[0];
-		float dist = v[0]*v[0]+v[2]*v[2];
-		if(dist < v_nearDist){
-			v_nearDist = dist;
-			b_nearest = b;
-
-		}
-		b = b->GetNextPatch();
-	}
+	// At the moment this is very slow, all road patches are checked!
+	assert(speed_profile);
+	const Bezier* b_nearest = speed_profile->GetNearest(mycar.position);
 	assert(b_nearest);
 	return b_nearest;
 }
-bool AiCarExperimental::recover(const Bezier* patch)
+bool AiCarExperimental::recover(const AiCarIndex::Entry & mycar)
 {
 	// Recover mode will basically detect walls on the front
 	// of the car, then go reverse if needed for 3 secs,
@@ -587,12 +561,12 @@ bool AiCarExperimental::recover(const Bezier* patch)
 	const float maxRayDistant = 3;
 
 
-	if(car->GetSpeed() < 1)
+	if(mycar.velocity.Magnitude() < 1)
 	{
 		//If the car is not moving, there may be a wall in the front.
 
 		//Cast ray towards front-middle
-		float dist = RayCastDistance(Vec3(0, 1, 0), maxRayDistant);
+		float dist = RayCastDistance(mycar, Vec3(0, 1, 0), maxRayDistant);
 
 		if(dist < maxRayDistant * 0.99)
 		{
@@ -627,25 +601,25 @@ bool AiCarExperimental::recover(const Bezier* patch)
 	// If car is still driving and it is not in recover mode, just do the usual stuff.
 	return false;
 }
-void AiCarExperimental::updateSteer()
+void AiCarExperimental::updateSteer(const AiCarIndex::Entry & mycar)
 {
 #ifdef VISUALIZE_AI_DEBUG
 	steerlook.clear();
 #endif
 
-	const Bezier *curr_patch_ptr = GetCurrentPatch(car);
+	const Bezier *curr_patch_ptr = mycar.patch;
 
 	//if car has no contact with track, just let it roll
 	if (!curr_patch_ptr || isRecovering)
 	{
-		last_patch = getNearestPatch(last_patch);
+		last_patch = getNearestPatch(mycar);
 
 		//if car is off track, steer the car towards the last patch it was on
 		//this should get the car back on track
 		curr_patch_ptr = last_patch;
 
 		//recover to the road.
-		if(recover(curr_patch_ptr)){
+		if(recover(mycar)){
 			return;
 		}
 	}
@@ -666,7 +640,7 @@ void AiCarExperimental::updateSteer()
 	//find the point to steer towards
 	float track_width = GetPatchWidthVector(curr_patch).Magnitude();
 	float lookahead = track_width * LOOKAHEAD_FACTOR1 +
-			car->GetVelocity().Magnitude() * LOOKAHEAD_FACTOR2;
+			mycar.velocity.Magnitude() * LOOKAHEAD_FACTOR2;
 	lookahead = 1.0;
 	float length = 0.0;
 	Vec3 dest_point = GetPatchFrontCenter(next_patch);
@@ -697,9 +671,9 @@ void AiCarExperimental::updateSteer()
 		}
 	}
 
-	Vec3 car_position = car->GetCenterOfMassPosition();
+	Vec3 car_position = mycar.position;
 	Vec3 car_orientation = Direction::Forward;
-	(car->GetOrientation()).RotateVector(car_orientation);
+	mycar.orientation.RotateVector(car_orientation);
 
 	Vec3 desire_orientation = dest_point - car_position;
 
@@ -720,7 +694,7 @@ void AiCarExperimental::updateSteer()
 	//calculate steering angle and direction
 	double angle = beta - alpha;
 
-	//angle += steerAwayFromOthers(c, dt, othercars, angle); //sum in traffic avoidance bias
+	//angle += steerAwayFromOthers(mycar); //sum in traffic avoidance bias
 
 	if (angle > -360.0 && angle <= -180.0)
 		angle = -(360.0 + angle);
@@ -731,10 +705,10 @@ void AiCarExperimental::updateSteer()
 	else if (angle > 180.0 && angle <= 360.0)
 		angle = 360.0 - angle;
 
-	float optimum_range = car->GetOptimumSteeringAngle();
+	float optimum_range = params.optimum_steering_angle;
 	angle = clamp(angle, -optimum_range, optimum_range);
 
-	float steer_value = angle / car->GetMaxSteeringAngle();
+	float steer_value = angle / params.max_steering_angle;
 	if (steer_value > 1.0) steer_value = 1.0;
 	else if (steer_value < -1.0) steer_value = -1.0;
 
@@ -814,10 +788,12 @@ float AiCarExperimental::brakeFromOthers(float speed_diff)
 	return bias;
 }
 
-void AiCarExperimental::analyzeOthers(float dt, const std::list <Car> & checkcars)
+void AiCarExperimental::analyzeOthers(float dt, const AiCarIndex & checkcars)
 {
 	//const float speed = std::max(1.0f,car->GetVelocity().Magnitude());
 	const float half_carlength = 1.25; //in meters
+	const float lookahead_time = 10.0; //only pay attention to cars we reach within this time in seconds
+	const float lookahead_min = 50.0; //in meters
 
 	//std::cout << speed << ": " << authority << std::endl;
 
@@ -828,98 +804,112 @@ void AiCarExperimental::analyzeOthers(float dt, const std::list <Car> & checkcar
 	//avoidancedraw->ClearLine();
 #endif
 
-	for (std::list <Car>::const_iterator i = checkcars.begin(); i != checkcars.end(); ++i)
+	neighbors.clear();
+	const AiCarIndex::Entry * mycar = checkcars.GetEntry(car);
+	if (mycar)
 	{
-		if (&(*i) != car)
-		{
-			OtherCarInfo & info = othercars[&(*i)];
-
-			//find direction of other cars in our frame
-			Vec3 relative_position = i->GetCenterOfMassPosition() - car->GetCenterOfMassPosition();
-			(-car->GetOrientation()).RotateVector(relative_position);
-
-			//std::cout << relative_position.dot(throttle_axis) << ", " << relative_position.dot(steer_right_axis) << std::endl;
+		const float lookahead = std::max(lookahead_min, mycar->velocity.Magnitude() * lookahead_time);
+		checkcars.GetNeighbors(car, half_carlength, lookahead, neighbors);
+	}
 
-			//only make a move if the other car is within our distance limit
-			float fore_position = relative_position.dot(throttle_axis);
-			//float speed_diff = i->GetVelocity().dot(throttle_axis) - car->GetVelocity().dot(throttle_axis); //positive if other car is faster
+	//cars outside of the window are dropped, their info starts over when they come back
+	std::map <const Car *, OtherCarInfo> infos;
+	for (std::vector <const AiCarIndex::Entry *>::const_iterator n = neighbors.begin(); n != neighbors.end(); ++n)
+	{
+		const AiCarIndex::Entry & other = **n;
+		const Car * othercar = other.car;
+		OtherCarInfo & info = infos[othercar];
+		std::map <const Car *, OtherCarInfo>::const_iterator last = othercars.find(othercar);
+		if (last != othercars.end())
+			info = last->second;
+
+		//find direction of other cars in our frame
+		Vec3 relative_position = other.position - mycar->position;
+		(-mycar->orientation).RotateVector(relative_position);
+
+		//std::cout << relative_position.dot(throttle_axis) << ", " << relative_position.dot(steer_right_axis) << std::endl;
+
+		//only make a move if the other car is within our distance limit
+		float fore_position = relative_position.dot(throttle_axis);
+		//float speed_diff = othercar->GetVelocity().dot(throttle_axis) - car->GetVelocity().dot(throttle_axis); //positive if other car is faster
+
+		Vec3 myvel = mycar->velocity;
+		Vec3 othervel = other.velocity;
+		(-mycar->orientation).RotateVector(myvel);
+		(-other.orientation).RotateVector(othervel);
+		float speed_diff = othervel.dot(throttle_axis) - myvel.dot(throttle_axis); //positive if other car is faster
+
+		//std::cout << speed_diff << std::endl;
+		//float distancelimit = clamp(distancelimitcoeff*-speed_diff, distancelimitmin, distancelimitmax);
+		const float fore_position_offset = -half_carlength;
+		if (fore_position > fore_position_offset)// && fore_position < distancelimit) //only pay attention to cars roughly in front of us
+		{
+			//float horizontal_distance = relative_position.dot(steer_right_axis); //fallback method if not on a patch
+			//float orig_horiz = horizontal_distance;
 
-			Vec3 myvel = car->GetVelocity();
-			Vec3 othervel = i->GetVelocity();
-			(-car->GetOrientation()).RotateVector(myvel);
-			(-i->GetOrientation()).RotateVector(othervel);
-			float speed_diff = othervel.dot(throttle_axis) - myvel.dot(throttle_axis); //positive if other car is faster
+			const Bezier * othercarpatch = other.patch;
+			const Bezier * mycarpatch = mycar->patch;
 
-			//std::cout << speed_diff << std::endl;
-			//float distancelimit = clamp(distancelimitcoeff*-speed_diff, distancelimitmin, distancelimitmax);
-			const float fore_position_offset = -half_carlength;
-			if (fore_position > fore_position_offset)// && fore_position < distancelimit) //only pay attention to cars roughly in front of us
+			if (othercarpatch && mycarpatch)
 			{
-				//float horizontal_distance = relative_position.dot(steer_right_axis); //fallback method if not on a patch
-				//float orig_horiz = horizontal_distance;
-
-				const Bezier * othercarpatch = GetCurrentPatch(&(*i));
-				const Bezier * mycarpatch = GetCurrentPatch(car);
-
-				if (othercarpatch && mycarpatch)
-				{
-					float my_track_placement = GetHorizontalDistanceAlongPatch(*mycarpatch, car->GetCenterOfMassPosition());
-					float their_track_placement = GetHorizontalDistanceAlongPatch(*othercarpatch, i->GetCenterOfMassPosition());
+				float my_track_placement = GetHorizontalDistanceAlongPatch(*mycarpatch, mycar->position);
+				float their_track_placement = GetHorizontalDistanceAlongPatch(*othercarpatch, other.position);
 
-					float speed_diff_denom = clamp(speed_diff, -100, -0.01);
-					float eta = (fore_position-fore_position_offset)/-speed_diff_denom;
+				float speed_diff_denom = clamp(speed_diff, -100, -0.01);
+				float eta = (fore_position-fore_position_offset)/-speed_diff_denom;
 
-					info.fore_distance = fore_position;
+				info.fore_distance = fore_position;
 
-					if (!info.active)
-						info.eta = eta;
-					else
-						info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
-
-					float horizontal_distance = their_track_placement - my_track_placement;
-					//if (!info.active)
-						info.horizontal_distance = horizontal_distance;
-					/*else
-						info.horizontal_distance = RateLimit(info.horizontal_distance, horizontal_distance, spacingdistance*dt, spacingdistance*dt);*/
-
-					//std::cout << info.horizontal_distance << ", " << info.eta << std::endl;
-
-					info.active = true;
-				}
+				if (!info.active)
+					info.eta = eta;
 				else
-					info.active = false;
+					info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
+
+				float horizontal_distance = their_track_placement - my_track_placement;
+				//if (!info.active)
+					info.horizontal_distance = horizontal_distance;
+				/*else
+					info.horizontal_distance = RateLimit(info.horizontal_distance, horizontal_distance, spacingdistance*dt, spacingdistance*dt);*/
 
-				//std::cout << orig_horiz << ", " << horizontal_distance << ",    " << fore_position << ", " << speed_diff << std::endl;
+				//std::cout << info.horizontal_distance << ", " << info.eta << std::endl;
 
-				/*if (!min_horizontal_distance)
-					min_horizontal_distance = optional <float> (horizontal_distance);
-				else if (std::abs(min_horizontal_distance.get()) > std::abs(horizontal_distance))
-					min_horizontal_distance = optional <float> (horizontal_distance);*/
+				info.active = true;
 			}
 			else
 				info.active = false;
 
+			//std::cout << orig_horiz << ", " << horizontal_distance << ",    " << fore_position << ", " << speed_diff << std::endl;
+
+			/*if (!min_horizontal_distance)
+				min_horizontal_distance = optional <float> (horizontal_distance);
+			else if (std::abs(min_horizontal_distance.get()) > std::abs(horizontal_distance))
+				min_horizontal_distance = optional <float> (horizontal_distance);*/
+		}
+		else
+			info.active = false;
+
 /*#ifdef VISUALIZE_AI_DEBUG
-			if (info.active)
-			{
-				avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
-				Vec3 feeler1(speed*info.eta,0,0);
-				car->GetOrientation().RotateVector(feeler1);
-				Vec3 feeler2(0,-info.horizontal_distance,0);
-				car->GetOrientation().RotateVector(feeler2);
-				avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition()+feeler1+feeler2);
-				avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
-			}
-#endif*/
+		if (info.active)
+		{
+			avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
+			Vec3 feeler1(speed*info.eta,0,0);
+			car->GetOrientation().RotateVector(feeler1);
+			Vec3 feeler2(0,-info.horizontal_distance,0);
+			car->GetOrientation().RotateVector(feeler2);
+			avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition()+feeler1+feeler2);
+			avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
 		}
+#endif*/
 	}
+
+	othercars.swap(infos);
 }
 
-float AiCarExperimental::steerAwayFromOthers()
+float AiCarExperimental::steerAwayFromOthers(const AiCarIndex::Entry & mycar)
 {
 	const float spacingdistance = 3.5; //how far left and right we target for our spacing in meters (center of mass to center of mass)
 	const float horizontal_meters_per_second = 5.0; //how fast we want to steer away in horizontal meters per second
-	const float speed = std::max(1.0f,car->GetVelocity().Magnitude());
+	const float speed = std::max(1.0f,mycar.velocity.Magnitude());
 	const float authority = std::min(10.0,(180.0/3.141593)*atan(horizontal_meters_per_second/speed)); //steering bias authority limit magnitude in degrees
 	const float gain = 4.0; //amplify steering command by this factor
 	const float mineta = 1.0; //fastest reaction time in seconds
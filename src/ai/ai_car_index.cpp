@@ -0,0 +1,167 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "ai_car_index.h"
+#include "car.h"
+#include "bezier.h"
+#include "physics/carwheelposition.h"
+
+#include <algorithm>
+
+static bool DistanceLess(const AiCarIndex::Entry & a, const AiCarIndex::Entry & b)
+{
+	if (!a.patch || !b.patch)
+		return a.patch && !b.patch;
+	return a.distance < b.distance;
+}
+
+static bool EntryBefore(const AiCarIndex::Entry & a, float distance)
+{
+	return a.distance < distance;
+}
+
+static bool EntryAfter(float distance, const AiCarIndex::Entry & a)
+{
+	return distance < a.distance;
+}
+
+static float GetPatchLength(const Bezier & patch)
+{
+	Vec3 front = (patch.GetPoint(0,0) + patch.GetPoint(0,3)) * 0.5;
+	Vec3 back = (patch.GetPoint(3,0) + patch.GetPoint(3,3)) * 0.5;
+	return (front - back).Magnitude();
+}
+
+// append the entries from min to max distance, skipping the car itself
+static void AddRange(
+	std::vector <AiCarIndex::Entry>::const_iterator begin,
+	std::vector <AiCarIndex::Entry>::const_iterator end,
+	float min, float max, const Car * car,
+	std::vector <const AiCarIndex::Entry *> & neighbors)
+{
+	std::vector <AiCarIndex::Entry>::const_iterator i = std::lower_bound(begin, end, min, EntryBefore);
+	std::vector <AiCarIndex::Entry>::const_iterator e = std::upper_bound(i, end, max, EntryAfter);
+	for (; i != e; ++i)
+	{
+		if (i->car != car)
+			neighbors.push_back(&*i);
+	}
+}
+
+AiCarIndex::AiCarIndex() : road_entries(0), track_length(0), patch_length(0)
+{
+	// ctor
+}
+
+void AiCarIndex::Update(const std::list <Car> & cars, float new_track_length)
+{
+	track_length = new_track_length;
+	entries.clear();
+	for (std::list <Car>::const_iterator i = cars.begin(); i != cars.end(); ++i)
+	{
+		Entry entry;
+		entry.car = &*i;
+		entry.patch = GetCurrentPatch(&*i);
+		entry.distance = entry.patch ? entry.patch->GetDistFromStart() : 0;
+		entry.position = i->GetCenterOfMassPosition();
+		entry.velocity = i->GetVelocity();
+		entry.orientation = i->GetOrientation();
+		entry.engine_rpm = i->GetEngineRPM();
+		entry.gear = i->GetGear();
+		entries.push_back(entry);
+	}
+	Sort();
+}
+
+void AiCarIndex::Update(const std::vector <Entry> & cars, float new_track_length)
+{
+	track_length = new_track_length;
+	entries = cars;
+	Sort();
+}
+
+void AiCarIndex::GetNeighbors(const Car * car, float behind, float ahead, std::vector <const Entry *> & neighbors) const
+{
+	const Entry * entry = GetEntry(car);
+	if (!entry || !entry->patch) return;
+
+	std::vector <Entry>::const_iterator begin = entries.begin();
+	std::vector <Entry>::const_iterator end = entries.begin() + road_entries;
+
+	float min = entry->distance - behind - patch_length;
+	float max = entry->distance + ahead + patch_length;
+	if (track_length > 0 && max - min >= track_length)
+	{
+		// window covers the whole lap
+		AddRange(begin, end, -1E30f, 1E30f, car, neighbors);
+	}
+	else if (track_length > 0 && min < 0)
+	{
+		AddRange(begin, end, min + track_length, 1E30f, car, neighbors);
+		AddRange(begin, end, -1E30f, max, car, neighbors);
+	}
+	else if (track_length > 0 && max >= track_length)
+	{
+		AddRange(begin, end, min, 1E30f, car, neighbors);
+		AddRange(begin, end, -1E30f, max - track_length, car, neighbors);
+	}
+	else
+	{
+		AddRange(begin, end, min, max, car, neighbors);
+	}
+}
+
+const AiCarIndex::Entry * AiCarIndex::GetEntry(const Car * car) const
+{
+	std::vector <std::pair <const Car *, unsigned int> >::const_iterator i =
+		std::lower_bound(lookup.begin(), lookup.end(), std::make_pair(car, 0u));
+	if (i == lookup.end() || i->first != car)
+		return NULL;
+	return &entries[i->second];
+}
+
+const Bezier * AiCarIndex::GetCurrentPatch(const Car * car)
+{
+	const Bezier * patch = car->GetCurPatch(WheelPosition(0));
+	if (!patch)
+		patch = car->GetCurPatch(WheelPosition(1)); //let's try the other wheel
+	return patch;
+}
+
+void AiCarIndex::Sort()
+{
+	patch_length = 0;
+	road_entries = 0;
+	for (unsigned int i = 0; i < entries.size(); ++i)
+	{
+		if (!entries[i].patch) continue;
+
+		patch_length = std::max(patch_length, GetPatchLength(*entries[i].patch));
+		road_entries++;
+	}
+	std::sort(entries.begin(), entries.end(), DistanceLess);
+
+	lookup.clear();
+	lookup.reserve(entries.size());
+	for (unsigned int i = 0; i < entries.size(); ++i)
+	{
+		lookup.push_back(std::make_pair(entries[i].car, i));
+	}
+	std::sort(lookup.begin(), lookup.end());
+}
@@ -0,0 +1,86 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _AI_CAR_INDEX_H
+#define _AI_CAR_INDEX_H
+
+#include "mathvector.h"
+#include "quaternion.h"
+
+#include <vector>
+#include <list>
+
+class Car;
+class Bezier;
+
+/// Cars sorted by their distance along the track, rebuilt once per tick by the Ai manager.
+/// Lets each AI car look at the cars within its look-ahead window only
+/// instead of testing every car on the grid.
+/// Cars which are not on a road patch are not returned as neighbors.
+/// Entries keep a snapshot of the car state taken when the index is built,
+/// AI cars read their own and each other's state through it,
+/// so updating them in any order gives the same result.
+class AiCarIndex
+{
+public:
+	struct Entry
+	{
+		const Car * car;
+		const Bezier * patch; ///< NULL if the car isn't on a road patch
+		float distance; ///< patch distance from start
+		Vec3 position; ///< center of mass
+		Vec3 velocity;
+		Quat orientation;
+		int engine_rpm;
+		int gear;
+	};
+
+	AiCarIndex();
+
+	/// track_length is the lap length of a circuit, zero for open roads
+	void Update(const std::list <Car> & cars, float track_length);
+
+	/// use the given car states instead of reading them from the cars
+	void Update(const std::vector <Entry> & cars, float track_length);
+
+	/// append the other cars from behind to ahead meters around the given car
+	/// distances are measured along the track, the window is widened by a patch length
+	/// because cars are indexed with the distance of their patch start
+	void GetNeighbors(const Car * car, float behind, float ahead, std::vector <const Entry *> & neighbors) const;
+
+	/// return the index entry of the car, NULL if the car isn't indexed
+	const Entry * GetEntry(const Car * car) const;
+
+	/// return the road patch under the car, NULL if there is none
+	static const Bezier * GetCurrentPatch(const Car * car);
+
+	unsigned int size() const {return entries.size();}
+
+private:
+	std::vector <Entry> entries; ///< cars on a road patch sorted by distance, followed by the others
+	unsigned int road_entries; ///< number of cars on a road patch
+	std::vector <std::pair <const Car *, unsigned int> > lookup; ///< sorted by car
+	float track_length;
+	float patch_length; ///< longest indexed patch
+
+	/// sort the entries and build the car lookup
+	void Sort();
+};
+
+#endif // _AI_CAR_INDEX_H
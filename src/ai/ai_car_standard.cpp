@@ -20,6 +20,7 @@
 #include "ai_car_standard.h"
 #include "car.h"
 #include "bezier.h"
+#include "roadstrip.h"
 #include "track.h"
 #include "physics/carinput.h"
 #include "mathvector.h"
@@ -31,6 +32,7 @@
 #include <cassert>
 #include <cmath>
 #include <algorithm>
+#include <set>
 #include <iostream>
 
 #define GRAVITY 9.8
@@ -55,17 +57,18 @@
 #define THROTTLE_RATE_LIMIT 0.1
 
 AiCar* AiCarStandardFactory::create(Car * car, float difficulty){
-	return new AiCarStandard(car, difficulty);
-}
-
-AiCarStandard::AiCarStandard (Car * new_car, float newdifficulty) :
-	AiCar(new_car, newdifficulty), shift_time(0.0), longitude_mu(0.9),
-	lateral_mu(0.9), last_patch(NULL), use_racingline(true)
-{
 	assert(car->GetTCSEnabled());
 	assert(car->GetABSEnabled());
 	car->SetAutoShift(true);
 	car->SetAutoClutch(true);
+	return new AiCarStandard(car, difficulty, AiCarParams(*car));
+}
+
+AiCarStandard::AiCarStandard (Car * new_car, float newdifficulty, const AiCarParams & new_params) :
+	AiCar(new_car, newdifficulty), params(new_params), shift_time(0.0), longitude_mu(0.9),
+	lateral_mu(0.9), last_patch(NULL), use_racingline(true)
+{
+	calcMu();
 }
 
 AiCarStandard::~AiCarStandard ()
@@ -105,23 +108,14 @@ float AiCarStandard::RateLimit(float old_value, float new_value, float rate_limi
 		return new_value;
 }
 
-void AiCarStandard::Update(float dt, const std::list <Car> & checkcars)
+void AiCarStandard::Update(float dt, const AiCarIndex & checkcars)
 {
-	analyzeOthers(dt, checkcars);
-	updateGasBrake();
-	updateSteer();
-}
+	const AiCarIndex::Entry * mycar = checkcars.GetEntry(car);
+	if (!mycar) return;
 
-const Bezier * AiCarStandard::GetCurrentPatch(const Car *c)
-{
-	const Bezier *curr_patch = c->GetCurPatch(WheelPosition(0));
-	if (!curr_patch)
-	{
-		curr_patch = c->GetCurPatch(WheelPosition(1)); //let's try the other wheel
-		if (!curr_patch) return NULL;
-	}
-
-	return curr_patch;
+	analyzeOthers(dt, checkcars);
+	updateGasBrake(*mycar);
+	updateSteer(*mycar);
 }
 
 Vec3 AiCarStandard::GetPatchFrontCenter(const Bezier & patch)
@@ -215,7 +209,7 @@ void AiCarStandard::TrimPatch(Bezier & patch, float trimleft_front, float trimri
 	patch.SetFromCorners(newfl, newfr, newbl, newbr);
 }
 
-Bezier AiCarStandard::RevisePatch(const Bezier * origpatch, bool use_racingline)
+Bezier AiCarStandard::RevisePatch(const Bezier * origpatch, bool use_racingline) const
 {
 	Bezier patch = *origpatch;
 
@@ -286,7 +280,66 @@ Bezier AiCarStandard::RevisePatch(const Bezier * origpatch, bool use_racingline)
 	return patch;
 }
 
-void AiCarStandard::updateGasBrake()
+void AiCarStandard::AddRoadProfile(const Bezier * patch, AiSpeedProfile & profile) const
+{
+	//walk the road until it ends, joins a profiled road or loops back
+	std::vector <const Bezier *> road;
+	std::set <const Bezier *> visited;
+	const Bezier * next = patch;
+	while (next && !profile.Get(next) && visited.insert(next).second)
+	{
+		road.push_back(next);
+		next = next->GetNextPatch();
+	}
+
+	std::vector <AiSpeedProfile::Patch> patches(road.size());
+	Bezier curr_patch = RevisePatch(road[0], use_racingline);
+	for (unsigned int i = 0; i < road.size(); ++i)
+	{
+		Vec3 patch_direction = GetPatchDirection(curr_patch);
+		patches[i].length = patch_direction.Magnitude();
+		patches[i].direction = patch_direction.Normalize();
+
+		float width = GetPatchWidthVector(*road[i]).Magnitude();
+		if (!curr_patch.GetNextPatch())
+		{
+			patches[i].speed_limit = calcSpeedLimit(&curr_patch, NULL, lateral_mu, width);
+		}
+		else
+		{
+			Bezier next_patch = RevisePatch(curr_patch.GetNextPatch(), use_racingline);
+			patches[i].speed_limit = calcSpeedLimit(&curr_patch, &next_patch, lateral_mu, width);
+			curr_patch = next_patch;
+		}
+	}
+
+	profile.AddRoad(road, patches, next);
+}
+
+bool AiCarStandard::GetSpeedProfileParams(AiSpeedProfile::Params & profile_params) const
+{
+	profile_params.friction = lateral_mu;
+	profile_params.lift = params.lift * params.inv_mass;
+	profile_params.brake_accel = longitude_mu * GRAVITY;
+	profile_params.brake_drag = (-params.lift * longitude_mu + params.drag) * params.inv_mass;
+	profile_params.brake_scale = 1.0;
+	return true;
+}
+
+void AiCarStandard::BuildSpeedProfile(const std::list <RoadStrip> & roads, AiSpeedProfile & profile) const
+{
+	for (std::list <RoadStrip>::const_iterator road = roads.begin(); road != roads.end(); ++road)
+	{
+		const std::vector <RoadPatch> & patches = road->GetPatches();
+		for (unsigned int i = 0; i < patches.size(); ++i)
+		{
+			if (!profile.Get(&patches[i].GetPatch()))
+				AddRoadProfile(&patches[i].GetPatch(), profile);
+		}
+	}
+}
+
+void AiCarStandard::updateGasBrake(const AiCarIndex::Entry & mycar)
 {
 #ifdef VISUALIZE_AI_DEBUG
 	brakelook.clear();
@@ -296,46 +349,33 @@ void AiCarStandard::updateGasBrake()
 	float gas_value = 0.5;
 	const float speed_percent = 1.0;
 
-	if (car->GetEngineRPM() < car->GetEngineStallRPM())
+	if (mycar.engine_rpm < params.stall_rpm)
 		inputs[CarInput::START_ENGINE] = 1.0;
 	else
 		inputs[CarInput::START_ENGINE] = 0.0;
 
-	calcMu();
+	const Bezier *curr_patch_ptr = mycar.patch;
+	const AiSpeedProfile::Patch * curr_profile = NULL;
+	if (curr_patch_ptr && speed_profile)
+		curr_profile = speed_profile->Get(curr_patch_ptr);
 
-	const Bezier *curr_patch_ptr = GetCurrentPatch(car);
 	//if car is not on track, just let it roll
-    if (!curr_patch_ptr)
+	if (!curr_profile)
 	{
 		inputs[CarInput::THROTTLE] = 0.8;
 		inputs[CarInput::BRAKE] = 0.0;
 		return;
 	}
 
-	Bezier curr_patch = RevisePatch(curr_patch_ptr, use_racingline);
-	//Bezier curr_patch = *curr_patch_ptr;
-
-	Vec3 patch_direction = GetPatchDirection(curr_patch);
-
 	//this version uses the velocity along tangent vector. it should calculate a lower current speed,
 	//hence higher gas value or lower brake value
 	//float currentspeed = car->chassis().cm_velocity().component(direction_vector);
-	float currentspeed = car->GetVelocity().dot(patch_direction.Normalize());
+	float currentspeed = mycar.velocity.dot(curr_profile->direction);
 	//this version just uses the velocity, do not care about the direction
 	//float currentspeed = car->chassis().cm_velocity().magnitude();
 
 	//check speed against speed limit of current patch
-	float speed_limit = 0;
-	if (!curr_patch.GetNextPatch())
-	{
-		speed_limit = calcSpeedLimit(&curr_patch, NULL, lateral_mu, GetPatchWidthVector(*curr_patch_ptr).Magnitude())*speed_percent;
-	}
-	else
-	{
-		Bezier next_patch = RevisePatch(curr_patch.GetNextPatch(), use_racingline);
-		speed_limit = calcSpeedLimit(&curr_patch, &next_patch, lateral_mu, GetPatchWidthVector(*curr_patch_ptr).Magnitude())*speed_percent;
-	}
-
+	float speed_limit = curr_profile->speed_limit * speed_percent;
 	speed_limit *= difficulty;
 
 	float speed_diff = speed_limit - currentspeed;
@@ -364,64 +404,27 @@ void AiCarStandard::updateGasBrake()
 		brake_value = 0.0;
 	}
 
-	//check upto maxlookahead distance
-	float maxlookahead = calcBrakeDist(currentspeed, 0.0, longitude_mu)+10;
-	//maxlookahead = 0.1;
-	float dist_checked = 0.0;
-	float brake_dist = 0.0;
-	Bezier patch_to_check = curr_patch;
-
-#ifdef VISUALIZE_AI_DEBUG
-	brakelook.push_back(patch_to_check);
-#endif
-
-	while (dist_checked < maxlookahead)
+	//brake if we are too fast to slow down for the patches ahead
+	if (currentspeed > curr_profile->brake_speed)
 	{
-		Bezier * unmodified_patch_to_check = patch_to_check.GetNextPatch();
-
-		//if there is no next patch(probably a non-closed track, just let it roll
-		if (!patch_to_check.GetNextPatch())
-		{
-			brake_value = 0.0;
-			dist_checked = maxlookahead;
-			break;
-		}
-		else
-			patch_to_check = RevisePatch(patch_to_check.GetNextPatch(), use_racingline);
+		brake_value = 1.0;
+		gas_value = 0.0;
+	}
 
 #ifdef VISUALIZE_AI_DEBUG
-		brakelook.push_back(patch_to_check);
-#endif
-
-		//speed_limit = calcSpeedLimit(c, &patch_to_check, lateral_mu)*speed_percent;
-		if (!patch_to_check.GetNextPatch())
-		{
-			speed_limit = calcSpeedLimit(&patch_to_check, NULL, lateral_mu, GetPatchWidthVector(*unmodified_patch_to_check).Magnitude())*speed_percent;
-		}
-		else
-		{
-			Bezier next_patch = RevisePatch(patch_to_check.GetNextPatch(), use_racingline);
-			speed_limit = calcSpeedLimit(&patch_to_check, &next_patch, lateral_mu, GetPatchWidthVector(*unmodified_patch_to_check).Magnitude())*speed_percent;
-		}
-
-		dist_checked += GetPatchDirection(patch_to_check).Magnitude();
-		brake_dist = calcBrakeDist(currentspeed, speed_limit, longitude_mu);
-
-		//if (brake_dist + CORNER_BRAKE_OFFSET > dist_checked)
-		if (brake_dist > dist_checked)
-		{
-			//std::cout << "brake: limit " << speed_limit << ", cur " << currentspeed << ", brake " << brake_dist << ", dist " << dist_checked << std::endl;
-
-			/*brake_value = (brake_dist + CORNER_BRAKE_OFFSET - dist_checked)*CORNER_BRAKE_GAIN;
-			if (brake_value > 1.0) brake_value = 1.0;*/
-			brake_value = 1.0;
-			gas_value = 0.0;
-			break;
-		}
+	float maxlookahead = calcBrakeDist(currentspeed, 0.0, longitude_mu)+10;
+	float dist_checked = 0.0;
+	for (const Bezier * patch_to_check = curr_patch_ptr; patch_to_check && dist_checked < maxlookahead; patch_to_check = patch_to_check->GetNextPatch())
+	{
+		const AiSpeedProfile::Patch * profile_to_check = speed_profile->Get(patch_to_check);
+		if (!profile_to_check) break;
+		brakelook.push_back(RevisePatch(patch_to_check, use_racingline));
+		dist_checked += profile_to_check->length;
 	}
+#endif
 
 	//std::cout << speed_limit << std::endl;
-	if (car->GetGear() == 0)
+	if (mycar.gear == 0)
 	{
 		inputs[CarInput::SHIFT_UP] = 1.0;
 		gas_value = 0.2;
@@ -449,23 +452,13 @@ void AiCarStandard::updateGasBrake()
 
 void AiCarStandard::calcMu()
 {
-	int i;
-	float long_friction = 0.0;
-	float lat_friction = 0.0;
-
-	for (i=0; i<4; i++)
-	{
-		long_friction += car->GetTireMaxFx(WheelPosition(i));
-		lat_friction += car->GetTireMaxFy(WheelPosition(i));
-	}
-
-	float long_mu = FRICTION_FACTOR_LONG * long_friction * car->GetInvMass() / GRAVITY;
-	float lat_mu = FRICTION_FACTOR_LAT * lat_friction * car->GetInvMass() / GRAVITY;
+	float long_mu = FRICTION_FACTOR_LONG * params.max_fx * params.inv_mass / GRAVITY;
+	float lat_mu = FRICTION_FACTOR_LAT * params.max_fy * params.inv_mass / GRAVITY;
 	if (!isnan(long_mu)) longitude_mu = long_mu;
 	if (!isnan(lat_mu)) lateral_mu = lat_mu;
 }
 
-float AiCarStandard::calcSpeedLimit(const Bezier* patch, const Bezier * nextpatch, float friction, float extraradius=0)
+float AiCarStandard::calcSpeedLimit(const Bezier* patch, const Bezier * nextpatch, float friction, float extraradius=0) const
 {
 	assert(patch);
 
@@ -486,7 +479,7 @@ float AiCarStandard::calcSpeedLimit(const Bezier* patch, const Bezier * nextpatc
 	//float v1 = sqrt(friction * GRAVITY * adjusted_radius);
 
 	//take into account downforce
-	double denom = (1.0 - std::min(1.01, adjusted_radius * -(car->GetAerodynamicDownforceCoefficient()) * friction * car->GetInvMass()));
+	double denom = (1.0 - std::min(1.01, adjusted_radius * -params.lift * friction * params.inv_mass));
 	double real = (friction * GRAVITY * adjusted_radius) / denom;
 	double v2 = 1000.0; //some really big number
 	if (real > 0)
@@ -497,23 +490,22 @@ float AiCarStandard::calcSpeedLimit(const Bezier* patch, const Bezier * nextpatc
 	return v2;
 }
 
-float AiCarStandard::calcBrakeDist(float current_speed, float allowed_speed, float friction)
+float AiCarStandard::calcBrakeDist(float current_speed, float allowed_speed, float friction) const
 {
 	float c = friction * GRAVITY;
-	float d = (-(car->GetAerodynamicDownforceCoefficient()) * friction +
-				car->GetAeordynamicDragCoefficient()) * car->GetInvMass();
+	float d = (-params.lift * friction + params.drag) * params.inv_mass;
 	float v1sqr = current_speed * current_speed;
 	float v2sqr = allowed_speed * allowed_speed;
 	return -log((c + v2sqr*d)/(c + v1sqr*d))/(2.0*d);
 }
 
-void AiCarStandard::updateSteer()
+void AiCarStandard::updateSteer(const AiCarIndex::Entry & mycar)
 {
 #ifdef VISUALIZE_AI_DEBUG
 	steerlook.clear();
 #endif
 
-	const Bezier *curr_patch_ptr = GetCurrentPatch(car);
+	const Bezier *curr_patch_ptr = mycar.patch;
 
 	//if car has no contact with track, just let it roll
 	if (!curr_patch_ptr)
@@ -540,7 +532,7 @@ void AiCarStandard::updateSteer()
 	//find the point to steer towards
 	float track_width = GetPatchWidthVector(curr_patch).Magnitude();
 	float lookahead = track_width * LOOKAHEAD_FACTOR1 +
-			car->GetVelocity().Magnitude() * LOOKAHEAD_FACTOR2;
+			mycar.velocity.Magnitude() * LOOKAHEAD_FACTOR2;
 	lookahead = 1.0;
 	float length = 0.0;
 	Vec3 dest_point = GetPatchFrontCenter(next_patch);
@@ -571,9 +563,9 @@ void AiCarStandard::updateSteer()
 		}
 	}
 
-	Vec3 car_position = car->GetCenterOfMassPosition();
+	Vec3 car_position = mycar.position;
 	Vec3 car_orientation = Direction::Forward;
-	(car->GetOrientation()).RotateVector(car_orientation);
+	mycar.orientation.RotateVector(car_orientation);
 
 	Vec3 desire_orientation = dest_point - car_position;
 
@@ -594,7 +586,7 @@ void AiCarStandard::updateSteer()
 	//calculate steering angle and direction
 	double angle = beta - alpha;
 
-	//angle += steerAwayFromOthers(c, dt, othercars, angle); //sum in traffic avoidance bias
+	//angle += steerAwayFromOthers(mycar); //sum in traffic avoidance bias
 
 	if (angle > -360.0 && angle <= -180.0)
 		angle = -(360.0 + angle);
@@ -605,10 +597,10 @@ void AiCarStandard::updateSteer()
 	else if (angle > 180.0 && angle <= 360.0)
 		angle = 360.0 - angle;
 
-	float optimum_range = car->GetOptimumSteeringAngle();
+	float optimum_range = params.optimum_steering_angle;
 	angle = clamp(angle, -optimum_range, optimum_range);
 
-	float steer_value = angle / car->GetMaxSteeringAngle();
+	float steer_value = angle / params.max_steering_angle;
 	if (steer_value > 1.0) steer_value = 1.0;
 	else if (steer_value < -1.0) steer_value = -1.0;
 
@@ -684,10 +676,12 @@ float AiCarStandard::brakeFromOthers(float speed_diff)
 	return bias;
 }
 
-void AiCarStandard::analyzeOthers(float dt, const std::list <Car> & checkcars)
+void AiCarStandard::analyzeOthers(float dt, const AiCarIndex & checkcars)
 {
 	//const float speed = std::max(1.0f,car->GetVelocity().Magnitude());
 	const float half_carlength = 1.25; //in meters
+	const float lookahead_time = 10.0; //only pay attention to cars we reach within this time in seconds
+	const float lookahead_min = 50.0; //in meters
 
 	//std::cout << speed << ": " << authority << std::endl;
 
@@ -698,98 +692,112 @@ void AiCarStandard::analyzeOthers(float dt, const std::list <Car> & checkcars)
 	//avoidancedraw->ClearLine();
 #endif
 
-	for (std::list <Car>::const_iterator i = checkcars.begin(); i != checkcars.end(); ++i)
+	neighbors.clear();
+	const AiCarIndex::Entry * mycar = checkcars.GetEntry(car);
+	if (mycar)
 	{
-		if (&(*i) != car)
-		{
-			OtherCarInfo & info = othercars[&(*i)];
-
-			//find direction of other cars in our frame
-			Vec3 relative_position = i->GetCenterOfMassPosition() - car->GetCenterOfMassPosition();
-			(-car->GetOrientation()).RotateVector(relative_position);
-
-			//std::cout << relative_position.dot(throttle_axis) << ", " << relative_position.dot(steer_right_axis) << std::endl;
+		const float lookahead = std::max(lookahead_min, mycar->velocity.Magnitude() * lookahead_time);
+		checkcars.GetNeighbors(car, half_carlength, lookahead, neighbors);
+	}
 
-			//only make a move if the other car is within our distance limit
-			float fore_position = relative_position.dot(throttle_axis);
-			//float speed_diff = i->GetVelocity().dot(throttle_axis) - car->GetVelocity().dot(throttle_axis); //positive if other car is faster
+	//cars outside of the window are dropped, their info starts over when they come back
+	std::map <const Car *, OtherCarInfo> infos;
+	for (std::vector <const AiCarIndex::Entry *>::const_iterator n = neighbors.begin(); n != neighbors.end(); ++n)
+	{
+		const AiCarIndex::Entry & other = **n;
+		const Car * othercar = other.car;
+		OtherCarInfo & info = infos[othercar];
+		std::map <const Car *, OtherCarInfo>::const_iterator last = othercars.find(othercar);
+		if (last != othercars.end())
+			info = last->second;
 
-			Vec3 myvel = car->GetVelocity();
-			Vec3 othervel = i->GetVelocity();
-			(-car->GetOrientation()).RotateVector(myvel);
-			(-i->GetOrientation()).RotateVector(othervel);
-			float speed_diff = othervel.dot(throttle_axis) - myvel.dot(throttle_axis); //positive if other car is faster
+		//find direction of other cars in our frame
+		Vec3 relative_position = other.position - mycar->position;
+		(-mycar->orientation).RotateVector(relative_position);
 
-			//std::cout << speed_diff << std::endl;
-			//float distancelimit = clamp(distancelimitcoeff*-speed_diff, distancelimitmin, distancelimitmax);
-			const float fore_position_offset = -half_carlength;
-			if (fore_position > fore_position_offset)// && fore_position < distancelimit) //only pay attention to cars roughly in front of us
-			{
-				//float horizontal_distance = relative_position.dot(steer_right_axis); //fallback method if not on a patch
-				//float orig_horiz = horizontal_distance;
+		//std::cout << relative_position.dot(throttle_axis) << ", " << relative_position.dot(steer_right_axis) << std::endl;
 
-				const Bezier * othercarpatch = GetCurrentPatch(&(*i));
-				const Bezier * mycarpatch = GetCurrentPatch(car);
+		//only make a move if the other car is within our distance limit
+		float fore_position = relative_position.dot(throttle_axis);
+		//float speed_diff = othercar->GetVelocity().dot(throttle_axis) - car->GetVelocity().dot(throttle_axis); //positive if other car is faster
 
-				if (othercarpatch && mycarpatch)
-				{
-					float my_track_placement = GetHorizontalDistanceAlongPatch(*mycarpatch, car->GetCenterOfMassPosition());
-					float their_track_placement = GetHorizontalDistanceAlongPatch(*othercarpatch, i->GetCenterOfMassPosition());
+		Vec3 myvel = mycar->velocity;
+		Vec3 othervel = other.velocity;
+		(-mycar->orientation).RotateVector(myvel);
+		(-other.orientation).RotateVector(othervel);
+		float speed_diff = othervel.dot(throttle_axis) - myvel.dot(throttle_axis); //positive if other car is faster
 
-					float speed_diff_denom = clamp(speed_diff, -100, -0.01);
-					float eta = (fore_position-fore_position_offset)/-speed_diff_denom;
+		//std::cout << speed_diff << std::endl;
+		//float distancelimit = clamp(distancelimitcoeff*-speed_diff, distancelimitmin, distancelimitmax);
+		const float fore_position_offset = -half_carlength;
+		if (fore_position > fore_position_offset)// && fore_position < distancelimit) //only pay attention to cars roughly in front of us
+		{
+			//float horizontal_distance = relative_position.dot(steer_right_axis); //fallback method if not on a patch
+			//float orig_horiz = horizontal_distance;
 
-					info.fore_distance = fore_position;
+			const Bezier * othercarpatch = other.patch;
+			const Bezier * mycarpatch = mycar->patch;
 
-					if (!info.active)
-						info.eta = eta;
-					else
-						info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
+			if (othercarpatch && mycarpatch)
+			{
+				float my_track_placement = GetHorizontalDistanceAlongPatch(*mycarpatch, mycar->position);
+				float their_track_placement = GetHorizontalDistanceAlongPatch(*othercarpatch, other.position);
 
-					float horizontal_distance = their_track_placement - my_track_placement;
-					//if (!info.active)
-						info.horizontal_distance = horizontal_distance;
-					/*else
-						info.horizontal_distance = RateLimit(info.horizontal_distance, horizontal_distance, spacingdistance*dt, spacingdistance*dt);*/
+				float speed_diff_denom = clamp(speed_diff, -100, -0.01);
+				float eta = (fore_position-fore_position_offset)/-speed_diff_denom;
 
-					//std::cout << info.horizontal_distance << ", " << info.eta << std::endl;
+				info.fore_distance = fore_position;
 
-					info.active = true;
-				}
+				if (!info.active)
+					info.eta = eta;
 				else
-					info.active = false;
+					info.eta = RateLimit(info.eta, eta, 10.f*dt, 10000.f*dt);
 
-				//std::cout << orig_horiz << ", " << horizontal_distance << ",    " << fore_position << ", " << speed_diff << std::endl;
+				float horizontal_distance = their_track_placement - my_track_placement;
+				//if (!info.active)
+					info.horizontal_distance = horizontal_distance;
+				/*else
+					info.horizontal_distance = RateLimit(info.horizontal_distance, horizontal_distance, spacingdistance*dt, spacingdistance*dt);*/
 
-				/*if (!min_horizontal_distance)
-					min_horizontal_distance = optional <float> (horizontal_distance);
-				else if (std::abs(min_horizontal_distance.get()) > std::abs(horizontal_distance))
-					min_horizontal_distance = optional <float> (horizontal_distance);*/
+				//std::cout << info.horizontal_distance << ", " << info.eta << std::endl;
+
+				info.active = true;
 			}
 			else
 				info.active = false;
 
+			//std::cout << orig_horiz << ", " << horizontal_distance << ",    " << fore_position << ", " << speed_diff << std::endl;
+
+			/*if (!min_horizontal_distance)
+				min_horizontal_distance = optional <float> (horizontal_distance);
+			else if (std::abs(min_horizontal_distance.get()) > std::abs(horizontal_distance))
+				min_horizontal_distance = optional <float> (horizontal_distance);*/
+		}
+		else
+			info.active = false;
+
 /*#ifdef VISUALIZE_AI_DEBUG
-			if (info.active)
-			{
-				avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
-				Vec3 feeler1(speed*info.eta,0,0);
-				car->GetOrientation().RotateVector(feeler1);
-				Vec3 feeler2(0,-info.horizontal_distance,0);
-				car->GetOrientation().RotateVector(feeler2);
-				avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition()+feeler1+feeler2);
-				avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
-			}
-#endif*/
+		if (info.active)
+		{
+			avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
+			Vec3 feeler1(speed*info.eta,0,0);
+			car->GetOrientation().RotateVector(feeler1);
+			Vec3 feeler2(0,-info.horizontal_distance,0);
+			car->GetOrientation().RotateVector(feeler2);
+			avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition()+feeler1+feeler2);
+			avoidancedraw->AddLinePoint(car->GetCenterOfMassPosition());
 		}
+#endif*/
 	}
+
+	othercars.swap(infos);
 }
 
-float AiCarStandard::steerAwayFromOthers()
+float AiCarStandard::steerAwayFromOthers(const AiCarIndex::Entry & mycar)
 {
 	const float spacingdistance = 3.5; //how far left and right we target for our spacing in meters (center of mass to center of mass)
 	const float horizontal_meters_per_second = 5.0; //how fast we want to steer away in horizontal meters per second
-	const float speed = std::max(1.0f,car->GetVelocity().Magnitude());
+	const float speed = std::max(1.0f,mycar.velocity.Magnitude());
 	const float authority = std::min(10.0,(180.0/3.141593)*atan(horizontal_meters_per_second/speed)); //steering bias authority limit magnitude in degrees
 	const float gain = 4.0; //amplify steering command by this factor
 	const float mineta = 1.0; //fastest reaction time in seconds
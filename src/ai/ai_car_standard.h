@@ -21,6 +21,8 @@
 #define _AI_CAR_STANDARD_H
 
 #include "ai_car.h"
+#include "ai_car_index.h"
+#include "ai_speed_profile.h"
 #include "ai_factory.h"
 #include "physics/carinput.h"
 #include "reseatable_reference.h"
@@ -45,16 +47,17 @@ class AiCarStandard :
 {
 private:
 
-	void updateGasBrake();
+	void updateGasBrake(const AiCarIndex::Entry & mycar);
 	void calcMu();
-	float calcSpeedLimit(const Bezier* patch, const Bezier* nextpatch, float friction, float extraradius);
-	float calcBrakeDist(float current_speed, float allowed_speed, float friction);
-	void updateSteer();
-	void analyzeOthers(float dt, const std::list <Car> & othercars);
-	float steerAwayFromOthers(); ///< returns a float that should be added into the steering wheel command
+	float calcSpeedLimit(const Bezier* patch, const Bezier* nextpatch, float friction, float extraradius) const;
+	float calcBrakeDist(float current_speed, float allowed_speed, float friction) const;
+	void updateSteer(const AiCarIndex::Entry & mycar);
+	void analyzeOthers(float dt, const AiCarIndex & othercars);
+	float steerAwayFromOthers(const AiCarIndex::Entry & mycar); ///< returns a float that should be added into the steering wheel command
 	float brakeFromOthers(float speed_diff); ///< returns a float that should be added into the brake command. speed_diff is the difference between the desired speed and speed limit of this area of the track
 	double Angle(double x1, double y1); ///< returns the angle in degrees of the normalized 2-vector
-	Bezier RevisePatch(const Bezier * origpatch, bool use_racingline);
+	Bezier RevisePatch(const Bezier * origpatch, bool use_racingline) const;
+	void AddRoadProfile(const Bezier * patch, AiSpeedProfile & profile) const; ///< profiles the road from the patch until it ends, joins a profiled road or loops back
 
 	/*
 	/// for replanning the path
@@ -81,6 +84,8 @@ private:
 		bool active;
 	};
 	std::map <const Car *, OtherCarInfo> othercars;
+	std::vector <const AiCarIndex::Entry *> neighbors; ///< cars within the look-ahead window
+	AiCarParams params; ///< car constants read when the AI was added
 
 	float shift_time;
 	float longitude_mu; ///<friction coefficient of the tire - longitude direction
@@ -91,7 +96,6 @@ private:
 	template<class T> static bool isnan(const T & x);
 	static float clamp(float val, float min, float max);
 	static float RateLimit(float old_value, float new_value, float rate_limit_pos, float rate_limit_neg);
-	static const Bezier * GetCurrentPatch(const Car *c);
 	static Vec3 GetPatchFrontCenter(const Bezier & patch);
 	static Vec3 GetPatchBackCenter(const Bezier & patch);
 	static Vec3 GetPatchDirection(const Bezier & patch);
@@ -116,9 +120,11 @@ private:
 #endif
 
 public:
-	AiCarStandard (Car * new_car, float newdifficulty);
+	AiCarStandard (Car * new_car, float newdifficulty, const AiCarParams & new_params);
 	~AiCarStandard();
-	void Update(float dt, const std::list <Car> & checkcars);
+	void Update(float dt, const AiCarIndex & checkcars);
+	bool GetSpeedProfileParams(AiSpeedProfile::Params & profile_params) const;
+	void BuildSpeedProfile(const std::list <RoadStrip> & roads, AiSpeedProfile & profile) const;
 
 #ifdef VISUALIZE_AI_DEBUG
 	void Visualize();
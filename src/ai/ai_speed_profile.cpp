@@ -0,0 +1,214 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "ai_speed_profile.h"
+#include "bezier.h"
+#include "unittest.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+/// speed used when nothing ahead limits the car
+static const float unlimited_speed = 1000.0;
+
+AiSpeedProfile::Params::Params() :
+	friction(0), lift(0), brake_accel(0), brake_drag(0), brake_scale(1)
+{
+	// ctor
+}
+
+bool AiSpeedProfile::Params::operator<(const Params & other) const
+{
+	if (friction != other.friction) return friction < other.friction;
+	if (lift != other.lift) return lift < other.lift;
+	if (brake_accel != other.brake_accel) return brake_accel < other.brake_accel;
+	if (brake_drag != other.brake_drag) return brake_drag < other.brake_drag;
+	return brake_scale < other.brake_scale;
+}
+
+AiSpeedProfile::AiSpeedProfile()
+{
+	// ctor
+}
+
+void AiSpeedProfile::SetParams(const Params & new_params)
+{
+	if (params < new_params || new_params < params)
+	{
+		params = new_params;
+		patches.clear();
+	}
+}
+
+const AiSpeedProfile::Patch * AiSpeedProfile::Get(const Bezier * patch) const
+{
+	std::tr1::unordered_map <const Bezier *, Patch>::const_iterator i = patches.find(patch);
+	if (i == patches.end())
+		return NULL;
+	return &i->second;
+}
+
+const Bezier * AiSpeedProfile::GetNearest(const Vec3 & position) const
+{
+	const Bezier * nearest = NULL;
+	float nearest_dist = 0;
+	std::tr1::unordered_map <const Bezier *, Patch>::const_iterator i;
+	for (i = patches.begin(); i != patches.end(); ++i)
+	{
+		float dist = (i->first->GetPoint(2,2) - position).MagnitudeSquared();
+		if (!nearest || dist < nearest_dist)
+		{
+			nearest_dist = dist;
+			nearest = i->first;
+		}
+	}
+	return nearest;
+}
+
+void AiSpeedProfile::AddRoad(const std::vector <const Bezier *> & road, std::vector <Patch> & profile, const Bezier * next)
+{
+	assert(road.size() == profile.size());
+
+	bool joined = Get(next);
+
+	std::vector <Patch *> added(road.size());
+	for (unsigned int i = 0; i < road.size(); ++i)
+	{
+		Patch & patch = patches[road[i]];
+		patch = profile[i];
+		patch.brake_speed = unlimited_speed;
+		added[i] = &patch;
+	}
+
+	// a loop needs a second pass to carry the limits past its end
+	bool loop = !joined && Get(next);
+	for (int pass = loop ? 2 : 1; pass > 0; --pass)
+	{
+		// the speed and length of the patch ahead of the one being processed
+		float ahead_speed = unlimited_speed;
+		float ahead_length = 0;
+		if (const Patch * ahead = Get(next))
+		{
+			ahead_speed = std::min(ahead->speed_limit, ahead->brake_speed);
+			ahead_length = ahead->length;
+		}
+
+		for (int i = road.size() - 1; i >= 0; --i)
+		{
+			Patch & patch = *added[i];
+			patch.brake_speed = GetBrakeSpeed(ahead_speed, ahead_length);
+			ahead_speed = std::min(patch.speed_limit, patch.brake_speed);
+			ahead_length = patch.length;
+		}
+	}
+
+	for (unsigned int i = 0; i < road.size(); ++i)
+	{
+		profile[i] = *added[i];
+	}
+}
+
+float AiSpeedProfile::GetBrakeSpeed(float speed, float distance) const
+{
+	float d = distance / params.brake_scale;
+	float v2 = speed * speed;
+	float c = params.brake_accel;
+	float k = params.brake_drag;
+	if (std::abs(k) > 1E-6)
+	{
+		// lift cancels the brake force at this speed, there is nothing to brake for
+		float decel = c + v2 * k;
+		if (decel <= 0)
+			return unlimited_speed;
+
+		// inverse of the brake distance -log((c + v2 * k) / (c + v1 * k)) / (2 * k)
+		// for negative k the result stays below the speed the brake force vanishes at
+		float v1 = (decel * exp(2.0 * k * d) - c) / k;
+		return sqrt(v1);
+	}
+	return sqrt(v2 + 2.0 * c * d);
+}
+
+QT_TEST(ai_speed_profile_test)
+{
+	AiSpeedProfile profile;
+	AiSpeedProfile::Params params;
+	params.friction = 1.0;
+	params.brake_accel = 9.8;
+	profile.SetParams(params);
+
+	// braking from 30 to 10 m/s at 9.8 m/s^2 takes 40.8 m
+	QT_CHECK_CLOSE(profile.GetBrakeSpeed(10.0, 800.0 / (2.0 * 9.8)), 30.0, 0.001);
+
+	// the drag term shortens the brake distance
+	params.brake_drag = 0.001;
+	profile.SetParams(params);
+	QT_CHECK_GREATER(profile.GetBrakeSpeed(10.0, 800.0 / (2.0 * 9.8)), 30.0);
+
+	// lift lengthens it, the brake distance formula of the per tick look-ahead
+	// still holds for negative drag
+	params.brake_drag = -0.001;
+	profile.SetParams(params);
+	float lift_speed = profile.GetBrakeSpeed(10.0, 800.0 / (2.0 * 9.8));
+	QT_CHECK_LESS(lift_speed, 30.0);
+	float c = 9.8, k = -0.001;
+	float lift_dist = -log((c + 100.0 * k) / (c + lift_speed * lift_speed * k)) / (2.0 * k);
+	QT_CHECK_CLOSE(lift_dist, 800.0 / (2.0 * 9.8), 0.01);
+
+	// the brake speed stays below the speed lift cancels the brake force at
+	QT_CHECK_LESS(profile.GetBrakeSpeed(10.0, 1000.0), sqrt(9800.0));
+	QT_CHECK_CLOSE(profile.GetBrakeSpeed(100.0, 10.0), unlimited_speed, 0.001);
+
+	// a loop of four 10 m patches with a slow corner
+	std::vector <const Bezier *> road(4);
+	std::vector <AiSpeedProfile::Patch> patches(4);
+	for (unsigned int i = 0; i < road.size(); ++i)
+	{
+		road[i] = reinterpret_cast <const Bezier *> (&patches[i]);
+		patches[i].length = 10;
+		patches[i].speed_limit = 100;
+	}
+	patches[2].speed_limit = 10;
+
+	params.brake_accel = 10.0;
+	params.brake_drag = 0.0;
+	profile.SetParams(params);
+	profile.AddRoad(road, patches, road[0]);
+	QT_CHECK_EQUAL(profile.size(), 4u);
+	QT_CHECK_CLOSE(patches[1].brake_speed, sqrt(100.0 + 200.0), 0.001);
+	QT_CHECK_CLOSE(patches[0].brake_speed, sqrt(100.0 + 400.0), 0.001);
+	QT_CHECK_CLOSE(patches[3].brake_speed, sqrt(100.0 + 600.0), 0.001);
+	QT_CHECK_CLOSE(patches[2].brake_speed, sqrt(100.0 + 800.0), 0.001);
+	QT_CHECK_EQUAL(profile.Get(road[3])->brake_speed, patches[3].brake_speed);
+
+	// an open road joining the loop before the corner
+	std::vector <const Bezier *> lane(1, reinterpret_cast <const Bezier *> (&profile));
+	std::vector <AiSpeedProfile::Patch> lanepatches(1, patches[0]);
+	profile.AddRoad(lane, lanepatches, road[1]);
+	QT_CHECK_CLOSE(lanepatches[0].brake_speed, sqrt(100.0 + 400.0), 0.001);
+
+	// the end of an open road doesn't limit the speed
+	profile.Clear();
+	road.pop_back();
+	patches.pop_back();
+	profile.AddRoad(road, patches, NULL);
+	QT_CHECK_CLOSE(patches[2].brake_speed, unlimited_speed, 0.001);
+	QT_CHECK_CLOSE(patches[1].brake_speed, sqrt(100.0 + 200.0), 0.001);
+}
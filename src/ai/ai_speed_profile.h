@@ -0,0 +1,95 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _AI_SPEED_PROFILE_H
+#define _AI_SPEED_PROFILE_H
+
+#include "mathvector.h"
+#include "unordered_map.h"
+
+#include <vector>
+
+class Bezier;
+
+/// Speed limits of the road patches driven by an AI car.
+/// Patches are added a road at a time, a backward pass over the road computes
+/// the highest speed on each patch which still leaves room to brake down to the
+/// speed limits of the patches ahead. The profile only depends on track geometry,
+/// racing line and car parameters, so it is built once per track and car parameters
+/// when the AI cars are added, cars with equal parameters share a profile.
+class AiSpeedProfile
+{
+public:
+	/// car parameters the profile is computed with
+	struct Params
+	{
+		Params();
+
+		float friction; ///< lateral friction coefficient of the speed limits
+		float lift; ///< aerodynamic lift coefficient times inverse mass, negative for downforce
+		float brake_accel; ///< braking deceleration at zero speed
+		float brake_drag; ///< braking deceleration per squared speed, negative if lift exceeds drag
+		float brake_scale; ///< brake distances are multiplied by this
+
+		bool operator<(const Params & other) const;
+	};
+
+	struct Patch
+	{
+		Vec3 direction; ///< normalized direction of the revised patch
+		float length; ///< length of the revised patch
+		float speed_limit; ///< cornering speed limit of the patch
+		float brake_speed; ///< highest speed on the patch to still brake in time for the patches ahead
+	};
+
+	AiSpeedProfile();
+
+	/// braking deceleration is brake_accel + brake_drag * speed^2
+	/// the profile is cleared if any of the values changes
+	void SetParams(const Params & params);
+
+	const Params & GetParams() const {return params;}
+
+	/// return the profile of the patch, NULL if the patch hasn't been added
+	const Patch * Get(const Bezier * patch) const;
+
+	/// return the added patch closest to position, NULL if the profile is empty
+	/// all patches are checked, only meant for cars off the road
+	const Bezier * GetNearest(const Vec3 & position) const;
+
+	/// add consecutive road patches, brake_speed is computed here
+	/// next is the patch following the last one, NULL at the end of an open road
+	/// it can be an already added patch, or one of the new patches if the road is a loop
+	void AddRoad(const std::vector <const Bezier *> & road, std::vector <Patch> & profile, const Bezier * next);
+
+	/// highest speed distance meters before a point passed at speed
+	/// with negative drag the brake force vanishes at sqrt(-brake_accel / brake_drag),
+	/// points passed at or above that speed don't limit the speed before them
+	float GetBrakeSpeed(float speed, float distance) const;
+
+	void Clear() {patches.clear();}
+
+	unsigned int size() const {return patches.size();}
+
+private:
+	std::tr1::unordered_map <const Bezier *, Patch> patches;
+	Params params;
+};
+
+#endif // _AI_SPEED_PROFILE_H
@@ -110,7 +110,7 @@ static bool LoadWheel(
 
 			VertexArray rimva, diskva;
 			MeshGen::mg_rim(rimva, size[0], size[1], size[2], 10);
-			diskva = mesh->GetVertexArray();
+			mesh->CopyVertexArray(diskva);
 			diskva.Translate(-0.75 * 0.5, 0, 0);
 			diskva.Scale(width, diameter, diameter);
 			content.load(mesh, path, meshname, rimva + diskva);
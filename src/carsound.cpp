@@ -35,7 +35,8 @@ CarSound::CarSound() :
 	gearsound_check(0),
 	brakesound_check(false),
 	handbrakesound_check(false),
-	interior(false)
+	interior(false),
+	audible(true)
 {
 	// ctor
 }
@@ -54,6 +55,17 @@ bool CarSound::Load(
 {
 	psound = &sound;
 
+	// decode effect sounds on the loader threads, the loads below wait for them
+	const char * effects[] = {
+		"tire_squeal", "gravel", "grass", "bump_rear", "bump_front",
+		"crash", "gear", "brake", "handbrake", "wind"};
+	const size_t effects_count = sizeof(effects) / sizeof(effects[0]);
+	std::vector<ContentManager::Future<SoundBuffer> > prefetch(effects_count);
+	for (size_t i = 0; i < effects_count; ++i)
+	{
+		content.loadAsync(prefetch[i], carpath, effects[i]);
+	}
+
 	// check for sound specification file
 	std::string path_aud = carpath + "/" + carname + ".aud";
 	std::ifstream file_aud(path_aud.c_str());
@@ -235,6 +247,19 @@ void CarSound::Update(const CarDynamics & dynamics, float dt)
 	Vec3 pos_car = ToMathVector<float>(dynamics.GetPosition());
 	Vec3 pos_eng = ToMathVector<float>(dynamics.GetEnginePosition());
 
+	// skip source updates while the car can't be heard, mute it once when it gets out of range
+	if (!psound->GetAudible(pos_car[0], pos_car[1], pos_car[2], 1.0f))
+	{
+		if (audible)
+		{
+			Mute();
+			audible = false;
+		}
+		crashdetection.Update(dynamics.GetSpeed(), dt);
+		return;
+	}
+	audible = true;
+
 	psound->SetSourcePosition(roadnoise, pos_car[0], pos_car[1], pos_car[2]);
 	psound->SetSourcePosition(crashsound, pos_car[0], pos_car[1], pos_car[2]);
 	psound->SetSourcePosition(gearsound, pos_car[0], pos_car[1], pos_car[2]);
@@ -481,6 +506,21 @@ void CarSound::EnableInteriorSounds(bool value)
 	interior = value;
 }
 
+void CarSound::Mute()
+{
+	for (size_t i = 0; i < enginesounds.size(); ++i)
+		psound->SetSourceGain(enginesounds[i].sound_source, 0.0);
+
+	for (int i = 0; i < WHEEL_POSITION_SIZE; ++i)
+	{
+		psound->SetSourceGain(tiresqueal[i], 0.0);
+		psound->SetSourceGain(gravelsound[i], 0.0);
+		psound->SetSourceGain(grasssound[i], 0.0);
+	}
+
+	psound->SetSourceGain(roadnoise, 0.0);
+}
+
 void CarSound::Clear()
 {
 	if (!psound) return;
@@ -67,6 +67,9 @@ private:
 	bool brakesound_check;
 	bool handbrakesound_check;
 	bool interior;
+	bool audible;
+
+	void Mute();
 
 	void Clear();
 };
@@ -123,6 +123,56 @@ bool Factory<PTree>::create(
 	return false;
 }
 
+template <>
+bool Factory<PTree>::decode(
+	decoded & data,
+	std::ostream & error,
+	const std::string & basepath,
+	const std::string & path,
+	const std::string & name,
+	const empty&)
+{
+	const std::string abspath = basepath + "/" + path + "/" + name;
+	std::ifstream file(abspath.c_str());
+	if (file.good())
+	{
+		std::stringstream sstream;
+		sstream << file.rdbuf();
+		data.basepath = basepath;
+		data.path = path;
+		data.file = sstream.str();
+		return true;
+	}
+	return false;
+}
+
+bool Factory<PTree>::finalize(
+	std::tr1::shared_ptr<PTree> & sptr,
+	decoded & data,
+	std::ostream & error)
+{
+	std::stringstream sstream(data.file);
+	std::tr1::shared_ptr<PTree> temp(new PTree());
+	if (m_content)
+	{
+		// include support
+		ConfigInclude include(*m_content, data.basepath, data.path);
+		m_read(sstream, *temp, &include);
+	}
+	else
+	{
+		m_read(sstream, *temp, 0);
+	}
+	sptr = temp;
+	return true;
+}
+
+size_t Factory<PTree>::getSize(const PTree &) const
+{
+	// configs are small, not budgeted
+	return 0;
+}
+
 const std::tr1::shared_ptr<PTree> & Factory<PTree>::getDefault() const
 {
 	return m_default;
@@ -22,6 +22,7 @@
 
 #include "contentfactory.h"
 #include <iosfwd>
+#include <string>
 
 class PTree;
 class ContentManager;
@@ -50,6 +51,34 @@ public:
 		const std::string & name,
 		const P & param);
 
+	/// file read on a loader thread, parsed by finalize
+	/// parsing stays on the main thread, includes load through the content manager
+	struct decoded
+	{
+		std::string basepath;
+		std::string path;
+		std::string file;
+	};
+
+	/// read file, thread safe
+	template <class P>
+	bool decode(
+		decoded & data,
+		std::ostream & error,
+		const std::string & basepath,
+		const std::string & path,
+		const std::string & name,
+		const P & param);
+
+	/// parse file, main thread only
+	bool finalize(
+		std::tr1::shared_ptr<PTree> & sptr,
+		decoded & data,
+		std::ostream & error);
+
+	/// memory held by the content in bytes, used by the cache budget
+	size_t getSize(const PTree & config) const;
+
 	const std::tr1::shared_ptr<PTree> & getDefault() const;
 
 private:
@@ -36,6 +36,8 @@ public:
 		const std::string & name,
 		const P & param);
 
+	size_t getSize(const Content & content) const;
+
 	const std::tr1::shared_ptr<Content> & getDefault() const;
 };
 
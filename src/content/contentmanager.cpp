@@ -18,19 +18,164 @@
 /************************************************************************/
 
 #include "contentmanager.h"
+#include "quickmp.h"
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+
+#include <fstream>
+#include <deque>
+#include <algorithm>
+
+struct ContentManager::Loader
+{
+	std::vector<SDL_Thread *> threads;
+	SDL_mutex * mutex;
+	SDL_cond * queued_cond;
+	SDL_cond * decoded_cond;
+	std::deque<std::tr1::shared_ptr<Request> > queued;
+	std::deque<std::tr1::shared_ptr<Request> > decoded;
+	size_t inflight; ///< requests not finalized yet, main thread only
+	bool quit;
+
+	Loader() :
+		mutex(SDL_CreateMutex()),
+		queued_cond(SDL_CreateCond()),
+		decoded_cond(SDL_CreateCond()),
+		inflight(0),
+		quit(false)
+	{
+		// leave one processor to the main thread
+		int count = std::max(1, int(QMP_GET_NUM_PROCS()) - 1);
+		for (int i = 0; i < count; ++i)
+		{
+#if SDL_VERSION_ATLEAST(2,0,0)
+			threads.push_back(SDL_CreateThread(Run, NULL, this));
+#else
+			threads.push_back(SDL_CreateThread(Run, this));
+#endif
+		}
+	}
+
+	~Loader()
+	{
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(queued_cond);
+		SDL_UnlockMutex(mutex);
+
+		for (size_t i = 0; i < threads.size(); ++i)
+		{
+			SDL_WaitThread(threads[i], NULL);
+		}
+
+		SDL_DestroyCond(decoded_cond);
+		SDL_DestroyCond(queued_cond);
+		SDL_DestroyMutex(mutex);
+	}
+
+	/// loader thread, decodes queued requests
+	static int Run(void * data)
+	{
+		Loader & loader = *(Loader *)data;
+		SDL_LockMutex(loader.mutex);
+		while (true)
+		{
+			while (loader.queued.empty() && !loader.quit)
+			{
+				SDL_CondWait(loader.queued_cond, loader.mutex);
+			}
+			if (loader.quit)
+			{
+				break;
+			}
+
+			std::tr1::shared_ptr<Request> request = loader.queued.front();
+			loader.queued.pop_front();
+			SDL_UnlockMutex(loader.mutex);
+
+			request->decode();
+
+			SDL_LockMutex(loader.mutex);
+			loader.decoded.push_back(request);
+			SDL_CondSignal(loader.decoded_cond);
+		}
+		SDL_UnlockMutex(loader.mutex);
+		return 0;
+	}
+};
 
 ContentManager::ContentManager(std::ostream & error) :
-	error(error)
+	error(error),
+	budget(0),
+	stamp(0),
+	loader(0)
 {
 	// ctor
 }
 
 ContentManager::~ContentManager()
 {
+	delete loader;
+	budget = 0;
 	sweep();
 	_logleaks();
 }
 
+void ContentManager::update()
+{
+	_finalize(false);
+}
+
+void ContentManager::finish()
+{
+	while (_finalize(true));
+}
+
+void ContentManager::_queue(const std::tr1::shared_ptr<Request> & request)
+{
+	if (!loader)
+	{
+		loader = new Loader();
+	}
+
+	SDL_LockMutex(loader->mutex);
+	loader->queued.push_back(request);
+	SDL_CondSignal(loader->queued_cond);
+	SDL_UnlockMutex(loader->mutex);
+	loader->inflight++;
+}
+
+bool ContentManager::_finalize(bool block)
+{
+	if (!loader || loader->inflight == 0)
+	{
+		return false;
+	}
+
+	SDL_LockMutex(loader->mutex);
+	while (block && loader->decoded.empty())
+	{
+		SDL_CondWait(loader->decoded_cond, loader->mutex);
+	}
+
+	// one at a time, finalize can reenter through nested loads (config includes)
+	while (!loader->decoded.empty())
+	{
+		std::tr1::shared_ptr<Request> request = loader->decoded.front();
+		loader->decoded.pop_front();
+		SDL_UnlockMutex(loader->mutex);
+
+		loader->inflight--;
+		request->finalize();
+
+		SDL_LockMutex(loader->mutex);
+	}
+	SDL_UnlockMutex(loader->mutex);
+
+	return loader->inflight > 0;
+}
+
 void ContentManager::addSharedPath(const std::string & path)
 {
 	sharedpaths.push_back(path);
@@ -41,12 +186,62 @@ void ContentManager::addPath(const std::string & path)
 	basepaths.push_back(path);
 }
 
+bool ContentManager::findFile(
+	const std::string & path,
+	const std::string & name,
+	std::string & filepath) const
+{
+	for (size_t i = 0; i < basepaths.size(); ++i)
+	{
+		filepath = basepaths[i] + "/" + path + "/" + name;
+		if (std::ifstream(filepath.c_str()))
+			return true;
+	}
+	for (size_t i = 0; i < sharedpaths.size(); ++i)
+	{
+		filepath = sharedpaths[i] + "//" + name;
+		if (std::ifstream(filepath.c_str()))
+			return true;
+	}
+	filepath.clear();
+	return false;
+}
+
+void ContentManager::setBudget(size_t bytes)
+{
+	budget = bytes;
+}
+
 void ContentManager::sweep()
 {
+	size_t memory = 0;
+	std::vector<Unused> unused;
+	for (size_t i = 0; i < factory_cached.m_caches.size(); ++i)
+	{
+		memory += factory_cached.m_caches[i]->memory();
+		factory_cached.m_caches[i]->unused(unused);
+	}
+
+	// drop least recently used content first
+	std::sort(unused.begin(), unused.end());
+	for (size_t i = 0; i < unused.size() && (budget == 0 || memory > budget); ++i)
+	{
+		unused[i].cache->remove(unused[i].name);
+		memory -= unused[i].memory;
+	}
+}
+
+void ContentManager::logMemory(std::ostream & log) const
+{
+	size_t total = 0;
 	for (size_t i = 0; i < factory_cached.m_caches.size(); ++i)
 	{
-		factory_cached.m_caches[i]->sweep();
+		const Cache & cache = *factory_cached.m_caches[i];
+		log << factory_cached.m_names[i] << ": " << cache.size() << " objects, "
+			<< cache.memory() / 1024 << " KB\n";
+		total += cache.memory();
 	}
+	log << "Cached content: " << total / 1024 << " KB, budget: " << budget / 1024 << " KB" << std::endl;
 }
 
 bool ContentManager::_logleaks()
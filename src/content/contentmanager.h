@@ -26,6 +26,9 @@
 #include "configfactory.h"
 #include <vector>
 #include <map>
+#include <string>
+#include <sstream>
+#include <cassert>
 
 class ContentManager
 {
@@ -56,33 +59,135 @@ public:
 		const std::string & name,
 		const P & param);
 
+	/// handle of an asynchronously loaded shared object
+	template <class T>
+	class Future;
+
+	/// queue shared object load, retrieve from cache if available
+	/// files are read and decoded on the loader threads, content is finalized
+	/// (gl uploads) on the main thread by update, wait or finish
+	/// requests for an object already in flight share its future
+	template <class T>
+	void loadAsync(
+		Future<T> & future,
+		const std::string & path,
+		const std::string & name);
+
+	/// support additional optional parameters, param is copied
+	/// pointers in it (TextureInfo::data) have to stay valid until the future is ready
+	template <class T, class P>
+	void loadAsync(
+		Future<T> & future,
+		const std::string & path,
+		const std::string & name,
+		const P & param);
+
+	/// finalize decoded content, call regularly from the main thread
+	void update();
+
+	/// block until the object is loaded, return false if it failed
+	/// failed objects resolve to the default object like load
+	template <class T>
+	bool wait(Future<T> & future, std::tr1::shared_ptr<T> & sptr);
+
+	/// block until all queued objects are loaded
+	void finish();
+
+	/// find the file a content name resolves to, same lookup order as load
+	/// used to read and decode content outside of the factories
+	bool findFile(
+		const std::string & path,
+		const std::string & name,
+		std::string & filepath) const;
+
 	/// add shared content directory path
 	void addSharedPath(const std::string & path);
 
 	/// add content directory path
 	void addPath(const std::string & path);
 
+	/// memory budget in bytes, 0 by default
+	/// sweep keeps unused content while the cached content fits the budget,
+	/// least recently used content is dropped first
+	void setBudget(size_t bytes);
+
 	/// garbage collect unused content
 	void sweep();
 
+	/// log cached object count and memory per content type
+	void logMemory(std::ostream & log) const;
+
 	/// factories access
 	template <class T>
 	Factory<T> & getFactory();
 
 private:
+	struct Cache;
+
+	/// unused cache entry, sweep candidate
+	struct Unused
+	{
+		Cache * cache;
+		std::string name;
+		size_t memory;
+		unsigned stamp;
+		bool operator<(const Unused & other) const {return stamp < other.stamp;}
+	};
+
 	struct Cache
 	{
 		virtual void log(std::ostream & log) const = 0;
 		virtual size_t size() const = 0;
-		virtual void sweep() = 0;
+		virtual size_t memory() const = 0;
+		virtual void unused(std::vector<Unused> & entries) = 0;
+		virtual void remove(const std::string & name) = 0;
+	};
+
+	template <class T>
+	struct CacheEntry
+	{
+		std::tr1::shared_ptr<T> sptr;
+		size_t memory; ///< content size in bytes
+		unsigned stamp; ///< last use
 	};
 
 	template <class T>
-	class CacheShared : public Cache, public std::map<std::string, std::tr1::shared_ptr<T> >
+	class CacheShared : public Cache, public std::map<std::string, CacheEntry<T> >
 	{
 		void log(std::ostream & log) const;
 		size_t size() const;
-		void sweep();
+		size_t memory() const;
+		void unused(std::vector<Unused> & entries);
+		void remove(const std::string & name);
+	};
+
+	/// async load request, decoded on a loader thread, finalized on the main thread
+	struct Request
+	{
+		virtual ~Request() {}
+		virtual void decode() = 0;
+		virtual void finalize() = 0;
+	};
+
+	template <class T>
+	struct Pending : Request
+	{
+		std::tr1::shared_ptr<T> sptr;
+		bool done;
+		bool loaded;
+		Pending() : done(false), loaded(false) {}
+		void decode() {}
+		void finalize() {}
+	};
+
+	template <class T, class P>
+	struct PendingLoad;
+
+	/// requests in flight by path + name
+	template <class T>
+	struct PendingShared : std::map<std::string, std::tr1::shared_ptr<Pending<T> > >
+	{
+		// empty
 	};
 
 	/// register content factories
@@ -90,12 +195,15 @@ private:
 	struct FactoryCached
 	{
 		std::vector<Cache*> m_caches;
+		std::vector<const char*> m_names;
 
 		#define REGISTER(T)\
 		Factory<T> T ## _factory;\
 		CacheShared<T> T ## _cache;\
+		PendingShared<T> T ## _pending;\
 		operator Factory<T>&() {return T ## _factory;}\
-		operator CacheShared<T>&() {return T ## _cache;}
+		operator CacheShared<T>&() {return T ## _cache;}\
+		operator PendingShared<T>&() {return T ## _pending;}
 		REGISTER(SoundBuffer)
 		REGISTER(Texture)
 		REGISTER(Model)
@@ -104,7 +212,7 @@ private:
 
 		FactoryCached()
 		{
-			#define INIT(T) m_caches.push_back(&T ## _cache);
+			#define INIT(T) m_caches.push_back(&T ## _cache); m_names.push_back(#T);
 			INIT(SoundBuffer)
 			INIT(Texture)
 			INIT(Model)
@@ -121,6 +229,28 @@ private:
 	/// error log
 	std::ostream & error;
 
+	/// cache memory budget, use counter
+	size_t budget;
+	unsigned stamp;
+
+	/// loader threads and request queues
+	struct Loader;
+	Loader * loader;
+
+	/// queue request for decoding, start loader threads if necessary
+	void _queue(const std::tr1::shared_ptr<Request> & request);
+
+	/// finalize decoded requests, if block wait for a request to be decoded
+	/// return false if there are no requests left in flight
+	bool _finalize(bool block);
+
+	/// wait for an in flight request of the object
+	template <class T>
+	bool _wait(
+		std::tr1::shared_ptr<T> & sptr,
+		const std::string & path,
+		const std::string & name);
+
 	/// content leak logger
 	bool _logleaks();
 
@@ -129,6 +259,12 @@ private:
 		const std::string & path,
 		const std::string & name);
 
+	/// add loaded object to the cache
+	template <class T>
+	void _cache(
+		const std::tr1::shared_ptr<T> & sptr,
+		const std::string & name);
+
 	/// get implementation
 	template <class T>
 	bool _get(
@@ -179,12 +315,181 @@ inline bool ContentManager::load(
 {
 	// check for the specialised version in basepaths
 	// fall back to the generic one in shared paths
-	return 	_load(sptr, basepaths, path, name, param) ||
+	return 	_wait(sptr, path, name) ||
+			_load(sptr, basepaths, path, name, param) ||
 			_load(sptr, sharedpaths, "", name, param) ||
 			_getdefault(sptr) ||
 			_logerror(path, name);
 }
 
+template <class T>
+class ContentManager::Future
+{
+public:
+	/// object is loaded or failed to load
+	bool ready() const
+	{
+		return m_pending.get() && m_pending->done;
+	}
+
+	/// loaded object, default object if failed, only valid if ready
+	const std::tr1::shared_ptr<T> & get() const
+	{
+		assert(ready());
+		return m_pending->sptr;
+	}
+
+private:
+	friend class ContentManager;
+	std::tr1::shared_ptr<Pending<T> > m_pending;
+};
+
+template <class T, class P>
+struct ContentManager::PendingLoad : ContentManager::Pending<T>
+{
+	ContentManager & content;
+	std::vector<std::string> basepaths;
+	std::vector<std::string> sharedpaths;
+	std::string path;
+	std::string name;
+	std::string key;
+	P param;
+	typename Factory<T>::decoded data;
+	std::ostringstream error;
+
+	PendingLoad(
+		ContentManager & content,
+		const std::string & path,
+		const std::string & name,
+		const P & param) :
+		content(content),
+		basepaths(content.basepaths),
+		sharedpaths(content.sharedpaths),
+		path(path),
+		name(name),
+		param(param)
+	{
+		// ctor
+	}
+
+	// same lookup order as _load, remember the cache key
+	void decode()
+	{
+		Factory<T> & factory = content.getFactory<T>();
+		for (size_t i = 0; i < basepaths.size() && key.empty(); ++i)
+		{
+			if (factory.decode(data, error, basepaths[i], path, name, param))
+				key = path + name;
+		}
+		for (size_t i = 0; i < sharedpaths.size() && key.empty(); ++i)
+		{
+			if (factory.decode(data, error, sharedpaths[i], "", name, param))
+				key = name;
+		}
+	}
+
+	void finalize()
+	{
+		Factory<T> & factory = content.getFactory<T>();
+		if (!key.empty() && factory.finalize(this->sptr, data, error))
+		{
+			content._cache(this->sptr, key);
+			this->loaded = true;
+		}
+		content.error << error.str();
+		if (!this->loaded)
+		{
+			content._getdefault(this->sptr);
+			content._logerror(path, name);
+		}
+		this->done = true;
+
+		PendingShared<T> & pending = content.factory_cached;
+		pending.erase(path + name);
+	}
+};
+
+template <class T>
+inline void ContentManager::loadAsync(
+	Future<T> & future,
+	const std::string & path,
+	const std::string & name)
+{
+	loadAsync(future, path, name, typename Factory<T>::empty());
+}
+
+template <class T, class P>
+inline void ContentManager::loadAsync(
+	Future<T> & future,
+	const std::string & path,
+	const std::string & name,
+	const P & param)
+{
+	// coalesce with request in flight
+	PendingShared<T> & pending = factory_cached;
+	typename PendingShared<T>::const_iterator i = pending.find(path + name);
+	if (i != pending.end())
+	{
+		future.m_pending = i->second;
+		return;
+	}
+
+	// retrieve from cache
+	std::tr1::shared_ptr<T> sptr;
+	if (get(sptr, path, name))
+	{
+		future.m_pending.reset(new Pending<T>());
+		future.m_pending->sptr = sptr;
+		future.m_pending->loaded = true;
+		future.m_pending->done = true;
+		return;
+	}
+
+	std::tr1::shared_ptr<PendingLoad<T, P> > request(new PendingLoad<T, P>(*this, path, name, param));
+	pending[path + name] = request;
+	future.m_pending = request;
+	_queue(request);
+}
+
+template <class T>
+inline bool ContentManager::wait(Future<T> & future, std::tr1::shared_ptr<T> & sptr)
+{
+	assert(future.m_pending.get());
+	while (!future.ready() && _finalize(true));
+	sptr = future.get();
+	return future.m_pending->loaded;
+}
+
+template <class T>
+inline bool ContentManager::_wait(
+	std::tr1::shared_ptr<T> & sptr,
+	const std::string & path,
+	const std::string & name)
+{
+	PendingShared<T> & pending = factory_cached;
+	typename PendingShared<T>::const_iterator i = pending.find(path + name);
+	if (i == pending.end())
+	{
+		return false;
+	}
+
+	Future<T> future;
+	future.m_pending = i->second;
+	return wait(future, sptr);
+}
+
+template <class T>
+inline void ContentManager::_cache(
+	const std::tr1::shared_ptr<T> & sptr,
+	const std::string & name)
+{
+	CacheShared<T> & cache = factory_cached;
+	CacheEntry<T> & entry = cache[name];
+	entry.sptr = sptr;
+	entry.memory = getFactory<T>().getSize(*sptr);
+	entry.stamp = ++stamp;
+}
+
 template <class T>
 inline bool ContentManager::_get(
 	std::tr1::shared_ptr<T> & sptr,
@@ -192,10 +497,11 @@ inline bool ContentManager::_get(
 {
 	// retrieve from cache
 	CacheShared<T> & cache = factory_cached;
-	typename CacheShared<T>::const_iterator i = cache.find(name);
+	typename CacheShared<T>::iterator i = cache.find(name);
 	if (i != cache.end())
 	{
-		sptr = i->second;
+		sptr = i->second.sptr;
+		i->second.stamp = ++stamp;
 		return true;
 	}
 	return false;
@@ -222,8 +528,7 @@ inline bool ContentManager::_load(
 		if (factory.create(sptr, error, basepaths[i], relpath, name, param))
 		{
 			// cache loaded content
-			CacheShared<T> & cache = factory_cached;
-			cache[relpath + name] = sptr;
+			_cache(sptr, relpath + name);
 			return true;
 		}
 	}
@@ -242,31 +547,54 @@ template <class T>
 inline void ContentManager::CacheShared<T>::log(std::ostream & log) const
 {
 	typename CacheShared<T>::const_iterator it = CacheShared<T>::begin();
-	while (it != CacheShared<T>::end())
+	for (; it != CacheShared<T>::end(); ++it)
 	{
-		log << it->second.use_count() << " : " << it->first;
+		log << it->second.sptr.use_count() << " : " << it->first << "\n";
 	}
 }
 
 template <class T>
 inline size_t ContentManager::CacheShared<T>::size() const
 {
-	return std::map<std::string, std::tr1::shared_ptr<T> >::size();
+	return std::map<std::string, CacheEntry<T> >::size();
+}
+
+template <class T>
+inline size_t ContentManager::CacheShared<T>::memory() const
+{
+	size_t n = 0;
+	typename CacheShared<T>::const_iterator it = CacheShared<T>::begin();
+	for (; it != CacheShared<T>::end(); ++it)
+	{
+		n += it->second.memory;
+	}
+	return n;
 }
 
 template <class T>
-inline void ContentManager::CacheShared<T>::sweep()
+inline void ContentManager::CacheShared<T>::unused(std::vector<Unused> & entries)
 {
-	typename CacheShared<T>::iterator it = CacheShared<T>::begin();
-	while (it != CacheShared<T>::end())
+	typename CacheShared<T>::const_iterator it = CacheShared<T>::begin();
+	for (; it != CacheShared<T>::end(); ++it)
 	{
-		if (it->second.unique())
-			CacheShared<T>::erase(it++);
-		else
-			++it;
+		if (it->second.sptr.unique())
+		{
+			Unused entry;
+			entry.cache = this;
+			entry.name = it->first;
+			entry.memory = it->second.memory;
+			entry.stamp = it->second.stamp;
+			entries.push_back(entry);
+		}
 	}
 }
 
+template <class T>
+inline void ContentManager::CacheShared<T>::remove(const std::string & name)
+{
+	CacheShared<T>::erase(name);
+}
+
 template <class T>
 inline Factory<T> & ContentManager::getFactory()
 {
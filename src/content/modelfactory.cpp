@@ -19,11 +19,13 @@
 
 #include "modelfactory.h"
 #include "graphics/model_joe03.h"
+#include "graphics/meshfile.h"
 #include <fstream>
 
 Factory<Model>::Factory() :
 	m_default(new Model()),
-	m_vbo(false)
+	m_vbo(false),
+	m_headless(false)
 {
 	// ctor
 }
@@ -40,6 +42,17 @@ void Factory<Model>::init(bool use_vbo)
 	m_default->Load(va, error, !m_vbo);
 }
 
+void Factory<Model>::initHeadless()
+{
+	m_headless = true;
+
+	// init default model
+	VertexArray va;
+	va.SetToUnitCube();
+	va.Scale(0.5, 0.5, 0.5);
+	m_default->BuildFromVertexArray(va);
+}
+
 template <>
 bool Factory<Model>::create(
 	std::tr1::shared_ptr<Model>& sptr,
@@ -50,10 +63,26 @@ bool Factory<Model>::create(
 	const empty&)
 {
 	const std::string abspath = basepath + "/" + path + "/" + name;
+	std::tr1::shared_ptr<Model> mesh;
+	if (loadMeshFile(mesh, error, abspath))
+	{
+		if (!m_headless)
+		{
+			if (m_vbo)
+				mesh->GenerateVertexArrayObject(error);
+			else
+				mesh->GenerateListID(error);
+		}
+		sptr = mesh;
+		return true;
+	}
 	if (std::ifstream(abspath.c_str()))
 	{
 		std::tr1::shared_ptr<ModelJoe03> temp(new ModelJoe03());
-		if (temp->Load(abspath, error, !m_vbo))
+		bool loaded = m_headless ?
+			temp->LoadMesh(abspath, error) :
+			temp->Load(abspath, error, !m_vbo);
+		if (loaded)
 		{
 			sptr = temp;
 			return true;
@@ -72,7 +101,10 @@ bool Factory<Model>::create(
 	const JoePack& pack)
 {
 	std::tr1::shared_ptr<ModelJoe03> temp(new ModelJoe03());
-	if (temp->Load(name, error, !m_vbo, &pack))
+	bool loaded = m_headless ?
+		temp->LoadMesh(name, error, &pack) :
+		temp->Load(name, error, !m_vbo, &pack);
+	if (loaded)
 	{
 		sptr = temp;
 		return true;
@@ -90,6 +122,12 @@ bool Factory<Model>::create(
 	const VertexArray& varray)
 {
 	std::tr1::shared_ptr<Model> temp(new Model());
+	if (m_headless)
+	{
+		temp->BuildFromVertexArray(varray);
+		sptr = temp;
+		return true;
+	}
 	if (temp->Load(varray, error, !m_vbo))
 	{
 		sptr = temp;
@@ -98,6 +136,104 @@ bool Factory<Model>::create(
 	return false;
 }
 
+template <>
+bool Factory<Model>::create(
+	std::tr1::shared_ptr<Model>& sptr,
+	std::ostream& error,
+	const std::string& basepath,
+	const std::string& path,
+	const std::string& name,
+	const decoded& data)
+{
+	// mesh decoded by the caller, shared instead of copied
+	decoded temp = data;
+	return temp.model.get() && finalize(sptr, temp, error);
+}
+
+template <>
+bool Factory<Model>::decode(
+	decoded & data,
+	std::ostream & error,
+	const std::string & basepath,
+	const std::string & path,
+	const std::string & name,
+	const empty&)
+{
+	const std::string abspath = basepath + "/" + path + "/" + name;
+	if (loadMeshFile(data.model, error, abspath))
+	{
+		return true;
+	}
+	if (std::ifstream(abspath.c_str()))
+	{
+		std::tr1::shared_ptr<ModelJoe03> temp(new ModelJoe03());
+		if (temp->LoadMesh(abspath, error))
+		{
+			data.model = temp;
+			return true;
+		}
+	}
+	return false;
+}
+
+template <>
+bool Factory<Model>::decode(
+	decoded & data,
+	std::ostream & error,
+	const std::string & basepath,
+	const std::string & path,
+	const std::string & name,
+	const JoePack * const & pack)
+{
+	// pack files are read from the mapped archive, thread safe
+	std::tr1::shared_ptr<ModelJoe03> temp(new ModelJoe03());
+	if (temp->LoadMesh(name, error, pack))
+	{
+		data.model = temp;
+		return true;
+	}
+	return false;
+}
+
+bool Factory<Model>::finalize(
+	std::tr1::shared_ptr<Model> & sptr,
+	decoded & data,
+	std::ostream & error)
+{
+	if (!m_headless)
+	{
+		if (m_vbo)
+			data.model->GenerateVertexArrayObject(error);
+		else
+			data.model->GenerateListID(error);
+	}
+	sptr = data.model;
+	return true;
+}
+
+bool Factory<Model>::loadMeshFile(
+	std::tr1::shared_ptr<Model> & sptr,
+	std::ostream & error,
+	const std::string & abspath)
+{
+	const std::string meshpath = MeshFile::GetPath(abspath);
+	if (!std::ifstream(meshpath.c_str()))
+		return false;
+
+	std::tr1::shared_ptr<Model> temp(new Model());
+	// a mesh file older than its source model is ignored, the source is loaded instead
+	if (!temp->LoadMeshFile(meshpath, error, abspath))
+		return false;
+
+	sptr = temp;
+	return true;
+}
+
+size_t Factory<Model>::getSize(const Model & model) const
+{
+	return model.GetMemorySize();
+}
+
 const std::tr1::shared_ptr<Model> & Factory<Model>::getDefault() const
 {
 	return m_default;
@@ -35,6 +35,10 @@ public:
 	/// use VBOs instead of draw lists for models
 	void init(bool use_vbo);
 
+	/// load mesh data only, skip gl buffer generation,
+	/// used by headless (no gl context) simulation modes
+	void initHeadless();
+
 	template <class P>
 	bool create(
 		std::tr1::shared_ptr<Model> & sptr,
@@ -44,11 +48,44 @@ public:
 		const std::string & name,
 		const P & param);
 
+	/// mesh loaded on a loader thread, gl buffers are generated by finalize
+	/// also accepted by create to cache a mesh decoded outside of the factory
+	struct decoded
+	{
+		std::tr1::shared_ptr<Model> model;
+	};
+
+	/// load mesh, thread safe
+	template <class P>
+	bool decode(
+		decoded & data,
+		std::ostream & error,
+		const std::string & basepath,
+		const std::string & path,
+		const std::string & name,
+		const P & param);
+
+	/// generate gl buffers, main thread only
+	bool finalize(
+		std::tr1::shared_ptr<Model> & sptr,
+		decoded & data,
+		std::ostream & error);
+
+	/// memory held by the content in bytes, used by the cache budget
+	size_t getSize(const Model & model) const;
+
 	const std::tr1::shared_ptr<Model> & getDefault() const;
 
 private:
 	std::tr1::shared_ptr<Model> m_default;
 	bool m_vbo;
+	bool m_headless;
+
+	/// load the converted mesh file of a model if there is one, see MeshFile
+	bool loadMeshFile(
+		std::tr1::shared_ptr<Model> & sptr,
+		std::ostream & error,
+		const std::string & abspath);
 };
 
 #endif // _MODELFACTORY_H
@@ -60,6 +60,32 @@ bool Factory<SoundBuffer>::create(
 	return false;
 }
 
+template <>
+bool Factory<SoundBuffer>::decode(
+	decoded & data,
+	std::ostream & error,
+	const std::string & basepath,
+	const std::string & path,
+	const std::string & name,
+	const empty& param)
+{
+	return create(data.buffer, error, basepath, path, name, param);
+}
+
+bool Factory<SoundBuffer>::finalize(
+	std::tr1::shared_ptr<SoundBuffer> & sptr,
+	decoded & data,
+	std::ostream & error)
+{
+	sptr = data.buffer;
+	return true;
+}
+
+size_t Factory<SoundBuffer>::getSize(const SoundBuffer & sound) const
+{
+	return sound.GetMemorySize();
+}
+
 const std::tr1::shared_ptr<SoundBuffer> & Factory<SoundBuffer>::getDefault() const
 {
 	return m_default;
@@ -45,6 +45,30 @@ public:
 		const std::string & name,
 		const P & param);
 
+	/// sound loaded on a loader thread
+	struct decoded
+	{
+		std::tr1::shared_ptr<SoundBuffer> buffer;
+	};
+
+	/// load sound, thread safe
+	template <class P>
+	bool decode(
+		decoded & data,
+		std::ostream & error,
+		const std::string & basepath,
+		const std::string & path,
+		const std::string & name,
+		const P & param);
+
+	bool finalize(
+		std::tr1::shared_ptr<SoundBuffer> & sptr,
+		decoded & data,
+		std::ostream & error);
+
+	/// memory held by the content in bytes, used by the cache budget
+	size_t getSize(const SoundBuffer & sound) const;
+
 	const std::tr1::shared_ptr<SoundBuffer> & getDefault() const;
 
 private:
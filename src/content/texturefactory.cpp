@@ -27,7 +27,8 @@ Factory<Texture>::Factory() :
 	m_zero(new Texture()),
 	m_size(TextureInfo::LARGE),
 	m_compress(true),
-	m_srgb(false)
+	m_srgb(false),
+	m_headless(false)
 {
 	// ctor
 }
@@ -38,6 +39,9 @@ void Factory<Texture>::init(int max_size, bool use_srgb, bool compress)
 	m_srgb = use_srgb;
 	m_compress = compress;
 
+	// init decoders before textures are decoded concurrently
+	Texture::InitDecoders();
+
 	// init default texture
 	std::stringstream error;
 	unsigned char one[] = {255u, 255u, 255u, 255u};
@@ -58,6 +62,11 @@ void Factory<Texture>::init(int max_size, bool use_srgb, bool compress)
 	m_zero->Load("", info, error);
 }
 
+void Factory<Texture>::initHeadless()
+{
+	m_headless = true;
+}
+
 template <>
 bool Factory<Texture>::create(
 	std::tr1::shared_ptr<Texture> & sptr,
@@ -67,6 +76,12 @@ bool Factory<Texture>::create(
 	const std::string & name,
 	const TextureInfo& info)
 {
+	if (m_headless)
+	{
+		sptr = m_default;
+		return true;
+	}
+
 	const std::string abspath = basepath + "/" + path + "/" + name;
 	if (info.data || std::ifstream(abspath.c_str()))
 	{
@@ -84,6 +99,73 @@ bool Factory<Texture>::create(
 	return false;
 }
 
+template <>
+bool Factory<Texture>::decode(
+	decoded & data,
+	std::ostream & error,
+	const std::string & basepath,
+	const std::string & path,
+	const std::string & name,
+	const TextureInfo& info)
+{
+	if (m_headless)
+	{
+		return true;
+	}
+
+	const std::string abspath = basepath + "/" + path + "/" + name;
+	if (info.data || std::ifstream(abspath.c_str()))
+	{
+		data.path = abspath;
+		data.info = info;
+		if (!info.data && !info.cube)
+		{
+			// formats Decode can't handle are loaded by finalize
+			Texture::Decode(abspath, data.info, data.pixels);
+		}
+		return true;
+	}
+	return false;
+}
+
+bool Factory<Texture>::finalize(
+	std::tr1::shared_ptr<Texture> & sptr,
+	decoded & data,
+	std::ostream & error)
+{
+	if (m_headless)
+	{
+		sptr = m_default;
+		return true;
+	}
+
+	TextureInfo info_temp = data.info;
+	info_temp.srgb = data.info.compress && m_srgb;
+	info_temp.compress = data.info.compress && m_compress;
+	info_temp.maxsize = TextureInfo::Size(m_size);
+	if (!data.pixels.empty())
+	{
+		info_temp.data = &data.pixels[0];
+	}
+	std::tr1::shared_ptr<Texture> temp(new Texture());
+	if (temp->Load(data.path, info_temp, error))
+	{
+		sptr = temp;
+		return true;
+	}
+	return false;
+}
+
+bool Factory<Texture>::isHeadless() const
+{
+	return m_headless;
+}
+
+size_t Factory<Texture>::getSize(const Texture & texture) const
+{
+	return texture.GetMemorySize();
+}
+
 const std::tr1::shared_ptr<Texture> & Factory<Texture>::getDefault() const
 {
 	return m_default;
@@ -22,6 +22,8 @@
 
 #include "contentfactory.h"
 #include "graphics/textureinfo.h"
+#include <string>
+#include <vector>
 
 class Texture;
 
@@ -38,6 +40,13 @@ public:
 	/// limit texture size to max size
 	void init(int max_size, bool use_srgb, bool compress);
 
+	/// skip image decoding and gl uploads, all textures resolve to unloaded
+	/// placeholders, used by headless (no gl context) simulation modes
+	void initHeadless();
+
+	/// no image decoding, textures are placeholders
+	bool isHeadless() const;
+
 	template <class P>
 	bool create(
 		std::tr1::shared_ptr<Texture> & sptr,
@@ -47,7 +56,34 @@ public:
 		const std::string & name,
 		const P & param);
 
+	/// image decoded on a loader thread, uploaded by finalize
+	struct decoded
+	{
+		std::string path;
+		TextureInfo info;
+		std::vector<unsigned char> pixels;
+	};
+
+	/// decode image, thread safe
+	template <class P>
+	bool decode(
+		decoded & data,
+		std::ostream & error,
+		const std::string & basepath,
+		const std::string & path,
+		const std::string & name,
+		const P & param);
+
+	/// upload decoded image, main thread only
+	bool finalize(
+		std::tr1::shared_ptr<Texture> & sptr,
+		decoded & data,
+		std::ostream & error);
+
 	/// default texture is white: rgba (1, 1, 1, 1)
+	/// memory held by the content in bytes, used by the cache budget
+	size_t getSize(const Texture & texture) const;
+
 	const std::tr1::shared_ptr<Texture> & getDefault() const;
 
 	/// zero texture is black: rgba (0, 0, 0, 0)
@@ -59,6 +95,7 @@ private:
 	int m_size;
 	bool m_compress;
 	bool m_srgb;
+	bool m_headless;
 };
 
 #endif // _TEXTUREFACTORY_H
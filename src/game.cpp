@@ -420,6 +420,7 @@ void Game::InitCoreSubsystems()
 	content.getFactory<Texture>().init(texture_size, using_gl3, settings.GetTextureCompress());
 	content.getFactory<Model>().init(using_gl3);
 	content.getFactory<PTree>().init(read_ini, write_ini, content);
+	content.setBudget(size_t(std::max(0, settings.GetContentBudget())) << 20);
 
 	// Init content paths
 	// Always add writeable data paths first so they are checked first
@@ -603,8 +604,8 @@ bool Game::ParseArguments(std::list <std::string> & args)
 		const std::string carname = argmap["-cartest"];
 		const std::string cardir = pathmanager.GetCarsDir() + "/" + carname;
 
-		PerformanceTesting perftest(dynamics);
-		perftest.Test(cardir, carname, content, info_output, error_output);
+		PerformanceTesting perftest(dynamics, content, pathmanager, info_output, error_output);
+		perftest.Test(cardir, carname);
 		continue_game = false;
 	}
 	arghelp["-cartest CAR"] = "Run car performance testing on given CAR.";
@@ -654,6 +655,8 @@ bool Game::ParseArguments(std::list <std::string> & args)
 	if (argmap.find("-multithreaded") != argmap.end())
 	{
 		multithreaded = true;
+		dynamics.setMultithreaded(true);
+		ai.SetMultithreaded(true);
 
 		if (processors > 1)
 		{
@@ -673,6 +676,73 @@ bool Game::ParseArguments(std::list <std::string> & args)
 	arghelp["-multithreaded"] = "Use multithreading where possible.";
 	#endif
 
+	if (!argmap["-bench-physics"].empty())
+	{
+		std::string carname = settings.GetCar();
+		if (!argmap["-bench-car"].empty())
+			carname = argmap["-bench-car"];
+
+		int carnum = 8;
+		if (!argmap["-bench-cars"].empty())
+			carnum = cast<int>(argmap["-bench-cars"]);
+
+		int ticks = 5400;
+		if (!argmap["-bench-ticks"].empty())
+			ticks = cast<int>(argmap["-bench-ticks"]);
+
+		PerformanceTesting perftest(dynamics, content, pathmanager, info_output, error_output);
+		perftest.BenchmarkPhysics(argmap["-bench-physics"], carname, carnum, ticks, timestep, multithreaded, argmap["-bench-output"]);
+		continue_game = false;
+	}
+	arghelp["-bench-physics TRACK"] = "Run headless fixed-step physics benchmark on given TRACK.";
+	arghelp["-bench-car CAR"] = "Car used by -bench-physics, defaults to the settings car.";
+	arghelp["-bench-cars N"] = "Number of AI cars used by -bench-physics, defaults to 8.";
+	arghelp["-bench-ticks N"] = "Number of physics ticks run by -bench-physics, defaults to 5400.";
+	arghelp["-bench-output FILE"] = "Write benchmark results to FILE instead of the log.";
+
+	if (argmap.find("-bench-serialize") != argmap.end())
+	{
+		PerformanceTesting perftest(dynamics, content, pathmanager, info_output, error_output);
+		perftest.BenchmarkSerialize(argmap["-bench-output"]);
+		continue_game = false;
+	}
+	arghelp["-bench-serialize"] = "Run binary serialization benchmark.";
+
+	if (argmap.find("-bench-sound") != argmap.end())
+	{
+		PerformanceTesting perftest(dynamics, content, pathmanager, info_output, error_output);
+		perftest.BenchmarkSound(argmap["-bench-output"]);
+		continue_game = false;
+	}
+	arghelp["-bench-sound"] = "Run sound mixer benchmark.";
+
+	if (!argmap["-replay"].empty())
+	{
+		unsigned seekframe = 0;
+		if (!argmap["-replay-seek"].empty())
+			seekframe = cast<unsigned>(argmap["-replay-seek"]);
+
+		unsigned frames = 0;
+		if (!argmap["-replay-frames"].empty())
+			frames = cast<unsigned>(argmap["-replay-frames"]);
+
+		bool verify = (argmap.find("-replay-verify") != argmap.end());
+
+		float tolerance = 0;
+		if (!argmap["-replay-tolerance"].empty())
+			tolerance = cast<float>(argmap["-replay-tolerance"]);
+
+		PerformanceTesting perftest(dynamics, content, pathmanager, info_output, error_output);
+		perftest.PlayReplay(argmap["-replay"], seekframe, frames, verify, tolerance, timestep, argmap["-replay-output"]);
+		continue_game = false;
+	}
+	arghelp["-replay FILE"] = "Play replay FILE headless as fast as possible.";
+	arghelp["-replay-seek N"] = "Frame -replay seeks to before playing, using the nearest replay keyframe.";
+	arghelp["-replay-frames N"] = "Number of frames played by -replay, defaults to the whole replay.";
+	arghelp["-replay-verify"] = "Compare -replay car states against the recorded keyframes, report the first divergence.";
+	arghelp["-replay-tolerance M"] = "Position difference in meters -replay-verify accepts, defaults to 0 (exact match).";
+	arghelp["-replay-output FILE"] = "Write -replay results to FILE instead of the log.";
+
 	if (argmap.find("-nosound") != argmap.end())
 		sound.Disable();
 	arghelp["-nosound"] = "Disable all sound.";
@@ -811,6 +881,9 @@ void Game::MainLoop()
 
 		eventsystem.BeginFrame();
 
+		// Finalize content decoded by the loader threads since the last frame.
+		content.update();
+
 		// Do CPU intensive stuff in parallel with the GPU...
 		Tick(eventsystem.Get_dt());
 
@@ -912,7 +985,7 @@ void Game::AdvanceGameLogic()
 	{
 		PROFILER.beginBlock("ai");
 		ai.Visualize();
-		ai.update(timestep, cars);
+		ai.update(timestep, cars, track.GetLength());
 		PROFILER.endBlock("ai");
 
 		PROFILER.beginBlock("physics");
@@ -1033,77 +1106,7 @@ void Game::UpdateTimer()
 	// Check for cars doing a lap.
 	for (std::list <Car>::iterator i = cars.begin(); i != cars.end(); ++i)
 	{
-		int carid = cartimerids[&(*i)];
-
-		bool advance = false;
-		int nextsector = 0;
-		if (track.GetSectors() > 0)
-		{
-			nextsector = (i->GetSector() + 1) % track.GetSectors();
-			//cout << "next " << nextsector << ", cur " << i->GetSector() << ", track " << track.GetSectors() << std::endl;
-			for (int p = 0; p < 4; ++p)
-			{
-				if (i->GetCurPatch(WheelPosition(p)) == track.GetSectorPatch(nextsector))
-				{
-					advance = true;
-					//info_output << "New sector " << nextsector << "/" << track.GetSectors();
-					//info_output << " patch " << i->GetCurPatch(WHEEL_POSITION(p)) << std::endl;
-					//info_output <<  ", " << track.GetSectorPatch(nextsector) << std::endl;
-				}
-				//else cout << p << ". " << i->GetCurPatch(p) << ", " << track.GetSectorPatch(nextsector) << std::endl;
-			}
-		}
-
-		if (advance)
-		{
-			// Only count it if the car's current sector isn't -1 which is the default value when the car is loaded...
-			timer.Lap(carid, nextsector, (i->GetSector() >= 0));
-			i->SetSector(nextsector);
-		}
-
-		// Update how far the car is on the track...
-		// Find the patch under the front left wheel...
-		const Bezier * curpatch = i->GetCurPatch(FRONT_LEFT);
-		if (!curpatch)
-			// Try the other wheel...
-			curpatch = i->GetCurPatch(FRONT_RIGHT);
-
-		// Only update if car is on track.
-		if (curpatch)
-		{
-			Vec3 pos = i->GetCenterOfMassPosition();
-			Vec3 back_left, back_right, front_left;
-			if (!track.IsReversed())
-			{
-				back_left = curpatch->GetBL();
-				back_right = curpatch->GetBR();
-				front_left = curpatch->GetFL();
-			}
-			else
-			{
-				back_left = curpatch->GetFL();
-				back_right = curpatch->GetFR();
-				front_left = curpatch->GetBL();
-			}
-
-			Vec3 forwardvec = front_left - back_left;
-			Vec3 relative_pos = pos - back_left;
-			float dist_from_back = 0;
-
-			if (forwardvec.Magnitude() > 0.0001)
-				dist_from_back = relative_pos.dot(forwardvec.Normalize());
-
-			timer.UpdateDistance(carid, curpatch->GetDistFromStart() + dist_from_back);
-			//std::cout << curpatch->GetDistFromStart() << ", " << dist_from_back << std::endl;
-			//std::cout << curpatch->GetDistFromStart() + dist_from_back << std::endl;
-		}
-
-		/*info_output << "sector=" << i->GetSector() << ", next=" << track.GetSectorPatch(nextsector) << ", ";
-		for (int w = 0; w < 4; w++)
-		{
-			info_output << w << "=" << i->GetCurPatch(WHEEL_POSITION(w)) << ", ";
-		}
-		info_output << std::endl;*/
+		timer.UpdateCar(cartimerids[&(*i)], *i, track);
 	}
 
 	timer.Tick(timestep);
@@ -1341,7 +1344,7 @@ void Game::UpdateCarInputs(int carid, Car & car)
 				if (aiControlled)
 				{
 					info_output << "Switching to AI controlled player." << std::endl;
-					ai.add_car(&car, 1.0);
+					ai.add_car(&car, 1.0, track.GetRoadList());
 				}
 				else
 				{
@@ -1374,6 +1377,12 @@ void Game::UpdateCarInputs(int carid, Car & car)
 		carinputs[CarInput::THROTTLE] = 0.0;
 	}
 
+	// Drive the car with the inputs as they are stored in the replay.
+	if (replay.GetRecording())
+	{
+		Replay::QuantizeInputs(carinputs);
+	}
+
 	car.Update(carinputs);
 
 	// Record car state.
@@ -1540,7 +1549,7 @@ bool Game::NewGame(bool playreplay, bool addopponents, int num_laps)
 		}
 		if (car_info[i].driver != "user")
 		{
-			ai.add_car(&cars.back(), car_info[i].ailevel, car_info[i].driver);
+			ai.add_car(&cars.back(), car_info[i].ailevel, track.GetRoadList(), car_info[i].driver);
 		}
 	}
 
@@ -1600,10 +1609,14 @@ bool Game::NewGame(bool playreplay, bool addopponents, int num_laps)
 			}
 		}
 
-		replay.StartRecording(car_info, settings.GetTrack(), error_output);
+		std::string replayname = GetReplayRecordingFilename();
+		info_output << "Recording replay to " << replayname << std::endl;
+		replay.StartRecording(car_info, settings.GetTrack(), replayname, error_output);
 	}
 
 	content.sweep();
+	if (debugmode)
+		content.logMemory(info_output);
 	return true;
 }
 
@@ -1707,6 +1720,7 @@ bool Game::LoadTrack(const std::string & trackname)
 		pathmanager.GetTracksDir()+"/"+trackname,
 		pathmanager.GetEffectsTextureDir(),
 		pathmanager.GetTrackPartsPath(),
+		pathmanager.GetCachePath(),
 		settings.GetAnisotropy(),
 		settings.GetTrackReverse(),
 		settings.GetTrackDynamic(),
@@ -1717,16 +1731,18 @@ bool Game::LoadTrack(const std::string & trackname)
 	}
 
 	bool success = true;
-	int count = 0;
+	int shown = -1;
 	while (!track.Loaded() && success)
 	{
-		int displayevery = track.ObjectsNum() / 50;
-		if (displayevery == 0 || count % displayevery == 0)
+		// objects are loaded in batches, update the screen in 2% steps
+		int loaded = track.ObjectsNumLoaded();
+		int progress = track.ObjectsNum() > 0 ? loaded * 50 / track.ObjectsNum() : 0;
+		if (progress != shown)
 		{
-			ShowLoadingScreen(count, track.ObjectsNum(), false, "", 0.5, 0.5);
+			ShowLoadingScreen(loaded, track.ObjectsNum(), false, "", 0.5, 0.5);
+			shown = progress;
 		}
 		success = track.ContinueDeferredLoad();
-		count++;
 	}
 
 	if (!success)
@@ -1789,6 +1805,7 @@ void Game::LoadGarage()
 		pathmanager.GetSkinsDir() + "/" + settings.GetSkin(),
 		pathmanager.GetEffectsTextureDir(),
 		pathmanager.GetTrackPartsPath(),
+		pathmanager.GetCachePath(),
 		settings.GetAnisotropy(),
 		track_reverse, track_dynamic,
 		graphics_interface->GetShadows()))
@@ -1798,16 +1815,18 @@ void Game::LoadGarage()
 	}
 
 	bool success = true;
-	int count = 0;
+	int shown = -1;
 	while (!track.Loaded() && success)
 	{
-		int displayevery = track.ObjectsNum() / 50;
-		if (displayevery == 0 || count % displayevery == 0)
+		// objects are loaded in batches, update the screen in 2% steps
+		int loaded = track.ObjectsNumLoaded();
+		int progress = track.ObjectsNum() > 0 ? loaded * 50 / track.ObjectsNum() : 0;
+		if (progress != shown)
 		{
-			ShowLoadingScreen(count, track.ObjectsNum(), false, "", 0.5, 0.5);
+			ShowLoadingScreen(loaded, track.ObjectsNum(), false, "", 0.5, 0.5);
+			shown = progress;
 		}
 		success = track.ContinueDeferredLoad();
-		count++;
 	}
 
 	if (!success)
@@ -1947,6 +1966,9 @@ void Game::CalculateFPS()
 		std::stringstream summary;
 		summary << "CPU:\n" << cpuProfile << "\n\nGPU:\n";
 		graphics_interface->printProfilingInfo(summary);
+		summary << "\nSound:\n";
+		summary << "real voices: " << sound.GetRealVoices() << std::endl;
+		summary << "virtual voices: " << sound.GetVirtualVoices() << std::endl;
 		profiling_text.Revise(summary.str());
 	}
 }
@@ -2542,9 +2564,7 @@ void Game::LeaveGame()
 
 	if (replay.GetRecording())
 	{
-		std::string replayname = GetReplayRecordingFilename();
-		info_output << "Saving replay to " << replayname << std::endl;
-		replay.StopRecording(replayname);
+		replay.StopRecording();
 
 		GuiOption::List replaylist;
 		PopulateReplayList(replaylist);
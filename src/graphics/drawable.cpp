@@ -28,6 +28,7 @@ Drawable::Drawable() :
 	linesize(0),
 	objcenter(0),
 	radius(0),
+	lod_distance(0),
 	color(1),
 	draw_order(0),
 	decal(false),
@@ -123,7 +124,7 @@ void Drawable::SetCull(bool newcull, bool newcullfront)
 	cull_front = newcullfront;
 }
 
-RenderModelExt & Drawable::GenRenderModelData(StringIdMap & stringMap)
+RenderModelExt & Drawable::GenRenderModelData(StringIdMap & stringMap, bool lod)
 {
 	// copy data over to the GL3V renderModel object
 	// eventually this should only be done when we update the values, but for now
@@ -154,6 +155,9 @@ RenderModelExt & Drawable::GenRenderModelData(StringIdMap & stringMap)
 			renderModel.textures.push_back(RenderTextureEntry(misc2Id, tex_id[2], GL_TEXTURE_2D));
 		}
 
+		lodRenderModel.clearTextureCache();
+		lodRenderModel.textures = renderModel.textures;
+
 		texturesChanged = false;
 	}
 
@@ -178,9 +182,15 @@ RenderModelExt & Drawable::GenRenderModelData(StringIdMap & stringMap)
 			renderModel.uniforms.push_back(RenderUniformEntry(colorId, srgba, 4));
 		}
 
+		lodRenderModel.clearUniformCache();
+		lodRenderModel.uniforms = renderModel.uniforms;
+
 		uniformsChanged = false;
 	}
 
+	if (lod && lod_distance > 0)
+		return lodRenderModel;
+
 	return renderModel;
 }
 
@@ -199,4 +209,21 @@ void Drawable::SetModel(const Model & model)
 		if (haveVao)
 			SetVertexArrayObject(vao, elementCount);
 	}
+
+	if (model.HaveMeshMetrics())
+	{
+		objcenter = model.GetCenter();
+		radius = model.GetRadius();
+	}
+}
+
+void Drawable::SetLodModel(const Model & model, float distance)
+{
+	GLuint vao;
+	unsigned int elementCount;
+	if (model.GetVertexArrayObject(vao, elementCount))
+	{
+		lodRenderModel.setVertexArrayObject(vao, elementCount);
+		lod_distance = distance;
+	}
 }
@@ -36,8 +36,14 @@ public:
 	bool operator < (const Drawable & other) const;
 
 	unsigned GetDrawList() const;
+	/// also sets object center and radius if the model has mesh metrics
 	void SetModel(const Model & model);
 
+	/// low detail model, drawn instead of the model beyond distance (GL3 only)
+	void SetLodModel(const Model & model, float distance);
+	/// zero if there is no low detail model
+	float GetLodDistance() const;
+
 	unsigned GetTexture0() const;
 	unsigned GetTexture1() const;
 	unsigned GetTexture2() const;
@@ -53,7 +59,7 @@ public:
 	const Mat4 & GetTransform() const;
 	void SetTransform(const Mat4 & value);
 
-	/// bounding sphere frustum culling
+	/// bounding sphere frustum culling, object center is in model space
 	const Vec3 & GetObjectCenter() const;
 	void SetObjectCenter(const Vec3 & value);
 
@@ -81,7 +87,8 @@ public:
 
 	/// this gets called if we are using the GL3 renderer
 	/// it returns a reference to the RenderModelExternal structure
-	RenderModelExt & GenRenderModelData(StringIdMap & stringMap);
+	/// of the low detail model if lod is set and there is one
+	RenderModelExt & GenRenderModelData(StringIdMap & stringMap, bool lod = false);
 
 	void SetVertexArrayObject(unsigned vao, unsigned elementCount);
 
@@ -93,6 +100,7 @@ private:
 	Mat4 transform;
 	Vec3 objcenter;
 	float radius;
+	float lod_distance;
 	Vec4 color;
 	float draw_order;
 	bool decal;
@@ -104,6 +112,7 @@ private:
 	bool uniformsChanged;
 
 	RenderModelExtDrawable renderModel;
+	RenderModelExtDrawable lodRenderModel;
 };
 
 inline bool Drawable::operator < (const Drawable & other) const
@@ -131,6 +140,11 @@ inline unsigned Drawable::GetTexture2() const
 	return tex_id[2];
 }
 
+inline float Drawable::GetLodDistance() const
+{
+	return lod_distance;
+}
+
 inline const VertexArray * Drawable::GetVertArray() const
 {
 	return vert_array;
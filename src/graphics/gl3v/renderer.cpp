@@ -361,6 +361,16 @@ bool Renderer::getPassEnabled(StringId passName) const
 	return false;
 }
 
+void Renderer::setPassCullCounts(StringId passName, unsigned int submitted, unsigned int culled)
+{
+	NameIdMap::const_iterator i = passIndexMap.find(passName);
+	if (i != passIndexMap.end())
+	{
+		assert(i->second < passes.size());
+		passes[i->second].setCullCounts(submitted, culled);
+	}
+}
+
 static const std::map <std::string, std::string> emptyStringMap;
 const std::map <std::string, std::string> & Renderer::getUserDefinedFields(StringId passName) const
 {
@@ -456,7 +466,7 @@ void Renderer::printRendererStatus(RendererStatusVerbosity verbosity, const Stri
 void Renderer::printProfilingInfo(std::ostream & out) const
 {
 	for (std::vector <RenderPass>::const_iterator i = passes.begin(); i != passes.end(); i++)
-		out << i->getName() << ": " << i->getLastTime()*1e6 << " us" << std::endl;
+		out << i->getName() << ": " << i->getLastTime()*1e6 << " us, culled " << i->getCulledCount() << "/" << i->getSubmittedCount() << std::endl;
 }
 
 bool Renderer::loadShader(const std::string & path, const std::string & name, const std::set <std::string> & defines, GLenum shaderType, std::ostream & errorOutput)
@@ -119,6 +119,9 @@ public:
 	void setPassEnabled(StringId passName, bool enable);
 	bool getPassEnabled(StringId passName) const;
 
+	/// Record how many external drawables were submitted to and culled from a pass this frame.
+	void setPassCullCounts(StringId passName, unsigned int submitted, unsigned int culled);
+
 	/// Get user-defined fields for a pass.
 	const std::map <std::string, std::string> & getUserDefinedFields(StringId passName) const;
 
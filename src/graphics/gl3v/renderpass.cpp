@@ -31,7 +31,7 @@
 
 const GLEnums GLEnumHelper;
 
-RenderPass::RenderPass() : configured(false), enabled(true), shaderProgram(0), framebufferObject(0), renderbuffer(0), passIndex(0), timerQuery(0), lastTime(-1)
+RenderPass::RenderPass() : configured(false), enabled(true), shaderProgram(0), framebufferObject(0), renderbuffer(0), passIndex(0), timerQuery(0), lastTime(-1), submittedCount(0), culledCount(0)
 {
 	// Constructor.
 }
@@ -962,6 +962,7 @@ void RenderPass::printRendererStatus(RendererStatusVerbosity verbosity, const St
 	printContextPrefix = prefix+prefix;
 	forEachInContainer(externalRenderTargets, printPairRenderTargetHelper);
 	out << prefix << "Auto-mipmapped render targets: " << (autoMipMapRenderTargets.empty() ? "none" : "") << autoMipMapRenderTargets << std::endl;
+	out << prefix << "Culled drawables: " << culledCount << " of " << submittedCount << std::endl;
 
 	if (verbosity >= VERBOSITY_PASSDETAIL)
 	{
@@ -997,6 +998,22 @@ float RenderPass::getLastTime() const
 	return lastTime;
 }
 
+void RenderPass::setCullCounts(unsigned int submitted, unsigned int culled)
+{
+	submittedCount = submitted;
+	culledCount = culled;
+}
+
+unsigned int RenderPass::getSubmittedCount() const
+{
+	return submittedCount;
+}
+
+unsigned int RenderPass::getCulledCount() const
+{
+	return culledCount;
+}
+
 bool RenderPass::createFramebufferObject(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const NameTexMap & sharedTextures, std::ostream & errorOutput)
 {
 	deleteFramebufferObject(gl);
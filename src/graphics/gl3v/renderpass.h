@@ -102,6 +102,11 @@ public:
 
 	float getLastTime() const;
 
+	/// External drawables submitted to and culled from the last frame, set by the renderer's user.
+	void setCullCounts(unsigned int submitted, unsigned int culled);
+	unsigned int getSubmittedCount() const;
+	unsigned int getCulledCount() const;
+
 private:
 	/// Returns true on success.
 	bool createFramebufferObject(GLWrapper & gl, unsigned int w, unsigned int h, StringIdMap & stringMap, const NameTexMap & sharedTextures, std::ostream & errorOutput);
@@ -181,6 +186,10 @@ private:
 	GLuint timerQuery;
 	/// Timing query object.
 	float lastTime;
+
+	/// Cull statistics of the last frame.
+	unsigned int submittedCount;
+	unsigned int culledCount;
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include <map>
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 
 #define enableContributionCull true
 
@@ -337,10 +338,8 @@ void GraphicsGL3::SetupScene(float fov, float new_view_distance, const Vec3 cam_
 }
 
 // returns true for cull, false for don't-cull
-static bool contributionCull(const Drawable * d, const Vec3 & cam)
+static bool contributionCull(const Vec3 & obj, float radius, const Vec3 & cam)
 {
-	const Vec3 & obj = d->GetObjectCenter();
-	float radius = d->GetRadius();
 	float dist2 = (obj - cam).MagnitudeSquared();
 	const float fov = 90; // rough field-of-view estimation
 	float numerator = 2*radius*fov;
@@ -354,11 +353,9 @@ static bool contributionCull(const Drawable * d, const Vec3 & cam)
 }
 
 // returns true for cull, false for don't-cull
-static bool frustumCull(const Drawable * d, const Frustum & frustum)
+static bool frustumCull(const Vec3 & center, float bound, const Frustum & frustum)
 {
 	float rd;
-	const float bound = d->GetRadius();
-	const Vec3 & center = d->GetObjectCenter();
 
 	for (int i=0; i<6; i++)
 	{
@@ -375,36 +372,58 @@ static bool frustumCull(const Drawable * d, const Frustum & frustum)
 	return false;
 }
 
-// if frustum is NULL, don't do frustum or contribution culling
-void GraphicsGL3::assembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos)
+// the drawable object center is in model space, transform its bounding sphere into world space
+// returns the world space radius
+static float getWorldBounds(const Drawable & d, Vec3 & center)
 {
-	if (frustum && enableContributionCull)
+	const Mat4 & transform = d.GetTransform();
+	center = d.GetObjectCenter();
+	transform.TransformVectorOut(center[0], center[1], center[2]);
+
+	// scale the radius by the largest axis scale of the transform
+	float scale2 = 0;
+	for (int i = 0; i < 3; i++)
 	{
-		for (std::vector <Drawable*>::const_iterator i = drawables.begin(); i != drawables.end(); i++)
-		{
-			if (!frustumCull(*i, *frustum) && !contributionCull(*i, camPos))
-				out.push_back(&(*i)->GenRenderModelData(stringMap));
-		}
+		float axis2 = transform[i*4]*transform[i*4] + transform[i*4+1]*transform[i*4+1] + transform[i*4+2]*transform[i*4+2];
+		scale2 = std::max(scale2, axis2);
 	}
-	else if (frustum)
+	return d.GetRadius() * sqrt(scale2);
+}
+
+// if frustum is NULL, don't do frustum or contribution culling
+// drawables without a bounding radius (2D, particles) are never culled
+// drawables with a low detail model use it beyond their lod distance from the camera
+void GraphicsGL3::assembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, unsigned int & culled)
+{
+	for (std::vector <Drawable*>::const_iterator i = drawables.begin(); i != drawables.end(); i++)
 	{
-		for (std::vector <Drawable*>::const_iterator i = drawables.begin(); i != drawables.end(); i++)
+		Drawable & d = **i;
+		if (d.GetRadius() <= 0)
 		{
-			if (!frustumCull(*i, *frustum))
-				out.push_back(&(*i)->GenRenderModelData(stringMap));
+			out.push_back(&d.GenRenderModelData(stringMap));
+			continue;
 		}
-	}
-	else
-	{
-		for (std::vector <Drawable*>::const_iterator i = drawables.begin(); i != drawables.end(); i++)
+
+		Vec3 center;
+		float radius = getWorldBounds(d, center);
+		if (frustum)
 		{
-			out.push_back(&(*i)->GenRenderModelData(stringMap));
+			if (frustumCull(center, radius, *frustum) ||
+				(enableContributionCull && contributionCull(center, radius, camPos)))
+			{
+				culled++;
+				continue;
+			}
 		}
+
+		float lodDistance = d.GetLodDistance();
+		bool lod = lodDistance > 0 && (center - camPos).MagnitudeSquared() > lodDistance * lodDistance;
+		out.push_back(&d.GenRenderModelData(stringMap, lod));
 	}
 }
 
 // if frustum is NULL, don't do frustum or contribution culling
-void GraphicsGL3::assembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos)
+void GraphicsGL3::assembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, unsigned int & culled)
 {
 	static std::vector <Drawable*> queryResults;
 	queryResults.clear();
@@ -414,13 +433,18 @@ void GraphicsGL3::assembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapte
 		adapter.Query(Aabb<float>::IntersectAlways(), queryResults);
 
 	const std::vector <Drawable*> & drawables = queryResults;
+	culled += adapter.size() - drawables.size();
 
 	if (frustum && enableContributionCull)
 	{
 		for (std::vector <Drawable*>::const_iterator i = drawables.begin(); i != drawables.end(); i++)
 		{
-			if (!contributionCull(*i, camPos))
+			Vec3 center;
+			float radius = getWorldBounds(**i, center);
+			if (!contributionCull(center, radius, camPos))
 				out.push_back(&(*i)->GenRenderModelData(stringMap));
+			else
+				culled++;
 		}
 	}
 	else
@@ -483,6 +507,8 @@ void GraphicsGL3::DrawScene(std::ostream & error_output)
 	{
 		if (renderer.getPassEnabled(*i))
 		{
+			unsigned int passSubmitted = 0;
+			unsigned int passCulled = 0;
 			const std::set <StringId> & passDrawGroups = renderer.getDrawGroups(*i);
 			for (std::set <StringId>::const_iterator g = passDrawGroups.begin(); g != passDrawGroups.end(); g++)
 			{
@@ -518,13 +544,15 @@ void GraphicsGL3::DrawScene(std::ostream & error_output)
 						frustumPtr = &frustum;
 					}
 
+					unsigned int & culled = cameraDrawGroupCullCounts[cameraDrawGroupKey];
+					culled = 0;
+
 					// assemble dynamic entries
 					reseatable_reference <PtrVector <Drawable> > dynamicDrawablesPtr = dynamic_drawlist.GetByName(drawGroupString);
 					if (dynamicDrawablesPtr)
 					{
 						const std::vector <Drawable*> & dynamicDrawables = *dynamicDrawablesPtr;
-						//assembleDrawList(dynamicDrawables, outDrawList, frustumPtr, lastCameraPosition);
-						assembleDrawList(dynamicDrawables, outDrawList, NULL, lastCameraPosition); // TODO: the above line is commented out because frustum culling dynamic drawables doesen't work at the moment; is the object center in the drawable for the car in the correct space??
+						assembleDrawList(dynamicDrawables, outDrawList, frustumPtr, lastCameraPosition, culled);
 					}
 
 					// assemble static entries
@@ -532,7 +560,7 @@ void GraphicsGL3::DrawScene(std::ostream & error_output)
 					if (staticDrawablesPtr)
 					{
 						const AabbTreeNodeAdapter <Drawable> & staticDrawables = *staticDrawablesPtr;
-						assembleDrawList(staticDrawables, outDrawList, frustumPtr, lastCameraPosition);
+						assembleDrawList(staticDrawables, outDrawList, frustumPtr, lastCameraPosition, culled);
 					}
 
 					// if it's requesting the full screen rect draw group, feed it our special drawable
@@ -540,15 +568,21 @@ void GraphicsGL3::DrawScene(std::ostream & error_output)
 					{
 						std::vector <Drawable*> rect;
 						rect.push_back(&fullscreenquad);
-						assembleDrawList(rect, outDrawList, NULL, lastCameraPosition);
+						assembleDrawList(rect, outDrawList, NULL, lastCameraPosition, culled);
 					}
 				}
 
 				// use the generated combination in our drawMap
 				drawMap[passName][drawGroupName] = &outDrawList;
 
+				unsigned int groupCulled = cameraDrawGroupCullCounts[cameraDrawGroupKey];
+				passCulled += groupCulled;
+				passSubmitted += groupCulled + outDrawList.size();
+
 				cameraDrawGroupCombinationsGenerated.insert(cameraDrawGroupKey);
 			}
+
+			renderer.setPassCullCounts(*i, passSubmitted, passCulled);
 		}
 	}
 
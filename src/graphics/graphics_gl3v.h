@@ -131,9 +131,12 @@ private:
 	// drawlist cache
 	std::map <std::string, std::vector <RenderModelExt*> > cameraDrawGroupDrawLists;
 
-	// drawlist assembly functions
-	void assembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos);
-	void assembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos);
+	// culled drawable count per camera/group drawlist, for renderer statistics
+	std::map <std::string, unsigned int> cameraDrawGroupCullCounts;
+
+	// drawlist assembly functions, culled drawables are added to the culled count
+	void assembleDrawList(const std::vector <Drawable*> & drawables, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, unsigned int & culled);
+	void assembleDrawList(const AabbTreeNodeAdapter <Drawable> & adapter, std::vector <RenderModelExt*> & out, Frustum * frustum, const Vec3 & camPos, unsigned int & culled);
 
 	// a map that stores which camera each pass uses
 	std::map <std::string, std::string> passNameToCameraName;
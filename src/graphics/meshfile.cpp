@@ -0,0 +1,291 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "meshfile.h"
+#include "vertexarray.h"
+#include "unittest.h"
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static const char file_magic[8] = {'V', 'D', 'M', 'E', 'S', 'H', '0', '1'};
+static const unsigned int file_byteorder = 0x01020304;
+static const unsigned int block_alignment = 16;
+
+const char * const MeshFile::extension = ".vmf";
+
+std::string MeshFile::GetPath(const std::string & modelpath)
+{
+	size_t n = modelpath.rfind('.');
+	size_t s = modelpath.find_last_of("/\\");
+	if (n == std::string::npos || (s != std::string::npos && n < s))
+		return modelpath + extension;
+	return modelpath.substr(0, n) + extension;
+}
+
+// size and modification time of a file, false if it doesn't exist
+static bool GetFileStamp(const std::string & path, unsigned int & size, unsigned int & time)
+{
+	struct stat filestat;
+	if (stat(path.c_str(), &filestat) != 0)
+		return false;
+	size = (unsigned int)filestat.st_size;
+	time = (unsigned int)filestat.st_mtime;
+	return true;
+}
+
+template <typename T>
+static void WriteBlock(std::ostream & out, const T * data, int count, unsigned int & offset)
+{
+	offset = (unsigned int)out.tellp();
+	out.write((const char *)data, count * sizeof(T));
+
+	// pad to the next block
+	static const char padding[block_alignment] = {0};
+	unsigned int size = count * sizeof(T);
+	out.write(padding, (block_alignment - size % block_alignment) % block_alignment);
+}
+
+bool MeshFile::Write(
+	const std::string & path,
+	const VertexArray & varray,
+	std::ostream & error,
+	const std::string & sourcepath)
+{
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.magic, file_magic, sizeof(file_magic));
+	header.byteorder = file_byteorder;
+	if (!sourcepath.empty() && !GetFileStamp(sourcepath, header.sourcesize, header.sourcetime))
+	{
+		error << "Can't read mesh source file: " << sourcepath << std::endl;
+		return false;
+	}
+
+	const float * vertices, * normals, * texcoords = 0;
+	const unsigned char * colors;
+	const int * faces;
+	int vcount, ncount, tcount = 0, ccount, fcount;
+	varray.GetVertices(vertices, vcount);
+	varray.GetNormals(normals, ncount);
+	varray.GetColors(colors, ccount);
+	varray.GetFaces(faces, fcount);
+	if (varray.GetTexCoordSets() > 0)
+		varray.GetTexCoords(0, texcoords, tcount);
+
+	header.count[VERTICES] = vcount;
+	header.count[NORMALS] = ncount;
+	header.count[TEXCOORDS] = tcount;
+	header.count[COLORS] = ccount;
+	header.count[FACES] = fcount;
+
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if (!out)
+	{
+		error << "Can't write mesh file: " << path << std::endl;
+		return false;
+	}
+
+	// write header twice, the second time with the block offsets
+	out.write((const char *)&header, sizeof(Header));
+	WriteBlock(out, vertices, vcount, header.offset[VERTICES]);
+	WriteBlock(out, normals, ncount, header.offset[NORMALS]);
+	WriteBlock(out, texcoords, tcount, header.offset[TEXCOORDS]);
+	WriteBlock(out, colors, ccount, header.offset[COLORS]);
+	WriteBlock(out, faces, fcount, header.offset[FACES]);
+	out.seekp(0);
+	out.write((const char *)&header, sizeof(Header));
+
+	if (!out)
+	{
+		error << "Failed to write mesh file: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool MeshFile::Open(const std::string & path, std::ostream & error)
+{
+	if (!file.Open(path))
+	{
+		return false;
+	}
+
+	const Header & header = *(const Header *)file.GetData();
+	if (file.GetSize() < sizeof(Header) ||
+		std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0)
+	{
+		error << "Not a mesh file: " << path << std::endl;
+		file.Close();
+		return false;
+	}
+
+	if (header.byteorder != file_byteorder)
+	{
+		error << "Mesh file byte order mismatch, reconvert: " << path << std::endl;
+		file.Close();
+		return false;
+	}
+
+	// check block bounds and alignment, without overflowing offset + count * size
+	const size_t elementsize[BLOCKS] = {sizeof(float), sizeof(float), sizeof(float), sizeof(unsigned char), sizeof(int)};
+	for (int i = 0; i < BLOCKS; ++i)
+	{
+		if (header.offset[i] % block_alignment != 0 || header.count[i] > 0x7fffffff ||
+			header.offset[i] < sizeof(Header) || header.offset[i] > file.GetSize() ||
+			header.count[i] > (file.GetSize() - header.offset[i]) / elementsize[i])
+		{
+			error << "Mesh file is corrupt: " << path << std::endl;
+			file.Close();
+			return false;
+		}
+	}
+
+	// check element counts and face indices, same layout as VertexArray
+	const unsigned int vertexcount = header.count[VERTICES] / 3;
+	bool valid = header.count[VERTICES] % 3 == 0 && header.count[FACES] % 3 == 0 &&
+		(header.count[NORMALS] == 0 || header.count[NORMALS] == vertexcount * 3) &&
+		(header.count[TEXCOORDS] == 0 || header.count[TEXCOORDS] == vertexcount * 2) &&
+		(header.count[COLORS] == 0 || header.count[COLORS] == vertexcount * 4);
+	int fcount;
+	const int * faces = GetFaces(fcount);
+	for (int i = 0; i < fcount && valid; ++i)
+	{
+		valid = (unsigned int)faces[i] < vertexcount;
+	}
+	if (!valid)
+	{
+		error << "Mesh file has invalid faces: " << path << std::endl;
+		file.Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshFile::IsCurrent(const std::string & sourcepath) const
+{
+	unsigned int size, time;
+	if (!GetFileStamp(sourcepath, size, time))
+		return true;
+
+	const Header & header = *(const Header *)file.GetData();
+	return header.sourcesize == size && header.sourcetime == time;
+}
+
+void MeshFile::Close()
+{
+	file.Close();
+}
+
+size_t MeshFile::GetDataSize() const
+{
+	int vcount, ncount, tcount, ccount, fcount;
+	GetVertices(vcount);
+	GetNormals(ncount);
+	GetTexCoords(tcount);
+	GetColors(ccount);
+	GetFaces(fcount);
+	return (vcount + ncount + tcount) * sizeof(float) + ccount * sizeof(unsigned char) + fcount * sizeof(int);
+}
+
+QT_TEST(meshfile_test)
+{
+	const char * filename = "meshfile_test.tmp";
+	std::ostringstream error;
+
+	VertexArray varray;
+	varray.SetToUnitCube();
+	QT_CHECK(MeshFile::Write(filename, varray, error));
+
+	MeshFile mesh;
+	QT_CHECK(!mesh.Open("meshfile_test.missing", error));
+	QT_CHECK(mesh.Open(filename, error));
+
+	const float * vertices, * mvertices;
+	const int * faces, * mfaces;
+	const float * texcoords, * mtexcoords;
+	int vcount, mvcount, fcount, mfcount, tcount, mtcount;
+	varray.GetVertices(vertices, vcount);
+	varray.GetFaces(faces, fcount);
+	varray.GetTexCoords(0, texcoords, tcount);
+	mvertices = mesh.GetVertices(mvcount);
+	mfaces = mesh.GetFaces(mfcount);
+	mtexcoords = mesh.GetTexCoords(mtcount);
+	QT_CHECK_EQUAL(mvcount, vcount);
+	QT_CHECK_EQUAL(mfcount, fcount);
+	QT_CHECK_EQUAL(mtcount, tcount);
+	QT_CHECK(std::memcmp(mvertices, vertices, vcount * sizeof(float)) == 0);
+	QT_CHECK(std::memcmp(mfaces, faces, fcount * sizeof(int)) == 0);
+	QT_CHECK(std::memcmp(mtexcoords, texcoords, tcount * sizeof(float)) == 0);
+	QT_CHECK_EQUAL((size_t)mvertices % 16, 0);
+	QT_CHECK_EQUAL((size_t)mfaces % 16, 0);
+	mesh.Close();
+
+	// out of range face index
+	{
+		std::fstream f(filename, std::ios::binary | std::ios::in | std::ios::out);
+		int padding = (16 - fcount * sizeof(int) % 16) % 16;
+		f.seekp(-(std::streamoff)(sizeof(int) + padding), std::ios::end);
+		int index = vcount;
+		f.write((const char *)&index, sizeof(int));
+	}
+	QT_CHECK(!mesh.Open(filename, error));
+
+	// block end past the file end, count * size would overflow 32 bit offsets
+	{
+		std::fstream f(filename, std::ios::binary | std::ios::in | std::ios::out);
+		unsigned int count = 0x7ffffff0;
+		f.seekp(16 + 4 * sizeof(unsigned int)); // face count, after magic, byte order and 4 counts
+		f.write((const char *)&count, sizeof(count));
+	}
+	QT_CHECK(!mesh.Open(filename, error));
+
+	// source model stamp
+	const char * sourcename = "meshfile_test_source.tmp";
+	{
+		std::ofstream source(sourcename);
+		source << "model";
+	}
+	QT_CHECK(MeshFile::Write(filename, varray, error, sourcename));
+	QT_CHECK(mesh.Open(filename, error));
+	QT_CHECK(mesh.IsCurrent(sourcename));
+	QT_CHECK(mesh.IsCurrent("meshfile_test.missing"));
+	{
+		std::ofstream source(sourcename);
+		source << "changed model";
+	}
+	QT_CHECK(!mesh.IsCurrent(sourcename));
+	mesh.Close();
+
+	// converted without source
+	QT_CHECK(MeshFile::Write(filename, varray, error));
+	QT_CHECK(mesh.Open(filename, error));
+	QT_CHECK(!mesh.IsCurrent(sourcename));
+	mesh.Close();
+	std::remove(sourcename);
+
+	QT_CHECK_EQUAL(MeshFile::GetPath("cars/body.joe"), "cars/body.vmf");
+	QT_CHECK_EQUAL(MeshFile::GetPath("cars.d/body"), "cars.d/body.vmf");
+
+	std::remove(filename);
+}
@@ -0,0 +1,108 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _MESHFILE_H
+#define _MESHFILE_H
+
+#include "mappedfile.h"
+#include <iosfwd>
+#include <string>
+
+class VertexArray;
+
+/// Binary mesh container, memory mapped on load. Data blocks are aligned so
+/// vertex data can be handed to gl buffer uploads and bullet collision meshes
+/// in place. Stored in the byte order of the converting host, files of the other
+/// byte order are rejected. The size and modification time of the source model
+/// are recorded on conversion, so a mesh file older than its source can be detected.
+class MeshFile
+{
+public:
+	/// file extension of converted meshes
+	static const char * const extension;
+
+	/// path of the converted mesh of a model file, extension replaced
+	static std::string GetPath(const std::string & modelpath);
+
+	/// write vertex array mesh data, first tex coord set only
+	/// sourcepath is the model file the mesh was converted from, optional
+	static bool Write(
+		const std::string & path,
+		const VertexArray & varray,
+		std::ostream & error,
+		const std::string & sourcepath = std::string());
+
+	/// map file and validate header, block bounds and face indices
+	bool Open(const std::string & path, std::ostream & error);
+
+	void Close();
+
+	bool IsOpen() const {return file.IsOpen();}
+
+	/// true if sourcepath doesn't exist or matches the recorded source size and time
+	bool IsCurrent(const std::string & sourcepath) const;
+
+	const float * GetVertices(int & count) const {return Get<float>(VERTICES, count);}
+
+	const float * GetNormals(int & count) const {return Get<float>(NORMALS, count);}
+
+	const float * GetTexCoords(int & count) const {return Get<float>(TEXCOORDS, count);}
+
+	const unsigned char * GetColors(int & count) const {return Get<unsigned char>(COLORS, count);}
+
+	const int * GetFaces(int & count) const {return Get<int>(FACES, count);}
+
+	/// size of the mesh data blocks in bytes
+	size_t GetDataSize() const;
+
+private:
+	enum Block
+	{
+		VERTICES,
+		NORMALS,
+		TEXCOORDS,
+		COLORS,
+		FACES,
+		BLOCKS
+	};
+
+	/// 64 byte file header, block offsets are 16 byte aligned
+	struct Header
+	{
+		char magic[8];
+		unsigned int byteorder;
+		unsigned int reserved;
+		unsigned int count[BLOCKS]; ///< element count
+		unsigned int offset[BLOCKS]; ///< from file start
+		unsigned int sourcesize; ///< 0 if converted without source
+		unsigned int sourcetime; ///< modification time, seconds
+	};
+
+	MappedFile file;
+
+	template <typename T>
+	const T * Get(Block block, int & count) const
+	{
+		const Header & header = *(const Header *)file.GetData();
+		count = header.count[block];
+		return count ? (const T *)(file.GetData() + header.offset[block]) : 0;
+	}
+};
+
+#endif // _MESHFILE_H
@@ -18,6 +18,7 @@
 /************************************************************************/
 
 #include "model.h"
+#include "meshfile.h"
 #include "utils.h"
 #include "vertexattribs.h"
 #include "glutil.h"
@@ -54,6 +55,8 @@ Model::Model(const std::string & filepath, std::ostream & error_output) :
 {
 	if (filepath.size() > 4 && filepath.substr(filepath.size()-4) == ".ova")
 		ReadFromFile(filepath, error_output, false);
+	else if (filepath.size() > 4 && filepath.substr(filepath.size()-4) == MeshFile::extension)
+		LoadMeshFile(filepath, error_output);
 	else
 		Load(filepath, error_output, false);
 }
@@ -128,6 +131,7 @@ bool Model::ReadFromFile(const std::string & filepath, std::ostream & error_outp
 		return false;
 	}
 
+	m_file.reset();
 	joeserialize::BinaryInputSerializer s(filein);
 	if (!Serialize(s))
 	{
@@ -146,6 +150,35 @@ bool Model::ReadFromFile(const std::string & filepath, std::ostream & error_outp
 	return true;
 }
 
+bool Model::LoadMeshFile(
+	const std::string & filepath,
+	std::ostream & error_output,
+	const std::string & sourcepath)
+{
+	Clear();
+
+	std::tr1::shared_ptr<MeshFile> file(new MeshFile());
+	if (!file->Open(filepath, error_output))
+		return false;
+
+	if (!sourcepath.empty() && !file->IsCurrent(sourcepath))
+		return false;
+
+	int vertcount, facecount;
+	file->GetVertices(vertcount);
+	file->GetFaces(facecount);
+	if (vertcount <= 0 || facecount <= 0)
+	{
+		error_output << "Mesh file is empty: " << filepath << std::endl;
+		return false;
+	}
+
+	m_file = file;
+	GenerateMeshMetrics();
+
+	return true;
+}
+
 void Model::GenerateListID(std::ostream & error_output)
 {
 	if (HaveListID())
@@ -154,35 +187,23 @@ void Model::GenerateListID(std::ostream & error_output)
 	ClearListID();
 	listid = glGenLists(1);
 
-	const int * faces;
-	const float * verts;
-	const float * norms;
-	const float * tc[1];
-	int facecount;
-	int vertcount;
-	int normcount;
-	int tccount[1];
-
-	m_mesh.GetFaces(faces, facecount);
-	m_mesh.GetVertices(verts, vertcount);
-	m_mesh.GetNormals(norms, normcount);
-	m_mesh.GetTexCoords(0, tc[0], tccount[0]);
-
-	assert(facecount > 0);
-	assert(vertcount > 0);
-	assert(normcount > 0);
-	assert (tccount[0] > 0);
+	const MeshData mesh = GetMeshData();
+
+	assert(mesh.facecount > 0);
+	assert(mesh.vertcount > 0);
+	assert(mesh.normcount > 0);
+	assert(mesh.tccount > 0);
 
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glEnableClientState(GL_NORMAL_ARRAY);
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 
-	glVertexPointer(3, GL_FLOAT, 0, verts);
-	glNormalPointer(GL_FLOAT, 0, norms);
-	glTexCoordPointer(2, GL_FLOAT, 0, tc[0]);
+	glVertexPointer(3, GL_FLOAT, 0, mesh.vertices);
+	glNormalPointer(GL_FLOAT, 0, mesh.normals);
+	glTexCoordPointer(2, GL_FLOAT, 0, mesh.texcoords);
 
 	glNewList(listid, GL_COMPILE);
-	glDrawElements(GL_TRIANGLES, facecount, GL_UNSIGNED_INT, faces);
+	glDrawElements(GL_TRIANGLES, mesh.facecount, GL_UNSIGNED_INT, mesh.faces);
 	glEndList();
 
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -223,10 +244,12 @@ void Model::GenerateVertexArrayObject(std::ostream & error_output)
         std::cout << "created vao " << vao << std::endl;
 	glBindVertexArray(vao);ERROR_CHECK;
 
+	// Mesh data is uploaded in place, from the vertex array or the mapped mesh file.
+	const MeshData mesh = GetMeshData();
+
 	// Buffer object for faces.
-	const int * faces;
-	int facecount;
-	m_mesh.GetFaces(faces, facecount);
+	const int * faces = mesh.faces;
+	int facecount = mesh.facecount;
 	assert(faces && facecount > 0);
 	glGenBuffers(1, &elementVbo);ERROR_CHECK;
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementVbo);ERROR_CHECK;
@@ -234,9 +257,8 @@ void Model::GenerateVertexArrayObject(std::ostream & error_output)
 	elementCount = facecount;
 
 	// Calculate the number of vertices (vertcount is the size of the verts array).
-	const float * verts;
-	int vertcount;
-	m_mesh.GetVertices(verts, vertcount);
+	const float * verts = mesh.vertices;
+	int vertcount = mesh.vertcount;
 	assert(verts && vertcount > 0);
 	unsigned int vertexCount = vertcount/3;
 
@@ -244,9 +266,8 @@ void Model::GenerateVertexArrayObject(std::ostream & error_output)
 	vbos.push_back(GenerateBufferObject(error_output, VERTEX_POSITION, verts, vertexCount, 3));
 
 	// Generate buffer object for normals.
-	const float * norms;
-	int normcount;
-	m_mesh.GetNormals(norms, normcount);
+	const float * norms = mesh.normals;
+	int normcount = mesh.normcount;
 	if (!norms || normcount <= 0)
 		glDisableVertexAttribArray(VERTEX_NORMAL);
 	else
@@ -260,9 +281,8 @@ void Model::GenerateVertexArrayObject(std::ostream & error_output)
 	glDisableVertexAttribArray(VERTEX_BITANGENT);
 
 	// Generate buffer object for colors.
-	const unsigned char * cols = 0;
-	int colcount = 0;
-	m_mesh.GetColors(cols, colcount);
+	const unsigned char * cols = mesh.colors;
+	int colcount = mesh.colcount;
 	if (cols && colcount)
 	{
 		assert((unsigned int)colcount == vertexCount*4);
@@ -272,14 +292,11 @@ void Model::GenerateVertexArrayObject(std::ostream & error_output)
 		glDisableVertexAttribArray(VERTEX_COLOR);
 
 	// Generate buffer object for texture coordinates.
-	const float * tc[1];
-	int tccount[1];
-	if (m_mesh.GetTexCoordSets() > 0)
+	if (mesh.texcoords && mesh.tccount > 0)
 	{
 		// TODO: Make this work for UV1 and UV2.
-		m_mesh.GetTexCoords(0, tc[0], tccount[0]);
-		assert((unsigned int)tccount[0] == vertexCount*2);
-		vbos.push_back(GenerateBufferObject(error_output, VERTEX_UV0, tc[0], vertexCount, 2));
+		assert((unsigned int)mesh.tccount == vertexCount*2);
+		vbos.push_back(GenerateBufferObject(error_output, VERTEX_UV0, mesh.texcoords, vertexCount, 2));
 	}
 	else
 		glDisableVertexAttribArray(VERTEX_UV0);
@@ -344,9 +361,9 @@ void Model::GenerateMeshMetrics()
 	float maxv[3] = {flt_min, flt_min, flt_min};
 	float minv[3] = {flt_max, flt_max, flt_max};
 
-	const float * verts;
-	int vnum3;
-	m_mesh.GetVertices(verts, vnum3);
+	const MeshData mesh = GetMeshData();
+	const float * verts = mesh.vertices;
+	int vnum3 = mesh.vertcount;
 	assert(vnum3);
 
 	for (int n = 0; n < vnum3; n += 3)
@@ -370,6 +387,7 @@ void Model::GenerateMeshMetrics()
 void Model::ClearMeshData()
 {
 	m_mesh.Clear();
+	m_file.reset();
 }
 
 unsigned Model::GetListID() const
@@ -394,9 +412,19 @@ float Model::GetRadius() const
 	return radius;
 }
 
+size_t Model::GetMemorySize() const
+{
+	// gl buffers and lists hold a copy of the mesh data, mapped mesh data is backed by the file
+	const size_t size = m_file.get() ? m_file->GetDataSize() : m_mesh.GetMemorySize();
+	size_t memory = m_file.get() ? 0 : size;
+	if (HaveVertexArrayObject() || HaveListID())
+		memory += size;
+	return memory;
+}
+
 bool Model::HaveMeshData() const
 {
-	return (m_mesh.GetNumFaces() > 0);
+	return (GetMeshData().facecount > 0);
 }
 
 bool Model::HaveMeshMetrics() const
@@ -417,11 +445,58 @@ void Model::Clear()
 	ClearMetrics();
 }
 
+Model::MeshData Model::GetMeshData() const
+{
+	MeshData mesh;
+	if (m_file.get())
+	{
+		mesh.vertices = m_file->GetVertices(mesh.vertcount);
+		mesh.normals = m_file->GetNormals(mesh.normcount);
+		mesh.texcoords = m_file->GetTexCoords(mesh.tccount);
+		mesh.colors = m_file->GetColors(mesh.colcount);
+		mesh.faces = m_file->GetFaces(mesh.facecount);
+		return mesh;
+	}
+
+	m_mesh.GetVertices(mesh.vertices, mesh.vertcount);
+	m_mesh.GetNormals(mesh.normals, mesh.normcount);
+	m_mesh.GetColors(mesh.colors, mesh.colcount);
+	m_mesh.GetFaces(mesh.faces, mesh.facecount);
+	mesh.texcoords = 0;
+	mesh.tccount = 0;
+	if (m_mesh.GetTexCoordSets() > 0)
+		m_mesh.GetTexCoords(0, mesh.texcoords, mesh.tccount);
+	return mesh;
+}
+
 const VertexArray & Model::GetVertexArray() const
 {
 	return m_mesh;
 }
 
+void Model::CopyVertexArray(VertexArray & varray) const
+{
+	if (!m_file.get())
+	{
+		varray = m_mesh;
+		return;
+	}
+
+	const MeshData mesh = GetMeshData();
+	varray.Clear();
+	varray.SetVertices(mesh.vertices, mesh.vertcount);
+	varray.SetFaces(mesh.faces, mesh.facecount);
+	if (mesh.normcount)
+		varray.SetNormals(mesh.normals, mesh.normcount);
+	if (mesh.colcount)
+		varray.SetColors(mesh.colors, mesh.colcount);
+	if (mesh.tccount)
+	{
+		varray.SetTexCoordSets(1);
+		varray.SetTexCoords(0, mesh.texcoords, mesh.tccount);
+	}
+}
+
 void Model::SetVertexArray(const VertexArray & newmesh)
 {
 	Clear();
@@ -436,7 +511,7 @@ void Model::BuildFromVertexArray(const VertexArray & newmesh)
 
 bool Model::Loaded()
 {
-	return (m_mesh.GetNumFaces() > 0);
+	return HaveMeshData();
 }
 
 void Model::RequireMetrics() const
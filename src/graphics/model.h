@@ -22,8 +22,11 @@
 
 #include "vertexarray.h"
 #include "mathvector.h"
+#include "memory.h"
 #include "glew.h"
 
+class MeshFile;
+
 /// Loading data into the mesh vertexarray is implemented by derived classes.
 class Model
 {
@@ -51,6 +54,14 @@ public:
 
 	bool ReadFromFile(const std::string & filepath, std::ostream & error_output, bool generatelistid=true);
 
+	/// Load a memory mapped mesh file, see MeshFile. No display list or vertex buffer objects are generated.
+	/// The mesh data stays in the mapped file, the vertex array is left empty.
+	/// Fails if sourcepath, the model the mesh file was converted from, changed since conversion.
+	bool LoadMeshFile(
+		const std::string & filepath,
+		std::ostream & error_output,
+		const std::string & sourcepath = std::string());
+
 	void GenerateListID(std::ostream & error_output);
 
 	void GenerateVertexArrayObject(std::ostream & error_output);
@@ -76,6 +87,9 @@ public:
 	/// Get bounding radius relative to center.
 	float GetRadius() const;
 
+	/// Get vertex data size in bytes, mesh data plus gl buffers or list.
+	size_t GetMemorySize() const;
+
 	bool HaveMeshData() const;
 
 	bool HaveMeshMetrics() const;
@@ -84,8 +98,28 @@ public:
 
 	void Clear();
 
+	/// Mesh data pointers, into the mapped mesh file if loaded from one, else into the vertex array.
+	struct MeshData
+	{
+		const float * vertices;
+		const float * normals;
+		const float * texcoords; ///< first set
+		const unsigned char * colors;
+		const int * faces;
+		int vertcount;
+		int normcount;
+		int tccount;
+		int colcount;
+		int facecount;
+	};
+	MeshData GetMeshData() const;
+
+	/// Empty if loaded from a mesh file, use GetMeshData or CopyVertexArray.
 	const VertexArray & GetVertexArray() const;
 
+	/// Copy mesh data into a vertex array.
+	void CopyVertexArray(VertexArray & varray) const;
+
 	void SetVertexArray(const VertexArray & newmesh);
 
 	void BuildFromVertexArray(const VertexArray & newmesh);
@@ -104,6 +138,9 @@ private:
 	unsigned elementCount;
 	unsigned listid;			///< listid 0 is invalid, means no display list compiled
 
+	/// Mapped mesh data, replaces m_mesh if set.
+	std::tr1::shared_ptr<MeshFile> m_file;
+
 	// Metrics.
 	Vec3 min;
 	Vec3 max;
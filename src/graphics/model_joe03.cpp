@@ -23,6 +23,8 @@
 #include "endian_utility.h"
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
 using std::vector;
 
 const int ModelJoe03::JOE_MAX_FACES = 32000;
@@ -119,17 +121,30 @@ static void CorrectEndian(std::vector<JoeTexCoord> & p)
 	}
 }
 
-static int BinaryRead ( void * buffer, unsigned int size, unsigned int count, FILE * f, const JoePack * pack )
+// Read source, either a file handle or a file in a memory mapped pack
+struct JoeFile
+{
+	FILE * file;
+	const char * data;
+	unsigned int size;
+	unsigned int pos;
+
+	JoeFile() : file(NULL), data(NULL), size(0), pos(0) {}
+};
+
+static int BinaryRead ( void * buffer, unsigned int size, unsigned int count, JoeFile & f )
 {
 	unsigned int bytesread = 0;
 
-	if ( pack == NULL )
+	if ( f.file != NULL )
 	{
-		bytesread = fread ( buffer, size, count, f );
+		bytesread = fread ( buffer, size, count, f.file );
 	}
 	else
 	{
-		bytesread = pack->fread ( buffer, size, count );
+		bytesread = std::min ( count, ( f.size - f.pos ) / size );
+		memcpy ( buffer, f.data + f.pos, bytesread * size );
+		f.pos += bytesread * size;
 	}
 
 	assert(bytesread == count);
@@ -179,16 +194,35 @@ static bool NeedsNormalSwap(JoeObject & Object)
 }
 
 bool ModelJoe03::Load ( const std::string & filename, std::ostream & err_output, bool genlist, const JoePack * pack)
+{
+	if (!LoadMesh(filename, err_output, pack))
+		return false;
+
+	if (genlist)
+	{
+		//optimize into a static display list
+		GenerateListID(err_output);
+	}
+	else
+	{
+		//optimize into vertex array/buffers
+		GenerateVertexArrayObject(err_output);
+	}
+
+	return true;
+}
+
+bool ModelJoe03::LoadMesh ( const std::string & filename, std::ostream & err_output, const JoePack * pack)
 {
 	Clear();
 
-	FILE * m_FilePointer = NULL;
+	JoeFile file;
 
 	//open file
 	if ( pack == NULL )
 	{
-		m_FilePointer = fopen(filename.c_str(), "rb");
-		if (!m_FilePointer)
+		file.file = fopen(filename.c_str(), "rb");
+		if (!file.file)
 		{
 			err_output << "MODEL_JOE03: Failed to open file " << filename << std::endl;
 			return false;
@@ -196,35 +230,21 @@ bool ModelJoe03::Load ( const std::string & filename, std::ostream & err_output,
 	}
 	else
 	{
-		if (!pack->fopen(filename))
+		// pack files are read from the mapped archive, concurrent loads don't share a read position
+		if (!pack->GetFile(filename, file.data, file.size))
 		{
 			err_output << "MODEL_JOE03: Failed to open file " << filename << " in " << pack->GetPath() << std::endl;
 			return false;
 		}
 	}
 
-	bool val = LoadFromHandle ( m_FilePointer, pack, err_output );
+	bool val = LoadFromHandle ( file, err_output );
 
 	// Clean up after everything
-	if ( pack == NULL )
-		fclose ( m_FilePointer );
-	else
-		pack->fclose();
+	if ( file.file != NULL )
+		fclose ( file.file );
 
-	if (val)
-	{
-		if (genlist)
-		{
-			//optimize into a static display list
-			GenerateListID(err_output);
-		}
-		else
-		{
-			//optimize into vertex array/buffers
-			GenerateVertexArrayObject(err_output);
-		}
-	}
-	else
+	if (!val)
 	{
 		err_output << "in " << filename << std::endl;
 	}
@@ -232,12 +252,12 @@ bool ModelJoe03::Load ( const std::string & filename, std::ostream & err_output,
 	return val;
 }
 
-bool ModelJoe03::LoadFromHandle ( FILE * m_FilePointer, const JoePack * pack, std::ostream & err_output )
+bool ModelJoe03::LoadFromHandle ( JoeFile & file, std::ostream & err_output )
 {
 	JoeObject Object;
 
 	// Read the header data and store it in our variable
-	BinaryRead ( &Object.info, sizeof ( JoeHeader ), 1, m_FilePointer, pack );
+	BinaryRead ( &Object.info, sizeof ( JoeHeader ), 1, file );
 
 	Object.info.magic = ENDIAN_SWAP_32 ( Object.info.magic );
 	Object.info.version = ENDIAN_SWAP_32 ( Object.info.version );
@@ -259,7 +279,7 @@ bool ModelJoe03::LoadFromHandle ( FILE * m_FilePointer, const JoePack * pack, st
 	}
 
 	// Read in the model data
-	ReadData ( m_FilePointer, pack, Object );
+	ReadData ( file, Object );
 
 	//generate metrics such as bounding box, etc
 	GenerateMeshMetrics();
@@ -268,7 +288,7 @@ bool ModelJoe03::LoadFromHandle ( FILE * m_FilePointer, const JoePack * pack, st
 	return true;
 }
 
-void ModelJoe03::ReadData ( FILE * m_FilePointer, const JoePack * pack, JoeObject & Object )
+void ModelJoe03::ReadData ( JoeFile & file, JoeObject & Object )
 {
 	int num_frames = Object.info.num_frames;
 	int num_faces = Object.info.num_faces;
@@ -279,25 +299,25 @@ void ModelJoe03::ReadData ( FILE * m_FilePointer, const JoePack * pack, JoeObjec
 	{
 		Object.frames[i].faces.resize(num_faces);
 
-		BinaryRead ( &Object.frames[i].faces[0], sizeof ( JoeFace ), num_faces, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].faces[0], sizeof ( JoeFace ), num_faces, file );
 		CorrectEndian ( Object.frames[i].faces );
 
-		BinaryRead ( &Object.frames[i].num_verts, sizeof ( int ), 1, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].num_verts, sizeof ( int ), 1, file );
 		Object.frames[i].num_verts = ENDIAN_SWAP_32 ( Object.frames[i].num_verts );
-		BinaryRead ( &Object.frames[i].num_texcoords, sizeof ( int ), 1, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].num_texcoords, sizeof ( int ), 1, file );
 		Object.frames[i].num_texcoords = ENDIAN_SWAP_32 ( Object.frames[i].num_texcoords );
-		BinaryRead ( &Object.frames[i].num_normals, sizeof ( int ), 1, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].num_normals, sizeof ( int ), 1, file );
 		Object.frames[i].num_normals = ENDIAN_SWAP_32 ( Object.frames[i].num_normals );
 
 		Object.frames[i].verts.resize(Object.frames[i].num_verts);
 		Object.frames[i].normals.resize(Object.frames[i].num_normals);
 		Object.frames[i].texcoords.resize(Object.frames[i].num_texcoords);
 
-		BinaryRead ( &Object.frames[i].verts[0], sizeof ( JoeVertex ), Object.frames[i].num_verts, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].verts[0], sizeof ( JoeVertex ), Object.frames[i].num_verts, file );
 		CorrectEndian ( Object.frames[i].verts );
-		BinaryRead ( &Object.frames[i].normals[0], sizeof ( JoeVertex ), Object.frames[i].num_normals, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].normals[0], sizeof ( JoeVertex ), Object.frames[i].num_normals, file );
 		CorrectEndian ( Object.frames[i].normals );
-		BinaryRead ( &Object.frames[i].texcoords[0], sizeof ( JoeTexCoord ), Object.frames[i].num_texcoords, m_FilePointer, pack );
+		BinaryRead ( &Object.frames[i].texcoords[0], sizeof ( JoeTexCoord ), Object.frames[i].num_texcoords, file );
 		CorrectEndian ( Object.frames[i].texcoords );
 	}
 
@@ -25,6 +25,7 @@
 
 class JoePack;
 struct JoeObject;
+struct JoeFile;
 
 // This class handles all of the loading code
 class ModelJoe03 : public Model
@@ -47,6 +48,8 @@ public:
 
 	bool Load(const std::string & strFileName, std::ostream & error_output, bool genlist, const JoePack * pack);
 
+	/// Load mesh data only, no display list or vertex buffer objects are generated.
+	bool LoadMesh(const std::string & strFileName, std::ostream & error_output, const JoePack * pack = 0);
 
 
 private:
@@ -55,9 +58,9 @@ private:
 	static const float MODEL_SCALE;
 
 	// This reads in the data from the MD2 file and stores it in the member variable
-	void ReadData(FILE * m_FilePointer, const JoePack * pack, JoeObject & Object);
+	void ReadData(JoeFile & file, JoeObject & Object);
 
-	bool LoadFromHandle(FILE * f, const JoePack * pack, std::ostream & error_output);
+	bool LoadFromHandle(JoeFile & file, std::ostream & error_output);
 };
 
 #endif
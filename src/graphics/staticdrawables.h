@@ -20,7 +20,7 @@
 #ifndef _STATICDRAWABLES_H
 #define _STATICDRAWABLES_H
 
-#include "aabbtree.h"
+#include "aabbbvh.h"
 #include "scenenode.h"
 
 #include <vector>
@@ -50,7 +50,7 @@ public:
 	void Query(const U & object, std::vector <T*> & output) const {spacetree.Query(object, output);}
 
 private:
-	AabbTreeNode <T*,OBJECTS_PER_NODE> spacetree;
+	AabbBvh <T*,OBJECTS_PER_NODE> spacetree;
 	unsigned int count; ///< cached from spacetree.size()
 };
 
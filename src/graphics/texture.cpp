@@ -35,6 +35,7 @@
 #include <fstream>
 #include <vector>
 #include <cassert>
+#include <algorithm>
 
 static bool IsPowerOfTwo(int x)
 {
@@ -67,6 +68,29 @@ static float Scale(TextureInfo::Size size, float width, float height)
 	return scale;
 }
 
+/// size of an uncompressed image with a full mipmap chain
+static unsigned MipmappedSize(unsigned w, unsigned h, unsigned bytespp)
+{
+	return w * h * bytespp * 4 / 3;
+}
+
+/// channel masks of byte ordered rgb(a) pixel data
+static void GetByteOrderMasks(int bytespp, Uint32 & rmask, Uint32 & gmask, Uint32 & bmask, Uint32 & amask)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	const int shift = (bytespp == 4) ? 0 : 8;
+	rmask = 0xff000000 >> shift;
+	gmask = 0x00ff0000 >> shift;
+	bmask = 0x0000ff00 >> shift;
+	amask = (bytespp == 4) ? 0x000000ff : 0;
+#else
+	rmask = 0x000000ff;
+	gmask = 0x0000ff00;
+	bmask = 0x00ff0000;
+	amask = (bytespp == 4) ? 0xff000000 : 0;
+#endif
+}
+
 static void GetTextureFormat(
 	const SDL_Surface * surface,
 	const TextureInfo & info,
@@ -175,10 +199,27 @@ static void SetSampler(const TextureInfo & info, bool hasmiplevels = false)
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, (float)info.anisotropy);
 }
 
+/// memory used by the bound 2d texture with a full mipmap chain
+/// compressed textures are measured by the driver, the compression ratio depends on the format it picked
+static unsigned GetTextureSize(unsigned w, unsigned h, unsigned bytespp)
+{
+	GLint compressed = GL_FALSE;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	if (compressed == GL_TRUE)
+	{
+		GLint size = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+		if (size > 0)
+			return unsigned(size) * 4 / 3;
+	}
+	return MipmappedSize(w, h, bytespp);
+}
+
 static void GenTexture(
 	const SDL_Surface * surface,
 	const TextureInfo & info,
 	unsigned & id,
+	unsigned & size,
 	bool & alpha,
 	std::ostream & error)
 {
@@ -201,12 +242,16 @@ static void GenTexture(
 	// If we support generatemipmap, go ahead and do it regardless of the info.mipmap setting.
 	// In the GL3 renderer the sampler decides whether or not to do mip filtering, so we conservatively make mipmaps available for all textures.
 	GenerateMipmap(GL_TEXTURE_2D);
+
+	// mipmaps are made available for all textures, see above
+	size = GetTextureSize(surface->w, surface->h, surface->format->BytesPerPixel);
 }
 
 Texture::Texture():
 	m_id(0),
 	m_w(0),
 	m_h(0),
+	m_size(0),
 	m_scale(1.0),
 	m_alpha(false),
 	m_cube(false)
@@ -275,17 +320,7 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 	if (info.data)
 	{
 		Uint32 rmask, gmask, bmask, amask;
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-		rmask = 0xff000000;
-		gmask = 0x00ff0000;
-		bmask = 0x0000ff00;
-		amask = 0x000000ff;
-#else
-		rmask = 0x000000ff;
-		gmask = 0x0000ff00;
-		bmask = 0x00ff0000;
-		amask = 0xff000000;
-#endif
+		GetByteOrderMasks(info.bytespp, rmask, gmask, bmask, amask);
 		orig_surface = SDL_CreateRGBSurfaceFrom(
 			info.data, info.width, info.height,
 			info.bytespp * 8, info.width * info.bytespp,
@@ -343,7 +378,7 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 		m_w = surface->w;
 		m_h = surface->h;
 
-		GenTexture(surface, info, m_id, m_alpha, error);
+		GenTexture(surface, info, m_id, m_size, m_alpha, error);
 	}
 
 	// free the texture surface separately if it's a scaled copy of the original
@@ -352,8 +387,8 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 		SDL_FreeSurface(surface);
 	}
 
-	// free the original surface if it's not a custom surface (used for the track map)
-	if (!info.data && orig_surface)
+	// free the original surface, pixels of a custom surface (info.data) are not freed
+	if (orig_surface)
 	{
 		SDL_FreeSurface(orig_surface);
 	}
@@ -361,6 +396,53 @@ bool Texture::Load(const std::string & path, const TextureInfo & info, std::ostr
 	return true;
 }
 
+void Texture::InitDecoders()
+{
+#if SDL_IMAGE_MAJOR_VERSION > 1 || SDL_IMAGE_MINOR_VERSION > 2 || SDL_IMAGE_PATCHLEVEL >= 8
+	IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
+#endif
+}
+
+bool Texture::Decode(const std::string & path, TextureInfo & info, std::vector<unsigned char> & pixels)
+{
+	SDL_Surface * surface = IMG_Load(path.c_str());
+	if (!surface)
+	{
+		return false;
+	}
+
+	// only byte ordered rgb(a) images can be passed back to Load as info.data
+	const SDL_PixelFormat & format = *surface->format;
+	const int bytespp = format.BytesPerPixel;
+	Uint32 rmask, gmask, bmask, amask;
+	GetByteOrderMasks(bytespp, rmask, gmask, bmask, amask);
+	bool decoded = (bytespp == 3 || bytespp == 4) && !format.palette &&
+		format.Rmask == rmask && format.Gmask == gmask &&
+		format.Bmask == bmask && format.Amask == amask;
+
+	if (decoded)
+	{
+		// copy rows without pitch padding
+		const int rowsize = surface->w * bytespp;
+		pixels.resize(rowsize * surface->h);
+		SDL_LockSurface(surface);
+		for (int i = 0; i < surface->h; ++i)
+		{
+			const unsigned char * row = (const unsigned char *)surface->pixels + i * surface->pitch;
+			std::copy(row, row + rowsize, pixels.begin() + i * rowsize);
+		}
+		SDL_UnlockSurface(surface);
+
+		info.data = &pixels[0];
+		info.width = surface->w;
+		info.height = surface->h;
+		info.bytespp = bytespp;
+	}
+
+	SDL_FreeSurface(surface);
+	return decoded;
+}
+
 void Texture::Unload()
 {
 	if (m_id)
@@ -404,6 +486,7 @@ bool Texture::LoadCubeVerticalCross(const std::string & path, const TextureInfo
 	// upload texture
 	unsigned bytespp = surface->format->BytesPerPixel;
 	std::vector<unsigned char> cubeface(m_w * m_h * bytespp);
+	m_size = 6 * MipmappedSize(m_w, m_h, bytespp);
 	for (int i = 0; i < 6; ++i)
 	{
 		// detect channels
@@ -558,6 +641,7 @@ bool Texture::LoadCube(const std::string & path, const TextureInfo & info, std::
 		}
 		m_w = surface->w;
 		m_h = surface->h;
+		m_size += surface->w * surface->h * surface->format->BytesPerPixel;
 
 		// detect channels
 		int format = GL_RGB;
@@ -710,8 +794,12 @@ bool Texture::LoadDDS(const std::string & path, const TextureInfo & info, std::o
 	}
 
 	// force mipmaps for GL3
+	m_size = texlen;
 	if (levels == 1)
+	{
 		GenerateMipmap(GL_TEXTURE_2D);
+		m_size = texlen * 4 / 3;
+	}
 
 	return true;
 }
@@ -23,6 +23,7 @@
 #include "texture_interface.h"
 #include "textureinfo.h"
 #include <iosfwd>
+#include <vector>
 
 class Texture : public TextureInterface
 {
@@ -49,13 +50,25 @@ public:
 
 	bool IsCube() const {return m_cube;}
 
+	/// estimated texture memory in bytes, including mipmaps
+	unsigned GetMemorySize() const {return m_size;}
+
 	bool Load(const std::string & path, const TextureInfo & info, std::ostream & error);
 
+	/// init image decoders, call from the main thread before using Decode concurrently
+	static void InitDecoders();
+
+	/// decode an rgb(a) image file into pixels without touching gl, safe to call
+	/// from worker threads, the result is passed to Load via info.data
+	/// return false if the file can not be decoded this way, Load(path) handles it
+	static bool Decode(const std::string & path, TextureInfo & info, std::vector<unsigned char> & pixels);
+
 	void Unload();
 
 private:
 	unsigned m_id;
 	unsigned m_w, m_h;	///< w and h are post-texture-size transform
+	unsigned m_size;	///< estimated texture memory
 	float m_scale;		///< amount of scaling applied by the texture-size transform
 	bool m_alpha;
 	bool m_cube;
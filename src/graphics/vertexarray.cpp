@@ -162,6 +162,19 @@ void VertexArray::GetTexCoords(size_t set, const float * & output_array_pointer,
 	output_array_pointer = texcoords[set].empty() ? NULL : &texcoords[set][0];
 }
 
+size_t VertexArray::GetMemorySize() const
+{
+	size_t size = colors.size() * sizeof(unsigned char);
+	size += normals.size() * sizeof(float);
+	size += vertices.size() * sizeof(float);
+	size += faces.size() * sizeof(int);
+	for (size_t i = 0; i < texcoords.size(); ++i)
+	{
+		size += texcoords[i].size() * sizeof(float);
+	}
+	return size;
+}
+
 #define COMBINEVECTORS(vname) {out.vname.reserve(vname.size() + v.vname.size());out.vname.insert(out.vname.end(), vname.begin(), vname.end());out.vname.insert(out.vname.end(), v.vname.begin(), v.vname.end());}
 
 VertexArray VertexArray::operator+ (const VertexArray & v) const
@@ -76,6 +76,9 @@ public:
 
 	int GetNumFaces() const { return faces.size(); }
 
+	/// size of the vertex data in bytes
+	size_t GetMemorySize() const;
+
 	/// helper functions
 
 	void SetToBillboard(float x1, float y1, float x2, float y2);
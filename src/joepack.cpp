@@ -18,16 +18,16 @@
 /************************************************************************/
 
 #include "joepack.h"
+#include "mappedfile.h"
 #include "endian_utility.h"
+#include "unordered_map.h"
 #include "unittest.h"
 
-#include <map>
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <cassert>
 
 using std::string;
-using std::map;
-using std::ios_base;
 
 struct JoePack::Impl
 {
@@ -37,132 +37,149 @@ struct JoePack::Impl
 		unsigned offset;
 		unsigned length;
 	};
+	typedef std::tr1::unordered_map <std::string, FatEntry> fat_type;
 	const std::string versionstr;
-	std::map <std::string, FatEntry> fat;
-	std::map <std::string, FatEntry>::iterator curfa;
-	std::ifstream f;
+	fat_type fat;
+	MappedFile file;
+
+	// fopen/fread state
+	fat_type::const_iterator curfa;
+	unsigned curpos;
 
 	Impl();
 	bool Load(const string & fn);
 	void Close();
+	bool GetFile(const string & fn, const char * & data, unsigned & size) const;
 	void fclose();
 	bool fopen(const string & fn);
 	int fread(void * buffer, const unsigned size, const unsigned count);
 };
 
-JoePack::Impl::Impl() : versionstr("JPK01.00")
+JoePack::Impl::Impl() : versionstr("JPK01.00"), curpos(0)
 {
 	curfa = fat.end();
 }
 
+static unsigned ReadUnsigned(const char * data)
+{
+	unsigned int value;
+	assert(sizeof(unsigned int) == 4);
+	std::memcpy(&value, data, sizeof(unsigned int));
+	return ENDIAN_SWAP_32(value);
+}
+
 bool JoePack::Impl::Load(const string & fn)
 {
 	Close();
-	f.clear();
-	f.open(fn.c_str(), ios_base::binary);
-	if (f)
+	if (!file.Open(fn))
 	{
-		//load header
-		char * versioncstr = new char[versionstr.length() + 1];
-		f.read(versioncstr, versionstr.length());
-		versioncstr[versionstr.length()] = '\0';
-		string fversionstr = versioncstr;
-		delete [] versioncstr;
-		if (fversionstr != versionstr)
-		{
-			//write out an error?
-			return false;
-		}
+		//write an error?
+		return false;
+	}
+
+	//load header
+	const char * data = file.GetData();
+	const size_t size = file.GetSize();
+	const size_t headersize = versionstr.length() + 2 * sizeof(unsigned int);
+	if (size < headersize || versionstr.compare(0, versionstr.length(), data, versionstr.length()) != 0)
+	{
+		//write out an error?
+		Close();
+		return false;
+	}
 
-		unsigned int numobjs = 0;
-		assert(sizeof(unsigned int) == 4);
-		f.read((char*)(&numobjs), sizeof(unsigned int));
-		numobjs = ENDIAN_SWAP_32(numobjs);
+	const char * pos = data + versionstr.length();
+	unsigned int numobjs = ReadUnsigned(pos);
+	pos += sizeof(unsigned int);
 
-		//DPRINT(numobjs << " objects");
+	//DPRINT(numobjs << " objects");
 
-		unsigned int maxstrlen = 0;
-		f.read((char*)(&maxstrlen), sizeof(unsigned int));
-		maxstrlen = ENDIAN_SWAP_32(maxstrlen);
+	unsigned int maxstrlen = ReadUnsigned(pos);
+	pos += sizeof(unsigned int);
 
-		//DPRINT(maxstrlen << " max string length");
+	//DPRINT(maxstrlen << " max string length");
 
-		char * fnch = new char[maxstrlen+1];
+	const size_t entrysize = 2 * sizeof(unsigned int) + maxstrlen;
+	if (numobjs > (size - headersize) / entrysize)
+	{
+		Close();
+		return false;
+	}
 
-		//load FAT
-		for (unsigned int i = 0; i < numobjs; i++)
+	//load FAT
+	fat.rehash(numobjs);
+	for (unsigned int i = 0; i < numobjs; i++, pos += entrysize)
+	{
+		FatEntry fa;
+		fa.offset = ReadUnsigned(pos);
+		fa.length = ReadUnsigned(pos + sizeof(unsigned int));
+		if (fa.offset > size || fa.length > size - fa.offset)
 		{
-			FatEntry fa;
-			f.read((char*)(&(fa.offset)), sizeof(unsigned int));
-			fa.offset = ENDIAN_SWAP_32(fa.offset);
-			f.read((char*)(&(fa.length)), sizeof(unsigned int));
-			fa.length = ENDIAN_SWAP_32(fa.length);
-			f.read(fnch, maxstrlen);
-			fnch[maxstrlen] = '\0';
-			string filename = fnch;
-			fat[filename] = fa;
-
-			//DPRINT(filename << ": offest " << fa.offset << " length " << fa.length);
+			Close();
+			return false;
 		}
 
-		delete [] fnch;
-		return true;
-	}
-	else
-	{
-		//write an error?
-		return false;
+		const char * fnch = pos + 2 * sizeof(unsigned int);
+		string filename(fnch, std::find(fnch, fnch + maxstrlen, '\0'));
+		fat[filename] = fa;
+
+		//DPRINT(filename << ": offest " << fa.offset << " length " << fa.length);
 	}
+
+	return true;
 }
 
 void JoePack::Impl::Close()
 {
-	if (f.is_open()) f.close();
+	file.Close();
 	fat.clear();
 	curfa = fat.end();
+	curpos = 0;
+}
+
+bool JoePack::Impl::GetFile(const string & fn, const char * & data, unsigned & size) const
+{
+	fat_type::const_iterator i = fat.find(fn);
+	if (i == fat.end())
+	{
+		return false;
+	}
+	data = file.GetData() + i->second.offset;
+	size = i->second.length;
+	return true;
 }
 
 void JoePack::Impl::fclose()
 {
 	curfa = fat.end();
+	curpos = 0;
 }
 
 bool JoePack::Impl::fopen(const string & fn)
 {
 	curfa = fat.find(fn);
-	if (curfa == fat.end())
-	{
-		return false;
-	}
-	else
-	{
-		f.seekg(curfa->second.offset);
-		return true;
-	}
+	curpos = 0;
+	return curfa != fat.end();
 }
 
 int JoePack::Impl::fread(void * buffer, const unsigned size, const unsigned count)
 {
 	if (curfa != fat.end())
 	{
-		unsigned int abspos = f.tellg();
-		assert(abspos >= curfa->second.offset);
-		unsigned int relpos = abspos - curfa->second.offset;
-		assert(curfa->second.length >= relpos);
-		unsigned int fileleft = curfa->second.length - relpos;
-		unsigned int requestedread = size*count;
-
 		assert(size != 0);
-
-		if (requestedread > fileleft)
+		assert(curfa->second.length >= curpos);
+		unsigned int fileleft = curfa->second.length - curpos;
+		unsigned int readcount = count;
+		if (size * count > fileleft)
 		{
 			//overflow
-			requestedread = fileleft/size;
+			readcount = fileleft / size;
 		}
 
-		//DPRINT("JOEPACK fread: " << abspos << "," << relpos << "," << fileleft << "," << requestedread);
-		f.read((char *)buffer, requestedread);
-		return f.gcount()/size;
+		unsigned int readsize = readcount * size;
+		std::memcpy(buffer, file.GetData() + curfa->second.offset + curpos, readsize);
+		curpos += readsize;
+		return readcount;
 	}
 	else
 	{
@@ -194,6 +211,20 @@ void JoePack::Close()
 	impl->Close();
 }
 
+string JoePack::GetName(const string & fn) const
+{
+	if (fn.find(packpath, 0) < fn.length())
+	{
+		return fn.substr(packpath.length()+1);
+	}
+	return fn;
+}
+
+bool JoePack::GetFile(const string & fn, const char * & data, unsigned & size) const
+{
+	return impl->GetFile(GetName(fn), data, size);
+}
+
 void JoePack::fclose() const
 {
 	impl->fclose();
@@ -201,16 +232,7 @@ void JoePack::fclose() const
 
 bool JoePack::fopen(const string & fn) const
 {
-	string newfn;
-	if (fn.find(packpath, 0) < fn.length())
-	{
-		newfn = fn.substr(packpath.length()+1);
-	}
-	else
-	{
-		newfn = fn;
-	}
-	return impl->fopen(newfn);
+	return impl->fopen(GetName(fn));
 }
 
 int JoePack::fread(void * buffer, const unsigned size, const unsigned count) const
@@ -230,4 +252,10 @@ QT_TEST(joepack_test)
 	string comparisonstr = "This is\na test.\n";
 	string filestr = buf;
 	QT_CHECK_EQUAL(buf,comparisonstr);
+
+	const char * data = 0;
+	unsigned size = 0;
+	QT_CHECK(p.GetFile("testlist.txt", data, size));
+	QT_CHECK_EQUAL(string(data, size), comparisonstr);
+	QT_CHECK(!p.GetFile("missing.txt", data, size));
 }
@@ -22,6 +22,9 @@
 
 #include <string>
 
+/// Read only access to the files of a joe pack archive. The archive is memory
+/// mapped and indexed on Load, GetFile is thread safe afterwards.
+/// The fopen/fread interface keeps a single read position and is not.
 class JoePack
 {
 public:
@@ -35,6 +38,10 @@ public:
 
 	void Close();
 
+	/// get the contents of a file in the pack, data points into the mapped
+	/// archive and stays valid until the pack is closed
+	bool GetFile(const std::string & fn, const char * & data, unsigned & size) const;
+
 	bool fopen(const std::string & fn) const;
 
 	void fclose() const;
@@ -45,6 +52,9 @@ private:
 	std::string packpath;
 	struct Impl;
 	Impl* impl;
+
+	/// strip the pack path from fn
+	std::string GetName(const std::string & fn) const;
 };
 
 #endif
@@ -21,6 +21,7 @@
 #include "unittest.h"
 
 #include <list>
+#include <deque>
 #include <map>
 #include <vector>
 #include <iostream>
@@ -614,6 +615,85 @@ QT_TEST(serialization_vector_bugs_test)
 	}
 }
 
+QT_TEST(serialization_bulk_vector_test)
+{
+	vector <float> floats;
+	vector <int> ints;
+	vector <double> doubles;
+	std::deque <float> floatitems;
+	std::deque <int> intitems;
+	std::deque <double> doubleitems;
+	for (int i = 0; i < 3000; i++)
+	{
+		floats.push_back(i * 0.25f - 100);
+		ints.push_back(i * 7919 - 65536);
+		doubles.push_back(i * 1.337);
+	}
+	floatitems.assign(floats.begin(), floats.end());
+	intitems.assign(ints.begin(), ints.end());
+	doubleitems.assign(doubles.begin(), doubles.end());
+
+	//bulk vectors are written like per item containers
+	stringstream bulkstream, itemstream;
+	{
+		BinaryOutputSerializer bulkout(bulkstream);
+		Serializer & bulk = bulkout;
+		QT_CHECK(bulk.Serialize("floats", floats));
+		QT_CHECK(bulk.Serialize("ints", ints));
+		QT_CHECK(bulk.Serialize("doubles", doubles));
+
+		BinaryOutputSerializer itemout(itemstream);
+		Serializer & item = itemout;
+		QT_CHECK(item.Serialize("floats", floatitems));
+		QT_CHECK(item.Serialize("ints", intitems));
+		QT_CHECK(item.Serialize("doubles", doubleitems));
+	}
+	QT_CHECK(bulkstream.str() == itemstream.str());
+
+	{
+		vector <float> floats2(5, 1.0f);
+		vector <int> ints2;
+		vector <double> doubles2;
+		BinaryInputSerializer bulkin(itemstream);
+		Serializer & bulk = bulkin;
+		QT_CHECK(bulk.Serialize("floats", floats2));
+		QT_CHECK(bulk.Serialize("ints", ints2));
+		QT_CHECK(bulk.Serialize("doubles", doubles2));
+		QT_CHECK(floats2 == floats);
+		QT_CHECK(ints2 == ints);
+		QT_CHECK(doubles2 == doubles);
+
+		//truncated data fails
+		vector <float> floats3;
+		stringstream truncated(bulkstream.str().substr(0, 1000));
+		BinaryInputSerializer truncatedin(truncated);
+		Serializer & t = truncatedin;
+		QT_CHECK(!t.Serialize("floats", floats3));
+	}
+
+	//text format is unchanged
+	stringstream textstream, textitemstream;
+	{
+		TextOutputSerializer textout(textstream);
+		Serializer & text = textout;
+		QT_CHECK(text.Serialize("ints", ints));
+
+		TextOutputSerializer textitemout(textitemstream);
+		Serializer & textitem = textitemout;
+		QT_CHECK(textitem.Serialize("ints", intitems));
+	}
+	QT_CHECK(textstream.str() == textitemstream.str());
+	{
+		vector <int> ints2;
+		TextInputSerializer textin;
+		textin.set_error_output(cerr);
+		QT_CHECK(textin.Parse(textstream));
+		Serializer & text = textin;
+		QT_CHECK(text.Serialize("ints", ints2));
+		QT_CHECK(ints2 == ints);
+	}
+}
+
 class TestSettings
 {
 	public:
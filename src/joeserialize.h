@@ -20,6 +20,7 @@
 #ifndef _JOESERIALIZE_H
 #define _JOESERIALIZE_H
 
+#include <algorithm>
 #include <list>
 #include <deque>
 #include <map>
@@ -49,6 +50,42 @@ class Serializer
 		///optional hints to higher level classes about where we are in the serialization process
 		virtual void ComplexTypeEnd(const std::string & name) { (void) name; }
 
+		///serialization of a contiguous array of simple types. by default the elements are serialized one by one as "*item1", "*item2"...
+		///serializers that ignore names should override these to read or write the whole array at once. returns true on success
+		virtual bool SerializeArray(int * t, int count) { return SerializeItems(t, count); }
+		virtual bool SerializeArray(unsigned int * t, int count) { return SerializeItems(t, count); }
+		virtual bool SerializeArray(float * t, int count) { return SerializeItems(t, count); }
+		virtual bool SerializeArray(double * t, int count) { return SerializeItems(t, count); }
+
+		template <typename T>
+		bool SerializeItems(T * t, int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				std::stringstream itemname;
+				itemname << "*item" << i+1;
+				if (!this->Serialize(itemname.str(), t[i])) return false;
+			}
+			return true;
+		}
+
+		///vectors of simple types, same layout as the generic vector serialization but the elements go through SerializeArray
+		template <typename T>
+		bool SerializeVector(const std::string & name, std::vector <T> & t)
+		{
+			ComplexTypeStart(name);
+			int listsize = t.size();
+			if (!this->Serialize("*size", listsize)) return false;
+			if (listsize < 0) return false;
+			if (this->GetIODirection() == DIRECTION_INPUT)
+			{
+				t.resize(listsize); //only resize, don't clear; we don't want to throw away information
+			}
+			if (listsize > 0 && !SerializeArray(&t[0], listsize)) return false;
+			ComplexTypeEnd(name);
+			return true;
+		}
+
 	public:
 		///generic serialization function that will be called for complex types; this is a branch. returns true on success
 		template <typename T>
@@ -214,6 +251,12 @@ class Serializer
 			return true;
 		}
 
+		///vectors of simple types are serialized as arrays, see SerializeArray
+		bool Serialize(const std::string & name, std::vector <int> & t) { return SerializeVector(name, t); }
+		bool Serialize(const std::string & name, std::vector <unsigned int> & t) { return SerializeVector(name, t); }
+		bool Serialize(const std::string & name, std::vector <float> & t) { return SerializeVector(name, t); }
+		bool Serialize(const std::string & name, std::vector <double> & t) { return SerializeVector(name, t); }
+
 		/// \verbatim vector <bool> is special \endverbatim
 		bool Serialize(const std::string & name, std::vector <bool> & t)
 		{
@@ -1147,6 +1190,42 @@ class BinaryOutputSerializer : public SerializerOutput
 			return !out_.bad();
 		}
 
+		///same output as WriteData per element, byte swapped through a small buffer
+		template <typename T>
+		bool WriteArray(const T * t, int count)
+		{
+			if (bigendian_)
+			{
+				out_.write(reinterpret_cast<const char *>(t), count * sizeof(T));
+				return !out_.bad();
+			}
+
+			const int buffersize = 1024;
+			unsigned char buffer[buffersize * sizeof(T)];
+			while (count > 0)
+			{
+				int n = std::min(count, buffersize);
+				const unsigned char * b = reinterpret_cast<const unsigned char *>(t);
+				for (int i = 0; i < n; i++)
+				{
+					for (unsigned int j = 0; j < sizeof(T); j++)
+					{
+						buffer[i * sizeof(T) + j] = b[i * sizeof(T) + sizeof(T) - 1 - j];
+					}
+				}
+				out_.write(reinterpret_cast<const char *>(buffer), n * sizeof(T));
+				t += n;
+				count -= n;
+			}
+			return !out_.bad();
+		}
+
+	protected:
+		virtual bool SerializeArray(int * t, int count) { return WriteArray(t, count); }
+		virtual bool SerializeArray(unsigned int * t, int count) { return WriteArray(t, count); }
+		virtual bool SerializeArray(float * t, int count) { return WriteArray(t, count); }
+		virtual bool SerializeArray(double * t, int count) { return WriteArray(t, count); }
+
 	public:
 		BinaryOutputSerializer(std::ostream & newout) : out_(newout),bigendian_(IsBigEndian()) {}
 
@@ -1241,6 +1320,32 @@ class BinaryInputSerializer : public SerializerInput
 			return true;
 		}
 
+		///same input as ReadData per element, read in one go and byte swapped in place
+		template <typename T>
+		bool ReadArray(T * t, int count)
+		{
+			if (in_.eof()) return false;
+			const std::streamsize size = count * sizeof(T);
+			in_.read(reinterpret_cast<char *>(t), size);
+			if (in_.fail() || in_.gcount() != size) return false;
+
+			if (!bigendian_)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					ByteSwap(reinterpret_cast<unsigned char *>(t + i), sizeof(T));
+				}
+			}
+
+			return true;
+		}
+
+	protected:
+		virtual bool SerializeArray(int * t, int count) { return ReadArray(t, count); }
+		virtual bool SerializeArray(unsigned int * t, int count) { return ReadArray(t, count); }
+		virtual bool SerializeArray(float * t, int count) { return ReadArray(t, count); }
+		virtual bool SerializeArray(double * t, int count) { return ReadArray(t, count); }
+
 	public:
 		BinaryInputSerializer(std::istream & newin) : in_(newin),bigendian_(IsBigEndian()) {}
 
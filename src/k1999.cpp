@@ -28,8 +28,15 @@
 
 #include "k1999.h"
 #include "roadstrip.h"
+#include "pathmanager.h"
 
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
 
 #define SecurityR   100.0 // Security radius
 #define SideDistExt 2.0 // Security distance wrt outside
@@ -39,6 +46,36 @@
 #define Min(X,Y) ((X)<(Y)?(X):(Y))
 #define Max(X,Y) ((X)>(Y)?(X):(Y))
 
+static const char cache_magic[8] = {'V', 'D', 'K', '1', '9', '9', '9', '1'};
+
+/// cache file header, followed by lane and curvature of each division
+struct CacheHeader
+{
+	char magic[8];
+	unsigned long long hash; ///< road geometry hash
+	unsigned int divs;
+	unsigned int reserved;
+};
+
+/// 64 bit fnv-1a
+static unsigned long long HashData(const void * data, size_t size, unsigned long long hash)
+{
+	const unsigned char * bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static std::string GetCacheName(const std::string & cachepath, unsigned long long hash)
+{
+	std::ostringstream filename;
+	filename << cachepath << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".k1999";
+	return filename.str();
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Update tx and ty arrays
 /////////////////////////////////////////////////////////////////////////////
@@ -315,6 +352,19 @@ bool K1999::LoadData(const RoadStrip & road)
 		count++;
 	}
 
+	// the smoothing parameters are part of the key, changing them invalidates cached lines
+	const double params[] = {SecurityR, SideDistExt, SideDistInt, Iterations};
+	Hash = 14695981039346656037ULL;
+	Hash = HashData(params, sizeof(params), Hash);
+	Hash = HashData(&Divs, sizeof(Divs), Hash);
+	if (Divs > 0)
+	{
+		Hash = HashData(&txLeft[0], Divs * sizeof(double), Hash);
+		Hash = HashData(&tyLeft[0], Divs * sizeof(double), Hash);
+		Hash = HashData(&txRight[0], Divs * sizeof(double), Hash);
+		Hash = HashData(&tyRight[0], Divs * sizeof(double), Hash);
+	}
+
 	if (road.GetClosed()) //a closed circuit
 		return true;
 	else
@@ -344,3 +394,58 @@ void K1999::UpdateRoadStrip(RoadStrip & road)
 	tyRight.clear();
 	tLane.clear();
 }
+
+bool K1999::LoadCached(const std::string & cachepath)
+{
+	if (cachepath.empty())
+		return false;
+
+	std::ifstream file(GetCacheName(cachepath, Hash).c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	CacheHeader header;
+	if (!file.read((char *)&header, sizeof(header)) ||
+		std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) ||
+		header.hash != Hash ||
+		header.divs != (unsigned int)Divs)
+		return false;
+
+	std::vector <double> lane(Divs), rinverse(Divs);
+	if (Divs > 0 &&
+		(!file.read((char *)&lane[0], Divs * sizeof(double)) ||
+		!file.read((char *)&rinverse[0], Divs * sizeof(double))))
+		return false;
+
+	tLane.swap(lane);
+	tRInverse.swap(rinverse);
+	for (int i = 0; i < Divs; ++i)
+		UpdateTxTy(i);
+
+	return true;
+}
+
+void K1999::WriteCached(const std::string & cachepath) const
+{
+	if (cachepath.empty() || Divs <= 0)
+		return;
+
+	CacheHeader header;
+	std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.hash = Hash;
+	header.divs = Divs;
+	header.reserved = 0;
+
+	// write to a temporary file first, threads might store the same road
+	const std::string filename = GetCacheName(cachepath, Hash);
+	std::ostringstream tmpname;
+	tmpname << filename << "." << this << ".tmp";
+	std::ofstream file(tmpname.str().c_str(), std::ios::binary);
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)&tLane[0], Divs * sizeof(double));
+	file.write((const char *)&tRInverse[0], Divs * sizeof(double));
+	file.close();
+
+	if (!file || !PathManager::RenameFile(tmpname.str(), filename))
+		std::remove(tmpname.str().c_str());
+}
@@ -30,6 +30,7 @@
 #define _K1999_H
 
 #include <vector>
+#include <string>
 #include <iosfwd>
 
 class RoadStrip;
@@ -46,6 +47,7 @@ private:
 	std::vector <double> tyRight;
 	std::vector <double> tLane;
 	int Divs;
+	unsigned long long Hash; ///< road geometry hash, keys the racing line cache
 
 	void UpdateTxTy(int i);
 	double GetRInverse(int prev, double x, double y, int next);
@@ -62,6 +64,14 @@ public:
 	bool LoadData(const RoadStrip & road);
 	void CalcRaceLine();
 	void UpdateRoadStrip(RoadStrip & road);
+
+	/// Load the racing line of the road from a cache file in cachepath, call after LoadData.
+	/// Cache files are keyed by a hash of the road geometry, the reversed road has its own file.
+	/// Returns false if there is no valid cache file, an empty cachepath disables the cache.
+	bool LoadCached(const std::string & cachepath);
+
+	/// Write the racing line computed by CalcRaceLine to the cache.
+	void WriteCached(const std::string & cachepath) const;
 };
 
 #endif //_K1999_H
@@ -43,6 +43,25 @@ LoadDrawable::LoadDrawable(
 	// ctor
 }
 
+void LoadDrawable::ScaleMesh(
+	const std::string & meshname,
+	const std::string & scalestr,
+	std::tr1::shared_ptr<Model> & mesh)
+{
+	if (!scalestr.empty() &&
+		!content.get(mesh, path, meshname + scalestr))
+	{
+		Vec3 scale;
+		std::stringstream s(scalestr);
+		s >> scale;
+
+		VertexArray meshva;
+		mesh->CopyVertexArray(meshva);
+		meshva.Scale(scale[0], scale[1], scale[2]);
+		content.load(mesh, path, meshname + scalestr, meshva);
+	}
+}
+
 bool LoadDrawable::operator()(
 	const PTree & cfg,
 	SceneNode & topnode,
@@ -68,62 +87,77 @@ bool LoadDrawable::operator()(
 {
 	Drawable drawable;
 
-	// set textures
-	std::tr1::shared_ptr<Texture> tex[3];
-	TextureInfo texinfo;
-	texinfo.mipmap = true;
-	texinfo.anisotropy = anisotropy;
 	if (texname.empty())
 	{
 		error << "No texture defined" << std::endl;
 		return false;
 	}
-	else
-	{
-		content.load(tex[0], path, texname[0], texinfo);
-		textures.insert(tex[0]);
-	}
+
+	// decode textures and mesh on the loader threads
+	ContentManager::Future<Texture> texfuture[3];
+	ContentManager::Future<Model> meshfuture;
+	TextureInfo texinfo;
+	texinfo.mipmap = true;
+	texinfo.anisotropy = anisotropy;
+	content.loadAsync(texfuture[0], path, texname[0], texinfo);
 	if (texname.size() > 1)
 	{
-		content.load(tex[1], path, texname[1], texinfo);
-		textures.insert(tex[1]);
-	}
-	else
-	{
-		tex[1] = content.getFactory<Texture>().getZero();
+		content.loadAsync(texfuture[1], path, texname[1], texinfo);
 	}
 	if (texname.size() > 2)
 	{
 		// don't compress normal map
 		texinfo.compress = false;
-		content.load(tex[2], path, texname[2], texinfo);
-		textures.insert(tex[2]);
+		content.loadAsync(texfuture[2], path, texname[2], texinfo);
 	}
-	else
+	content.loadAsync(meshfuture, path, meshname);
+
+	// optional low detail mesh
+	ContentManager::Future<Model> lodmeshfuture;
+	std::string lodmeshname;
+	if (cfg.get("mesh-lod", lodmeshname))
 	{
-		tex[2] = content.getFactory<Texture>().getZero();
+		content.loadAsync(lodmeshfuture, path, lodmeshname);
+	}
+
+	// set textures
+	std::tr1::shared_ptr<Texture> tex[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		if (i < texname.size())
+		{
+			content.wait(texfuture[i], tex[i]);
+			textures.insert(tex[i]);
+		}
+		else
+		{
+			tex[i] = content.getFactory<Texture>().getZero();
+		}
 	}
 	drawable.SetTextures(tex[0]->GetID(), tex[1]->GetID(), tex[2]->GetID());
 
 	// set mesh
 	std::tr1::shared_ptr<Model> mesh;
-	content.load(mesh, path, meshname);
+	content.wait(meshfuture, mesh);
 
 	std::string scalestr;
-	if (cfg.get("scale", scalestr) &&
-		!content.get(mesh, path, meshname + scalestr))
-	{
-		Vec3 scale;
-		std::stringstream s(scalestr);
-		s >> scale;
-
-		VertexArray meshva = mesh->GetVertexArray();
-		meshva.Scale(scale[0], scale[1], scale[2]);
-		content.load(mesh, path, meshname + scalestr, meshva);
-	}
+	cfg.get("scale", scalestr);
+	ScaleMesh(meshname, scalestr, mesh);
 	drawable.SetModel(*mesh);
 	models.insert(mesh);
 
+	if (!lodmeshname.empty())
+	{
+		std::tr1::shared_ptr<Model> lodmesh;
+		content.wait(lodmeshfuture, lodmesh);
+		ScaleMesh(lodmeshname, scalestr, lodmesh);
+
+		float loddistance = 50;
+		cfg.get("lod-distance", loddistance);
+		drawable.SetLodModel(*lodmesh, loddistance);
+		models.insert(lodmesh);
+	}
+
 	// set color
 	Vec4 col(1);
 	if (cfg.get("color", col))
@@ -36,6 +36,8 @@ class PTree;
 // [foo]
 // texture = diff.png, spec.png, norm.png		#required
 // mesh = model.joe								#required
+// mesh-lod = model-lod.joe						#optional low detail mesh
+// lod-distance = 50							#optional low detail mesh distance
 // position = 0.736, 1.14, -0.47				#optional relative to parent
 // rotation = 0, 0, 30							#optional relative to parent
 // scale = -1, 1, 1								#optional
@@ -72,6 +74,12 @@ struct LoadDrawable
 		SceneNode & topnode,
 		keyed_container<SceneNode>::handle * nodeptr = 0,
 		keyed_container<Drawable>::handle * drawptr = 0);
+
+	// replace mesh by a scaled copy if scalestr is not empty
+	void ScaleMesh(
+		const std::string & meshname,
+		const std::string & scalestr,
+		std::tr1::shared_ptr<Model> & mesh);
 };
 
 #endif // _LOADDRAWABLE_H
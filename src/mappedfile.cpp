@@ -0,0 +1,164 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "mappedfile.h"
+#include "unittest.h"
+
+#include <fstream>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	data(0),
+	size(0)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE),
+	mapping(0)
+#endif
+{
+	// ctor
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string & path, bool copy_on_write)
+{
+	Close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx(file, &filesize) || filesize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, 0, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+
+	data = (char *)MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	size = filesize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	data = 0;
+	size = 0;
+	mapping = 0;
+	file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string & path, bool copy_on_write)
+{
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat filestat;
+	if (fstat(fd, &filestat) != 0 || filestat.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	int protection = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+	void * addr = mmap(0, filestat.st_size, protection, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return false;
+
+	data = (char *)addr;
+	size = filestat.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		munmap(data, size);
+	data = 0;
+	size = 0;
+}
+
+#endif
+
+QT_TEST(mappedfile_test)
+{
+	const char * filename = "mappedfile_test.tmp";
+	{
+		std::ofstream f(filename, std::ios::binary);
+		f << "0123456789";
+	}
+
+	MappedFile file;
+	QT_CHECK(!file.Open("mappedfile_test.missing"));
+	QT_CHECK(file.Open(filename));
+	QT_CHECK_EQUAL(file.GetSize(), 10);
+	QT_CHECK_EQUAL(std::string(file.GetData(), file.GetSize()), "0123456789");
+
+	// copy on write changes stay in memory
+	QT_CHECK(file.Open(filename, true));
+	file.GetData()[0] = 'x';
+	QT_CHECK_EQUAL(file.GetData()[0], 'x');
+	file.Close();
+	QT_CHECK(!file.IsOpen());
+	QT_CHECK(file.Open(filename));
+	QT_CHECK_EQUAL(file.GetData()[0], '0');
+	file.Close();
+
+	std::remove(filename);
+}
@@ -0,0 +1,60 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+/// Memory mapped file. The mapping is read only by default, a copy on write
+/// mapping can be modified in memory, changes are never written to the file.
+class MappedFile
+{
+public:
+	MappedFile();
+
+	~MappedFile();
+
+	bool Open(const std::string & path, bool copy_on_write = false);
+
+	void Close();
+
+	bool IsOpen() const {return data != 0;}
+
+	const char * GetData() const {return data;}
+
+	/// only valid for copy on write mappings
+	char * GetData() {return data;}
+
+	size_t GetSize() const {return size;}
+
+private:
+	char * data;
+	size_t size;
+#ifdef _WIN32
+	void * file;
+	void * mapping;
+#endif
+
+	MappedFile(const MappedFile & other);
+	MappedFile & operator=(const MappedFile & other);
+};
+
+#endif // _MAPPEDFILE_H
@@ -23,6 +23,7 @@
 #include <fstream>
 #include <cassert>
 #include <cstdlib>
+#include <cstdio>
 #ifdef _WIN32
 #include <windows.h>
 #include <tchar.h>
@@ -97,6 +98,7 @@ void PathManager::Init(std::ostream & info_output, std::ostream & error_output)
 	MakeDir(GetTrackRecordsPath());
 	MakeDir(GetReplayPath());
 	MakeDir(GetScreenshotPath());
+	MakeDir(GetCachePath());
 	MakeDir(GetTemporaryFolder());
 
 	// Print diagnostic info.
@@ -206,6 +208,16 @@ void PathManager::DeleteFile1(const std::string & path)
 	remove(path.c_str());
 }
 
+bool PathManager::RenameFile(const std::string & path, const std::string & newpath)
+{
+#ifndef _WIN32
+	return rename(path.c_str(), newpath.c_str()) == 0;
+#else
+	// rename fails on windows if the new path exists
+	return MoveFileExA(path.c_str(), newpath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
+}
+
 std::string PathManager::GetDataPath() const
 {
 	return data_directory;
@@ -304,6 +316,11 @@ std::string PathManager::GetScreenshotPath() const
 	return settings_path+"/screenshots";
 }
 
+std::string PathManager::GetCachePath() const
+{
+	return settings_path+"/cache";
+}
+
 std::string PathManager::GetStaticReflectionMap() const
 {
 	return GetDataPath()+"/textures/weather/cubereflection-nosun.png";
@@ -39,6 +39,9 @@ public:
 	static void MakeDir(const std::string & dir);
 	static void DeleteFile1(const std::string & path);
 
+	/// Replaces an existing file at the new path, returns false on failure.
+	static bool RenameFile(const std::string & path, const std::string & newpath);
+
 	std::string GetDataPath() const;
 	std::string GetWriteableDataPath() const;
 	std::string GetCarPartsPath() const;
@@ -57,6 +60,7 @@ public:
 	std::string GetDefaultCarControlsFile() const;
 	std::string GetReplayPath() const;
 	std::string GetScreenshotPath() const;
+	std::string GetCachePath() const;
 	std::string GetStaticReflectionMap() const;
 	std::string GetStaticAmbientMap() const;
 	std::string GetShaderPath() const;
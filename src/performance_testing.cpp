@@ -22,9 +22,22 @@
 #include "physics/dynamicsworld.h"
 #include "physics/tracksurface.h"
 #include "content/contentmanager.h"
+#include "graphics/texture.h"
+#include "graphics/model.h"
+#include "sound/sound.h"
 #include "cfg/ptree.h"
+#include "joeserialize.h"
+#include "pathmanager.h"
+#include "quickprof.h"
+#include "replay.h"
+#include "settings.h"
+#include "utils.h"
 
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
@@ -38,8 +51,289 @@ static inline float ConvertToFeet(float meters)
 	return meters * 3.2808399;
 }
 
-PerformanceTesting::PerformanceTesting(DynamicsWorld & world) :
-	world(world), track(0), plane(0)
+/// Store min/median/p99/mean of the per tick samples (in us) in the given section.
+static void WriteBenchmarkStats(std::vector<double> & samples, PTree & section)
+{
+	if (samples.empty())
+		return;
+
+	std::sort(samples.begin(), samples.end());
+	size_t n = samples.size();
+	size_t p99 = std::min(n - 1, (size_t)(0.99 * n));
+	double sum = 0;
+	for (size_t i = 0; i < n; ++i)
+		sum += samples[i];
+
+	section.set("min", samples[0]);
+	section.set("median", samples[n / 2]);
+	section.set("p99", samples[p99]);
+	section.set("mean", sum / n);
+}
+
+static bool SameContact(const CollisionContact & a, const CollisionContact & b)
+{
+	return a.GetPosition() == b.GetPosition() &&
+		a.GetNormal() == b.GetNormal() &&
+		a.GetDepth() == b.GetDepth() &&
+		a.GetPatchId() == b.GetPatchId() &&
+		a.GetObject() == b.GetObject() &&
+		&a.GetSurface() == &b.GetSurface();
+}
+
+/// Step the world once with batched and once with per car wheel rays from the same car states.
+/// Returns the number of wheel contacts that differ, the car states are restored afterwards.
+static int VerifyWheelRays(DynamicsWorld & dynamics, std::list<Car> & cars, float timestep)
+{
+	std::vector<std::string> states;
+	for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+	{
+		std::ostringstream out;
+		joeserialize::BinaryOutputSerializer serialize_output(out);
+		i->Serialize(serialize_output);
+		states.push_back(out.str());
+	}
+
+	std::vector<CollisionContact> contacts[2];
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		int n = 0;
+		for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i, ++n)
+		{
+			std::istringstream in(states[n]);
+			joeserialize::BinaryInputSerializer serialize_input(in);
+			i->Serialize(serialize_input);
+		}
+		if (pass == 2)
+			break;
+
+		dynamics.setRayBatching(pass == 0);
+		dynamics.update(timestep);
+		for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+		{
+			for (int w = 0; w < WHEEL_POSITION_SIZE; ++w)
+			{
+				contacts[pass].push_back(i->GetWheelContact(WheelPosition(w)));
+			}
+		}
+	}
+	dynamics.setRayBatching(true);
+
+	int mismatches = 0;
+	for (size_t i = 0; i < contacts[0].size(); ++i)
+	{
+		if (!SameContact(contacts[0][i], contacts[1][i]))
+			mismatches++;
+	}
+	return mismatches;
+}
+
+/// Time Track::CastRay against a per road strip search, store rays per second in the given section.
+static void BenchmarkRoadRays(const Track & track, PTree & section)
+{
+	// one ray per patch, dropped onto a point blended from the patch corners
+	std::vector<Vec3> origins;
+	const std::list<RoadStrip> & roads = track.GetRoadList();
+	for (std::list<RoadStrip>::const_iterator i = roads.begin(); i != roads.end(); ++i)
+	{
+		const std::vector<RoadPatch> & patches = i->GetPatches();
+		for (int n = 0, e = patches.size(); n < e; ++n)
+		{
+			const Bezier & b = patches[n].GetPatch();
+			float u = (n % 7) / 7.0f + 0.05f;
+			float v = (n % 5) / 5.0f + 0.05f;
+			Vec3 front = b.GetFL() * (1 - u) + b.GetFR() * u;
+			Vec3 back = b.GetBL() * (1 - u) + b.GetBR() * u;
+			origins.push_back(front * (1 - v) + back * v + Vec3(0, 0, 2));
+		}
+	}
+	if (origins.empty())
+		return;
+
+	const Vec3 dir(0, 0, -1);
+	const float len = 4;
+	const int repeat = std::max(1, 100000 / (int)origins.size());
+	quickprof::Clock clock;
+
+	int strip_hits = 0;
+	unsigned long long t0 = clock.getTimeMicroseconds();
+	for (int r = 0; r < repeat; ++r)
+	{
+		for (size_t i = 0; i < origins.size(); ++i)
+		{
+			bool col = false;
+			for (std::list<RoadStrip>::const_iterator s = roads.begin(); s != roads.end(); ++s)
+			{
+				int patch_id = -1;
+				Vec3 coltri, colnorm;
+				const Bezier * colbez = NULL;
+				col = s->Collide(origins[i], dir, len, patch_id, coltri, colbez, colnorm) || col;
+			}
+			strip_hits += col;
+		}
+	}
+
+	int index_hits = 0;
+	unsigned long long t1 = clock.getTimeMicroseconds();
+	for (int r = 0; r < repeat; ++r)
+	{
+		for (size_t i = 0; i < origins.size(); ++i)
+		{
+			int patch_id = -1;
+			Vec3 coltri, colnorm;
+			const Bezier * colbez = NULL;
+			index_hits += track.CastRay(origins[i], dir, len, patch_id, coltri, colbez, colnorm);
+		}
+	}
+	unsigned long long t2 = clock.getTimeMicroseconds();
+
+	double rays = double(repeat) * origins.size();
+	double strip_time = std::max(t1 - t0, 1ULL) * 1E-6;
+	double index_time = std::max(t2 - t1, 1ULL) * 1E-6;
+	section.set("strips", roads.size());
+	section.set("patches", origins.size());
+	section.set("rays", rays);
+	section.set("strip-rays-per-second", rays / strip_time);
+	section.set("index-rays-per-second", rays / index_time);
+	section.set("speedup", strip_time / index_time);
+	section.set("hits-match", strip_hits == index_hits);
+}
+
+/// Time binary serialization of float arrays, bulk vector path against the per item path
+/// (deque, same binary layout), store megabytes per second in the given section.
+static void BenchmarkSerialization(PTree & section)
+{
+	const int count = 1 << 20;
+	const int repeat = 8;
+	std::vector<float> floats(count);
+	for (int i = 0; i < count; ++i)
+		floats[i] = i * 0.001f;
+	std::deque<float> items(floats.begin(), floats.end());
+
+	quickprof::Clock clock;
+	std::string data;
+	bool match = true;
+
+	unsigned long long t0 = clock.getTimeMicroseconds();
+	for (int r = 0; r < repeat; ++r)
+	{
+		std::ostringstream out;
+		joeserialize::BinaryOutputSerializer serialize_output(out);
+		joeserialize::Serializer & s = serialize_output;
+		s.Serialize("floats", floats);
+		data = out.str();
+	}
+
+	unsigned long long t1 = clock.getTimeMicroseconds();
+	for (int r = 0; r < repeat; ++r)
+	{
+		std::ostringstream out;
+		joeserialize::BinaryOutputSerializer serialize_output(out);
+		joeserialize::Serializer & s = serialize_output;
+		s.Serialize("floats", items);
+		match = match && (out.str() == data);
+	}
+
+	unsigned long long t2 = clock.getTimeMicroseconds();
+	for (int r = 0; r < repeat; ++r)
+	{
+		std::istringstream in(data);
+		joeserialize::BinaryInputSerializer serialize_input(in);
+		joeserialize::Serializer & s = serialize_input;
+		std::vector<float> input;
+		s.Serialize("floats", input);
+		match = match && (input == floats);
+	}
+
+	unsigned long long t3 = clock.getTimeMicroseconds();
+	for (int r = 0; r < repeat; ++r)
+	{
+		std::istringstream in(data);
+		joeserialize::BinaryInputSerializer serialize_input(in);
+		joeserialize::Serializer & s = serialize_input;
+		std::deque<float> input;
+		s.Serialize("floats", input);
+		match = match && (input == items);
+	}
+	unsigned long long t4 = clock.getTimeMicroseconds();
+
+	double mb = double(repeat) * count * sizeof(float) / (1 << 20);
+	section.set("megabytes", mb);
+	section.set("bulk-write-mb-per-second", mb / (std::max(t1 - t0, 1ULL) * 1E-6));
+	section.set("item-write-mb-per-second", mb / (std::max(t2 - t1, 1ULL) * 1E-6));
+	section.set("bulk-read-mb-per-second", mb / (std::max(t3 - t2, 1ULL) * 1E-6));
+	section.set("item-read-mb-per-second", mb / (std::max(t4 - t3, 1ULL) * 1E-6));
+	section.set("data-match", match);
+}
+
+/// Time the sound mixer callback against the number of playing sources,
+/// store microseconds per 512 frame callback in the given section.
+static void BenchmarkSoundMixer(PTree & section)
+{
+	// one second of a looping stereo tone
+	const int frames = 44100;
+	const int len = 512;
+	const int repeat = 1000;
+	std::vector<short> pcm(frames * 2);
+	for (int i = 0; i < frames; ++i)
+	{
+		pcm[i * 2] = 16000 * std::sin(i * 0.05);
+		pcm[i * 2 + 1] = 16000 * std::sin(i * 0.07);
+	}
+	std::tr1::shared_ptr<SoundBuffer> buffer(new SoundBuffer());
+	buffer->Load("benchmark", SoundInfo(frames * 2, 44100, 2, 2), &pcm[0]);
+
+	quickprof::Clock clock;
+	std::vector<unsigned char> stream(len * 4);
+	const int counts[] = {1, 8, 32, 64, 128};
+	for (int c = 0; c < 5; ++c)
+	{
+		const int count = counts[c];
+		Sound sound;
+		sound.SetMaxActiveSources(count);
+		sound.SetVolume(1.0);
+
+		std::vector<size_t> sources;
+		for (int i = 0; i < count; ++i)
+		{
+			sources.push_back(sound.AddSource(buffer, i * 0.1f, true, true));
+			sound.SetSourcePosition(sources.back(), i % 7, i % 5, 0);
+		}
+
+		// source updates between callbacks, gains ramp like in game
+		unsigned long long mix_time = 0;
+		for (int r = 0; r < repeat; ++r)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				sound.SetSourcePitch(sources[i], 0.5f + 0.01f * ((i + r) % 150));
+				sound.SetSourceGain(sources[i], 0.5f + 0.002f * ((i + r) % 100));
+			}
+			sound.Update(false);
+
+			unsigned long long t0 = clock.getTimeMicroseconds();
+			sound.Mix(&stream[0], stream.size());
+			mix_time += clock.getTimeMicroseconds() - t0;
+		}
+
+		PTree & sources_section = section.set("sources-" + tostr(count), "");
+		sources_section.set("us-per-callback", double(mix_time) / repeat);
+		sources_section.set("ns-per-source-frame", double(mix_time) * 1E3 / (double(repeat) * count * len));
+	}
+}
+
+PerformanceTesting::PerformanceTesting(
+	DynamicsWorld & world,
+	ContentManager & content,
+	PathManager & pathmanager,
+	std::ostream & info_output,
+	std::ostream & error_output) :
+	world(world),
+	content(content),
+	pathmanager(pathmanager),
+	info_output(info_output),
+	error_output(error_output),
+	plane_object(0),
+	plane(0)
 {
 	surface.type = TrackSurface::ASPHALT;
 	surface.bumpWaveLength = 1;
@@ -52,10 +346,10 @@ PerformanceTesting::PerformanceTesting(DynamicsWorld & world) :
 
 PerformanceTesting::~PerformanceTesting()
 {
-	if (track)
+	if (plane_object)
 	{
-		world.removeCollisionObject(track);
-		delete track;
+		world.removeCollisionObject(plane_object);
+		delete plane_object;
 	}
 	if (plane)
 	{
@@ -63,27 +357,22 @@ PerformanceTesting::~PerformanceTesting()
 	}
 }
 
-void PerformanceTesting::Test(
-	const std::string & cardir,
-	const std::string & carname,
-	ContentManager & content,
-	std::ostream & info_output,
-	std::ostream & error_output)
+void PerformanceTesting::Test(const std::string & cardir, const std::string & carname)
 {
 	info_output << "Beginning car performance test on " << carname << std::endl;
 
 	// init track
-	assert(!track);
+	assert(!plane_object);
 	assert(!plane);
 	btVector3 planeNormal(0, 0, 1);
 	btScalar planeConstant = 0;
 	plane = new btStaticPlaneShape(planeNormal, planeConstant);
 	plane->setUserPointer(static_cast<void*>(&surface));
-	track = new btCollisionObject();
-	track->setCollisionShape(plane);
-	track->setActivationState(DISABLE_SIMULATION);
-	track->setUserPointer(static_cast<void*>(&surface));
-	world.addCollisionObject(track);
+	plane_object = new btCollisionObject();
+	plane_object->setCollisionShape(plane);
+	plane_object->setActivationState(DISABLE_SIMULATION);
+	plane_object->setUserPointer(static_cast<void*>(&surface));
+	world.addCollisionObject(plane_object);
 
 	//load the car dynamics
 	std::tr1::shared_ptr<PTree> cfg;
@@ -309,3 +598,397 @@ void PerformanceTesting::TestStoppingDistance(bool abs, std::ostream & info_outp
 		info_output << "(no ABS)";
 	info_output << ": " << ConvertToFeet((stopend-stopstart).length()) << " ft" << std::endl;
 }
+
+void PerformanceTesting::BenchmarkSerialize(const std::string & outputfile)
+{
+	PTree results;
+	BenchmarkSerialization(results.set("serialize", ""));
+	WriteResults(results, "Serialization benchmark", outputfile);
+}
+
+void PerformanceTesting::BenchmarkSound(const std::string & outputfile)
+{
+	PTree results;
+	BenchmarkSoundMixer(results.set("soundMixer", ""));
+	WriteResults(results, "Sound mixer benchmark", outputfile);
+}
+
+void PerformanceTesting::InitHeadless()
+{
+	// Headless content, models are loaded without gl buffers, textures are skipped.
+	pathmanager.Init(info_output, error_output);
+	content.getFactory<PTree>().init(read_ini, write_ini, content);
+	content.getFactory<Texture>().initHeadless();
+	content.getFactory<Model>().initHeadless();
+	content.addPath(pathmanager.GetWriteableDataPath());
+	content.addPath(pathmanager.GetDataPath());
+	content.addSharedPath(pathmanager.GetCarPartsPath());
+	content.addSharedPath(pathmanager.GetTrackPartsPath());
+}
+
+bool PerformanceTesting::LoadTrack(const std::string & trackname)
+{
+	bool track_reverse = false;
+	bool track_dynamic = true;
+	bool track_shadows = false;
+	if (!track.DeferredLoad(
+		content, world,
+		info_output, error_output,
+		pathmanager.GetTracksPath(trackname),
+		pathmanager.GetTracksDir() + "/" + trackname,
+		pathmanager.GetEffectsTextureDir(),
+		pathmanager.GetTrackPartsPath(),
+		pathmanager.GetCachePath(),
+		0, track_reverse, track_dynamic, track_shadows))
+	{
+		error_output << "Error loading track: " << trackname << std::endl;
+		return false;
+	}
+	bool success = true;
+	while (!track.Loaded() && success)
+	{
+		success = track.ContinueDeferredLoad();
+	}
+	if (!success)
+	{
+		error_output << "Error loading track (deferred): " << trackname << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void PerformanceTesting::WriteResults(const PTree & results, const std::string & title, const std::string & outputfile)
+{
+	if (!outputfile.empty())
+	{
+		std::ofstream out(outputfile.c_str());
+		if (out)
+			write_ini(results, out);
+		else
+			error_output << "Couldn't write " << title << " results to " << outputfile << std::endl;
+	}
+	else
+	{
+		std::stringstream out;
+		write_ini(results, out);
+		info_output << title << " results:\n" << out.str() << std::endl;
+	}
+}
+
+void PerformanceTesting::Unload()
+{
+	ai.clear_cars();
+	cartimerids.clear();
+	cars.clear();
+	timer.Unload();
+	track.Clear();
+}
+
+void PerformanceTesting::UpdateTimer(float timestep)
+{
+	for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+	{
+		timer.UpdateCar(cartimerids[&(*i)], *i, track);
+	}
+	timer.Tick(timestep);
+}
+
+bool PerformanceTesting::BenchmarkPhysics(
+	const std::string & trackname,
+	const std::string & carname,
+	int carnum,
+	int ticks,
+	float timestep,
+	bool multithreaded,
+	const std::string & outputfile)
+{
+	info_output << "Beginning physics benchmark on " << trackname << " with " << carnum << " " << carname << std::endl;
+
+	InitHeadless();
+
+	if (!LoadTrack(trackname))
+		return false;
+
+	ai.SetMultithreaded(multithreaded);
+
+	// Load cars, physics only.
+	const size_t n0 = carname.find("/");
+	const size_t n1 = carname.length();
+	const std::string carfile = carname.substr(n0 + 1, n1 - n0 - 1);
+	const std::string cardir = pathmanager.GetCarsDir() + "/" + carname.substr(0, n0);
+	std::tr1::shared_ptr<PTree> carconf;
+	content.load(carconf, cardir, carfile + ".car");
+	if (!carconf->size())
+	{
+		error_output << "Failed to load " << carname << std::endl;
+		return false;
+	}
+	for (int i = 0; i < carnum; ++i)
+	{
+		std::pair<Vec3, Quat> start = track.GetStart(i);
+		cars.push_back(Car());
+		if (!cars.back().LoadPhysics(
+			error_output, content, world,
+			*carconf, cardir, "", start.first, start.second,
+			true, true, false))
+		{
+			error_output << "Failed to load physics for car " << carname << std::endl;
+			cars.pop_back();
+			break;
+		}
+		ai.add_car(&cars.back(), 1.0, track.GetRoadList());
+	}
+
+	// Timer records go into the temporary folder to keep the player records clean.
+	timer.Load(pathmanager.GetTemporaryFolder() + "/benchmark-" + trackname + ".txt", 0.0f);
+	for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+	{
+		cartimerids[&(*i)] = timer.AddCar(i->GetCarType());
+	}
+
+	// Per tick phase samples in microseconds.
+	std::vector<double> ai_time, step_time, action_time, ray_time, timer_time, tick_time;
+	ai_time.reserve(ticks);
+	step_time.reserve(ticks);
+	action_time.reserve(ticks);
+	ray_time.reserve(ticks);
+	timer_time.reserve(ticks);
+	tick_time.reserve(ticks);
+	unsigned long long rays = 0;
+
+	// batched wheel rays have to match the rays cars cast on their own
+	int wheelray_mismatches = VerifyWheelRays(world, cars, timestep);
+	if (wheelray_mismatches)
+	{
+		error_output << "Batched wheel rays differ from per car wheel rays: " << wheelray_mismatches << " contacts" << std::endl;
+	}
+
+	quickprof::Clock clock;
+	world.setProfiling(true);
+	for (int n = 0; n < ticks && !cars.empty(); ++n)
+	{
+		unsigned long long t0 = clock.getTimeMicroseconds();
+
+		ai.update(timestep, cars, track.GetLength());
+
+		unsigned long long t1 = clock.getTimeMicroseconds();
+
+		world.resetProfile();
+		world.update(timestep);
+
+		unsigned long long t2 = clock.getTimeMicroseconds();
+
+		for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+		{
+			i->Update(ai.GetInputs(&(*i)));
+		}
+
+		unsigned long long t3 = clock.getTimeMicroseconds();
+
+		UpdateTimer(timestep);
+
+		unsigned long long t4 = clock.getTimeMicroseconds();
+
+		const DynamicsWorld::Profile & profile = world.getProfile();
+		ai_time.push_back(t1 - t0);
+		step_time.push_back(t2 - t1);
+		action_time.push_back(profile.actions);
+		ray_time.push_back(profile.castray);
+		timer_time.push_back(t4 - t3);
+		tick_time.push_back(t4 - t0);
+		rays += profile.castray_count;
+	}
+	world.setProfiling(false);
+
+	double total = 0;
+	for (size_t i = 0; i < tick_time.size(); ++i)
+		total += tick_time[i];
+	total *= 1E-6;
+
+	PTree results;
+	PTree & bench = results.set("benchmark", "");
+	bench.set("track", trackname);
+	bench.set("car", carname);
+	bench.set("cars", cars.size());
+	bench.set("multithreaded", multithreaded);
+	bench.set("ticks", tick_time.size());
+	bench.set("timestep", timestep);
+	bench.set("seconds", total);
+	bench.set("ticks-per-second", total > 0 ? tick_time.size() / total : 0);
+	bench.set("realtime-factor", total > 0 ? tick_time.size() * timestep / total : 0);
+	bench.set("castray-count", rays);
+	bench.set("wheel-ray-mismatches", wheelray_mismatches);
+	WriteBenchmarkStats(ai_time, results.set("ai", ""));
+	WriteBenchmarkStats(step_time, results.set("stepSimulation", ""));
+	WriteBenchmarkStats(action_time, results.set("updateAction", ""));
+	WriteBenchmarkStats(ray_time, results.set("castRay", ""));
+	WriteBenchmarkStats(timer_time, results.set("UpdateTimer", ""));
+	WriteBenchmarkStats(tick_time, results.set("tick", ""));
+	BenchmarkRoadRays(track, results.set("roadCastRay", ""));
+
+	WriteResults(results, "Physics benchmark", outputfile);
+
+	Unload();
+
+	info_output << "Physics benchmark complete." << std::endl;
+	return true;
+}
+
+void PerformanceTesting::SeekReplay(Replay & replay, unsigned frame, float timestep)
+{
+	unsigned keyframe = replay.Seek(frame, cars);
+
+	// simulate from the keyframe up to the requested frame
+	for (; keyframe < frame && replay.GetPlaying(); ++keyframe)
+	{
+		world.update(timestep);
+
+		unsigned carid = 0;
+		for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i)
+		{
+			i->Update(replay.PlayFrame(carid++, *i));
+		}
+	}
+}
+
+bool PerformanceTesting::PlayReplay(
+	const std::string & replayfile,
+	unsigned seekframe,
+	unsigned frames,
+	bool verify,
+	float tolerance,
+	float timestep,
+	const std::string & outputfile)
+{
+	info_output << "Playing replay " << replayfile << std::endl;
+
+	InitHeadless();
+	Settings settings;
+	settings.Load(pathmanager.GetSettingsFile(), error_output);
+
+	Replay replay(timestep);
+	if (!replay.StartPlaying(replayfile, error_output, verify))
+		return false;
+
+	if (!LoadTrack(replay.GetTrack()))
+	{
+		replay.Reset();
+		return false;
+	}
+
+	// Load cars, physics only, car configs are stored in the replay.
+	const std::vector<CarInfo> & replay_cars = replay.GetCarInfo();
+	for (size_t i = 0; i < replay_cars.size(); ++i)
+	{
+		const CarInfo & info = replay_cars[i];
+		const size_t n0 = info.name.find("/");
+		const std::string cardir = pathmanager.GetCarsDir() + "/" + info.name.substr(0, n0);
+		PTree carconf;
+		std::stringstream carstream(info.config);
+		read_ini(carstream, carconf);
+
+		bool isai = (info.driver != "user");
+		std::pair<Vec3, Quat> start = track.GetStart(i);
+		cars.push_back(Car());
+		if (!cars.back().LoadPhysics(
+			error_output, content, world,
+			carconf, cardir, info.tire, start.first, start.second,
+			settings.GetABS() || isai, settings.GetTCS() || isai,
+			settings.GetVehicleDamage()))
+		{
+			error_output << "Failed to load physics for car " << info.name << std::endl;
+			Unload();
+			replay.Reset();
+			return false;
+		}
+	}
+
+	quickprof::Clock clock;
+	unsigned long long t0 = clock.getTimeMicroseconds();
+
+	if (seekframe > 0)
+		SeekReplay(replay, seekframe, timestep);
+
+	unsigned long long t1 = clock.getTimeMicroseconds();
+
+	// Keyframe verification state.
+	Replay::Divergence first_divergence = {0, 0, 0, true};
+	unsigned first_divergence_car = 0;
+	unsigned keyframes = 0;
+	unsigned diverged_keyframes = 0;
+	float max_position_error = 0;
+	float max_velocity_error = 0;
+
+	// Play as fast as possible, no frame rate limit.
+	const unsigned startframe = replay.GetFrame();
+	while (replay.GetPlaying() && (frames == 0 || replay.GetFrame() - startframe < frames))
+	{
+		world.update(timestep);
+
+		unsigned carid = 0;
+		for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i, ++carid)
+		{
+			i->Update(replay.PlayFrame(carid, *i));
+
+			Replay::Divergence divergence;
+			if (!verify || !replay.VerifyFrame(carid, *i, divergence))
+				continue;
+
+			keyframes++;
+			max_position_error = std::max(max_position_error, divergence.position);
+			max_velocity_error = std::max(max_velocity_error, divergence.velocity);
+			if (divergence.exact || divergence.position < tolerance)
+				continue;
+
+			if (diverged_keyframes == 0)
+			{
+				first_divergence = divergence;
+				first_divergence_car = carid;
+			}
+			diverged_keyframes++;
+		}
+	}
+	const unsigned played = replay.GetFrame() - startframe;
+
+	unsigned long long t2 = clock.getTimeMicroseconds();
+
+	double seek_time = (t1 - t0) * 1E-6;
+	double play_time = (t2 - t1) * 1E-6;
+
+	PTree results;
+	PTree & section = results.set("replay", "");
+	section.set("file", replayfile);
+	section.set("track", replay.GetTrack());
+	section.set("cars", cars.size());
+	section.set("frames", replay.GetFrameCount());
+	section.set("timestep", timestep);
+	section.set("seek-frame", seekframe);
+	section.set("seek-seconds", seek_time);
+	section.set("played-frames", played);
+	section.set("play-seconds", play_time);
+	section.set("realtime-factor", play_time > 0 ? played * timestep / play_time : 0);
+	if (verify)
+	{
+		PTree & verification = results.set("verify", "");
+		verification.set("tolerance", tolerance);
+		verification.set("keyframes", keyframes);
+		verification.set("diverged-keyframes", diverged_keyframes);
+		verification.set("diverged", diverged_keyframes > 0);
+		verification.set("max-position-error", max_position_error);
+		verification.set("max-velocity-error", max_velocity_error);
+		if (diverged_keyframes > 0)
+		{
+			verification.set("first-divergence-frame", first_divergence.frame);
+			verification.set("first-divergence-car", first_divergence_car);
+			verification.set("first-divergence-position-error", first_divergence.position);
+			verification.set("first-divergence-velocity-error", first_divergence.velocity);
+		}
+	}
+	WriteResults(results, "Replay", outputfile);
+
+	replay.Reset();
+	Unload();
+
+	info_output << "Replay complete." << std::endl;
+	return true;
+}
@@ -21,24 +21,70 @@
 #define _PERFORMANCE_TESTING_H
 
 #include "physics/cardynamics.h"
+#include "ai/ai.h"
+#include "car.h"
+#include "timer.h"
+#include "track.h"
+
+#include <iosfwd>
+#include <list>
+#include <map>
 
 class ContentManager;
+class PathManager;
+class PTree;
+class Replay;
 
+/// Car performance tests and headless (no window, sound or gl context) benchmarks.
+/// Benchmark results go to an ini style output file or to the info log.
 class PerformanceTesting
 {
 public:
-	PerformanceTesting(DynamicsWorld & world);
-	~PerformanceTesting();
-
-	void Test(
-		const std::string & cardir,
-		const std::string & carname,
+	PerformanceTesting(
+		DynamicsWorld & world,
 		ContentManager & content,
+		PathManager & pathmanager,
 		std::ostream & info_output,
 		std::ostream & error_output);
 
+	~PerformanceTesting();
+
+	/// maximum speed and stopping distance of a car on a flat plane
+	void Test(const std::string & cardir, const std::string & carname);
+
+	/// fixed-step physics benchmark of carnum AI driven cars on a track
+	bool BenchmarkPhysics(
+		const std::string & trackname,
+		const std::string & carname,
+		int carnum,
+		int ticks,
+		float timestep,
+		bool multithreaded,
+		const std::string & outputfile);
+
+	/// binary serialization benchmark, bulk vector path against the per item path
+	void BenchmarkSerialize(const std::string & outputfile);
+
+	/// sound mixer benchmark, mixes on the calling thread without a sound device
+	void BenchmarkSound(const std::string & outputfile);
+
+	/// replay playback at full speed, optionally starting at seekframe
+	/// with verify set, car states are compared against the recorded keyframes
+	bool PlayReplay(
+		const std::string & replayfile,
+		unsigned seekframe,
+		unsigned frames,
+		bool verify,
+		float tolerance,
+		float timestep,
+		const std::string & outputfile);
+
 private:
 	DynamicsWorld & world;
+	ContentManager & content;
+	PathManager & pathmanager;
+	std::ostream & info_output;
+	std::ostream & error_output;
 	TrackSurface surface;
 
 	std::vector<float> carinput;
@@ -46,14 +92,38 @@ private:
 	CarDynamics car;
 
 	/// flat plane test track
-	btCollisionObject * track;
+	btCollisionObject * plane_object;
 	btCollisionShape * plane;
 
+	/// benchmark track and cars
+	Track track;
+	std::list<Car> cars;
+	std::map<Car *, int> cartimerids;
+	Timer timer;
+	Ai ai;
+
 	void ResetCar();
 
 	void TestMaxSpeed(std::ostream & info_output, std::ostream & error_output);
 
 	void TestStoppingDistance(bool abs, std::ostream & info_output, std::ostream & error_output);
+
+	/// content setup, models are loaded without gl buffers, textures are skipped
+	void InitHeadless();
+
+	bool LoadTrack(const std::string & trackname);
+
+	/// drop benchmark cars, timer and track
+	void Unload();
+
+	/// write results to outputfile, or to the log if outputfile is empty
+	void WriteResults(const PTree & results, const std::string & title, const std::string & outputfile);
+
+	/// lap timing of the benchmark cars, same as the game timer update
+	void UpdateTimer(float timestep);
+
+	/// jump to the replay keyframe before frame, then simulate up to frame
+	void SeekReplay(Replay & replay, unsigned frame, float timestep);
 };
 
 #endif
@@ -0,0 +1,163 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "bvhcache.h"
+#include "mappedfile.h"
+#include "pathmanager.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "LinearMath/btAlignedAllocator.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+
+static const char cache_magic[8] = {'V', 'D', 'B', 'V', 'H', '0', '0', '1'};
+
+/// cache file header, followed by the serialized bvh
+/// 32 bytes to keep the bvh 16 byte aligned in the mapped file
+struct CacheHeader
+{
+	char magic[8];
+	unsigned int version;	///< bullet version
+	unsigned int scalar;	///< btScalar size
+	unsigned long long hash;	///< mesh data hash
+	unsigned int size;		///< serialized bvh size
+	unsigned int reserved;
+};
+
+/// 64 bit fnv-1a
+static unsigned long long Hash(const void * data, size_t size, unsigned long long hash)
+{
+	const unsigned char * bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static unsigned long long HashMesh(const btStridingMeshInterface & mesh)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int part = 0; part < mesh.getNumSubParts(); ++part)
+	{
+		const unsigned char * vertices;
+		const unsigned char * indices;
+		int numverts, vertexstride, numfaces, indexstride;
+		PHY_ScalarType vertextype, indextype;
+		mesh.getLockedReadOnlyVertexIndexBase(
+			&vertices, numverts, vertextype, vertexstride,
+			&indices, indexstride, numfaces, indextype, part);
+
+		int layout[6] = {numverts, vertextype, vertexstride, numfaces, indextype, indexstride};
+		hash = Hash(layout, sizeof(layout), hash);
+		hash = Hash(vertices, size_t(numverts) * vertexstride, hash);
+		hash = Hash(indices, size_t(numfaces) * indexstride, hash);
+
+		mesh.unLockReadOnlyVertexBase(part);
+	}
+	hash = Hash(&mesh.getScaling()[0], sizeof(btScalar) * 3, hash);
+	return hash;
+}
+
+static btBvhTriangleMeshShape * LoadCached(
+	btStridingMeshInterface * mesh,
+	const std::string & filename,
+	unsigned long long hash,
+	std::tr1::shared_ptr<MappedFile> & cachefile)
+{
+	// bvh is deserialized in place, map it copy on write
+	std::tr1::shared_ptr<MappedFile> file(new MappedFile());
+	if (!file->Open(filename, true) || file->GetSize() < sizeof(CacheHeader))
+		return 0;
+
+	const CacheHeader & header = *(const CacheHeader *)file->GetData();
+	if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) ||
+		header.version != BT_BULLET_VERSION ||
+		header.scalar != sizeof(btScalar) ||
+		header.hash != hash ||
+		header.size != file->GetSize() - sizeof(CacheHeader))
+		return 0;
+
+	char * buffer = file->GetData() + sizeof(CacheHeader);
+	btOptimizedBvh * bvh = (btOptimizedBvh *)btOptimizedBvh::deSerializeInPlace(buffer, header.size, false);
+	if (!bvh)
+		return 0;
+
+	// shape does not own the bvh, it lives in the mapped file
+	btBvhTriangleMeshShape * shape = new btBvhTriangleMeshShape(mesh, true, false);
+	shape->setOptimizedBvh(bvh);
+	cachefile = file;
+	return shape;
+}
+
+static void WriteCached(
+	const btOptimizedBvh & bvh,
+	const std::string & filename,
+	unsigned long long hash)
+{
+	CacheHeader header;
+	std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = BT_BULLET_VERSION;
+	header.scalar = sizeof(btScalar);
+	header.hash = hash;
+	header.size = bvh.calculateSerializeBufferSize();
+	header.reserved = 0;
+
+	void * buffer = btAlignedAlloc(header.size, 16);
+	if (bvh.serializeInPlace(buffer, header.size, false))
+	{
+		// write to a temporary file first, threads might store the same mesh
+		std::ostringstream tmpname;
+		tmpname << filename << "." << &bvh << ".tmp";
+		std::ofstream file(tmpname.str().c_str(), std::ios::binary);
+		file.write((const char *)&header, sizeof(header));
+		file.write((const char *)buffer, header.size);
+		file.close();
+
+		if (!file || !PathManager::RenameFile(tmpname.str(), filename))
+			std::remove(tmpname.str().c_str());
+	}
+	btAlignedFree(buffer);
+}
+
+btBvhTriangleMeshShape * LoadBvhTriangleMeshShape(
+	btStridingMeshInterface * mesh,
+	const std::string & cachepath,
+	std::tr1::shared_ptr<MappedFile> & cachefile)
+{
+	if (cachepath.empty())
+		return new btBvhTriangleMeshShape(mesh, true);
+
+	const unsigned long long hash = HashMesh(*mesh);
+	std::ostringstream filename;
+	filename << cachepath << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bvh";
+
+	btBvhTriangleMeshShape * shape = LoadCached(mesh, filename.str(), hash, cachefile);
+	if (shape)
+		return shape;
+
+	shape = new btBvhTriangleMeshShape(mesh, true);
+	WriteCached(*shape->getOptimizedBvh(), filename.str(), hash);
+	return shape;
+}
@@ -0,0 +1,41 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _BVHCACHE_H
+#define _BVHCACHE_H
+
+#include "memory.h"
+#include <string>
+
+class MappedFile;
+class btStridingMeshInterface;
+class btBvhTriangleMeshShape;
+
+/// Create a triangle mesh shape with a quantized bvh. The bvh is memory mapped
+/// from a cache file in cachepath if there is a valid one, else it is built
+/// and written to the cache. Cache files are keyed by a hash of the mesh data
+/// and the bullet version, stale or corrupt files are rebuilt.
+/// cachefile holds the mapped bvh, it has to outlive the shape.
+/// An empty cachepath disables the cache. Safe to call from worker threads.
+btBvhTriangleMeshShape * LoadBvhTriangleMeshShape(
+	btStridingMeshInterface * mesh,
+	const std::string & cachepath,
+	std::tr1::shared_ptr<MappedFile> & cachefile);
+
+#endif // _BVHCACHE_H
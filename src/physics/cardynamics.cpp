@@ -160,7 +160,7 @@ static bool LoadBrake(
 }
 
 #ifdef VDRIFTN
-static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, CarTire & tire, std::ostream & error_output)
+static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, bool tabulated, CarTire & tire, std::ostream & error_output)
 {
 	CarTireInfo info;
 
@@ -197,12 +197,13 @@ static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, CarTire & tire,
 	info.coefficients[TireInfo::RHY1] *= side_factor;
 	info.coefficients[TireInfo::RVY5] *= side_factor;
 
+	info.tabulated = tabulated;
 	tire.init(info);
 
 	return true;
 }
 #else
-static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, CarTire & tire, std::ostream & error_output)
+static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, bool tabulated, CarTire & tire, std::ostream & error_output)
 {
 	CarTireInfo info;
 
@@ -255,6 +256,7 @@ static bool LoadTire(const PTree & cfg_wheel, const PTree & cfg, CarTire & tire,
 	info.lateral[13] *= side_factor;
 	info.lateral[14] *= side_factor;
 
+	// tabulated forces are not supported by this tire model
 	tire.init(info);
 
 	return true;
@@ -473,6 +475,7 @@ CarDynamics::CarDynamics() :
 	transform(btTransform::getIdentity()),
 	linear_velocity(0,0,0),
 	angular_velocity(0,0,0),
+	wheel_contacts_batched(false),
 	drive(NONE),
 	driveshaft_rpm(0),
 	tacho_rpm(0),
@@ -521,6 +524,7 @@ CarDynamics::~CarDynamics()
 	// delete body
 	if (world)
 	{
+		world->removeRayCaster(this);
 		world->removeAction(this);
 		world->removeRigidBody(body);
 	}
@@ -601,6 +605,10 @@ bool CarDynamics::Load(
 		return false;
 	}
 
+	// optional tabulated tire forces, trade accuracy for speed
+	bool tire_table = false;
+	cfg.get("tire-table", tire_table);
+
 	int i = 0;
 	for (PTree::const_iterator it = cfg_wheels->begin(); it != cfg_wheels->end(); ++it, ++i)
 	{
@@ -615,7 +623,7 @@ bool CarDynamics::Load(
 		tirestr += "n";
 		#endif
 		content.load(cfg_tire, cardir, tirestr);
-		if (!LoadTire(cfg_wheel, *cfg_tire, tire[i], error)) return false;
+		if (!LoadTire(cfg_wheel, *cfg_tire, tire_table, tire[i], error)) return false;
 
 		const PTree * cfg_brake;
 		if (!cfg_wheel.get("brake", cfg_brake, error)) return false;
@@ -657,6 +665,7 @@ bool CarDynamics::Load(
 	body->setCollisionFlags(body->getCollisionFlags() | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
 	world.addRigidBody(body);
 	world.addAction(this);
+	world.addRayCaster(this);
 	this->world = &world;
 
 	// position is the center of a 2 x 4 x 1 meter box on track surface
@@ -1022,6 +1031,13 @@ static std::ostream & operator << (std::ostream & os, const CarTire & tire)
 	os << tire.getIdealSlipAngle() * SIMD_DEGS_PER_RAD << "\n";
 	os << "Slip: " << tire.getSlip() << " / ";
 	os << tire.getIdealSlip() << "\n";
+#ifdef VDRIFTN
+	if (tire.getTableSize())
+	{
+		os << "Table: " << tire.getTableSize() / 1024 << " KB, error ";
+		os << tire.getTableError() << "\n";
+	}
+#endif
 	return os;
 }
 
@@ -1453,41 +1469,51 @@ btVector3 CarDynamics::ApplySuspensionForceToBody ( int i, btScalar dt, btVector
 	return suspension_force;
 }
 
-btVector3 CarDynamics::ComputeTireFrictionForce (int i, btScalar dt, btScalar normal_force,
-        btScalar rotvel, const btVector3 & linvel, const btQuaternion & wheel_orientation)
+void CarDynamics::ComputeTireFrictionForces ( btVector3 friction_force[] )
 {
-	btMatrix3x3 wheel_mat(wheel_orientation);
-	btVector3 xw = wheel_mat.getColumn(0);
-	btVector3 yw = wheel_mat.getColumn(1);
-	btVector3 z = wheel_contact[i].GetNormal();
-
-	btScalar coszxw = z.dot(xw);
-	btScalar coszyw = z.dot(yw);
-	btVector3 x = (xw - z * coszxw).normalized();
-	btVector3 y = (yw - z * coszyw).normalized();
+	btScalar normal_force[WHEEL_POSITION_SIZE];
+	btScalar friction_coeff[WHEEL_POSITION_SIZE];
+	btScalar camber[WHEEL_POSITION_SIZE];
+	btScalar rotvel[WHEEL_POSITION_SIZE];
+	btScalar lonvel[WHEEL_POSITION_SIZE];
+	btScalar latvel[WHEEL_POSITION_SIZE];
+	for (int i = 0; i < WHEEL_POSITION_SIZE; ++i)
+	{
+		btMatrix3x3 wheel_mat(wheel_orientation[i]);
+		btVector3 xw = wheel_mat.getColumn(0);
+		btVector3 yw = wheel_mat.getColumn(1);
+		btVector3 z = wheel_contact[i].GetNormal();
 
-	btScalar camber = M_PI_2 - btAcos(coszxw);
-	btScalar lonvel = y.dot(linvel);
-	btScalar latvel = -x.dot(linvel);
+		btScalar coszxw = z.dot(xw);
+		btScalar coszyw = z.dot(yw);
+		btVector3 x = (xw - z * coszxw).normalized();
+		btVector3 y = (yw - z * coszyw).normalized();
 
-	btScalar friction_coeff =
-		tire[i].getTread() * wheel_contact[i].GetSurface().frictionTread +
-		(1.0 - tire[i].getTread()) * wheel_contact[i].GetSurface().frictionNonTread;
+		normal_force[i] = suspension_force[i].length();
+		camber[i] = M_PI_2 - btAcos(coszxw);
+		rotvel[i] = wheel[i].GetAngularVelocity() * wheel[i].GetRadius();
+		lonvel[i] = y.dot(wheel_velocity[i]);
+		latvel[i] = -x.dot(wheel_velocity[i]);
 
-	btVector3 friction_force = tire[i].getForce(
-		normal_force, friction_coeff, camber, rotvel, lonvel, latvel);
+		friction_coeff[i] =
+			tire[i].getTread() * wheel_contact[i].GetSurface().frictionTread +
+			(1.0 - tire[i].getTread()) * wheel_contact[i].GetSurface().frictionNonTread;
+	}
 
-	for (int n = 0; n < 3; ++n) assert(!isnan(friction_force[n]));
+	CarTire * tires[WHEEL_POSITION_SIZE];
+	for (int i = 0; i < WHEEL_POSITION_SIZE; ++i)
+	{
+		tires[i] = &tire[i];
+	}
+	CarTire::getForces(tires, normal_force, friction_coeff, camber, rotvel, lonvel, latvel,
+		friction_force, WHEEL_POSITION_SIZE);
 
-	return friction_force;
+	for (int i = 0; i < WHEEL_POSITION_SIZE; ++i)
+		for (int n = 0; n < 3; ++n) assert(!isnan(friction_force[i][n]));
 }
 
-void CarDynamics::ApplyWheelForces ( btScalar dt, btScalar wheel_drive_torque, int i, const btVector3 & suspension_force, btVector3 & force, btVector3 & torque )
+void CarDynamics::ApplyWheelForces ( btScalar dt, btScalar wheel_drive_torque, int i, const btVector3 & friction_force, btVector3 & force, btVector3 & torque )
 {
-	btScalar normal_force = suspension_force.length();
-	btScalar rotvel = wheel[i].GetAngularVelocity() * wheel[i].GetRadius();
-	btVector3 friction_force = ComputeTireFrictionForce ( i, dt, normal_force, rotvel, wheel_velocity[i], wheel_orientation[i] );
-
 	//calculate friction torque
 	btVector3 tire_force = Direction::forward * friction_force[0] - Direction::right * friction_force[1];
 	btScalar tire_friction_torque = friction_force[0] * wheel[i].GetRadius();
@@ -1588,10 +1614,14 @@ void CarDynamics::ApplyForces ( btScalar dt, const btVector3 & ext_force, const
 		}
 	}
 
+	//compute tire forces
+	btVector3 friction_force[WHEEL_POSITION_SIZE];
+	ComputeTireFrictionForces ( friction_force );
+
 	//compute wheel forces
 	for ( int i = 0; i < WHEEL_POSITION_SIZE; ++i )
 	{
-		ApplyWheelForces ( dt, wheel_drive_torque[i], i, suspension_force[i], force, torque );
+		ApplyWheelForces ( dt, wheel_drive_torque[i], i, friction_force[i], force, torque );
 	}
 
 	for ( int n = 0; n < 3; ++n ) assert ( !isnan ( force[n] ) );
@@ -1627,7 +1657,11 @@ void CarDynamics::updateAction(btCollisionWorld * collisionWorld, btScalar dt)
 	btVector3 torque = body->getInvInertiaTensorWorld().inverse() * dw / dt;
 	body->setLinearVelocity(linear_velocity);
 	body->setAngularVelocity(angular_velocity);
-	UpdateWheelContacts();
+
+	// wheel contacts are usually cast by the world together with all other cars
+	if (!wheel_contacts_batched)
+		UpdateWheelContacts();
+	wheel_contacts_batched = false;
 
 	feedback = 0;
 	int repeats = 10;
@@ -1653,9 +1687,11 @@ void CarDynamics::updateAction(btCollisionWorld * collisionWorld, btScalar dt)
 	angular_velocity = body->getAngularVelocity();
 }
 
-void CarDynamics::UpdateWheelContacts()
+void CarDynamics::AddWheelRays(RayBatch & rays)
 {
-	btVector3 raydir = GetDownVector();
+	// batched rays are collected before updateAction resets the body,
+	// use the pose the wheel positions were computed from, not the body pose
+	btVector3 raydir = -transform.getBasis().getColumn(2);
 	btScalar raylen = 4;
 	for (int i = 0; i < WHEEL_POSITION_SIZE; ++i)
 	{
@@ -1667,11 +1703,24 @@ void CarDynamics::UpdateWheelContacts()
 		}
 		else
 		{
-			world->castRay(raystart, raydir, raylen, body, wheel_contact[i]);
+			rays.add(raystart, raydir, raylen, body, wheel_contact[i]);
 		}
 	}
 }
 
+void CarDynamics::UpdateWheelContacts()
+{
+	RayBatch rays;
+	AddWheelRays(rays);
+	world->castRays(rays);
+}
+
+void CarDynamics::getRays(RayBatch & rays)
+{
+	AddWheelRays(rays);
+	wheel_contacts_batched = true;
+}
+
 void CarDynamics::InterpolateWheelContacts()
 {
 	btVector3 raydir = GetDownVector();
@@ -32,6 +32,7 @@
 #include "carwheelposition.h"
 #include "aerodevice.h"
 #include "collision_contact.h"
+#include "dynamicsworld.h"
 #include "cartelemetry.h"
 #include "motionstate.h"
 #include "joeserialize.h"
@@ -51,7 +52,7 @@ class FractureBody;
 class ContentManager;
 class PTree;
 
-class CarDynamics : public btActionInterface
+class CarDynamics : public btActionInterface, public RayCaster
 {
 friend class joeserialize::Serializer;
 
@@ -110,6 +111,9 @@ public:
 	const CollisionContact & GetWheelContact(WheelPosition wp) const;
 	CollisionContact & GetWheelContact(WheelPosition wp);
 
+	// wheel rays, cast by the world in one batch before updateAction
+	void getRays(RayBatch & rays);
+
 	// body
 	const btVector3 & GetWheelVelocity(WheelPosition wp) const;
 	const btVector3 & GetCenterOfMass() const;
@@ -208,6 +212,7 @@ protected:
 	btAlignedObjectArray<btVector3> wheel_velocity;
 	btAlignedObjectArray<btVector3> wheel_position;
 	btAlignedObjectArray<btQuaternion> wheel_orientation;
+	bool wheel_contacts_batched; ///< wheel contacts already cast this step
 
 	enum { NONE = 0, FWD = 1, RWD = 2, AWD = 3 } drive;
 	btScalar driveshaft_rpm;
@@ -254,15 +259,17 @@ protected:
 
 	btVector3 ApplySuspensionForceToBody ( int i, btScalar dt, btVector3 & force, btVector3 & torque );
 
-	btVector3 ComputeTireFrictionForce ( int i, btScalar dt, btScalar normal_force,
-        btScalar rotvel, const btVector3 & linvel, const btQuaternion & wheel_orientation );
+	// compute tire friction forces of all wheels in one batch
+	void ComputeTireFrictionForces ( btVector3 friction_force[] );
 
-	void ApplyWheelForces ( btScalar dt, btScalar wheel_drive_torque, int i, const btVector3 & suspension_force, btVector3 & force, btVector3 & torque );
+	void ApplyWheelForces ( btScalar dt, btScalar wheel_drive_torque, int i, const btVector3 & friction_force, btVector3 & force, btVector3 & torque );
 
 	void ApplyForces ( btScalar dt, const btVector3 & force, const btVector3 & torque);
 
 	void Tick ( btScalar dt, const btVector3 & force, const btVector3 & torque);
 
+	void AddWheelRays(RayBatch & rays);
+
 	void UpdateWheelContacts();
 
 	void InterpolateWheelContacts();
@@ -18,6 +18,8 @@
 /************************************************************************/
 
 #include "cartire.h"
+#include "scalar4.h"
+#include "unittest.h"
 #include "cfg/ptree.h"
 #include <cassert>
 
@@ -116,6 +118,138 @@ btVector3 CarTire::getForce(
 	return btVector3(Fx, Fy, Mz);
 }
 
+void CarTire::getForces(
+	CarTire * const tire[],
+	const btScalar normal_force[],
+	const btScalar friction_coeff[],
+	const btScalar inclination[],
+	const btScalar rot_velocity[],
+	const btScalar lon_velocity[],
+	const btScalar lat_velocity[],
+	btVector3 force[],
+	int count)
+{
+	const int lanes = 4;
+	const int bnum = 11, anum = 15, cnum = 18;
+	for (int n = 0; n < count; n += lanes)
+	{
+		// unused lanes repeat the last tire
+		const CarTire * t[lanes];
+		btScalar load[lanes], mu[lanes], camber[lanes], gamma[lanes], sigma[lanes], tan_alpha[lanes];
+		btScalar sigma_hat[lanes], alpha_hat[lanes], expx[lanes], expz[lanes];
+		for (int l = 0; l < lanes; ++l)
+		{
+			const int k = n + btMin(l, count - n - 1);
+			t[l] = tire[k];
+
+			// lanes without contact are evaluated at 1 kN to stay finite
+			bool contact = normal_force[k] * friction_coeff[k] >= 1E-6;
+			load[l] = contact ? btMin(normal_force[k] * btScalar(0.001), btScalar(30)) : 1;
+			mu[l] = friction_coeff[k];
+			camber[l] = inclination[k];
+			btClamp(camber[l], btScalar(-0.1 * M_PI), btScalar(0.1 * M_PI));
+			gamma[l] = camber[l] * SIMD_DEGS_PER_RAD;
+			t[l]->getSigmaHatAlphaHat(normal_force[k], sigma_hat[l], alpha_hat[l]);
+
+			btScalar denom = btMax(btFabs(lon_velocity[k]), btScalar(1E-3));
+			sigma[l] = (rot_velocity[k] - lon_velocity[k]) / denom;
+			tan_alpha[l] = lat_velocity[k] / denom;
+
+			// load only, exp stays scalar to keep its full range
+			expx[l] = exp(-t[l]->longitudinal[5] * load[l]);
+			expz[l] = exp(-t[l]->aligning[5] * load[l]);
+		}
+
+		// transpose coefficients into lanes
+		Scalar4 b[bnum], a[anum], c[cnum];
+		for (int i = 0; i < bnum; ++i)
+		{
+			b[i] = Scalar4(t[0]->longitudinal[i], t[1]->longitudinal[i], t[2]->longitudinal[i], t[3]->longitudinal[i]);
+		}
+		for (int i = 0; i < anum; ++i)
+		{
+			a[i] = Scalar4(t[0]->lateral[i], t[1]->lateral[i], t[2]->lateral[i], t[3]->lateral[i]);
+		}
+		for (int i = 0; i < cnum; ++i)
+		{
+			c[i] = Scalar4(t[0]->aligning[i], t[1]->aligning[i], t[2]->aligning[i], t[3]->aligning[i]);
+		}
+
+		Scalar4 Fz(load[0], load[1], load[2], load[3]);
+		Scalar4 friction(mu[0], mu[1], mu[2], mu[3]);
+		Scalar4 g(gamma[0], gamma[1], gamma[2], gamma[3]);
+		Scalar4 s(sigma[0], sigma[1], sigma[2], sigma[3]);
+		Scalar4 alpha = -atan4(Scalar4(tan_alpha[0], tan_alpha[1], tan_alpha[2], tan_alpha[3])) * SIMD_DEGS_PER_RAD;
+		Scalar4 sh(sigma_hat[0], sigma_hat[1], sigma_hat[2], sigma_hat[3]);
+		Scalar4 ah(alpha_hat[0], alpha_hat[1], alpha_hat[2], alpha_hat[3]);
+
+		// beckman combining, see getForce
+		Scalar4 sigma_sign = select4(greater4(0, s), -1, 1);
+		Scalar4 alpha_sign = select4(greater4(0, alpha), -1, 1);
+		Scalar4 sn = s / sh;
+		Scalar4 an = alpha / ah;
+		Scalar4 rho = max4(sqrt4(sn * sn + an * an), btScalar(1E-4));
+		Scalar4 sp = rho * sh * sigma_sign;
+		Scalar4 ap = rho * ah * alpha_sign;
+		Scalar4 gx = sn / rho * sigma_sign;
+		Scalar4 gy = an / rho * alpha_sign;
+
+		// magic formula, see PacejkaFx, PacejkaFy, PacejkaMz
+		Scalar4 Cx = b[0];
+		Scalar4 Dx = (b[1] * Fz + b[2]) * Fz;
+		Scalar4 Bx = (b[3] * Fz + b[4]) * Fz * Scalar4(expx[0], expx[1], expx[2], expx[3]) / (Cx * Dx);
+		Scalar4 Ex = b[6] * Fz * Fz + b[7] * Fz + b[8];
+		Scalar4 BSx = Bx * (100 * sp);
+		Scalar4 Fx = Dx * sin4(Cx * atan4(BSx - Ex * (BSx - atan4(BSx)))) * friction;
+
+		Scalar4 Cy = a[0];
+		Scalar4 Dy = (a[1] * Fz + a[2]) * Fz;
+		Scalar4 By = a[3] * sin4(2 * atan4(Fz / a[4])) * (1 - a[5] * abs4(g)) / (Cy * Dy);
+		Scalar4 Ey = a[6] * Fz + a[7];
+		Scalar4 Svy = ((a[11] * Fz + a[12]) * g + a[13]) * Fz + a[14];
+		Scalar4 BSy = By * ap;
+		Scalar4 Fy = (Dy * sin4(Cy * atan4(BSy - Ey * (BSy - atan4(BSy)))) + Svy) * friction;
+
+		Scalar4 Cz = c[0];
+		Scalar4 Dz = (c[1] * Fz + c[2]) * Fz;
+		Scalar4 Bz = (c[3] * Fz + c[4]) * Fz * (1 - c[6] * abs4(g)) * Scalar4(expz[0], expz[1], expz[2], expz[3]) / (Cz * Dz);
+		Scalar4 Ez = (c[7] * Fz * Fz + c[8] * Fz + c[9]) * (1 - c[10] * abs4(g));
+		Scalar4 Shz = c[11] * g + c[12] * Fz + c[13];
+		Scalar4 Svz = (c[14] * Fz * Fz + c[15] * Fz) * g + c[16] * Fz + c[17];
+		Scalar4 BSz = Bz * (alpha + Shz);
+		Scalar4 Mz = (Dz * sin4(Cz * atan4(BSz - Ez * (BSz - atan4(BSz)))) + Svz) * friction;
+
+		btScalar fx[lanes], fy[lanes], mz[lanes], slip[lanes];
+		(gx * Fx).store(fx);
+		(gy * Fy).store(fy);
+		Mz.store(mz);
+		alpha.store(slip);
+
+		// scatter results, tires without contact keep their state
+		for (int l = 0; l < lanes && n + l < count; ++l)
+		{
+			const int k = n + l;
+			if (normal_force[k] * friction_coeff[k] < 1E-6)
+			{
+				force[k] = btVector3(0, 0, 0);
+				continue;
+			}
+
+			CarTire & tk = *tire[k];
+			tk.camber = camber[l];
+			tk.slide = sigma[l];
+			tk.slip = slip[l] * SIMD_RADS_PER_DEG;
+			tk.ideal_slide = sigma_hat[l];
+			tk.ideal_slip = alpha_hat[l] * SIMD_RADS_PER_DEG;
+			tk.fx = fx[l];
+			tk.fy = fy[l];
+			tk.fz = load[l];
+			tk.mz = mz[l];
+			force[k] = btVector3(fx[l], fy[l], mz[l]);
+		}
+	}
+}
+
 btScalar CarTire::getRollingResistance(const btScalar velocity, const btScalar resistance_factor) const
 {
 	// surface influence on rolling resistance
@@ -344,4 +478,66 @@ void CarTire::initSigmaHatAlphaHat(int tablesize)
 	}
 }
 
+
+QT_TEST(cartire_batch_test)
+{
+	const btScalar longitudinal[11] = {1.65, -7.5, 1688, 0, 229, 0.01, 0, 0, -0.5, 0, 0};
+	const btScalar lateral[15] = {1.799, -15, 1688, 4140, 6.026, 0.01, -0.3589, 1, 0, -0.006111, -0.03224, 0, 0, 0.5, 10};
+	const btScalar aligning[18] = {2.068, -6.49, -21.85, 0.416, -21.31, 0.02942, 0.01, -1.197, 5.228, -14.84, 0, 0, -0.003736, 0.03891, 0, 0, 0, 0};
+
+	// five tires to cover a partially filled lane block, peak grip differs per tire
+	const int count = 5;
+	CarTire tire_scalar[count], tire_batch[count];
+	CarTire * tire_ptr[count];
+	for (int i = 0; i < count; ++i)
+	{
+		CarTireInfo info;
+		info.longitudinal.assign(longitudinal, longitudinal + 11);
+		info.lateral.assign(lateral, lateral + 15);
+		info.aligning.assign(aligning, aligning + 18);
+		info.longitudinal[2] += 50 * i;
+		info.lateral[2] -= 50 * i;
+		tire_scalar[i].init(info);
+		tire_batch[i].init(info);
+		tire_ptr[i] = &tire_batch[i];
+	}
+
+	btScalar load[count], mu[count], camber[count], vrot[count], vlon[count], vlat[count];
+	btVector3 force[count];
+	for (btScalar v = -5; v <= 40; v += 5)
+	{
+		for (btScalar slip = -0.5; slip <= 0.5; slip += 0.05)
+		{
+			for (btScalar angle = -0.4; angle <= 0.4; angle += 0.05)
+			{
+				for (int i = 0; i < count; ++i)
+				{
+					load[i] = 1000 + 2500 * i;
+					mu[i] = 1.0 - 0.1 * i;
+					camber[i] = 0.02 * (i - 2);
+					vlon[i] = v;
+					vrot[i] = v * (1 + slip);
+					vlat[i] = btTan(angle) * btFabs(v);
+				}
+				load[count - 1] = 0; // no contact
+
+				CarTire::getForces(tire_ptr, load, mu, camber, vrot, vlon, vlat, force, count);
+
+				for (int i = 0; i < count; ++i)
+				{
+					btVector3 f = tire_scalar[i].getForce(load[i], mu[i], camber[i], vrot[i], vlon[i], vlat[i]);
+					btScalar tolerance = 1E-4 * load[i] + 1E-3;
+					QT_CHECK_CLOSE(force[i][0], f[0], tolerance);
+					QT_CHECK_CLOSE(force[i][1], f[1], tolerance);
+					QT_CHECK_CLOSE(force[i][2], f[2], tolerance);
+					QT_CHECK_CLOSE(tire_batch[i].getSlip(), tire_scalar[i].getSlip(), 1E-4);
+					QT_CHECK_CLOSE(tire_batch[i].getSlipAngle(), tire_scalar[i].getSlipAngle(), 1E-4);
+					QT_CHECK_CLOSE(tire_batch[i].getIdealSlip(), tire_scalar[i].getIdealSlip(), 1E-6);
+					QT_CHECK_CLOSE(tire_batch[i].getIdealSlipAngle(), tire_scalar[i].getIdealSlipAngle(), 1E-6);
+				}
+			}
+		}
+	}
+}
+
 #endif
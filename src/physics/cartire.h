@@ -72,6 +72,21 @@ public:
 		btScalar lon_velocty,
 		btScalar lat_velocity);
 
+	/// batched getForce, evaluates count tires in lanes of four
+	/// input and output arrays hold count elements, tire state is updated
+	/// uses vectorizable approximations of atan and sin,
+	/// forces differ from getForce by less than 1E-4 of the normal force
+	static void getForces(
+		CarTire * const tire[],
+		const btScalar normal_force[],
+		const btScalar friction_coeff[],
+		const btScalar inclination[],
+		const btScalar rot_velocity[],
+		const btScalar lon_velocity[],
+		const btScalar lat_velocity[],
+		btVector3 force[],
+		int count);
+
 	btScalar getRollingResistance(
 		const btScalar velocity,
 		const btScalar resistance_factor) const;
@@ -22,9 +22,13 @@
 #include "collision_contact.h"
 #include "tobullet.h"
 #include "track.h"
+#include "quickprof.h"
+#include "quickmp.h"
 
 #define EXTBULLET
 
+static quickprof::Clock profile_clock;
+
 struct MyRayResultCallback : public btCollisionWorld::RayResultCallback
 {
 	MyRayResultCallback(
@@ -95,7 +99,10 @@ DynamicsWorld::DynamicsWorld(
 	btDiscreteDynamicsWorld(dispatcher, broadphase, constraintSolver, collisionConfig),
 	track(0),
 	timeStep(timeStep),
-	maxSubSteps(maxSubSteps)
+	maxSubSteps(maxSubSteps),
+	profiling(false),
+	multithreaded(false),
+	raybatching(true)
 {
 	setGravity(btVector3(0.0, 0.0, -9.81));
 	setForceUpdateAllAabbs(false);
@@ -110,12 +117,32 @@ const Bezier* DynamicsWorld::GetSectorPatch(int i){
 	return track->GetSectorPatch(i);
 }
 
-bool DynamicsWorld::castRay(
+// broadphase objects overlapping an aabb
+struct RayObjectCallback : public btBroadphaseAabbCallback
+{
+	RayObjectCallback(btAlignedObjectArray<btCollisionObject*> & objects) :
+		objects(objects)
+	{
+		// ctor
+	}
+
+	virtual bool process(const btBroadphaseProxy * proxy)
+	{
+		objects.push_back(static_cast<btCollisionObject*>(proxy->m_clientObject));
+		return true;
+	}
+
+	btAlignedObjectArray<btCollisionObject*> & objects;
+};
+
+// contact from ray hit, refined by track bezier patches
+static bool GetRayContact(
+	const Track * track,
 	const btVector3 & origin,
 	const btVector3 & direction,
 	const btScalar length,
-	const btCollisionObject * caster,
-	CollisionContact & contact) const
+	const MyRayResultCallback & ray,
+	CollisionContact & contact)
 {
 	btVector3 p = origin + direction * length;
 	btVector3 n = -direction;
@@ -125,9 +152,6 @@ bool DynamicsWorld::castRay(
 	const TrackSurface * s = TrackSurface::None();
 	const btCollisionObject * c = 0;
 
-	MyRayResultCallback ray(origin, p, caster);
-	rayTest(origin, p, ray);
-
 	// track geometry collision
 	bool geometryHit = ray.hasHit();
 	if (geometryHit)
@@ -182,6 +206,134 @@ bool DynamicsWorld::castRay(
 	return false;
 }
 
+void RayBatch::add(
+	const btVector3 & origin,
+	const btVector3 & direction,
+	const btScalar length,
+	const btCollisionObject * caster,
+	CollisionContact & contact)
+{
+	Ray ray;
+	ray.origin = origin;
+	ray.direction = direction;
+	ray.length = length;
+	ray.caster = caster;
+	ray.contact = &contact;
+	rays.push_back(ray);
+}
+
+void RayBatch::clear()
+{
+	rays.resize(0);
+}
+
+int RayBatch::size() const
+{
+	return rays.size();
+}
+
+bool DynamicsWorld::castRay(
+	const btVector3 & origin,
+	const btVector3 & direction,
+	const btScalar length,
+	const btCollisionObject * caster,
+	CollisionContact & contact) const
+{
+	unsigned long long int start = 0;
+	if (profiling)
+		start = profile_clock.getTimeMicroseconds();
+
+	// broadphase ray test uses shared scratch buffers, serialize it when
+	// called from the parallel action update, bezier patch tests below are
+	// read only and run concurrently
+	bool parallel = QMP_IN_PARALLEL();
+	btVector3 end = origin + direction * length;
+	MyRayResultCallback ray(origin, end, caster);
+	if (parallel)
+		QMP_CRITICAL(0);
+	rayTest(origin, end, ray);
+	if (parallel)
+		QMP_END_CRITICAL(0);
+
+	bool hit = GetRayContact(track, origin, direction, length, ray, contact);
+	if (profiling)
+		addCastRayProfile(start);
+	return hit;
+}
+
+void DynamicsWorld::castRays(RayBatch & batch) const
+{
+	const btAlignedObjectArray<RayBatch::Ray> & rays = batch.rays;
+	if (rays.size() == 0)
+		return;
+
+	unsigned long long int start = 0;
+	if (profiling)
+		start = profile_clock.getTimeMicroseconds();
+
+	// scratch buffers are shared, serialize when called from the parallel action update
+	bool parallel = QMP_IN_PARALLEL();
+	if (parallel)
+		QMP_CRITICAL(0);
+
+	for (int first = 0, last = 0; first < rays.size(); first = last)
+	{
+		// one broadphase query for all consecutive rays of a caster
+		btVector3 aabb_min = rays[first].origin;
+		btVector3 aabb_max = rays[first].origin;
+		for (last = first; last < rays.size() && rays[last].caster == rays[first].caster; ++last)
+		{
+			btVector3 end = rays[last].origin + rays[last].direction * rays[last].length;
+			aabb_min.setMin(rays[last].origin);
+			aabb_min.setMin(end);
+			aabb_max.setMax(rays[last].origin);
+			aabb_max.setMax(end);
+		}
+		rayobjects.resize(0);
+		RayObjectCallback objects(rayobjects);
+		m_broadphasePairCache->aabbTest(aabb_min, aabb_max, objects);
+
+		for (int i = first; i < last; ++i)
+		{
+			const RayBatch::Ray & r = rays[i];
+			btVector3 end = r.origin + r.direction * r.length;
+			btTransform from(btMatrix3x3::getIdentity(), r.origin);
+			btTransform to(btMatrix3x3::getIdentity(), end);
+			MyRayResultCallback ray(r.origin, end, r.caster);
+			for (int n = 0; n < rayobjects.size(); ++n)
+			{
+				// same filtering as the broadphase ray test, caster is skipped early
+				btCollisionObject * object = rayobjects[n];
+				btBroadphaseProxy * proxy = object->getBroadphaseHandle();
+				btScalar fraction = ray.m_closestHitFraction;
+				btVector3 normal;
+				if (object != r.caster && ray.needsCollision(proxy) &&
+					btRayAabb(r.origin, end, proxy->m_aabbMin, proxy->m_aabbMax, fraction, normal))
+				{
+					rayTestSingle(from, to, object, object->getCollisionShape(), object->getWorldTransform(), ray);
+				}
+			}
+			GetRayContact(track, r.origin, r.direction, r.length, ray, *r.contact);
+		}
+	}
+
+	if (parallel)
+		QMP_END_CRITICAL(0);
+
+	if (profiling)
+		addCastRayProfile(start, rays.size());
+}
+
+void DynamicsWorld::addRayCaster(RayCaster * caster)
+{
+	raycasters.push_back(caster);
+}
+
+void DynamicsWorld::removeRayCaster(RayCaster * caster)
+{
+	raycasters.remove(caster);
+}
+
 void DynamicsWorld::update(btScalar dt)
 {
 	stepSimulation(dt, maxSubSteps, timeStep);
@@ -193,6 +345,85 @@ void DynamicsWorld::debugPrint(std::ostream & out) const
 	out << "Collision objects: " << getNumCollisionObjects() << std::endl;
 }
 
+void DynamicsWorld::setProfiling(bool value)
+{
+	profiling = value;
+	resetProfile();
+}
+
+const DynamicsWorld::Profile & DynamicsWorld::getProfile() const
+{
+	return profile;
+}
+
+void DynamicsWorld::resetProfile()
+{
+	profile = Profile();
+}
+
+void DynamicsWorld::setMultithreaded(bool value)
+{
+	multithreaded = value;
+}
+
+void DynamicsWorld::setRayBatching(bool value)
+{
+	raybatching = value;
+}
+
+void DynamicsWorld::updateActions(btScalar timeStep)
+{
+	unsigned long long int start = 0;
+	if (profiling)
+		start = profile_clock.getTimeMicroseconds();
+
+	// rays of all casters in one batch, actions read their contacts
+	if (raybatching && raycasters.size() > 0)
+	{
+		raybatch.clear();
+		for (int i = 0; i < raycasters.size(); ++i)
+		{
+			raycasters[i]->getRays(raybatch);
+		}
+		castRays(raybatch);
+	}
+
+	if (multithreaded && m_actions.size() > 1)
+		updateActionsParallel(timeStep);
+	else
+		btDiscreteDynamicsWorld::updateActions(timeStep);
+
+	if (profiling)
+		profile.actions += profile_clock.getTimeMicroseconds() - start;
+}
+
+void DynamicsWorld::updateActionsParallel(btScalar timeStep)
+{
+	btCollisionWorld * world = this;
+	btActionInterface ** actions = &m_actions[0];
+	QMP_SHARE(world);
+	QMP_SHARE(actions);
+	QMP_SHARE(timeStep);
+	QMP_PARALLEL_FOR(i, 0, m_actions.size())
+		QMP_USE_SHARED(world, btCollisionWorld *);
+		QMP_USE_SHARED(actions, btActionInterface **);
+		QMP_USE_SHARED(timeStep, btScalar);
+		actions[i]->updateAction(world, timeStep);
+	QMP_END_PARALLEL_FOR;
+}
+
+void DynamicsWorld::addCastRayProfile(unsigned long long int start, unsigned count) const
+{
+	unsigned long long int dt = profile_clock.getTimeMicroseconds() - start;
+	bool parallel = QMP_IN_PARALLEL();
+	if (parallel)
+		QMP_CRITICAL(1);
+	profile.castray += dt;
+	profile.castray_count += count;
+	if (parallel)
+		QMP_END_CRITICAL(1);
+}
+
 void DynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
 	// todo: after fracture we should run the solver again for better realism
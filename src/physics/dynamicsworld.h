@@ -30,6 +30,44 @@ class CollisionContact;
 class FractureBody;
 class Bezier;
 
+// rays cast into the collision world in one call
+class RayBatch
+{
+public:
+	// contact receives the first hit of the ray, caster is excluded from hits
+	// rays of the same caster should be added consecutively
+	void add(
+		const btVector3 & origin,
+		const btVector3 & direction,
+		const btScalar length,
+		const btCollisionObject * caster,
+		CollisionContact & contact);
+
+	void clear();
+
+	int size() const;
+
+private:
+	friend class DynamicsWorld;
+	struct Ray
+	{
+		btVector3 origin;
+		btVector3 direction;
+		btScalar length;
+		const btCollisionObject * caster;
+		CollisionContact * contact;
+	};
+	btAlignedObjectArray<Ray> rays;
+};
+
+// rays of all registered casters are cast in one batch before the action update
+class RayCaster
+{
+public:
+	virtual ~RayCaster() {}
+	virtual void getRays(RayBatch & rays) = 0;
+};
+
 class DynamicsWorld  : public btDiscreteDynamicsWorld
 {
 public:
@@ -61,12 +99,45 @@ public:
 		const btCollisionObject * caster,
 		CollisionContact & contact) const;
 
+	// cast a batch of rays, the broadphase is traversed once per caster
+	void castRays(RayBatch & rays) const;
+
+	// register ray caster, its rays are cast before the action update
+	void addRayCaster(RayCaster * caster);
+
+	void removeRayCaster(RayCaster * caster);
+
+	// cast the rays of registered casters in one batch, enabled by default
+	// if disabled casters cast their own rays during the action update
+	void setRayBatching(bool value);
+
 	void update(btScalar dt);
 
 	void draw();
 
 	void debugPrint(std::ostream & out) const;
 
+	// accumulated time (in us) spent in car actions and ray casts
+	struct Profile
+	{
+		Profile() : actions(0), castray(0), castray_count(0) {}
+		double actions;
+		double castray;
+		unsigned castray_count;
+	};
+
+	// enable phase timing, disabled by default
+	void setProfiling(bool value);
+
+	// phase timing since last reset
+	const Profile & getProfile() const;
+
+	void resetProfile();
+
+	// update car actions in parallel, actions only interact through ray casts
+	// into the collision world which is not modified during the action update
+	void setMultithreaded(bool value);
+
 protected:
 	struct ActiveCon
 	{
@@ -76,12 +147,25 @@ protected:
 		int id;
 	};
 	btAlignedObjectArray<ActiveCon> m_activeConnections;
+	btAlignedObjectArray<RayCaster*> raycasters;
+	RayBatch raybatch;
+	mutable btAlignedObjectArray<btCollisionObject*> rayobjects;
 	const Track * track;
 	btScalar timeStep;
 	int maxSubSteps;
+	mutable Profile profile;
+	bool profiling;
+	bool multithreaded;
+	bool raybatching;
 
 	void reset();
 
+	void updateActions(btScalar timeStep);
+
+	void updateActionsParallel(btScalar timeStep);
+
+	void addCastRayProfile(unsigned long long int start, unsigned count = 1) const;
+
 	void solveConstraints(btContactSolverInfo& solverInfo);
 
 	void fractureCallback();
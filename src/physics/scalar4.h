@@ -0,0 +1,155 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SCALAR4_H
+#define _SCALAR4_H
+
+#include "LinearMath/btVector3.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) && !defined(BT_USE_DOUBLE_PRECISION)
+#include <emmintrin.h>
+#define SCALAR4_SSE
+#endif
+
+// four lane scalar vector used by the batched tire evaluations,
+// sse when available, plain arrays otherwise
+struct Scalar4
+{
+#ifdef SCALAR4_SSE
+	__m128 v;
+	Scalar4() {}
+	Scalar4(__m128 v) : v(v) {}
+	Scalar4(btScalar s) : v(_mm_set1_ps(s)) {}
+	Scalar4(btScalar a, btScalar b, btScalar c, btScalar d) : v(_mm_setr_ps(a, b, c, d)) {}
+	void store(btScalar * p) const { _mm_storeu_ps(p, v); }
+#else
+	btScalar v[4];
+	Scalar4() {}
+	Scalar4(btScalar s) { v[0] = s; v[1] = s; v[2] = s; v[3] = s; }
+	Scalar4(btScalar a, btScalar b, btScalar c, btScalar d) { v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+	void store(btScalar * p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+#endif
+};
+
+#ifdef SCALAR4_SSE
+inline Scalar4 operator+(const Scalar4 & a, const Scalar4 & b) { return _mm_add_ps(a.v, b.v); }
+inline Scalar4 operator-(const Scalar4 & a, const Scalar4 & b) { return _mm_sub_ps(a.v, b.v); }
+inline Scalar4 operator*(const Scalar4 & a, const Scalar4 & b) { return _mm_mul_ps(a.v, b.v); }
+inline Scalar4 operator/(const Scalar4 & a, const Scalar4 & b) { return _mm_div_ps(a.v, b.v); }
+inline Scalar4 operator-(const Scalar4 & a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+inline Scalar4 abs4(const Scalar4 & a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline Scalar4 min4(const Scalar4 & a, const Scalar4 & b) { return _mm_min_ps(a.v, b.v); }
+inline Scalar4 max4(const Scalar4 & a, const Scalar4 & b) { return _mm_max_ps(a.v, b.v); }
+inline Scalar4 sqrt4(const Scalar4 & a) { return _mm_sqrt_ps(a.v); }
+
+// lane mask, all bits set where a > b
+inline Scalar4 greater4(const Scalar4 & a, const Scalar4 & b) { return _mm_cmpgt_ps(a.v, b.v); }
+
+// per lane mask ? a : b
+inline Scalar4 select4(const Scalar4 & mask, const Scalar4 & a, const Scalar4 & b)
+{
+	return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+}
+
+inline Scalar4 floor4(const Scalar4 & a)
+{
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+}
+#else
+#define SCALAR4_OP(expr) Scalar4 r; for (int i = 0; i < 4; ++i) r.v[i] = expr; return r;
+inline Scalar4 operator+(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(a.v[i] + b.v[i]) }
+inline Scalar4 operator-(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(a.v[i] - b.v[i]) }
+inline Scalar4 operator*(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(a.v[i] * b.v[i]) }
+inline Scalar4 operator/(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(a.v[i] / b.v[i]) }
+inline Scalar4 operator-(const Scalar4 & a) { SCALAR4_OP(-a.v[i]) }
+inline Scalar4 abs4(const Scalar4 & a) { SCALAR4_OP(btFabs(a.v[i])) }
+inline Scalar4 min4(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(btMin(a.v[i], b.v[i])) }
+inline Scalar4 max4(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(btMax(a.v[i], b.v[i])) }
+inline Scalar4 sqrt4(const Scalar4 & a) { SCALAR4_OP(btSqrt(a.v[i])) }
+inline Scalar4 greater4(const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(a.v[i] > b.v[i]) }
+inline Scalar4 select4(const Scalar4 & mask, const Scalar4 & a, const Scalar4 & b) { SCALAR4_OP(mask.v[i] ? a.v[i] : b.v[i]) }
+inline Scalar4 floor4(const Scalar4 & a) { SCALAR4_OP(std::floor(a.v[i])) }
+#undef SCALAR4_OP
+#endif
+
+inline Scalar4 sgn4(const Scalar4 & a)
+{
+	return select4(greater4(a, 0), 1, 0) - select4(greater4(0, a), 1, 0);
+}
+
+// Abramowitz and Stegun 4.4.49, max error 2E-8 rad
+inline Scalar4 atan4(const Scalar4 & x)
+{
+	const btScalar a1 = 0.9999993329;
+	const btScalar a3 = -0.3332985605;
+	const btScalar a5 = 0.1994653599;
+	const btScalar a7 = -0.1390853351;
+	const btScalar a9 = 0.0964200441;
+	const btScalar a11 = -0.0559098861;
+	const btScalar a13 = 0.0218612288;
+	const btScalar a15 = -0.0040540580;
+	Scalar4 a = abs4(x);
+	Scalar4 t = min4(a, 1) / max4(a, 1);
+	Scalar4 s = t * t;
+	Scalar4 r = t * (a1 + s * (a3 + s * (a5 + s * (a7 + s * (a9 + s * (a11 + s * (a13 + s * a15)))))));
+	r = select4(greater4(a, 1), SIMD_HALF_PI - r, r);
+	return select4(greater4(0, x), -r, r);
+}
+
+// reduced to [-pi/2, pi/2], taylor series up to x^11, max error 6E-8
+inline Scalar4 sin4(const Scalar4 & x)
+{
+	const btScalar c3 = -1.0 / 6.0;
+	const btScalar c5 = 1.0 / 120.0;
+	const btScalar c7 = -1.0 / 5040.0;
+	const btScalar c9 = 1.0 / 362880.0;
+	const btScalar c11 = -1.0 / 39916800.0;
+	Scalar4 y = x - SIMD_2_PI * floor4(x * btScalar(1 / SIMD_2_PI) + btScalar(0.5));
+	y = select4(greater4(y, SIMD_HALF_PI), SIMD_PI - y, y);
+	y = select4(greater4(-SIMD_HALF_PI, y), -SIMD_PI - y, y);
+	Scalar4 s = y * y;
+	return y * (1 + s * (c3 + s * (c5 + s * (c7 + s * (c9 + s * c11)))));
+}
+
+inline Scalar4 cos4(const Scalar4 & x)
+{
+	return sin4(x + SIMD_HALF_PI);
+}
+
+// taylor series up to x^6 of x/16 squared four times, accurate for |x| < 4
+inline Scalar4 exp4(const Scalar4 & x)
+{
+	const btScalar c2 = 1.0 / 2.0;
+	const btScalar c3 = 1.0 / 6.0;
+	const btScalar c4 = 1.0 / 24.0;
+	const btScalar c5 = 1.0 / 120.0;
+	const btScalar c6 = 1.0 / 720.0;
+	Scalar4 y = x * btScalar(1.0 / 16.0);
+	Scalar4 e = 1 + y * (1 + y * (c2 + y * (c3 + y * (c4 + y * (c5 + y * c6)))));
+	e = e * e;
+	e = e * e;
+	e = e * e;
+	e = e * e;
+	return e;
+}
+
+#endif
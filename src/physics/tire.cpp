@@ -18,6 +18,8 @@
 /************************************************************************/
 
 #include "tire.h"
+#include "scalar4.h"
+#include "unittest.h"
 
 template <typename T>
 inline T sgn(T val)
@@ -35,7 +37,8 @@ TireInfo::TireInfo() :
 	max_camber(15),
 	roll_resistance_quad(1E-6),
 	roll_resistance_lin(1E-3),
-	tread(0)
+	tread(0),
+	tabulated(false)
 {
 	// ctor
 }
@@ -47,7 +50,13 @@ Tire::Tire() :
 	ideal_slip_angle(0),
 	vx(0), vy(0),
 	fx(0), fy(0), fz(0),
-	mz(0)
+	mz(0),
+	table_slip_scale(1),
+	table_slip_range(0.5),
+	table_angle_scale(1),
+	table_angle_range(0.5),
+	table_camber_max(1),
+	table_error(0, 0, 0)
 {
 	// ctor
 }
@@ -56,6 +65,7 @@ void Tire::init(const TireInfo & info)
 {
 	TireInfo::operator=(info);
 	initSigmaHatAlphaHat();
+	initTable();
 }
 
 void Tire::getSigmaHatAlphaHat(btScalar load, btScalar & sh, btScalar & ah) const
@@ -96,23 +106,13 @@ btVector3 Tire::getForce(
 	btScalar sigma = -lon_slip_velocity / denom;
 	btScalar alpha = btAtan(lat_velocity / denom);
 
-	// force parameters
+	// forces
 	btScalar Fz = normal_load;
-	btScalar Fz0 = nominal_load;
-	btScalar dFz = (Fz - Fz0) / Fz0;
-
-	// pure slip
-	btScalar Dy, BCy, Shf;
-	btScalar Fx0 = PacejkaFx(sigma, Fz, dFz, friction_coeff);
-	btScalar Fy0 = PacejkaFy(alpha, camber, Fz, dFz, friction_coeff, Dy, BCy, Shf);
-	btScalar Mz0 = PacejkaMz(alpha, camber, Fz, dFz, friction_coeff, Fy0, BCy, Shf);
-
-	// combined slip
-	btScalar Gx = PacejkaGx(sigma, alpha);
-	btScalar Gy = PacejkaGy(sigma, alpha);
-	btScalar Svy = PacejkaSvy(sigma, alpha, camber, Dy, dFz);
-	btScalar Fx = Gx * Fx0;
-	btScalar Fy = Gy * Fy0 + Svy;
+	btScalar Fx, Fy, Mz;
+	if (table.empty())
+		getFormulaForce(sigma, alpha, camber, Fz, friction_coeff, Fx, Fy, Mz);
+	else
+		getTableForce(sigma, alpha, camber, Fz, friction_coeff, Fx, Fy, Mz);
 
 	// ideal slip and angle
 	btScalar sigma_hat(0), alpha_hat(0);
@@ -125,11 +125,304 @@ btVector3 Tire::getForce(
 	fx = Fx;
 	fy = Fy;
 	fz = Fz;
-	mz = Mz0;
+	mz = Mz;
 	vx = lon_slip_velocity;
 	vy = lat_velocity;
 
-	return btVector3(Fx, Fy, Mz0);
+	return btVector3(Fx, Fy, Mz);
+}
+
+void Tire::getFormulaForce(
+	btScalar sigma,
+	btScalar alpha,
+	btScalar gamma,
+	btScalar Fz,
+	btScalar friction_coeff,
+	btScalar & Fx,
+	btScalar & Fy,
+	btScalar & Mz) const
+{
+	btScalar Fz0 = nominal_load;
+	btScalar dFz = (Fz - Fz0) / Fz0;
+
+	// pure slip
+	btScalar Dy, BCy, Shf;
+	btScalar Fx0 = PacejkaFx(sigma, Fz, dFz, friction_coeff);
+	btScalar Fy0 = PacejkaFy(alpha, gamma, Fz, dFz, friction_coeff, Dy, BCy, Shf);
+	btScalar Mz0 = PacejkaMz(alpha, gamma, Fz, dFz, friction_coeff, Fy0, BCy, Shf);
+
+	// combined slip
+	btScalar Gx = PacejkaGx(sigma, alpha);
+	btScalar Gy = PacejkaGy(sigma, alpha);
+	btScalar Svy = PacejkaSvy(sigma, alpha, gamma, dFz, Dy);
+	Fx = Gx * Fx0;
+	Fy = Gy * Fy0 + Svy;
+	Mz = Mz0;
+}
+
+// force tables are stored as consecutive blocks in the table vector
+// Fx0[load][slip], Fy0[load][camber][angle], Mz0[load][camber][angle],
+// Gx[slip][angle], Gy[slip][angle], Svy[slip] (slip dependent factor)
+
+// map x to table coordinate [0, size - 1], u is expected in [-1, 1]
+static inline btScalar tableCoord(btScalar u, int size)
+{
+	btScalar x = (u + 1) * btScalar(0.5) * (size - 1);
+	btClamp(x, btScalar(0), btScalar(size - 1));
+	return x;
+}
+
+// compress unbounded slip into [-range, range], range < 1,
+// sampling density is highest around zero, slip beyond range is clamped
+static inline btScalar tableSlipCoord(btScalar x, btScalar scale, btScalar range, int size)
+{
+	return tableCoord(x / ((btFabs(x) + scale) * range), size);
+}
+
+// slip value of table sample i, inverse of tableSlipCoord
+static inline btScalar tableSlipSample(int i, btScalar scale, btScalar range, int size)
+{
+	btScalar u = range * (btScalar(2 * i) / (size - 1) - 1);
+	return scale * u / (1 - btFabs(u));
+}
+
+// compressed range covering slip values up to x
+static inline btScalar tableSlipRange(btScalar x, btScalar scale)
+{
+	return x / (x + scale);
+}
+
+static inline void tableIndex(btScalar x, int size, int & i, btScalar & blend)
+{
+	i = btMin(int(x), size - 2);
+	blend = x - i;
+}
+
+static inline btScalar lerp(btScalar a, btScalar b, btScalar blend)
+{
+	return a + (b - a) * blend;
+}
+
+// bilinear interpolation of row major table t[i][j]
+static inline btScalar lerp2(const btScalar * t, int rowsize, int i, int j, btScalar bi, btScalar bj)
+{
+	const btScalar * t0 = t + i * rowsize + j;
+	const btScalar * t1 = t0 + rowsize;
+	return lerp(lerp(t0[0], t0[1], bj), lerp(t1[0], t1[1], bj), bi);
+}
+
+void Tire::getTableForce(
+	btScalar sigma,
+	btScalar alpha,
+	btScalar gamma,
+	btScalar Fz,
+	btScalar friction_coeff,
+	btScalar & Fx,
+	btScalar & Fy,
+	btScalar & Mz) const
+{
+	const int ns = table_slip_size;
+	const int nc = table_camber_size;
+	const int nl = table_load_size;
+	const int ng = table_combined_size;
+	const btScalar * tfx = &table[0];
+	const btScalar * tfy = tfx + nl * ns;
+	const btScalar * tmz = tfy + nl * nc * ns;
+	const btScalar * tgx = tmz + nl * nc * ns;
+	const btScalar * tgy = tgx + ng * ng;
+	const btScalar * tsv = tgy + ng * ng;
+
+	int is, ia, ic, il, igs, iga;
+	btScalar bs, ba, bc, bl, bgs, bga;
+	tableIndex(tableSlipCoord(sigma, table_slip_scale, table_slip_range, ns), ns, is, bs);
+	tableIndex(tableSlipCoord(alpha, table_angle_scale, table_angle_range, ns), ns, ia, ba);
+	tableIndex(tableSlipCoord(sigma, table_slip_scale, table_slip_range, ng), ng, igs, bgs);
+	tableIndex(tableSlipCoord(alpha, table_angle_scale, table_angle_range, ng), ng, iga, bga);
+	tableIndex(tableCoord(gamma / table_camber_max, nc), nc, ic, bc);
+	tableIndex(tableCoord(2 * Fz / max_load - 1, nl), nl, il, bl);
+
+	// pure slip, normalized by load
+	btScalar Fx0 = lerp2(tfx, ns, il, is, bl, bs);
+	btScalar Fy0 = lerp(
+		lerp2(tfy + il * nc * ns, ns, ic, ia, bc, ba),
+		lerp2(tfy + (il + 1) * nc * ns, ns, ic, ia, bc, ba), bl);
+	btScalar Mz0 = lerp(
+		lerp2(tmz + il * nc * ns, ns, ic, ia, bc, ba),
+		lerp2(tmz + (il + 1) * nc * ns, ns, ic, ia, bc, ba), bl);
+
+	// combined slip
+	btScalar Gx = lerp2(tgx, ng, igs, iga, bgs, bga);
+	btScalar Gy = lerp2(tgy, ng, igs, iga, bgs, bga);
+
+	// combined slip lateral offset, slip factor from table, see PacejkaSvy
+	const btScalar * p = coefficients;
+	btScalar dFz = (Fz - nominal_load) / nominal_load;
+	btScalar Dy = Fz * (p[PDY1] + p[PDY2] * dFz) * (1 - p[PDY3] * gamma * gamma);
+	btScalar Dv = Dy * (p[RVY1] + p[RVY2] * dFz + p[RVY3] * gamma) / btSqrt(1 + p[RVY4] * p[RVY4] * alpha * alpha);
+	btScalar Svy = Dv * lerp(tsv[is], tsv[is + 1], bs);
+
+	btScalar mu = friction_coeff * Fz;
+	Fx = Gx * Fx0 * mu;
+	Fy = Gy * Fy0 * mu + Svy;
+	Mz = Mz0 * mu;
+}
+
+void Tire::getForces(
+	Tire * const tire[],
+	const btScalar normal_load[],
+	const btScalar friction_coeff[],
+	const btScalar camber[],
+	const btScalar rot_velocity[],
+	const btScalar lon_velocity[],
+	const btScalar lat_velocity[],
+	btVector3 force[],
+	int count)
+{
+	const int lanes = 4;
+	for (int n = 0; n < count; n += lanes)
+	{
+		// tabulated tires are cheaper to evaluate one by one
+		bool tabulated = false;
+		for (int k = n; k < n + lanes && k < count; ++k)
+		{
+			tabulated = tabulated || !tire[k]->table.empty();
+		}
+		if (tabulated)
+		{
+			for (int k = n; k < n + lanes && k < count; ++k)
+			{
+				force[k] = tire[k]->getForce(normal_load[k], friction_coeff[k], camber[k],
+					rot_velocity[k], lon_velocity[k], lat_velocity[k]);
+			}
+			continue;
+		}
+
+		// unused lanes repeat the last tire
+		const Tire * t[lanes];
+		btScalar load[lanes], mu[lanes], gamma[lanes], vslip[lanes], sigma[lanes], tan_alpha[lanes];
+		for (int l = 0; l < lanes; ++l)
+		{
+			const int k = n + btMin(l, count - n - 1);
+			t[l] = tire[k];
+
+			// lanes without contact are evaluated at nominal load to stay finite
+			bool contact = normal_load[k] * friction_coeff[k] >= 1E-6;
+			load[l] = contact ? btMin(btMax(normal_load[k], btScalar(0)), t[l]->max_load) : t[l]->nominal_load;
+			mu[l] = friction_coeff[k];
+			gamma[l] = btMin(btMax(camber[k], -t[l]->max_camber), t[l]->max_camber);
+
+			btScalar denom = btMax(btFabs(lon_velocity[k]), btScalar(1E-3));
+			vslip[l] = lon_velocity[k] - rot_velocity[k];
+			sigma[l] = -vslip[l] / denom;
+			tan_alpha[l] = lat_velocity[k] / denom;
+		}
+
+		// transpose coefficients into lanes
+		Scalar4 p[CNUM];
+		for (int c = 0; c < CNUM; ++c)
+		{
+			p[c] = Scalar4(t[0]->coefficients[c], t[1]->coefficients[c], t[2]->coefficients[c], t[3]->coefficients[c]);
+		}
+
+		// magic formula, see PacejkaFx, PacejkaFy, PacejkaMz, PacejkaGx, PacejkaGy, PacejkaSvy
+		const btScalar R0 = 0.3;
+		Scalar4 Fz(load[0], load[1], load[2], load[3]);
+		Scalar4 Fz0(t[0]->nominal_load, t[1]->nominal_load, t[2]->nominal_load, t[3]->nominal_load);
+		Scalar4 g(gamma[0], gamma[1], gamma[2], gamma[3]);
+		Scalar4 s(sigma[0], sigma[1], sigma[2], sigma[3]);
+		Scalar4 a = atan4(Scalar4(tan_alpha[0], tan_alpha[1], tan_alpha[2], tan_alpha[3]));
+		Scalar4 friction(mu[0], mu[1], mu[2], mu[3]);
+		Scalar4 dFz = (Fz - Fz0) / Fz0;
+
+		// pure slip longitudinal
+		Scalar4 Svx = Fz * (p[PVX1] + p[PVX2] * dFz);
+		Scalar4 Shx = p[PHX1] + p[PHX2] * dFz;
+		Scalar4 Sx = s + Shx;
+		Scalar4 Kx = Fz * (p[PKX1] + p[PKX2] * dFz) * exp4(-p[PKX3] * dFz);
+		Scalar4 Ex = (p[PEX1] + p[PEX2] * dFz + p[PEX3] * dFz * dFz) * (1 - p[PEX4] * sgn4(Sx));
+		Scalar4 Dx = Fz * (p[PDX1] + p[PDX2] * dFz);
+		Scalar4 Cx = p[PCX1];
+		Scalar4 BSx = Kx / (Cx * Dx) * Sx;
+		Scalar4 Fx0 = (Dx * sin4(Cx * atan4(BSx - Ex * (BSx - atan4(BSx)))) + Svx) * friction;
+
+		// pure slip lateral
+		Scalar4 Svy0 = Fz * (p[PVY1] + p[PVY2] * dFz + (p[PVY3] + p[PVY4] * dFz) * g);
+		Scalar4 Shy = p[PHY1] + p[PHY2] * dFz + p[PHY3] * g;
+		Scalar4 Ay = a + Shy;
+		Scalar4 Ky = p[PKY1] * Fz0 * sin4(2 * atan4(Fz / (p[PKY2] * Fz0))) * (1 - p[PKY3] * abs4(g));
+		Scalar4 Ey = (p[PEY1] + p[PEY2] * dFz) * (1 - (p[PEY3] + p[PEY4] * g) * sgn4(Ay));
+		Scalar4 Dy = Fz * (p[PDY1] + p[PDY2] * dFz) * (1 - p[PDY3] * g * g);
+		Scalar4 Cy = p[PCY1];
+		Scalar4 By = Ky / (Cy * Dy);
+		Scalar4 BAy = By * Ay;
+		Scalar4 Fy0 = (Dy * sin4(Cy * atan4(BAy - Ey * (BAy - atan4(BAy)))) + Svy0) * friction;
+		Scalar4 BCy = By * Cy;
+		Scalar4 Shf = Shy + Svy0 / Ky;
+
+		// aligning torque
+		Scalar4 cos_alpha = cos4(a);
+		Scalar4 Sht = p[QHZ1] + p[QHZ2] * dFz + (p[QHZ3] + p[QHZ4] * dFz) * g;
+		Scalar4 At = a + Sht;
+		Scalar4 Bt = (p[QBZ1] + p[QBZ2] * dFz + p[QBZ3] * dFz * dFz) * (1 + p[QBZ4] * g + p[QBZ5] * abs4(g));
+		Scalar4 Ct = p[QCZ1];
+		Scalar4 Dt = Fz * (p[QDZ1] + p[QDZ2] * dFz) * (1 + p[QDZ3] * g + p[QDZ4] * g * g) * (R0 / Fz0);
+		Scalar4 Et = (p[QEZ1] + p[QEZ2] * dFz + p[QEZ3] * dFz * dFz) * (1 + (p[QEZ4] + p[QEZ5] * g) * atan4(Bt * Ct * At));
+		Scalar4 BAt = Bt * At;
+		Scalar4 Mzt = -Fy0 * Dt * cos4(Ct * atan4(BAt - Et * (BAt - atan4(BAt)))) * cos_alpha;
+		Scalar4 Ar = a + Shf;
+		Scalar4 Br = p[QBZ10] * BCy;
+		Scalar4 Dr = Fz * (p[QDZ6] + p[QDZ7] * dFz + (p[QDZ8] + p[QDZ9] * dFz) * g) * R0;
+		Scalar4 Mzr = Dr * cos4(atan4(Br * Ar)) * cos_alpha * friction;
+
+		// combined slip
+		Scalar4 Bgx = p[RBX1] * cos4(atan4(p[RBX2] * s));
+		Scalar4 Cgx = p[RCX1];
+		Scalar4 Gx = cos4(Cgx * atan4(Bgx * (a + p[RHX1]))) / cos4(Cgx * atan4(Bgx * p[RHX1]));
+
+		Scalar4 Bgy = p[RBY1] * cos4(atan4(p[RBY2] * (a - p[RBY3])));
+		Scalar4 Cgy = p[RCY1];
+		Scalar4 Gy = cos4(Cgy * atan4(Bgy * (s + p[RHY1]))) / cos4(Cgy * atan4(Bgy * p[RHY1]));
+
+		Scalar4 Dv = Dy * (p[RVY1] + p[RVY2] * dFz + p[RVY3] * g) * cos4(atan4(p[RVY4] * a));
+		Scalar4 Svy = Dv * sin4(p[RVY5] * atan4(p[RVY6] * s));
+
+		btScalar Fx[lanes], Fy[lanes], Mz[lanes], alpha[lanes];
+		(Gx * Fx0).store(Fx);
+		(Gy * Fy0 + Svy).store(Fy);
+		(Mzt + Mzr).store(Mz);
+		a.store(alpha);
+
+		// scatter results, update tire state
+		for (int l = 0; l < lanes && n + l < count; ++l)
+		{
+			const int k = n + l;
+			Tire & tk = *tire[k];
+			if (normal_load[k] * friction_coeff[k] < 1E-6)
+			{
+				tk.slip = tk.slip_angle = 0;
+				tk.ideal_slip = tk.ideal_slip_angle = 1;
+				tk.fx = tk.fy = tk.fz = tk.mz = 0;
+				tk.vx = tk.vy = 0;
+				force[k] = btVector3(0, 0, 0);
+				continue;
+			}
+
+			btScalar sigma_hat(0), alpha_hat(0);
+			tk.getSigmaHatAlphaHat(load[l], sigma_hat, alpha_hat);
+
+			tk.slip = sigma[l];
+			tk.slip_angle = alpha[l];
+			tk.ideal_slip = sigma_hat;
+			tk.ideal_slip_angle = alpha_hat;
+			tk.fx = Fx[l];
+			tk.fy = Fy[l];
+			tk.fz = load[l];
+			tk.mz = Mz[l];
+			tk.vx = vslip[l];
+			tk.vy = lat_velocity[k];
+			force[k] = btVector3(Fx[l], Fy[l], Mz[l]);
+		}
+	}
 }
 
 btScalar Tire::getSqueal() const
@@ -307,7 +600,7 @@ btScalar Tire::PacejkaMz(
 
 btScalar Tire::PacejkaGx(
 	btScalar sigma,
-	btScalar alpha)
+	btScalar alpha) const
 {
 	const btScalar * p = coefficients;
 	btScalar B = p[RBX1] * btCos(btAtan(p[RBX2] * sigma));
@@ -321,7 +614,7 @@ btScalar Tire::PacejkaGx(
 
 btScalar Tire::PacejkaGy(
 	btScalar sigma,
-	btScalar alpha)
+	btScalar alpha) const
 {
 	const btScalar * p = coefficients;
 	btScalar B = p[RBY1] * btCos(btAtan(p[RBY2] * (alpha - p[RBY3])));
@@ -338,7 +631,7 @@ btScalar Tire::PacejkaSvy(
 	btScalar alpha,
 	btScalar gamma,
 	btScalar dFz,
-	btScalar Dy)
+	btScalar Dy) const
 {
 	const btScalar * p = coefficients;
 	btScalar Dv = Dy * (p[RVY1] + p[RVY2] * dFz + p[RVY3] * gamma) * btCos(btAtan(p[RVY4] * alpha));
@@ -393,3 +686,205 @@ void Tire::initSigmaHatAlphaHat()
 	}
 }
 
+void Tire::initTable()
+{
+	table.clear();
+	table_error.setZero();
+	if (!tabulated)
+		return;
+
+	const int ns = table_slip_size;
+	const int nc = table_camber_size;
+	const int nl = table_load_size;
+	const int ng = table_combined_size;
+	table.resize(nl * ns + 2 * nl * nc * ns + 2 * ng * ng + ns);
+	btScalar * tfx = &table[0];
+	btScalar * tfy = tfx + nl * ns;
+	btScalar * tmz = tfy + nl * nc * ns;
+	btScalar * tgx = tmz + nl * nc * ns;
+	btScalar * tgy = tgx + ng * ng;
+	btScalar * tsv = tgy + ng * ng;
+
+	// slip axes are scaled by the ideal slip at nominal load
+	getSigmaHatAlphaHat(nominal_load, table_slip_scale, table_angle_scale);
+	table_slip_scale = btMax(table_slip_scale, btScalar(1E-2));
+	table_angle_scale = btMax(table_angle_scale, btScalar(1E-2));
+	table_slip_range = tableSlipRange(4, table_slip_scale);
+	table_angle_range = tableSlipRange(SIMD_HALF_PI, table_angle_scale);
+	table_camber_max = btMin(max_camber, btScalar(0.25));
+
+	const btScalar mu = 1.0;
+	btScalar Dy, BCy, Shf;
+	for (int l = 0; l < nl; ++l)
+	{
+		// forces are normalized by load, first sample is kept off zero load
+		btScalar Fz = max_load * btMax(btScalar(l) / (nl - 1), btScalar(1E-2));
+		btScalar dFz = (Fz - nominal_load) / nominal_load;
+		for (int s = 0; s < ns; ++s)
+		{
+			btScalar sigma = tableSlipSample(s, table_slip_scale, table_slip_range, ns);
+			tfx[l * ns + s] = PacejkaFx(sigma, Fz, dFz, mu) / Fz;
+		}
+		for (int c = 0; c < nc; ++c)
+		{
+			btScalar gamma = table_camber_max * (btScalar(2 * c) / (nc - 1) - 1);
+			for (int a = 0; a < ns; ++a)
+			{
+				btScalar alpha = tableSlipSample(a, table_angle_scale, table_angle_range, ns);
+				btScalar Fy0 = PacejkaFy(alpha, gamma, Fz, dFz, mu, Dy, BCy, Shf);
+				btScalar Mz0 = PacejkaMz(alpha, gamma, Fz, dFz, mu, Fy0, BCy, Shf);
+				tfy[(l * nc + c) * ns + a] = Fy0 / Fz;
+				tmz[(l * nc + c) * ns + a] = Mz0 / Fz;
+			}
+		}
+	}
+	for (int s = 0; s < ng; ++s)
+	{
+		btScalar sigma = tableSlipSample(s, table_slip_scale, table_slip_range, ng);
+		for (int a = 0; a < ng; ++a)
+		{
+			btScalar alpha = tableSlipSample(a, table_angle_scale, table_angle_range, ng);
+			tgx[s * ng + a] = PacejkaGx(sigma, alpha);
+			tgy[s * ng + a] = PacejkaGy(sigma, alpha);
+		}
+	}
+	for (int s = 0; s < ns; ++s)
+	{
+		btScalar sigma = tableSlipSample(s, table_slip_scale, table_slip_range, ns);
+		tsv[s] = btSin(coefficients[RVY5] * btAtan(coefficients[RVY6] * sigma));
+	}
+
+	// measure error half way between samples, worst case for linear interpolation
+	btVector3 error(0, 0, 0);
+	for (int l = 0; l < nl - 1; ++l)
+	{
+		btScalar Fz = max_load * (l + btScalar(0.5)) / (nl - 1);
+		for (int c = 0; c < nc - 1; ++c)
+		{
+			btScalar gamma = table_camber_max * (btScalar(2 * c + 1) / (nc - 1) - 1);
+			for (int s = 0; s < ns - 1; ++s)
+			{
+				btScalar sigma = 0.5 * (tableSlipSample(s, table_slip_scale, table_slip_range, ns) + tableSlipSample(s + 1, table_slip_scale, table_slip_range, ns));
+				for (int a = 0; a < ns - 1; ++a)
+				{
+					btScalar alpha = 0.5 * (tableSlipSample(a, table_angle_scale, table_angle_range, ns) + tableSlipSample(a + 1, table_angle_scale, table_angle_range, ns));
+					btScalar Fx, Fy, Mz, Fxt, Fyt, Mzt;
+					getFormulaForce(sigma, alpha, gamma, Fz, mu, Fx, Fy, Mz);
+					getTableForce(sigma, alpha, gamma, Fz, mu, Fxt, Fyt, Mzt);
+					error.setMax(btVector3(btFabs(Fxt - Fx), btFabs(Fyt - Fy), btFabs(Mzt - Mz)) / Fz);
+				}
+			}
+		}
+	}
+	table_error = error;
+}
+
+
+QT_TEST(tire_batch_test)
+{
+	const btScalar coefficients[TireInfo::CNUM] = {
+		1.65, 1.21, -0.037, 0.344, 0.095, -0.02, 0, 21.51, -0.163, 0.245, -0.002, 0.002, 0, 0,
+		1.193, 0.99, -0.145, 0.5, -1.003, -0.537, -0.083, -4.787, 14.95, 2.13, -0.028, 0.003, -0.001, 0.075, 0.045, -0.024, -0.532, 0.039,
+		10.9, -1.8, 0, 0.2, 0, 1.18, 0.09, -0.006, 0.2, 0, -1.6, 0.4, 0, 0.11, -0.9, 0.003, -0.001, 0.15, -0.04, 0, 0.4, 0.004, -0.003, -0.1, 0.01,
+		12.35, -10.77, 1.092, 0.007, 6.461, 4.196, -0.015, 1.081, 0.009, 0.053, -0.073, 0.517, 35.44, 1.9, -10.7};
+
+	// five tires to cover a partially filled lane block, peak grip differs per tire
+	const int count = 5;
+	Tire tire_scalar[count], tire_batch[count];
+	Tire * tire_ptr[count];
+	for (int i = 0; i < count; ++i)
+	{
+		TireInfo info;
+		for (int c = 0; c < TireInfo::CNUM; ++c)
+		{
+			info.coefficients[c] = coefficients[c];
+		}
+		info.coefficients[TireInfo::PDX1] += 0.05 * i;
+		info.coefficients[TireInfo::PDY1] -= 0.05 * i;
+		tire_scalar[i].init(info);
+		tire_batch[i].init(info);
+		tire_ptr[i] = &tire_batch[i];
+	}
+
+	btScalar load[count], mu[count], camber[count], vrot[count], vlon[count], vlat[count];
+	btVector3 force[count];
+	for (btScalar v = -5; v <= 40; v += 5)
+	{
+		for (btScalar slip = -0.5; slip <= 0.5; slip += 0.05)
+		{
+			for (btScalar angle = -0.4; angle <= 0.4; angle += 0.05)
+			{
+				for (int i = 0; i < count; ++i)
+				{
+					load[i] = 1000 + 2500 * i;
+					mu[i] = 1.0 - 0.1 * i;
+					camber[i] = 0.02 * (i - 2);
+					vlon[i] = v;
+					vrot[i] = v * (1 + slip);
+					vlat[i] = btTan(angle) * btFabs(v);
+				}
+				load[count - 1] = 0; // no contact
+
+				Tire::getForces(tire_ptr, load, mu, camber, vrot, vlon, vlat, force, count);
+
+				for (int i = 0; i < count; ++i)
+				{
+					btVector3 f = tire_scalar[i].getForce(load[i], mu[i], camber[i], vrot[i], vlon[i], vlat[i]);
+					btScalar tolerance = 1E-4 * load[i] + 1E-3;
+					QT_CHECK_CLOSE(force[i][0], f[0], tolerance);
+					QT_CHECK_CLOSE(force[i][1], f[1], tolerance);
+					QT_CHECK_CLOSE(force[i][2], f[2], tolerance);
+					QT_CHECK_CLOSE(tire_batch[i].getSlip(), tire_scalar[i].getSlip(), 1E-4);
+					QT_CHECK_CLOSE(tire_batch[i].getSlipAngle(), tire_scalar[i].getSlipAngle(), 1E-4);
+					QT_CHECK_CLOSE(tire_batch[i].getIdealSlip(), tire_scalar[i].getIdealSlip(), 1E-6);
+					QT_CHECK_CLOSE(tire_batch[i].getIdealSlipAngle(), tire_scalar[i].getIdealSlipAngle(), 1E-6);
+				}
+			}
+		}
+	}
+}
+
+QT_TEST(tire_table_test)
+{
+	TireInfo info;
+	const btScalar coefficients[TireInfo::CNUM] = {
+		1.65, 1.21, -0.037, 0.344, 0.095, -0.02, 0, 21.51, -0.163, 0.245, -0.002, 0.002, 0, 0,
+		1.193, 0.99, -0.145, 0.5, -1.003, -0.537, -0.083, -4.787, 14.95, 2.13, -0.028, 0.003, -0.001, 0.075, 0.045, -0.024, -0.532, 0.039,
+		10.9, -1.8, 0, 0.2, 0, 1.18, 0.09, -0.006, 0.2, 0, -1.6, 0.4, 0, 0.11, -0.9, 0.003, -0.001, 0.15, -0.04, 0, 0.4, 0.004, -0.003, -0.1, 0.01,
+		12.35, -10.77, 1.092, 0.007, 6.461, 4.196, -0.015, 1.081, 0.009, 0.053, -0.073, 0.517, 35.44, 1.9, -10.7};
+	for (int c = 0; c < TireInfo::CNUM; ++c)
+	{
+		info.coefficients[c] = coefficients[c];
+	}
+
+	Tire tire_formula, tire_table;
+	tire_formula.init(info);
+	info.tabulated = true;
+	tire_table.init(info);
+
+	QT_CHECK_EQUAL(tire_formula.getTableSize(), 0);
+	QT_CHECK(tire_table.getTableSize() > 0);
+	QT_CHECK(tire_table.getTableError()[0] > 0 && tire_table.getTableError()[0] < 0.015);
+	QT_CHECK(tire_table.getTableError()[1] > 0 && tire_table.getTableError()[1] < 0.025);
+	QT_CHECK(tire_table.getTableError()[2] < 0.002);
+
+	// forces within measured table error, small margin for samples outside the camber range
+	btVector3 error(0, 0, 0);
+	for (btScalar load = 500; load <= 9500; load += 1500)
+	{
+		for (btScalar slip = -0.5; slip <= 0.5; slip += 0.05)
+		{
+			for (btScalar angle = -0.4; angle <= 0.4; angle += 0.05)
+			{
+				btScalar v = 20;
+				btScalar camber = 0.01;
+				btVector3 f0 = tire_formula.getForce(load, 0.9, camber, v * (1 + slip), v, btTan(angle) * v);
+				btVector3 f1 = tire_table.getForce(load, 0.9, camber, v * (1 + slip), v, btTan(angle) * v);
+				error.setMax(btVector3(btFabs(f1[0] - f0[0]), btFabs(f1[1] - f0[1]), btFabs(f1[2] - f0[2])) / load);
+			}
+		}
+	}
+	QT_CHECK(error[0] < tire_table.getTableError()[0] * 1.5);
+	QT_CHECK(error[1] < tire_table.getTableError()[1] * 1.5);
+	QT_CHECK(error[2] < tire_table.getTableError()[2] * 1.5 + 1E-4);
+}
@@ -22,6 +22,8 @@
 
 #include "LinearMath/btVector3.h"
 
+#include <vector>
+
 struct TireInfo
 {
 	/// tire coefficients enumerator
@@ -71,6 +73,7 @@ struct TireInfo
 	btScalar roll_resistance_quad;	///< quadratic rolling resistance on a hard surface
 	btScalar roll_resistance_lin;	///< linear rolling resistance on a hard surface
 	btScalar tread;					///< 1.0 pure off-road tire, 0.0 pure road tire
+	bool tabulated;					///< interpolate sampled force tables instead of evaluating the magic formula
 	TireInfo();						///< default constructor
 };
 
@@ -100,6 +103,21 @@ public:
 		btScalar lon_velocty,
 		btScalar lat_velocity);
 
+	/// batched getForce, evaluates count tires in lanes of four
+	/// input and output arrays hold count elements, tire state is updated
+	/// uses vectorizable approximations of atan, sin, cos and exp,
+	/// forces differ from getForce by less than 1E-4 of the normal load
+	static void getForces(
+		Tire * const tire[],
+		const btScalar normal_load[],
+		const btScalar friction_coeff[],
+		const btScalar camber[],
+		const btScalar rot_velocity[],
+		const btScalar lon_velocity[],
+		const btScalar lat_velocity[],
+		btVector3 force[],
+		int count);
+
 	btScalar getRollingResistance(
 		const btScalar velocity,
 		const btScalar resistance_factor) const;
@@ -122,6 +140,13 @@ public:
 	/// load is the normal force in N, camber is in rad
 	btScalar getMaxFy(btScalar load, btScalar camber) const;
 
+	/// tabulated mode, maximum Fx, Fy, Mz error relative to load
+	/// measured in between table samples, zero if not tabulated
+	const btVector3 & getTableError() const;
+
+	/// tabulated mode, table memory in bytes
+	int getTableSize() const;
+
 private:
 	btScalar slip;				///< ratio of tire contact patch speed to road speed, minus one
 	btScalar slip_angle;		///< angle (in degrees) between the wheel heading and the wheel velocity
@@ -131,6 +156,40 @@ private:
 	btScalar fx, fy, fz;		///< contact force in tire space
 	btScalar mz;				///< aligning torque
 
+	static const int table_slip_size = 48;		///< slip ratio, slip angle samples
+	static const int table_camber_size = 5;		///< camber samples
+	static const int table_load_size = 8;		///< load samples
+	static const int table_combined_size = 32;	///< combined slip samples per axis
+	std::vector<btScalar> table;	///< forces normalized by load, empty if not tabulated
+	btScalar table_slip_scale;		///< slip ratio axis compression
+	btScalar table_slip_range;		///< slip ratio axis range, compressed
+	btScalar table_angle_scale;		///< slip angle axis compression
+	btScalar table_angle_range;		///< slip angle axis range, compressed
+	btScalar table_camber_max;		///< camber axis range
+	btVector3 table_error;			///< max force error relative to load
+
+	/// combined slip forces, magic formula
+	void getFormulaForce(
+		btScalar sigma,
+		btScalar alpha,
+		btScalar gamma,
+		btScalar Fz,
+		btScalar friction_coeff,
+		btScalar & Fx,
+		btScalar & Fy,
+		btScalar & Mz) const;
+
+	/// combined slip forces, interpolated from tables
+	void getTableForce(
+		btScalar sigma,
+		btScalar alpha,
+		btScalar gamma,
+		btScalar Fz,
+		btScalar friction_coeff,
+		btScalar & Fx,
+		btScalar & Fy,
+		btScalar & Mz) const;
+
 	/// longitudinal friction
 	btScalar PacejkaFx(
 		btScalar sigma,
@@ -163,12 +222,12 @@ private:
 	/// combined slip longitudinal factor
 	btScalar PacejkaGx(
 		btScalar sigma,
-		btScalar alpha);
+		btScalar alpha) const;
 
 	/// combined slip lateral factor
 	btScalar PacejkaGy(
 		btScalar sigma,
-		btScalar alpha);
+		btScalar alpha) const;
 
 	/// combined slip lateral offset
 	btScalar PacejkaSvy(
@@ -176,7 +235,7 @@ private:
 		btScalar alpha,
 		btScalar gamma,
 		btScalar dFz,
-		btScalar Dy);
+		btScalar Dy) const;
 
 	/// get ideal slide ratio, slip angle
 	void getSigmaHatAlphaHat(
@@ -193,6 +252,9 @@ private:
 
 	/// init sigma_hat, alpha_hat tables
 	void initSigmaHatAlphaHat();
+
+	/// sample force tables, measure table error
+	void initTable();
 };
 
 // implementation
@@ -237,6 +299,16 @@ inline btScalar Tire::getMz() const
 	return mz;
 }
 
+inline const btVector3 & Tire::getTableError() const
+{
+	return table_error;
+}
+
+inline int Tire::getTableSize() const
+{
+	return table.size() * sizeof(btScalar);
+}
+
 inline btScalar Tire::getRollingResistance(
 	const btScalar velocity,
 	const btScalar resistance_factor) const
@@ -334,6 +334,7 @@ namespace qmp_internal
 	#error This development environment does not support pthreads or windows threads
 #endif
 
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
@@ -25,15 +25,124 @@
 
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+
+/// frames per block, written while recording
+static const unsigned block_frames = 300;
+
+/// variable length unsigned, 7 bits per byte
+static void WriteVarint(std::string & out, unsigned value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(char((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(char(value));
+}
+
+static bool ReadVarint(const std::string & in, size_t & pos, unsigned & value)
+{
+	value = 0;
+	for (unsigned shift = 0; pos < in.size() && shift < 35; shift += 7)
+	{
+		unsigned char c = in[pos++];
+		value |= unsigned(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+/// inputs are in [0, 1], stored as 16 bit fixed point
+/// steering is signed, the ai writes left and right steering into STEER_RIGHT
+static bool IsSignedInput(unsigned index)
+{
+	return index == CarInput::STEER_RIGHT;
+}
+
+static unsigned QuantizeInput(unsigned index, float value)
+{
+	if (IsSignedInput(index))
+		return unsigned(std::min(std::max(value, -1.0f), 1.0f) * 32767 + 32767.5f);
+	return unsigned(std::min(std::max(value, 0.0f), 1.0f) * 65535 + 0.5f);
+}
+
+static float DequantizeInput(unsigned index, unsigned value)
+{
+	if (IsSignedInput(index))
+		return (int(value) - 32767) / 32767.0f;
+	return value / 65535.0f;
+}
+
+static void WriteInput(std::string & out, unsigned index, float value)
+{
+	unsigned q = QuantizeInput(index, value);
+	out.push_back(char(q >> 8));
+	out.push_back(char(q & 0xFF));
+}
+
+static bool ReadInput(const std::string & in, size_t & pos, unsigned index, float & value)
+{
+	if (pos + 2 > in.size())
+		return false;
+	unsigned q = (unsigned((unsigned char)in[pos]) << 8) | (unsigned char)in[pos + 1];
+	value = DequantizeInput(index, q);
+	pos += 2;
+	return true;
+}
+
+/// Zero run length coding, blocks are mostly xor deltas of consecutive keyframes.
+/// Output is a sequence of literal length, literal bytes, zero run length.
+static void PackZeroRuns(const std::string & in, std::string & out)
+{
+	out.clear();
+	size_t i = 0, n = in.size();
+	while (i < n)
+	{
+		// literals up to the next run of at least three zeros
+		size_t start = i;
+		while (i < n && !(i + 2 < n && !in[i] && !in[i + 1] && !in[i + 2]))
+			++i;
+		size_t end = i;
+		while (end < n && !in[end])
+			++end;
+		WriteVarint(out, i - start);
+		out.append(in, start, i - start);
+		WriteVarint(out, end - i);
+		i = end;
+	}
+}
+
+static bool UnpackZeroRuns(const std::string & in, unsigned size, std::string & out)
+{
+	out.clear();
+	out.reserve(size);
+	size_t pos = 0;
+	while (pos < in.size())
+	{
+		unsigned literal = 0, zeros = 0;
+		if (!ReadVarint(in, pos, literal) || literal > in.size() - pos)
+			return false;
+		out.append(in, pos, literal);
+		pos += literal;
+		if (!ReadVarint(in, pos, zeros) || out.size() + zeros > size)
+			return false;
+		out.append(zeros, '\0');
+	}
+	return out.size() == size;
+}
 
 Replay::Replay(float framerate) :
-	version_info("VDRIFTREPLAYV16", CarInput::INVALID, framerate),
-	replaymode(IDLE)
+	version_info("VDRIFTREPLAYV17", CarInput::INVALID, framerate),
+	replaymode(IDLE),
+	block_start(0),
+	verifying(false)
 {
 	// ctor
 }
 
-bool Replay::StartPlaying(const std::string & replayfilename, std::ostream & error_output)
+bool Replay::StartPlaying(const std::string & replayfilename, std::ostream & error_output, bool verify)
 {
 	Reset();
 
@@ -53,26 +162,37 @@ bool Replay::StartPlaying(const std::string & replayfilename, std::ostream & err
 	}
 
 	replaymode = PLAYING;
+	verifying = verify;
 
 	return true;
 }
 
 void Replay::Reset()
 {
+	if (recordstream.is_open())
+		recordstream.close();
 	replaymode = IDLE;
+	verifying = false;
 	track.clear();
 	carinfo.clear();
 	carstate.clear();
 }
 
-void Replay::StartRecording(
+bool Replay::StartRecording(
 	const std::vector<CarInfo> & ncarinfo,
 	const std::string & trackname,
+	const std::string & replayfilename,
 	std::ostream & error_log)
 {
 	Reset();
 
-	replaymode = RECORDING;
+	recordstream.open(replayfilename.c_str(), std::ios::binary);
+	if (!recordstream)
+	{
+		error_log << "Error creating replay file: " << replayfilename << std::endl;
+		return false;
+	}
+
 	carinfo = ncarinfo;
 	track = trackname;
 
@@ -81,19 +201,29 @@ void Replay::StartRecording(
 	{
 		carstate[i].Reset();
 	}
+	block_start = 0;
+
+	// write the file format version data manually
+	// if the serialization functions were used,
+	// a variable length string would be written instead,
+	// which isn't exactly what we want
+	version_info.Save(recordstream);
+
+	joeserialize::BinaryOutputSerializer serialize_output(recordstream);
+	SerializeHeader(serialize_output);
+
+	replaymode = RECORDING;
+
+	return true;
 }
 
-void Replay::StopRecording(const std::string & replayfilename)
+void Replay::StopRecording()
 {
-	replaymode = IDLE;
-	if (!replayfilename.empty())
+	if (GetRecording())
 	{
-		std::ofstream f(replayfilename.c_str(), std::ios::binary);
-		if (f)
-		{
-			Save(f);
-		}
+		WriteBlock();
 	}
+	Reset();
 }
 
 const std::vector<float> & Replay::PlayFrame(unsigned carid, Car & car)
@@ -101,13 +231,43 @@ const std::vector<float> & Replay::PlayFrame(unsigned carid, Car & car)
 	assert(carid < carstate.size());
 	assert(unsigned(version_info.inputs_supported) == CarInput::INVALID);
 
-	if (GetPlaying() && !carstate[carid].PlayFrame(car))
+	if (GetPlaying() && !carstate[carid].PlayFrame(car, verifying))
 	{
 		replaymode = IDLE;
 	}
 	return carstate[carid].inputbuffer;
 }
 
+bool Replay::VerifyFrame(unsigned carid, Car & car, Divergence & divergence)
+{
+	assert(carid < carstate.size());
+	assert(verifying);
+
+	const StateFrame * stateframe = carstate[carid].verify_stateframe;
+	if (!stateframe)
+		return false;
+	carstate[carid].verify_stateframe = NULL;
+
+	std::stringstream statestream;
+	joeserialize::BinaryOutputSerializer serialize_output(statestream);
+	car.Serialize(serialize_output);
+
+	divergence.frame = stateframe->GetFrame();
+	divergence.exact = (statestream.str() == stateframe->GetBinaryStateData());
+	divergence.position = 0;
+	divergence.velocity = 0;
+	if (!divergence.exact)
+	{
+		// resync to the recorded state, the difference is the divergence since the last keyframe
+		Vec3 position = car.GetPosition();
+		Vec3 velocity = car.GetVelocity();
+		carstate[carid].ProcessPlayStateFrame(*stateframe, car);
+		divergence.position = (car.GetPosition() - position).Magnitude();
+		divergence.velocity = (car.GetVelocity() - velocity).Magnitude();
+	}
+	return true;
+}
+
 void Replay::RecordFrame(unsigned carid, const std::vector <float> & inputs, Car & car)
 {
 	assert(carid < carstate.size());
@@ -117,12 +277,95 @@ void Replay::RecordFrame(unsigned carid, const std::vector <float> & inputs, Car
 	{
 		// enforce a maximum recording time of about 92 days
 		if (carstate[carid].frame > 2000000000)
-			replaymode = IDLE;
+		{
+			StopRecording();
+			return;
+		}
 
 		carstate[carid].RecordFrame(inputs, car);
+
+		// write a block once the last car has recorded its last frame
+		if (carid + 1 == carstate.size() && carstate[carid].frame - block_start >= block_frames)
+			WriteBlock();
+	}
+}
+
+void Replay::QuantizeInputs(std::vector<float> & inputs)
+{
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		inputs[i] = DequantizeInput(i, QuantizeInput(i, inputs[i]));
 	}
 }
 
+void Replay::WriteBlock()
+{
+	std::string block;
+	WriteVarint(block, block_start);
+	for (size_t i = 0; i < carstate.size(); ++i)
+	{
+		carstate[i].WriteBlock(block_start, block);
+	}
+	if (!carstate.empty())
+		block_start = carstate.back().frame;
+
+	unsigned size = block.size();
+	std::string data;
+	PackZeroRuns(block, data);
+
+	joeserialize::BinaryOutputSerializer serialize_output(recordstream);
+	serialize_output.Serialize("size", size);
+	serialize_output.Serialize("data", data);
+	recordstream.flush();
+}
+
+unsigned Replay::Seek(unsigned frame, std::list<Car> & cars)
+{
+	assert(cars.size() == carstate.size());
+	assert(!GetRecording());
+
+	// playback might have run out of frames already
+	replaymode = PLAYING;
+
+	// the cars are simulated together, they have to restart from the same keyframe
+	unsigned keyframe = frame;
+	for (bool synced = false; !synced;)
+	{
+		synced = true;
+		for (size_t i = 0; i < carstate.size(); ++i)
+		{
+			unsigned carkeyframe = carstate[i].GetKeyframe(keyframe);
+			if (carkeyframe < keyframe)
+			{
+				keyframe = carkeyframe;
+				synced = false;
+			}
+		}
+	}
+
+	size_t carid = 0;
+	for (std::list<Car>::iterator i = cars.begin(); i != cars.end(); ++i, ++carid)
+	{
+		carstate[carid].Seek(keyframe, *i);
+	}
+	return keyframe;
+}
+
+unsigned Replay::GetFrame() const
+{
+	return carstate.empty() ? 0 : carstate[0].frame;
+}
+
+unsigned Replay::GetFrameCount() const
+{
+	unsigned count = 0;
+	for (size_t i = 0; i < carstate.size(); ++i)
+	{
+		count = std::max(count, carstate[i].GetFrameCount());
+	}
+	return count;
+}
+
 void Replay::CarState::RecordFrame(const std::vector <float> & inputs, Car & car)
 {
 	assert(inputbuffer.size() == CarInput::INVALID);
@@ -154,10 +397,8 @@ void Replay::CarState::RecordFrame(const std::vector <float> & inputs, Car & car
 	frame++;
 }
 
-bool Replay::CarState::PlayFrame(Car & car)
+bool Replay::CarState::PlayFrame(Car & car, bool verify)
 {
-	frame++;
-
 	assert(inputbuffer.size() == CarInput::INVALID);
 
 	// fast forward through the inputframes until we're up to date
@@ -169,17 +410,197 @@ bool Replay::CarState::PlayFrame(Car & car)
 	}
 
 	// fast forward through the stateframes until we're up to date
+	verify_stateframe = NULL;
 	while (cur_stateframe < stateframes.size() &&
 			stateframes[cur_stateframe].GetFrame() <= frame)
 	{
 		if (stateframes[cur_stateframe].GetFrame() == frame)
-			ProcessPlayStateFrame(stateframes[cur_stateframe], car);
+		{
+			// verification compares the state once the car has processed the inputs
+			if (verify)
+				verify_stateframe = &stateframes[cur_stateframe];
+			else
+				ProcessPlayStateFrame(stateframes[cur_stateframe], car);
+		}
 		cur_stateframe++;
 	}
 
+	frame++;
+
 	return (cur_stateframe != stateframes.size() || cur_inputframe != inputframes.size());
 }
 
+template <class T>
+struct FrameLess
+{
+	bool operator()(unsigned frame, const T & other) const
+	{
+		return frame < other.GetFrame();
+	}
+};
+
+unsigned Replay::CarState::GetKeyframe(unsigned target) const
+{
+	std::vector<StateFrame>::const_iterator key = std::upper_bound(
+		stateframes.begin(), stateframes.end(), target, FrameLess<StateFrame>());
+	if (key == stateframes.begin())
+		return 0;
+	--key;
+	return key->GetFrame();
+}
+
+unsigned Replay::CarState::Seek(unsigned target, Car & car)
+{
+	// stateframes are recorded in frame order, binary search for the keyframe
+	std::vector<StateFrame>::const_iterator key = std::upper_bound(
+		stateframes.begin(), stateframes.end(), target, FrameLess<StateFrame>());
+	if (key == stateframes.begin())
+	{
+		Reset();
+		return 0;
+	}
+	--key;
+
+	unsigned keyframe = key->GetFrame();
+	frame = keyframe + 1;
+	cur_stateframe = key - stateframes.begin() + 1;
+	verify_stateframe = NULL;
+
+	// skip input frames up to and including the keyframe, the input snapshot covers them
+	std::vector<InputFrame>::const_iterator input = std::upper_bound(
+		inputframes.begin(), inputframes.end(), keyframe, FrameLess<InputFrame>());
+	cur_inputframe = input - inputframes.begin();
+
+	ProcessPlayStateFrame(*key, car);
+
+	return keyframe;
+}
+
+unsigned Replay::CarState::GetFrameCount() const
+{
+	unsigned count = 0;
+	if (!stateframes.empty())
+		count = stateframes.back().GetFrame();
+	if (!inputframes.empty())
+		count = std::max(count, inputframes.back().GetFrame());
+	return count;
+}
+
+void Replay::CarState::WriteBlock(unsigned start, std::string & block)
+{
+	WriteVarint(block, inputframes.size());
+	for (size_t n = 0; n < inputframes.size(); ++n)
+	{
+		const InputFrame & inputframe = inputframes[n];
+		WriteVarint(block, inputframe.GetFrame() - start);
+		WriteVarint(block, inputframe.GetNumInputs());
+		for (unsigned i = 0; i < inputframe.GetNumInputs(); ++i)
+		{
+			WriteVarint(block, inputframe.GetInput(i).first);
+			WriteInput(block, inputframe.GetInput(i).first, inputframe.GetInput(i).second);
+		}
+	}
+
+	WriteVarint(block, stateframes.size());
+	for (size_t n = 0; n < stateframes.size(); ++n)
+	{
+		const StateFrame & stateframe = stateframes[n];
+		WriteVarint(block, stateframe.GetFrame() - start);
+
+		const std::vector<float> & snapshot = stateframe.GetInputSnapshot();
+		WriteVarint(block, snapshot.size());
+		for (size_t i = 0; i < snapshot.size(); ++i)
+		{
+			WriteInput(block, i, snapshot[i]);
+		}
+
+		// xor against the previous keyframe, most state bytes don't change
+		const std::string & state = stateframe.GetBinaryStateData();
+		const bool delta = (state.size() == keyframe_state.size());
+		WriteVarint(block, state.size());
+		WriteVarint(block, delta);
+		if (delta)
+		{
+			for (size_t i = 0; i < state.size(); ++i)
+			{
+				block.push_back(state[i] ^ keyframe_state[i]);
+			}
+		}
+		else
+		{
+			block.append(state);
+		}
+		keyframe_state = state;
+	}
+
+	inputframes.clear();
+	stateframes.clear();
+}
+
+bool Replay::CarState::ReadBlock(unsigned start, const std::string & block, size_t & pos)
+{
+	unsigned count = 0;
+	if (!ReadVarint(block, pos, count))
+		return false;
+
+	for (unsigned n = 0; n < count; ++n)
+	{
+		unsigned offset = 0, inputs = 0;
+		if (!ReadVarint(block, pos, offset) || !ReadVarint(block, pos, inputs))
+			return false;
+
+		inputframes.push_back(InputFrame(start + offset));
+		for (unsigned i = 0; i < inputs; ++i)
+		{
+			unsigned index = 0;
+			float value = 0;
+			if (!ReadVarint(block, pos, index) || index >= CarInput::INVALID || !ReadInput(block, pos, index, value))
+				return false;
+			inputframes.back().AddInput(index, value);
+		}
+	}
+
+	if (!ReadVarint(block, pos, count))
+		return false;
+
+	for (unsigned n = 0; n < count; ++n)
+	{
+		unsigned offset = 0, inputs = 0;
+		if (!ReadVarint(block, pos, offset) || !ReadVarint(block, pos, inputs) || inputs > CarInput::INVALID)
+			return false;
+
+		std::vector<float> snapshot(inputs);
+		for (unsigned i = 0; i < inputs; ++i)
+		{
+			if (!ReadInput(block, pos, i, snapshot[i]))
+				return false;
+		}
+
+		unsigned size = 0, delta = 0;
+		if (!ReadVarint(block, pos, size) || !ReadVarint(block, pos, delta) || size > block.size() - pos)
+			return false;
+
+		std::string state(block, pos, size);
+		pos += size;
+		if (delta)
+		{
+			if (keyframe_state.size() != size)
+				return false;
+			for (size_t i = 0; i < size; ++i)
+			{
+				state[i] ^= keyframe_state[i];
+			}
+		}
+		keyframe_state = state;
+
+		stateframes.push_back(StateFrame(start + offset));
+		stateframes.back().SetBinaryStateData(state);
+		stateframes.back().SetInputSnapshot(snapshot);
+	}
+
+	return true;
+}
+
 void Replay::CarState::ProcessPlayInputFrame(const InputFrame & frame)
 {
 	for (unsigned i = 0; i < frame.GetNumInputs(); i++)
@@ -205,24 +626,17 @@ void Replay::CarState::ProcessPlayStateFrame(const StateFrame & frame, Car & car
 
 bool Replay::Serialize(joeserialize::Serializer & s)
 {
-	_SERIALIZE_(s, track);
-	_SERIALIZE_(s, carinfo);
+	if (!SerializeHeader(s))
+		return false;
 	_SERIALIZE_(s, carstate);
 	return true;
 }
 
-void Replay::Save(std::ostream & outstream)
+bool Replay::SerializeHeader(joeserialize::Serializer & s)
 {
-	// write the file format version data manually
-	// if the serialization functions were used,
-	// a variable length string would be written instead,
-	// which isn't exactly what we want
-	version_info.Save(outstream);
-
-	joeserialize::BinaryOutputSerializer serialize_output(outstream);
-	Serialize(serialize_output);
-
-	Reset();
+	_SERIALIZE_(s, track);
+	_SERIALIZE_(s, carinfo);
+	return true;
 }
 
 bool Replay::Load(std::istream & instream, std::ostream & error_output)
@@ -230,6 +644,19 @@ bool Replay::Load(std::istream & instream, std::ostream & error_output)
 	Version stream_version;
 	stream_version.Load(instream);
 
+	// version 16 files hold all frames in a single uncompressed stream
+	Version legacy_version("VDRIFTREPLAYV16", version_info.inputs_supported, version_info.framerate);
+	if (stream_version == legacy_version)
+	{
+		joeserialize::BinaryInputSerializer serialize_input(instream);
+		if (!Serialize(serialize_input))
+		{
+			error_output << "Error loading replay." << std::endl;
+			return false;
+		}
+		return true;
+	}
+
 	if (!(stream_version == version_info))
 	{
 		error_output << "Stream version " <<
@@ -244,12 +671,45 @@ bool Replay::Load(std::istream & instream, std::ostream & error_output)
 	}
 
 	joeserialize::BinaryInputSerializer serialize_input(instream);
-	if (!Serialize(serialize_input))
+	if (!SerializeHeader(serialize_input))
 	{
 		error_output << "Error loading replay." << std::endl;
 		return false;
 	}
 
+	carstate.resize(carinfo.size());
+	for (size_t i = 0; i < carstate.size(); ++i)
+	{
+		carstate[i].Reset();
+	}
+
+	while (instream.peek() != std::istream::traits_type::eof())
+	{
+		// a recording that has been cut off is playable up to its last complete block
+		unsigned size = 0;
+		std::string data;
+		if (!serialize_input.Serialize("size", size) ||
+			!serialize_input.Serialize("data", data))
+		{
+			error_output << "Replay is truncated, frames after " << GetFrameCount() << " are missing." << std::endl;
+			break;
+		}
+
+		std::string block;
+		size_t pos = 0;
+		unsigned start = 0;
+		bool success = UnpackZeroRuns(data, size, block) && ReadVarint(block, pos, start);
+		for (size_t i = 0; i < carstate.size() && success; ++i)
+		{
+			success = carstate[i].ReadBlock(start, block, pos);
+		}
+		if (!success)
+		{
+			error_output << "Error loading replay block at frame " << start << "." << std::endl;
+			return false;
+		}
+	}
+
 	return true;
 }
 
@@ -407,7 +867,9 @@ void Replay::CarState::Reset()
 	inputbuffer.resize(CarInput::INVALID, 0);
 	cur_inputframe = 0;
 	cur_stateframe = 0;
+	verify_stateframe = NULL;
 	frame = 0;
+	keyframe_state.clear();
 }
 
 bool Replay::CarState::Serialize(joeserialize::Serializer & s)
@@ -419,11 +881,82 @@ bool Replay::CarState::Serialize(joeserialize::Serializer & s)
 
 QT_TEST(replay_test)
 {
-	/*//basic version validity check
+	// zero run coding round trip
 	{
-		REPLAY replay(0.004);
-		stringstream teststream;
-		replay.Save(teststream);
-		QT_CHECK(replay.Load(teststream, std::cerr));
-	}*/
+		std::string data("\0\0\0\0abc\0d\0\0e\0\0\0\0\0\0\0f\0\0\0", 23);
+		data.append(1000, '\0');
+		data.append("tail");
+		std::string packed, unpacked;
+		PackZeroRuns(data, packed);
+		QT_CHECK(packed.size() < 40);
+		QT_CHECK(UnpackZeroRuns(packed, data.size(), unpacked));
+		QT_CHECK(unpacked == data);
+		QT_CHECK(!UnpackZeroRuns(packed, data.size() - 1, unpacked));
+	}
+
+	// quantized inputs are stable
+	{
+		std::vector<float> inputs;
+		inputs.push_back(0);
+		inputs.push_back(1);
+		inputs.push_back(0.123456);
+		inputs.push_back(-0.5);
+		inputs.push_back(2);
+		Replay::QuantizeInputs(inputs);
+		QT_CHECK_EQUAL(inputs[0], 0);
+		QT_CHECK_EQUAL(inputs[1], 1);
+		QT_CHECK_CLOSE(inputs[2], 0.123456, 1 / 65535.0);
+		QT_CHECK_EQUAL(inputs[3], 0);
+		QT_CHECK_EQUAL(inputs[4], 1);
+
+		std::vector<float> requantized(inputs);
+		Replay::QuantizeInputs(requantized);
+		QT_CHECK(requantized == inputs);
+
+		std::string block;
+		size_t pos = 0;
+		float value = 0;
+		WriteInput(block, 2, inputs[2]);
+		QT_CHECK(ReadInput(block, pos, 2, value));
+		QT_CHECK_EQUAL(value, inputs[2]);
+	}
+
+	// signed steering survives recording and playback
+	{
+		std::vector<float> inputs(CarInput::INVALID, 0.0f);
+		inputs[CarInput::STEER_RIGHT] = -0.7f;
+		inputs[CarInput::STEER_LEFT] = 0.25f;
+		Replay::QuantizeInputs(inputs);
+		QT_CHECK_CLOSE(inputs[CarInput::STEER_RIGHT], -0.7f, 1 / 32767.0);
+		QT_CHECK_CLOSE(inputs[CarInput::STEER_LEFT], 0.25f, 1 / 65535.0);
+
+		// the recorded value has to play back exactly as the car was driven
+		std::string block;
+		size_t pos = 0;
+		float steer = 0, zero = 1;
+		WriteInput(block, CarInput::STEER_RIGHT, inputs[CarInput::STEER_RIGHT]);
+		WriteInput(block, CarInput::STEER_RIGHT, 0.0f);
+		QT_CHECK(ReadInput(block, pos, CarInput::STEER_RIGHT, steer));
+		QT_CHECK(ReadInput(block, pos, CarInput::STEER_RIGHT, zero));
+		QT_CHECK_EQUAL(steer, inputs[CarInput::STEER_RIGHT]);
+		QT_CHECK_EQUAL(zero, 0.0f);
+		QT_CHECK_LESS(steer, 0.0f);
+	}
+
+	// varints
+	{
+		std::string block;
+		WriteVarint(block, 0);
+		WriteVarint(block, 127);
+		WriteVarint(block, 128);
+		WriteVarint(block, 4000000000u);
+		QT_CHECK_EQUAL(block.size(), 1 + 1 + 2 + 5);
+		size_t pos = 0;
+		unsigned value = 1;
+		QT_CHECK(ReadVarint(block, pos, value) && value == 0);
+		QT_CHECK(ReadVarint(block, pos, value) && value == 127);
+		QT_CHECK(ReadVarint(block, pos, value) && value == 128);
+		QT_CHECK(ReadVarint(block, pos, value) && value == 4000000000u);
+		QT_CHECK(!ReadVarint(block, pos, value));
+	}
 }
@@ -25,7 +25,10 @@
 #include "macros.h"
 
 #include <iosfwd>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <list>
 
 class Car;
 
@@ -34,10 +37,11 @@ class Replay
 public:
 	Replay(float framerate);
 
-	/// true on success
+	/// true on success, with verify set keyframes are left to VerifyFrame
 	bool StartPlaying(
 		const std::string & replayfilename,
-		std::ostream & error_output);
+		std::ostream & error_output,
+		bool verify = false);
 
 	/// stops playing/recording, clears state
 	void Reset();
@@ -45,13 +49,15 @@ public:
 	/// true if the replay system is currently playing
 	bool GetPlaying() const;
 
-	void StartRecording(
+	/// frames are written to replayfilename in blocks while recording, true on success
+	bool StartRecording(
 		const std::vector<CarInfo> & carinfo,
 		const std::string & trackname,
+		const std::string & replayfilename,
 		std::ostream & error_log);
 
-	/// if replayfilename is empty, do not save the data
-	void StopRecording(const std::string & replayfilename);
+	/// write the remaining frames, close the replay file
+	void StopRecording();
 
 	/// true if the replay system is currently recording
 	bool GetRecording() const;
@@ -59,9 +65,36 @@ public:
 	/// set car state, return car inputs
 	const std::vector<float> & PlayFrame(unsigned carid, Car & car);
 
+	/// difference between simulated and recorded car state
+	struct Divergence
+	{
+		unsigned frame;
+		float position; ///< position difference in m
+		float velocity; ///< velocity difference in m/s
+		bool exact; ///< true if the serialized states are identical
+	};
+
+	/// compare the car state after PlayFrame and car input update against the recorded keyframe,
+	/// then set the car to the keyframe state, false if the played frame has no keyframe
+	bool VerifyFrame(unsigned carid, Car & car, Divergence & divergence);
+
 	/// record car inputs and state
 	void RecordFrame(unsigned carid, const std::vector <float> & inputs, Car & car);
 
+	/// jump all cars to the last keyframe at or before frame they have in common, set car states,
+	/// return the keyframe, the caller has to simulate the frames from the keyframe up to frame
+	/// cars are in car id order, the order they are passed to PlayFrame in
+	unsigned Seek(unsigned frame, std::list<Car> & cars);
+
+	/// current play/record frame
+	unsigned GetFrame() const;
+
+	/// last recorded frame
+	unsigned GetFrameCount() const;
+
+	/// round inputs to the precision stored in the replay
+	static void QuantizeInputs(std::vector<float> & inputs);
+
 	bool Serialize(joeserialize::Serializer & s);
 
 	const std::vector<CarInfo> & GetCarInfo() const;
@@ -152,7 +185,9 @@ private:
 		std::vector<float> inputbuffer; // buffer for input delta frame decoding
 		unsigned cur_inputframe;
 		unsigned cur_stateframe;
+		const StateFrame * verify_stateframe; // keyframe of the last played frame, verify mode only
 		unsigned frame;
+		std::string keyframe_state; // previous keyframe state for delta coding
 
 		/// true if we have zero recorded frames
 		bool Empty() const;
@@ -164,11 +199,27 @@ private:
 		bool Serialize(joeserialize::Serializer & s);
 
 		/// set car, update inputbuffer, false if we are out of frames
-		bool PlayFrame(Car & car);
+		/// with verify set the keyframe is not applied but stored in verify_stateframe
+		bool PlayFrame(Car & car, bool verify);
 
 		/// get car state, save input delta frame
 		void RecordFrame(const std::vector<float> & inputs, Car & car);
 
+		/// frame of the last keyframe at or before target, 0 if there is none
+		unsigned GetKeyframe(unsigned target) const;
+
+		/// set car state of the last keyframe at or before target, return keyframe
+		unsigned Seek(unsigned target, Car & car);
+
+		/// last recorded frame
+		unsigned GetFrameCount() const;
+
+		/// append frames to the block, frame numbers relative to start, then clear them
+		void WriteBlock(unsigned start, std::string & block);
+
+		/// append frames read from the block at pos, false on corrupt data
+		bool ReadBlock(unsigned start, const std::string & block, size_t & pos);
+
 		void ProcessPlayInputFrame(const InputFrame & frame);
 
 		void ProcessPlayStateFrame(const StateFrame & frame, Car & car);
@@ -182,12 +233,18 @@ private:
 
 	/// not serialized
 	enum {IDLE, RECORDING, PLAYING} replaymode;
+	std::ofstream recordstream;
+	unsigned block_start;
+	bool verifying;
+
+	/// track and car info, written ahead of the frame blocks
+	bool SerializeHeader(joeserialize::Serializer & s);
 
-	/// load all input and state frames to the stream
+	/// load all input and state frames from the stream
 	bool Load(std::istream & instream, std::ostream & error_output);
 
-	/// save all input and state frames to the stream and then clear them
-	void Save(std::ostream & outstream);
+	/// compress recorded frames of all cars into a block, write it to the record stream
+	void WriteBlock();
 };
 
 // implementation
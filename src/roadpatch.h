@@ -78,4 +78,54 @@ private:
 	VertexArray racingline_vertexarray;
 };
 
+/// Closest hit of a ray against patches found by a space partitioning query.
+/// Used as the query output list, patches are tested as the query reports
+/// their index, so no candidate list has to be stored.
+template <typename PatchArray>
+class RoadPatchRayTest
+{
+public:
+	RoadPatchRayTest(
+		const PatchArray & patches,
+		const Vec3 & origin,
+		const Vec3 & direction,
+		float seglen) :
+		patches(patches),
+		origin(origin),
+		direction(direction),
+		seglen(seglen),
+		id(-1)
+	{
+		// ctor
+	}
+
+	void push_back(int i)
+	{
+		Vec3 coltri, colnorm;
+		if (GetPatch(patches[i]).Collide(origin, direction, seglen, coltri, colnorm))
+		{
+			if (id < 0 || (coltri - origin).MagnitudeSquared() < (point - origin).MagnitudeSquared())
+			{
+				point = coltri;
+				normal = colnorm;
+				id = i;
+			}
+		}
+	}
+
+	bool Hit() const {return id >= 0;}
+
+	const PatchArray & patches;
+	const Vec3 origin;
+	const Vec3 direction;
+	const float seglen;
+	Vec3 point; ///< closest hit point
+	Vec3 normal; ///< closest hit normal
+	int id; ///< closest hit patch index, -1 if no hit
+
+private:
+	static const RoadPatch & GetPatch(const RoadPatch & patch) {return patch;}
+	static const RoadPatch & GetPatch(const RoadPatch * patch) {return *patch;}
+};
+
 #endif // _ROADPATCH_H
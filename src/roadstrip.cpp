@@ -124,26 +124,17 @@ bool RoadStrip::Collide(
 		}
 	}
 
-	bool col = false;
-	std::vector<int> candidates;
-	aabb_part.Query(Aabb<float>::Ray(origin, direction, seglen), candidates);
-	for (std::vector<int>::iterator i = candidates.begin(); i != candidates.end(); ++i)
+	RoadPatchRayTest<std::vector<RoadPatch> > ray(patches, origin, direction, seglen);
+	aabb_part.Query(Aabb<float>::Ray(origin, direction, seglen), ray);
+	if (ray.Hit())
 	{
-		Vec3 coltri, colnorm;
-		if (patches[*i].Collide(origin, direction, seglen, coltri, colnorm))
-		{
-			if (!col || (coltri-origin).MagnitudeSquared() < (outtri-origin).MagnitudeSquared())
-			{
-				outtri = coltri;
-				normal = colnorm;
-				colpatch = &patches[*i].GetPatch();
-				patch_id = *i;
-			}
-			col = true;
-		}
+		outtri = ray.point;
+		normal = ray.normal;
+		colpatch = &patches[ray.id].GetPatch();
+		patch_id = ray.id;
 	}
 
-	return col;
+	return ray.Hit();
 }
 
 void RoadStrip::CreateRacingLine(
@@ -21,7 +21,7 @@
 #define _ROADSTRIP_H
 
 #include "roadpatch.h"
-#include "aabbtree.h"
+#include "aabbbvh.h"
 #include "optional.h"
 #include "memory.h"
 
@@ -71,7 +71,7 @@ public:
 private:
 	std::tr1::shared_ptr<Texture> racingline_texture;
 	std::vector<RoadPatch> patches;
-	AabbTreeNode <unsigned> aabb_part;
+	AabbBvh <unsigned> aabb_part;
 	bool closed;
 
 	void GenerateSpacePartitioning();
@@ -216,6 +216,12 @@ public:
 		return texture_compress;
 	}
 
+	/// memory budget of cached content in megabytes
+	int GetContentBudget() const
+	{
+		return content_budget;
+	}
+
 	float GetButtonRamp() const
 	{
 		return button_ramp;
@@ -427,6 +433,7 @@ private:
 	std::string selected_replay;
 	std::string texture_size;
 	bool texture_compress;
+	int content_budget;
 	float button_ramp;
 	std::string ff_device;
 	float ff_gain;
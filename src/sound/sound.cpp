@@ -19,9 +19,17 @@
 
 #include "sound.h"
 #include "coordinatesystem.h"
+#include "unittest.h"
 #include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOUND_SSE
+#endif
 
 //static std::ofstream logso("logso.txt");
 //static std::ofstream logsa("logsa.txt");
@@ -124,6 +132,22 @@ static inline const T & GetItem(size_t id, const std::vector<T> & items, size_t
 	return items[idn];
 }
 
+// sources quieter than this are virtual, they are not mixed
+static const float audible_gain = 1E-3f;
+
+// squared distance beyond which the distance attenuation is zero, 1000^(1/1.3) m
+static const float max_distance2 = 202.35f * 202.35f;
+
+// distance attenuation, 0.75 at 1m, 0 at 200m distance
+static inline float GetDistanceGain(float distance)
+{
+	// v1: 1.5 at 1m, 0 at 200m distance
+	//float cgain = log(1000.0 / pow((double)len, 1.3)) / log(100.0);
+	// scaled v1 by 0.5: 0.75 at 1m, 0 at 200m distance
+	float cgain = 0.5f / log(100.f) * (log(1000.f) - 1.3f * log(distance));
+	return clamp(cgain, 0.0f, 1.0f);
+}
+
 bool Sound::SourceActive::operator<(const Sound::SourceActive & other) const
 {
 	// reverse op as partial sort sorts for the smallest elemets
@@ -144,7 +168,12 @@ Sound::Sound() :
 	set_pause(true),
 	sampler_lock(0),
 	source_lock(0),
+	stream_lock(0),
+	stream_thread(0),
+	stream_quit(false),
 	max_active_sources(64),
+	voices_real(0),
+	voices_virtual(0),
 	sources_num(0),
 	update_id(0),
 	sources_pause(true),
@@ -153,6 +182,8 @@ Sound::Sound() :
 {
 	sources.reserve(64);
 	samplers.reserve(64);
+	sampler_lock = SDL_CreateMutex();
+	source_lock = SDL_CreateMutex();
 }
 
 Sound::~Sound()
@@ -160,6 +191,17 @@ Sound::~Sound()
 	if (initdone)
 		SDL_CloseAudio();
 
+	if (stream_thread)
+	{
+		SDL_LockMutex(stream_lock);
+		stream_quit = true;
+		SDL_UnlockMutex(stream_lock);
+		SDL_WaitThread(stream_thread, NULL);
+	}
+
+	if (stream_lock)
+		SDL_DestroyMutex(stream_lock);
+
 	if (sampler_lock)
 		SDL_DestroyMutex(sampler_lock);
 
@@ -172,9 +214,6 @@ bool Sound::Init(int buffersize, std::ostream & info_output, std::ostream & erro
 	if (disable || initdone)
 		return false;
 
-	sampler_lock = SDL_CreateMutex();
-	source_lock = SDL_CreateMutex();
-
 	SDL_AudioSpec desired, obtained;
 
 	desired.freq = 44100;
@@ -229,6 +268,14 @@ bool Sound::Init(int buffersize, std::ostream & info_output, std::ostream & erro
 	initdone = true;
 	SetVolume(1.0);
 
+	// decode streamed sounds in the background
+	stream_lock = SDL_CreateMutex();
+#if SDL_VERSION_ATLEAST(2,0,0)
+	stream_thread = SDL_CreateThread(DecodeStreams, NULL, this);
+#else
+	stream_thread = SDL_CreateThread(DecodeStreams, this);
+#endif
+
 	// enable sound, run callback
 	SDL_PauseAudio(false);
 
@@ -255,6 +302,27 @@ void Sound::SetMaxActiveSources(size_t value)
 	max_active_sources = value;
 }
 
+bool Sound::GetAudible(float x, float y, float z, float gain) const
+{
+	Vec3 relvec = Vec3(x, y, z) - listener_pos;
+	float len2 = relvec.MagnitudeSquared();
+	if (len2 > max_distance2)
+		return false;
+	float len = sqrt(len2);
+	if (len < 0.1f) len = 0.1f;
+	return GetDistanceGain(len) * gain >= audible_gain;
+}
+
+size_t Sound::GetRealVoices() const
+{
+	return voices_real;
+}
+
+size_t Sound::GetVirtualVoices() const
+{
+	return voices_virtual;
+}
+
 size_t Sound::AddSource(std::tr1::shared_ptr<SoundBuffer> buffer, float offset, bool is3d, bool loop)
 {
 	Source src;
@@ -267,11 +335,31 @@ size_t Sound::AddSource(std::tr1::shared_ptr<SoundBuffer> buffer, float offset,
 	src.is3d = is3d;
 	src.playing = true;
 	src.loop = loop;
+
+	// long sounds are decoded while playing
+	int samples_per_channel = buffer->GetInfo().channels ? buffer->GetInfo().samples / buffer->GetInfo().channels : 0;
+	if (buffer->GetStreamed() && initdone && samples_per_channel > 0)
+	{
+		int frame = int(offset * Sampler::denom) % samples_per_channel;
+		src.stream.reset(new SoundStream(*buffer, loop));
+		if (src.stream->Open(frame, *log_error))
+		{
+			SDL_LockMutex(stream_lock);
+			streams.push_back(src.stream);
+			SDL_UnlockMutex(stream_lock);
+		}
+		else
+		{
+			src.stream.reset();
+		}
+	}
+
 	size_t id = AddItem(src, sources, sources_num);
 
 	// notify sound thread
 	SamplerAdd ns;
 	ns.buffer = buffer.get();
+	ns.stream = src.stream.get();
 	ns.offset = offset * Sampler::denom;
 	ns.loop = loop;
 	ns.id = -1;
@@ -296,6 +384,7 @@ void Sound::ResetSource(size_t id)
 	// notify sound thread
 	SamplerAdd ns;
 	ns.buffer = src.buffer.get();
+	ns.stream = src.stream.get();
 	ns.offset = src.offset * Sampler::denom;
 	ns.loop = src.loop;
 	ns.id = idn;
@@ -347,6 +436,28 @@ void Sound::SetVolume(float value)
 	sound_volume = value;
 }
 
+void Sound::Mix(unsigned char * stream, int len)
+{
+	GetSamplerChanges();
+/*
+	logsa << "id: " << samplers_update.getLast().id;
+	logsa << " add: " << samplers_update.getLast().sadd.size();
+	logsa << " del: " << samplers_update.getLast().sremove.size();
+	logsa << " set: " << samplers_update.getLast().sset.size();
+	logsa << " samplers: " << samplers_num;
+	logsa << std::endl;
+*/
+	ProcessSamplerAdd();
+
+	ProcessSamplerUpdate();
+
+	ProcessSamplers(stream, len);
+
+	ProcessSamplerRemove();
+
+	SetSourceChanges();
+}
+
 void Sound::Update(bool pause)
 {
 	if (disable) return;
@@ -427,39 +538,44 @@ void Sound::ProcessSources()
 	supdate.resize(sources_num);
 
 	sources_active.clear();
+	size_t sources_playing = 0;
 	for (size_t i = 0; i < sources_num; ++i)
 	{
 		Source & src = sources[i];
 		if (!src.playing) continue;
 
+		++sources_playing;
 		float gain1 = 0.0, gain2 = 0.0;
-		if (src.gain > 0)
+		if (src.gain >= audible_gain)
 		{
 			if (src.is3d)
 			{
+				// distance attenuation, sources out of hearing range are virtual voices
 				Vec3 relvec = src.position - listener_pos;
-				float len = relvec.Magnitude();
-				if (len < 0.1f) len = 0.1f;
-
-				// distance attenuation
-				// v1: 1.5 at 1m, 0 at 200m distance
-				//float cgain = log(1000.0 / pow((double)len, 1.3)) / log(100.0);
-				// scaled v1 by 0.5: 0.75 at 1m, 0 at 200m distance
-				float cgain = 0.5f / log(100.f) * (log(1000.f) - 1.3f * log(len));
-				cgain = clamp(cgain, 0.0f, 1.0f);
-
-				// directional attenuation
+				float len2 = relvec.MagnitudeSquared();
+				float len = 0.1f, cgain = 0.0f;
+				if (len2 <= max_distance2)
+				{
+					len = sqrt(len2);
+					if (len < 0.1f) len = 0.1f;
+					cgain = GetDistanceGain(len);
+				}
+
+				// directional attenuation of audible sources
 				// maximum at 0.75 (source on opposite side)
-				relvec = relvec * (1.0f / len);
-				(-listener_rot).RotateVector(relvec);
-				float xcoord = relvec.dot(Direction::Right) * 0.75f;
-				float pgain1 = xcoord;			// left attenuation
-				float pgain2 = -xcoord;			// right attenuation
-				if (pgain1 < 0) pgain1 = 0;
-				if (pgain2 < 0) pgain2 = 0;
-
-				gain1 = cgain * src.gain * (1 - pgain1);
-				gain2 = cgain * src.gain * (1 - pgain2);
+				if (cgain * src.gain >= audible_gain)
+				{
+					relvec = relvec * (1.0f / len);
+					(-listener_rot).RotateVector(relvec);
+					float xcoord = relvec.dot(Direction::Right) * 0.75f;
+					float pgain1 = xcoord;			// left attenuation
+					float pgain2 = -xcoord;			// right attenuation
+					if (pgain1 < 0) pgain1 = 0;
+					if (pgain2 < 0) pgain2 = 0;
+
+					gain1 = cgain * src.gain * (1 - pgain1);
+					gain2 = cgain * src.gain * (1 - pgain2);
+				}
 			}
 			else
 			{
@@ -485,6 +601,9 @@ void Sound::ProcessSources()
 	}
 
 	LimitActiveSources();
+
+	voices_real = std::min(sources_active.size(), max_active_sources);
+	voices_virtual = sources_playing - voices_real;
 }
 
 void Sound::LimitActiveSources()
@@ -560,13 +679,12 @@ void Sound::ProcessSamplers(unsigned char *stream, int len)
 	if (samplers_pause && !samplers_fade)
 		return;
 
-	// init sampling buffers
+	// init accumulation buffers
 	int len4 = len / 4;
-	buffer1.resize(len4);
-	buffer2.resize(len4);
+	buffer1.assign(len4, 0);
+	buffer2.assign(len4, 0);
 
-	// run samplers
-	short * sstream = (short*)stream;
+	// accumulate samplers
 	for (size_t i = 0; i < samplers_num; ++i)
 	{
 		Sampler & smp = samplers[i];
@@ -576,29 +694,40 @@ void Sound::ProcessSamplers(unsigned char *stream, int len)
 
 		if (smp.gain1 | smp.gain2 | smp.last_gain1 | smp.last_gain2)
 		{
-			SampleAndAdvanceWithPitch16bit(smp, &buffer1[0], &buffer2[0], len4);
-
-			for (int n = 0; n < len4; ++n)
-			{
-				int pos = n * 2;
-				int val1 = sstream[pos] + buffer1[n];
-				int val2 = sstream[pos + 1] + buffer2[n];
-
-				val1 = clamp(val1, -32768, 32767);
-				val2 = clamp(val2, -32768, 32767);
-
-				sstream[pos] = val1;
-				sstream[pos + 1] = val2;
-			}
+			if (smp.stream)
+				SampleAndAdvanceStream16bit(smp, &buffer1[0], &buffer2[0], len4);
+			else
+				SampleAndAdvanceWithPitch16bit(smp, &buffer1[0], &buffer2[0], len4);
 		}
 		else
 		{
-			AdvanceWithPitch(smp, len);
+			AdvanceWithPitch(smp, len4);
 		}
 
 		if (!smp.playing)
 			sources_stop.getLast().push_back(smp.id);
 	}
+
+	// saturate into the interleaved stream
+	// samplers are summed at full range and the sum is clamped once, the mix
+	// differs from clamping after each sampler when a partial sum saturates
+	short * sstream = (short*)stream;
+	int n = 0;
+#ifdef SOUND_SSE
+	for (; n + 4 <= len4; n += 4)
+	{
+		__m128i val1 = _mm_loadu_si128((const __m128i *)&buffer1[n]);
+		__m128i val2 = _mm_loadu_si128((const __m128i *)&buffer2[n]);
+		__m128i lo = _mm_unpacklo_epi32(val1, val2);
+		__m128i hi = _mm_unpackhi_epi32(val1, val2);
+		_mm_storeu_si128((__m128i *)&sstream[n * 2], _mm_packs_epi32(lo, hi));
+	}
+#endif
+	for (; n < len4; ++n)
+	{
+		sstream[n * 2] = clamp(buffer1[n], -32768, 32767);
+		sstream[n * 2 + 1] = clamp(buffer2[n], -32768, 32767);
+	}
 }
 
 void Sound::ProcessSamplerRemove()
@@ -608,6 +737,9 @@ void Sound::ProcessSamplerRemove()
 	{
 		size_t id = sremove[i];
 		assert(id < samplers.size());
+		Sampler & smp = GetItem(id, samplers, samplers_num);
+		if (smp.stream)
+			smp.stream->Release();
 		RemoveItem(id, samplers, samplers_num);
 	}
 	sremove.clear();
@@ -620,6 +752,7 @@ void Sound::ProcessSamplerAdd()
 	{
 		Sampler smp;
 		smp.buffer = sadd[i].buffer;
+		smp.stream = sadd[i].stream;
 		smp.samples_per_channel = smp.buffer->GetInfo().samples / smp.buffer->GetInfo().channels;
 		smp.sample_pos = sadd[i].offset;
 		smp.sample_pos_remainder = 0;
@@ -631,6 +764,12 @@ void Sound::ProcessSamplerAdd()
 		smp.playing = true;
 		smp.loop = sadd[i].loop;
 
+		if (smp.buffer->GetStreamed())
+		{
+			// stream failed to open
+			smp.playing = (smp.stream != 0);
+		}
+
 		if (sadd[i].id == -1)
 		{
 			AddItem(smp, samplers, samplers_num);
@@ -639,6 +778,10 @@ void Sound::ProcessSamplerAdd()
 		{
 			smp.id = samplers[sadd[i].id].id;
 			samplers[sadd[i].id] = smp;
+
+			// restart stream at sample offset, new streams are opened at it
+			if (smp.stream)
+				smp.stream->Seek(smp.sample_pos % smp.samples_per_channel);
 		}
 	}
 	sadd.clear();
@@ -659,29 +802,140 @@ void Sound::Callback16bitStereo(void *myself, Uint8 *stream, int len)
 	assert(this == myself);
 	assert(initdone);
 
-	GetSamplerChanges();
-/*
-	logsa << "id: " << samplers_update.getLast().id;
-	logsa << " add: " << samplers_update.getLast().sadd.size();
-	logsa << " del: " << samplers_update.getLast().sremove.size();
-	logsa << " set: " << samplers_update.getLast().sset.size();
-	logsa << " samplers: " << samplers_num;
-	logsa << std::endl;
-*/
-	ProcessSamplerAdd();
+	Mix(stream, len);
+}
 
-	ProcessSamplerUpdate();
+void Sound::CallbackWrapper(void *sound, unsigned char *stream, int len)
+{
+	static_cast<Sound*>(sound)->Callback16bitStereo(sound, stream, len);
+}
 
-	ProcessSamplers(stream, len);
+static bool StreamReleased(const std::tr1::shared_ptr<SoundStream> & stream)
+{
+	return stream->Released();
+}
 
-	ProcessSamplerRemove();
+int Sound::DecodeStreams(void *sound)
+{
+	Sound & s = *static_cast<Sound*>(sound);
+	std::vector<std::tr1::shared_ptr<SoundStream> > active;
+	while (true)
+	{
+		SDL_LockMutex(s.stream_lock);
+		if (s.stream_quit)
+		{
+			SDL_UnlockMutex(s.stream_lock);
+			break;
+		}
 
-	SetSourceChanges();
+		// drop streams no longer used by the sound thread
+		s.streams.erase(
+			std::remove_if(s.streams.begin(), s.streams.end(), StreamReleased),
+			s.streams.end());
+		active = s.streams;
+		SDL_UnlockMutex(s.stream_lock);
+
+		// decode outside of the lock, AddSource doesn't have to wait
+		for (size_t i = 0; i < active.size(); ++i)
+		{
+			active[i]->Decode();
+		}
+		active.clear();
+
+		SDL_Delay(10);
+	}
+	return 0;
 }
 
-void Sound::CallbackWrapper(void *sound, unsigned char *stream, int len)
+// number of samples, up to len, played before the playback position reaches frame end
+static inline int GetSpanLength(int end, int ni, int nr, int pitch, int denom, int len)
 {
-	static_cast<Sound*>(sound)->Callback16bitStereo(sound, stream, len);
+	if (ni >= end)
+		return 0;
+	if (pitch <= 0)
+		return len;
+	long long count = ((long long)(end - ni) * denom - nr - 1) / pitch + 1;
+	return count < len ? (int)count : len;
+}
+
+// longest span whose playback positions fit into an int
+static inline int GetMaxSpanLength(int pitch)
+{
+	return pitch > 0 ? std::max(1, (1 << 30) / pitch) : (1 << 30);
+}
+
+void Sound::MixWithPitch16bit(
+	const short * buf, int chan, int & ni, int & nr, int pitch,
+	int gain1, int gain2, int * chan1, int * chan2, int len)
+{
+	const int denom = Sampler::denom;
+	const int chaninc = chan - 1;
+	int i = 0;
+
+#ifdef SOUND_SSE
+	// four samples at a time, interpolation and gain in float
+	const __m128 scale = _mm_set1_ps(1.0f / denom);
+	const __m128 g1 = _mm_set1_ps(gain1 * (1.0f / denom));
+	const __m128 g2 = _mm_set1_ps(gain2 * (1.0f / denom));
+	const __m128i mask = _mm_set1_epi32(denom - 1);
+	const __m128i step = _mm_set1_epi32(pitch * 4);
+	__m128i pos = _mm_setr_epi32(nr, nr + pitch, nr + pitch * 2, nr + pitch * 3);
+	const short * b = buf + ni * chan;
+	for (; i + 4 <= len; i += 4)
+	{
+		// frame offsets and fractions of the playback positions
+		int id[4];
+		_mm_storeu_si128((__m128i *)id, _mm_srli_epi32(pos, 15));
+		__m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(pos, mask)), scale);
+		pos = _mm_add_epi32(pos, step);
+
+		const short * p0 = b + id[0] * chan;
+		const short * p1 = b + id[1] * chan;
+		const short * p2 = b + id[2] * chan;
+		const short * p3 = b + id[3] * chan;
+		__m128 s10 = _mm_setr_ps(p0[0], p1[0], p2[0], p3[0]);
+		__m128 s11 = _mm_setr_ps(p0[chaninc], p1[chaninc], p2[chaninc], p3[chaninc]);
+		__m128 s20 = _mm_setr_ps(p0[chan], p1[chan], p2[chan], p3[chan]);
+		__m128 s21 = _mm_setr_ps(p0[chan + chaninc], p1[chan + chaninc], p2[chan + chaninc], p3[chan + chaninc]);
+
+		__m128 v1 = _mm_mul_ps(_mm_add_ps(s10, _mm_mul_ps(_mm_sub_ps(s20, s10), f)), g1);
+		__m128 v2 = _mm_mul_ps(_mm_add_ps(s11, _mm_mul_ps(_mm_sub_ps(s21, s11), f)), g2);
+
+		__m128i * c1 = (__m128i *)(chan1 + i);
+		__m128i * c2 = (__m128i *)(chan2 + i);
+		_mm_storeu_si128(c1, _mm_add_epi32(_mm_loadu_si128(c1), _mm_cvttps_epi32(v1)));
+		_mm_storeu_si128(c2, _mm_add_epi32(_mm_loadu_si128(c2), _mm_cvttps_epi32(v2)));
+	}
+
+	// advance playback position past the mixed samples
+	nr += i * pitch;
+	int ninc = nr / denom;
+	nr -= ninc * denom;
+	ni += ninc;
+#endif
+
+	for (; i < len; ++i)
+	{
+		// the sample to the left and to the right of the playback position, channel 0 and 1
+		int id1 = ni * chan;
+		int id2 = id1 + chan;
+		int samp10 = buf[id1];
+		int samp11 = buf[id1 + chaninc];
+		int samp20 = buf[id2];
+		int samp21 = buf[id2 + chaninc];
+
+		// interpolated sample at playback position
+		int val1 = (nr * samp20 + (denom - nr) * samp10) / denom;
+		int val2 = (nr * samp21 + (denom - nr) * samp11) / denom;
+		chan1[i] += (val1 * gain1) / denom;
+		chan2[i] += (val2 * gain2) / denom;
+
+		// advance playback position
+		nr += pitch;
+		int ninc = nr / denom;
+		nr -= ninc * denom;
+		ni += ninc;
+	}
 }
 
 void Sound::SampleAndAdvanceWithPitch16bit(
@@ -690,15 +944,11 @@ void Sound::SampleAndAdvanceWithPitch16bit(
 	assert(len > 0);
 	assert(sampler.buffer);
 
-	// if not playing, fill output buffers with silence
+	// if not playing, leave output buffers untouched
 	if (!sampler.playing)
 	{
 		// should be dealt with before getting here
 		assert(0);
-		for (int i = 0; i < len; ++i)
-		{
-			chan1[i] = chan2[i] = 0;
-		}
 		return;
 	}
 
@@ -708,10 +958,40 @@ void Sound::SampleAndAdvanceWithPitch16bit(
 	int chaninc = chan - 1;
 	int nr = sampler.sample_pos_remainder;
 	int ni = sampler.sample_pos;
+	int max_span = GetMaxSpanLength(sampler.pitch);
 	const int16_t * buf = (const int16_t *)sampler.buffer->GetRawBuffer();
 
-	for (int i = 0; i < len; ++i)
+	int i = 0;
+	while (i < len)
 	{
+		if (ni >= sampler.samples_per_channel)
+		{
+			// finish playing the buffer if looping is not enabled
+			if (!sampler.loop)
+			{
+				sampler.playing = false;
+				break;
+			}
+			ni = ni % sampler.samples_per_channel;
+		}
+
+		// mix spans of constant gain that don't wrap around in one go
+		if (sampler.gain1 == sampler.last_gain1 && sampler.gain2 == sampler.last_gain2)
+		{
+			int span = GetSpanLength(
+				sampler.samples_per_channel - 1, ni, nr, sampler.pitch,
+				sampler.denom, std::min(len - i, max_span));
+			if (span > 0)
+			{
+				MixWithPitch16bit(
+					buf, chan, ni, nr, sampler.pitch,
+					sampler.last_gain1, sampler.last_gain2,
+					chan1 + i, chan2 + i, span);
+				i += span;
+				continue;
+			}
+		}
+
 		// limit gain change rate
 		int gain_delta1 = sampler.gain1 - sampler.last_gain1;
 		int gain_delta2 = sampler.gain2 - sampler.last_gain2;
@@ -720,43 +1000,123 @@ void Sound::SampleAndAdvanceWithPitch16bit(
 		sampler.last_gain1 += gain_delta1;
 		sampler.last_gain2 += gain_delta2;
 
-		if (ni >= sampler.samples_per_channel && !sampler.loop)
+		// the sample to the left of the playback position, channel 0 and 1
+		int id1 = ni * chan;
+		int samp10 = buf[id1];
+		int samp11 = buf[id1 + chaninc];
+
+		// the sample to the right of the playback position, channel 0 and 1
+		int id2 = (id1 + chan) % samples;
+		int samp20 = buf[id2];
+		int samp21 = buf[id2 + chaninc];
+
+		// interpolated sample at playback position
+		int val1 = (nr * samp20 + (sampler.denom - nr) * samp10) / sampler.denom;
+		int val2 = (nr * samp21 + (sampler.denom - nr) * samp11) / sampler.denom;
+		val1 = (val1 * sampler.last_gain1) / sampler.denom;
+		val2 = (val2 * sampler.last_gain2) / sampler.denom;
+
+		// accumulate output
+		chan1[i] += val1;
+		chan2[i] += val2;
+
+		// advance playback position
+		nr += sampler.pitch;
+		int ninc = nr / sampler.denom;
+		nr -= ninc * sampler.denom;
+		ni += ninc;
+		++i;
+	}
+
+	sampler.sample_pos = ni;
+	sampler.sample_pos_remainder = nr;
+	if (!sampler.loop)
+	{
+		sampler.playing = (sampler.sample_pos < sampler.samples_per_channel);
+	}
+	else
+	{
+		sampler.sample_pos = sampler.sample_pos % sampler.samples_per_channel;
+	}
+}
+
+void Sound::SampleAndAdvanceStream16bit(
+	Sampler & sampler, int * chan1, int * chan2, int len)
+{
+	assert(len > 0);
+	assert(sampler.stream);
+
+	// get the frames covered by this block, plus one to interpolate the last sample
+	int nr = sampler.sample_pos_remainder;
+	int ni = 0;
+	int frames = (nr + (len - 1) * sampler.pitch) / sampler.denom + 2;
+	int frames_left = sampler.loop ? frames : sampler.samples_per_channel - sampler.sample_pos;
+	int max_span = GetMaxSpanLength(sampler.pitch);
+	int chan = sampler.buffer->GetInfo().channels;
+	int chaninc = chan - 1;
+	const int16_t * buf = sampler.stream->GetFrames(frames);
+
+	int i = 0;
+	while (i < len)
+	{
+		if (ni >= frames_left)
 		{
-			// finish playing the buffer if looping is not enabled
-			chan1[i] = chan2[i] = 0;
+			// finish playing the stream if looping is not enabled
 			sampler.playing = false;
+			break;
 		}
-		else
+
+		// mix spans of constant gain in one go
+		if (sampler.gain1 == sampler.last_gain1 && sampler.gain2 == sampler.last_gain2)
 		{
-			// the sample to the left of the playback position, channel 0 and 1
-			int id1 = (ni * chan) % samples;
-			int samp10 = buf[id1];
-			int samp11 = buf[id1 + chaninc];
-
-			// the sample to the right of the playback position, channel 0 and 1
-			int id2 = (id1 + chan) % samples;
-			int samp20 = buf[id2];
-			int samp21 = buf[id2 + chaninc];
-
-			// interpolated sample at playback position
-			int val1 = (nr * samp20 + (sampler.denom - nr) * samp10) / sampler.denom;
-			int val2 = (nr * samp21 + (sampler.denom - nr) * samp11) / sampler.denom;
-			val1 = (val1 * sampler.last_gain1) / sampler.denom;
-			val2 = (val2 * sampler.last_gain2) / sampler.denom;
-
-			// fill output buffers
-			chan1[i] = val1;
-			chan2[i] = val2;
-
-			// advance playback position
-			nr += sampler.pitch;
-			int ninc = nr / sampler.denom;
-			nr -= ninc * sampler.denom;
-			ni += ninc;
+			int span = GetSpanLength(
+				frames_left, ni, nr, sampler.pitch,
+				sampler.denom, std::min(len - i, max_span));
+			MixWithPitch16bit(
+				buf, chan, ni, nr, sampler.pitch,
+				sampler.last_gain1, sampler.last_gain2,
+				chan1 + i, chan2 + i, span);
+			i += span;
+			continue;
 		}
+
+		// limit gain change rate
+		int gain_delta1 = sampler.gain1 - sampler.last_gain1;
+		int gain_delta2 = sampler.gain2 - sampler.last_gain2;
+		gain_delta1 = clamp(gain_delta1, -sampler.max_gain_delta, sampler.max_gain_delta);
+		gain_delta2 = clamp(gain_delta2, -sampler.max_gain_delta, sampler.max_gain_delta);
+		sampler.last_gain1 += gain_delta1;
+		sampler.last_gain2 += gain_delta2;
+
+		// the samples to the left and right of the playback position, the window starts at the sample position
+		int id1 = ni * chan;
+		int samp10 = buf[id1];
+		int samp11 = buf[id1 + chaninc];
+
+		int id2 = id1 + chan;
+		int samp20 = buf[id2];
+		int samp21 = buf[id2 + chaninc];
+
+		// interpolated sample at playback position
+		int val1 = (nr * samp20 + (sampler.denom - nr) * samp10) / sampler.denom;
+		int val2 = (nr * samp21 + (sampler.denom - nr) * samp11) / sampler.denom;
+		val1 = (val1 * sampler.last_gain1) / sampler.denom;
+		val2 = (val2 * sampler.last_gain2) / sampler.denom;
+
+		// accumulate output
+		chan1[i] += val1;
+		chan2[i] += val2;
+
+		// advance playback position
+		nr += sampler.pitch;
+		int ninc = nr / sampler.denom;
+		nr -= ninc * sampler.denom;
+		ni += ninc;
+		++i;
 	}
 
-	sampler.sample_pos = ni;
+	sampler.stream->Advance(ni);
+	sampler.sample_pos += ni;
 	sampler.sample_pos_remainder = nr;
 	if (!sampler.loop)
 	{
@@ -776,6 +1136,10 @@ void Sound::AdvanceWithPitch(Sampler & sampler, int len)
 	sampler.sample_pos_remainder -= delta * sampler.denom;
 	sampler.sample_pos += delta;
 
+	// keep stream in sync
+	if (sampler.stream)
+		sampler.stream->Advance(delta);
+
 	// loop buffer
 	if (!sampler.loop)
 	{
@@ -786,3 +1150,191 @@ void Sound::AdvanceWithPitch(Sampler & sampler, int len)
 		sampler.sample_pos = sampler.sample_pos % sampler.samples_per_channel;
 	}
 }
+
+// per sample integer reference of the sampler mixing
+struct MixTestVoice
+{
+	const short * buf;
+	int chan;
+	int samples_per_channel;
+	int sample_pos;
+	int sample_pos_remainder;
+	int pitch;
+	int gain;
+	int last_gain1;
+	int last_gain2;
+	bool playing;
+	bool loop;
+};
+
+static void MixTestReference(std::vector<MixTestVoice> & voices, short * stream, int len4)
+{
+	const int denom = 32768;
+	const int max_gain_delta = (denom * 173) / 44100;
+	std::vector<int> chan1(len4, 0), chan2(len4, 0);
+	for (size_t v = 0; v < voices.size(); ++v)
+	{
+		MixTestVoice & voice = voices[v];
+		if (!voice.playing)
+			continue;
+
+		int chaninc = voice.chan - 1;
+		int samples = voice.samples_per_channel * voice.chan;
+		int ni = voice.sample_pos;
+		int nr = voice.sample_pos_remainder;
+		for (int i = 0; i < len4; ++i)
+		{
+			if (ni >= voice.samples_per_channel)
+			{
+				if (!voice.loop)
+					break;
+				ni = ni % voice.samples_per_channel;
+			}
+
+			voice.last_gain1 += clamp(voice.gain - voice.last_gain1, -max_gain_delta, max_gain_delta);
+			voice.last_gain2 += clamp(voice.gain - voice.last_gain2, -max_gain_delta, max_gain_delta);
+
+			int id1 = ni * voice.chan;
+			int id2 = (id1 + voice.chan) % samples;
+			int val1 = (nr * voice.buf[id2] + (denom - nr) * voice.buf[id1]) / denom;
+			int val2 = (nr * voice.buf[id2 + chaninc] + (denom - nr) * voice.buf[id1 + chaninc]) / denom;
+			chan1[i] += (val1 * voice.last_gain1) / denom;
+			chan2[i] += (val2 * voice.last_gain2) / denom;
+
+			nr += voice.pitch;
+			int ninc = nr / denom;
+			nr -= ninc * denom;
+			ni += ninc;
+		}
+
+		voice.sample_pos = ni;
+		voice.sample_pos_remainder = nr;
+		if (!voice.loop)
+			voice.playing = (voice.sample_pos < voice.samples_per_channel);
+		else
+			voice.sample_pos = voice.sample_pos % voice.samples_per_channel;
+	}
+
+	for (int i = 0; i < len4; ++i)
+	{
+		stream[i * 2] = clamp(chan1[i], -32768, 32767);
+		stream[i * 2 + 1] = clamp(chan2[i], -32768, 32767);
+	}
+}
+
+QT_TEST(sound_mix_test)
+{
+	// a stereo and a mono buffer, loud enough to saturate the mix
+	const int frames1 = 1500, frames2 = 1001;
+	std::vector<short> pcm1(frames1 * 2), pcm2(frames2);
+	for (int i = 0; i < frames1; ++i)
+	{
+		pcm1[i * 2] = 20000 * std::sin(i * 0.05);
+		pcm1[i * 2 + 1] = 20000 * std::sin(i * 0.13);
+	}
+	for (int i = 0; i < frames2; ++i)
+	{
+		pcm2[i] = 25000 * std::sin(i * 0.031) + 5000 * std::sin(i * 0.7);
+	}
+	std::tr1::shared_ptr<SoundBuffer> buffer1(new SoundBuffer());
+	std::tr1::shared_ptr<SoundBuffer> buffer2(new SoundBuffer());
+	buffer1->Load("stereo", SoundInfo(frames1 * 2, 44100, 2, 2), &pcm1[0]);
+	buffer2->Load("mono", SoundInfo(frames2, 44100, 1, 2), &pcm2[0]);
+
+	Sound sound;
+	sound.SetVolume(1.0);
+
+	// looping sources and a one shot source which runs out
+	const int voices_num = 4;
+	const std::tr1::shared_ptr<SoundBuffer> * buffers[voices_num] = {&buffer1, &buffer2, &buffer1, &buffer2};
+	const bool loops[voices_num] = {true, true, true, false};
+	const float offsets[voices_num] = {0.0f, 0.5f, 100.25f, 0.0f};
+	std::vector<size_t> sources(voices_num);
+	std::vector<MixTestVoice> voices(voices_num);
+	for (int v = 0; v < voices_num; ++v)
+	{
+		const SoundBuffer & buffer = **buffers[v];
+		sources[v] = sound.AddSource(*buffers[v], offsets[v], false, loops[v]);
+		MixTestVoice & voice = voices[v];
+		voice.buf = (const short *)buffer.GetRawBuffer();
+		voice.chan = buffer.GetInfo().channels;
+		voice.samples_per_channel = buffer.GetInfo().samples / voice.chan;
+		voice.sample_pos = int(offsets[v] * 32768);
+		voice.sample_pos_remainder = 0;
+		voice.pitch = 32768;
+		voice.gain = 0;
+		voice.last_gain1 = 0;
+		voice.last_gain2 = 0;
+		voice.playing = true;
+		voice.loop = loops[v];
+	}
+
+	// gain ramps and pitch changes between callbacks, some callbacks at constant gain
+	const int len4 = 1024 + 3;
+	std::vector<short> output(len4 * 2), reference(len4 * 2);
+	int max_diff = 0;
+	int clipped = 0;
+	for (int step = 0; step < 12; ++step)
+	{
+		for (int v = 0; v < voices_num; ++v)
+		{
+			float gain = (step % 3 == 2) ? 0.0f : 0.3f + 0.1f * ((v + step) % 5);
+			float pitch = 0.45f + 0.37f * ((v * 3 + step / 2) % 4);
+			sound.SetSourceGain(sources[v], gain);
+			sound.SetSourcePitch(sources[v], pitch);
+			voices[v].gain = 1.0f * gain * 32768;
+			voices[v].pitch = pitch * 32768;
+		}
+		sound.Update(false);
+		sound.Mix((unsigned char *)&output[0], len4 * 4);
+		MixTestReference(voices, &reference[0], len4);
+
+		for (int i = 0; i < len4 * 2; ++i)
+		{
+			int diff = std::abs(output[i] - reference[i]);
+			max_diff = std::max(max_diff, diff);
+			clipped += (std::abs(reference[i]) >= 32767);
+		}
+	}
+
+	// the one shot source has stopped playing
+	sound.Update(false);
+
+	// the float resampler may round each source one step away from the integer reference
+	QT_CHECK_LESS_OR_EQUAL(max_diff, 2 * voices_num);
+	QT_CHECK_GREATER(clipped, 0);
+	QT_CHECK(!voices[3].playing);
+	QT_CHECK(!sound.GetSourcePlaying(sources[3]));
+	QT_CHECK(sound.GetSourcePlaying(sources[0]));
+
+	// two loud voices saturate the partial sum, a third one brings it back in range
+	// clamping after each voice would give 32767 - 25000 instead of 25000
+	const int frames3 = 256;
+	std::vector<short> pcm3(frames3, 25000), pcm4(frames3, -25000);
+	std::tr1::shared_ptr<SoundBuffer> buffer3(new SoundBuffer());
+	std::tr1::shared_ptr<SoundBuffer> buffer4(new SoundBuffer());
+	buffer3->Load("loud", SoundInfo(frames3, 44100, 1, 2), &pcm3[0]);
+	buffer4->Load("inverted", SoundInfo(frames3, 44100, 1, 2), &pcm4[0]);
+
+	Sound saturated;
+	saturated.SetVolume(1.0);
+	const std::tr1::shared_ptr<SoundBuffer> * loud_buffers[3] = {&buffer3, &buffer3, &buffer4};
+	for (int v = 0; v < 3; ++v)
+	{
+		size_t id = saturated.AddSource(*loud_buffers[v], 0.0f, false, true);
+		saturated.SetSourceGain(id, 1.0f);
+	}
+	saturated.Update(false);
+
+	// first callback ramps the gains up, the second one mixes at full gain
+	saturated.Mix((unsigned char *)&output[0], len4 * 4);
+	saturated.Mix((unsigned char *)&output[0], len4 * 4);
+	int min_sample = 32767, max_sample = -32768;
+	for (int i = 0; i < len4 * 2; ++i)
+	{
+		min_sample = std::min(min_sample, int(output[i]));
+		max_sample = std::max(max_sample, int(output[i]));
+	}
+	QT_CHECK_GREATER_OR_EQUAL(min_sample, 25000 - 3);
+	QT_CHECK_LESS_OR_EQUAL(max_sample, 25000 + 3);
+}
@@ -22,6 +22,7 @@
 
 #include "soundbuffer.h"
 #include "soundfilter.h"
+#include "soundstream.h"
 #include "tripplebuffer.h"
 #include "mathvector.h"
 #include "quaternion.h"
@@ -31,6 +32,7 @@
 #include <vector>
 
 struct SDL_mutex;
+struct SDL_Thread;
 
 class Sound
 {
@@ -54,6 +56,14 @@ public:
 	// active sources limit can be adjusted at runtime
 	void SetMaxActiveSources(size_t value);
 
+	// whether a 3d source at the given position would be heard at the given gain
+	bool GetAudible(float x, float y, float z, float gain) const;
+
+	// playing sources mixed and tracked without mixing (virtual) in the last update
+	size_t GetRealVoices() const;
+
+	size_t GetVirtualVoices() const;
+
 	size_t AddSource(std::tr1::shared_ptr<SoundBuffer> buffer, float offset, bool is3d, bool loop);
 
 	void RemoveSource(size_t id);
@@ -81,6 +91,10 @@ public:
 	// commit state changes
 	void Update(bool pause);
 
+	// run the sound thread mixer, called by the sound device callback
+	// without an initialized sound device it can be run on the calling thread
+	void Mix(unsigned char * stream, int len);
+
 private:
 	std::ostream * log_error;
 	SoundInfo deviceinfo;
@@ -102,6 +116,7 @@ private:
 	struct Source
 	{
 		std::tr1::shared_ptr<SoundBuffer> buffer;
+		std::tr1::shared_ptr<SoundStream> stream;
 		Vec3 position;
 		Vec3 velocity;
 		float offset;
@@ -118,6 +133,7 @@ private:
 		static const int denom = 32768;
 		static const int max_gain_delta = (denom * 173) / 44100; // 256 samples from min to max gain
 		const SoundBuffer * buffer;
+		SoundStream * stream;
 		int samples_per_channel;
 		int sample_pos;
 		int sample_pos_remainder;
@@ -135,6 +151,7 @@ private:
 	struct SamplerAdd
 	{
 		const SoundBuffer * buffer;
+		SoundStream * stream;
 		int offset;
 		bool loop;
 		int id;
@@ -160,11 +177,19 @@ private:
 	SDL_mutex * sampler_lock;
 	SDL_mutex * source_lock;
 
+	// stream decoder thread
+	std::vector<std::tr1::shared_ptr<SoundStream> > streams;
+	SDL_mutex * stream_lock;
+	SDL_Thread * stream_thread;
+	bool stream_quit;
+
 	// sound sources state
 	std::vector<SourceActive> sources_active;
 	std::vector<size_t> sources_remove;
 	std::vector<Source> sources;
 	size_t max_active_sources;
+	size_t voices_real;
+	size_t voices_virtual;
 	size_t sources_num;
 	size_t update_id;
 	bool sources_pause;
@@ -206,9 +231,20 @@ private:
 
 	static void CallbackWrapper(void *sound, unsigned char *stream, int len);
 
+	// stream thread methods
+	static int DecodeStreams(void *sound);
+
+	// add len samples at constant gain to the channel buffers, the interpolated frames have to be within buf
+	static void MixWithPitch16bit(
+		const short * buf, int chan, int & ni, int & nr, int pitch,
+		int gain1, int gain2, int * chan1, int * chan2, int len);
+
 	static void SampleAndAdvanceWithPitch16bit(
 		Sampler & sampler, int * chan1, int * chan2, int len);
 
+	static void SampleAndAdvanceStream16bit(
+		Sampler & sampler, int * chan1, int * chan2, int len);
+
 	static void AdvanceWithPitch(Sampler & sampler, int len);
 };
 
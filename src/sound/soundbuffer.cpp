@@ -18,6 +18,7 @@
 /************************************************************************/
 
 #include "soundbuffer.h"
+#include "soundstream.h"
 #include "endian_utility.h"
 
 #ifdef __APPLE__
@@ -35,6 +36,7 @@ SoundBuffer::SoundBuffer() :
 	info(0, 0, 0, 0),
 	size(0),
 	loaded(false),
+	streamed(false),
 	sound_buffer(0)
 {
 	// ctor
@@ -58,11 +60,26 @@ bool SoundBuffer::Load(const std::string & filename, const SoundInfo & sound_dev
 	}
 }
 
+void SoundBuffer::Load(const std::string & name, const SoundInfo & info, const short * samples)
+{
+	if (loaded)
+		Unload();
+
+	this->name = name;
+	this->info = info;
+	size = info.samples * sizeof(short);
+	sound_buffer = new char[size];
+	memcpy(sound_buffer, samples, size);
+	loaded = true;
+}
+
 void SoundBuffer::Unload()
 {
 	if (loaded && sound_buffer)
 		delete [] sound_buffer;
 	sound_buffer = 0;
+	size = 0;
+	streamed = false;
 }
 
 bool SoundBuffer::LoadWAV(const std::string & filename, const SoundInfo & sound_device_info, std::ostream & error_output)
@@ -143,6 +160,7 @@ bool SoundBuffer::LoadWAV(const std::string & filename, const SoundInfo & sound_
 					}
 
 					sound_buffer = new char[size];
+					this->size = size;
 
 					if (fread(sound_buffer, sizeof(char), size, fp) != size) return false; //read in our whole sound data chunk
 
@@ -267,9 +285,19 @@ bool SoundBuffer::LoadOGG(const std::string & filename, const SoundInfo & sound_
 			return false;
 		}
 
-		//allocate space
+		//decode on demand
 		unsigned int size = info.samples*info.channels*info.bytespersample;
+		if (size > SoundStream::min_stream_size)
+		{
+			streamed = true;
+			loaded = true;
+			ov_clear(&oggFile);
+			return true;
+		}
+
+		//allocate space
 		sound_buffer = new char[size];
+		this->size = size;
 		int bitstream;
 		int endian = 0; //0 for Little-Endian, 1 for Big-Endian
 		int wordsize = 2; //again, assuming ogg is always 16-bits
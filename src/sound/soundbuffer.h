@@ -34,6 +34,9 @@ public:
 
 	bool Load(const std::string & filename, const SoundInfo & sound_device_info, std::ostream & error_output);
 
+	/// copy 16 bit pcm data, info samples count all channels
+	void Load(const std::string & name, const SoundInfo & info, const short * samples);
+
 	void Unload();
 
 	const SoundInfo & GetInfo() const
@@ -46,6 +49,12 @@ public:
 		return ((short *)sound_buffer)[position * info.channels + (channel - 1) * (info.channels - 1)];
 	}
 
+	/// size of the pcm data in bytes
+	unsigned int GetMemorySize() const
+	{
+		return size;
+	}
+
 	const char * GetRawBuffer() const
 	{
 		return sound_buffer;
@@ -61,10 +70,17 @@ public:
 		return loaded;
 	}
 
+	/// long sounds are not decoded on load, they are played through a SoundStream
+	bool GetStreamed() const
+	{
+		return streamed;
+	}
+
 private:
 	SoundInfo info;
 	unsigned int size;
 	bool loaded;
+	bool streamed;
 	char * sound_buffer;
 	std::string name;
 
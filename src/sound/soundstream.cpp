@@ -0,0 +1,253 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#include "soundstream.h"
+#include "soundbuffer.h"
+
+#ifdef __APPLE__
+#define __MACOSX__
+#include <Vorbis/vorbisfile.h>
+#else
+#include <vorbis/vorbisfile.h>
+#endif
+
+#include <SDL/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cassert>
+
+SoundStream::SoundStream(const SoundBuffer & buffer, bool loop) :
+	filename(buffer.GetName()),
+	file(0),
+	mutex(SDL_CreateMutex()),
+	channels(buffer.GetInfo().channels),
+	loop(loop),
+	ring(ring_frames * buffer.GetInfo().channels),
+	ring_read(0),
+	ring_count(0),
+	seek_frame(-1),
+	end(false),
+	released(false),
+	block(block_frames * buffer.GetInfo().channels),
+	window_frames(0),
+	skip_frames(0)
+{
+	window.reserve(block_frames * channels);
+}
+
+SoundStream::~SoundStream()
+{
+	if (file)
+	{
+		ov_clear(file);
+		delete file;
+	}
+	SDL_DestroyMutex(mutex);
+}
+
+bool SoundStream::Open(int frame, std::ostream & error_output)
+{
+	assert(!file);
+
+	FILE * fp = fopen(filename.c_str(), "rb");
+	if (!fp)
+	{
+		error_output << "Can't open sound file: " << filename << std::endl;
+		return false;
+	}
+
+	file = new OggVorbis_File();
+	if (ov_open_callbacks(fp, file, NULL, 0, OV_CALLBACKS_DEFAULT) < 0)
+	{
+		fclose(fp);
+		delete file;
+		file = 0;
+		error_output << "Can't decode sound file: " << filename << std::endl;
+		return false;
+	}
+
+	if (frame > 0)
+	{
+		ov_pcm_seek(file, frame);
+	}
+	Decode();
+
+	return true;
+}
+
+void SoundStream::Decode()
+{
+	if (!file)
+		return;
+
+	while (true)
+	{
+		SDL_LockMutex(mutex);
+		int seek = seek_frame;
+		int space = ring_frames - ring_count;
+		bool done = end || released;
+		seek_frame = -1;
+		if (seek >= 0)
+		{
+			end = false;
+		}
+		SDL_UnlockMutex(mutex);
+
+		if (seek >= 0)
+		{
+			ov_pcm_seek(file, seek);
+		}
+		else if (done || space < block_frames)
+		{
+			return;
+		}
+
+		int count = DecodeBlock(block_frames);
+
+		SDL_LockMutex(mutex);
+		if (seek_frame < 0)
+		{
+			// drop the block if a seek came in while decoding
+			int write = (ring_read + ring_count) % ring_frames;
+			int count1 = std::min(count, ring_frames - write);
+			const short * data = &block[0];
+			std::copy(data, data + count1 * channels, &ring[write * channels]);
+			std::copy(data + count1 * channels, data + count * channels, &ring[0]);
+			ring_count += count;
+			end = (count < block_frames);
+		}
+		SDL_UnlockMutex(mutex);
+	}
+}
+
+int SoundStream::DecodeBlock(int count)
+{
+	int endian = 0; //0 for Little-Endian, 1 for Big-Endian
+	int wordsize = 2; //assuming ogg is always 16-bits
+	int issigned = 1; //use signed data
+	int bitstream;
+
+	char * buffer = (char *)&block[0];
+	int size = count * channels * wordsize;
+	int pos = 0;
+	bool restarted = false;
+	while (pos < size)
+	{
+		long bytes = ov_read(file, buffer + pos, size - pos, endian, wordsize, issigned, &bitstream);
+		if (bytes > 0)
+		{
+			pos += bytes;
+			restarted = false;
+		}
+		else if (bytes == OV_HOLE)
+		{
+			continue;
+		}
+		else if (bytes == 0 && loop && !restarted && ov_pcm_seek(file, 0) == 0)
+		{
+			// wrap around, guard against empty files
+			restarted = true;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return pos / (channels * wordsize);
+}
+
+int SoundStream::Read(short * frames, int count)
+{
+	SDL_LockMutex(mutex);
+	count = std::min(count, ring_count);
+	int count1 = std::min(count, ring_frames - ring_read);
+	if (frames)
+	{
+		const short * data = &ring[0];
+		std::copy(data + ring_read * channels, data + (ring_read + count1) * channels, frames);
+		std::copy(data, data + (count - count1) * channels, frames + count1 * channels);
+	}
+	ring_read = (ring_read + count) % ring_frames;
+	ring_count -= count;
+	SDL_UnlockMutex(mutex);
+	return count;
+}
+
+const short * SoundStream::GetFrames(int count)
+{
+	// drop frames which have been played as silence
+	if (skip_frames > 0)
+	{
+		skip_frames -= Read(0, skip_frames);
+	}
+
+	if (window_frames < count && skip_frames == 0)
+	{
+		window.resize(count * channels);
+		window_frames += Read(&window[window_frames * channels], count - window_frames);
+	}
+
+	// silence where the decoder has fallen behind, padding is not kept as stream data
+	window.resize(window_frames * channels);
+	window.resize(count * channels, 0);
+	return &window[0];
+}
+
+void SoundStream::Advance(int count)
+{
+	int erase = std::min(count, window_frames);
+	window.erase(window.begin(), window.begin() + erase * channels);
+	window_frames -= erase;
+	window.resize(window_frames * channels);
+
+	// frames past the window are skipped, now or once they are decoded
+	skip_frames += count - erase;
+	if (skip_frames > 0)
+	{
+		skip_frames -= Read(0, skip_frames);
+	}
+}
+
+void SoundStream::Seek(int frame)
+{
+	window.clear();
+	window_frames = 0;
+	skip_frames = 0;
+
+	SDL_LockMutex(mutex);
+	seek_frame = frame;
+	ring_count = 0;
+	end = false;
+	SDL_UnlockMutex(mutex);
+}
+
+void SoundStream::Release()
+{
+	SDL_LockMutex(mutex);
+	released = true;
+	SDL_UnlockMutex(mutex);
+}
+
+bool SoundStream::Released() const
+{
+	SDL_LockMutex(mutex);
+	bool value = released;
+	SDL_UnlockMutex(mutex);
+	return value;
+}
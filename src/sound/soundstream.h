@@ -0,0 +1,101 @@
+/************************************************************************/
+/*                                                                      */
+/* This file is part of VDrift.                                         */
+/*                                                                      */
+/* VDrift is free software: you can redistribute it and/or modify       */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* VDrift is distributed in the hope that it will be useful,            */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of       */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        */
+/* GNU General Public License for more details.                         */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with VDrift.  If not, see <http://www.gnu.org/licenses/>.      */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef _SOUNDSTREAM_H
+#define _SOUNDSTREAM_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class SoundBuffer;
+struct SDL_mutex;
+struct OggVorbis_File;
+
+/// Plays an ogg sound buffer without decoding it up front. Decoded frames are
+/// queued in a ring buffer, a stream is read by a single sampler.
+/// Decode is called by the decoder thread, GetFrames, Advance and Seek by the sound thread.
+class SoundStream
+{
+public:
+	/// ogg files with more pcm data than this (in bytes) are streamed instead of decoded on load
+	static const unsigned int min_stream_size = 1 << 20;
+
+	SoundStream(const SoundBuffer & buffer, bool loop);
+
+	~SoundStream();
+
+	/// open the sound file and decode the first frames starting at frame
+	bool Open(int frame, std::ostream & error_output);
+
+	/// fill the ring buffer
+	void Decode();
+
+	/// get count frames starting at the playback position
+	/// frames the decoder hasn't delivered yet are silent, they are skipped once decoded
+	const short * GetFrames(int count);
+
+	/// advance playback position by count frames
+	void Advance(int count);
+
+	/// restart playback at frame
+	void Seek(int frame);
+
+	/// the sampler is done with the stream
+	void Release();
+
+	bool Released() const;
+
+private:
+	static const int ring_frames = 32768;
+	static const int block_frames = 2048;
+
+	std::string filename;
+	OggVorbis_File * file;
+	SDL_mutex * mutex;
+	int channels;
+	bool loop;
+
+	// shared state, guarded by mutex
+	std::vector<short> ring;
+	int ring_read;
+	int ring_count;
+	int seek_frame;
+	bool end;
+	bool released;
+
+	// decoder thread state
+	std::vector<short> block;
+
+	// sound thread state
+	std::vector<short> window;
+	int window_frames; // decoded frames in window, the rest is padding
+	int skip_frames; // frames played as silence before they were decoded
+
+	/// decode up to count frames into block, returns frames decoded
+	int DecodeBlock(int count);
+
+	/// pop up to count frames from the ring buffer, returns frames read
+	int Read(short * frames, int count);
+
+	SoundStream(const SoundStream & other);
+	SoundStream & operator=(const SoundStream & other);
+};
+
+#endif // _SOUNDSTREAM_H
@@ -18,6 +18,8 @@
 /************************************************************************/
 
 #include "timer.h"
+#include "car.h"
+#include "track.h"
 #include "unittest.h"
 
 #include <string>
@@ -116,6 +118,74 @@ void Timer::UpdateDistance(const unsigned int carid, const double newdistance)
 	car[carid].UpdateLapDistance(newdistance);
 }
 
+void Timer::UpdateCar(const unsigned int carid, Car & vehicle, const Track & track)
+{
+	assert(carid < car.size());
+
+	bool advance = false;
+	int nextsector = 0;
+	if (track.GetSectors() > 0)
+	{
+		nextsector = (vehicle.GetSector() + 1) % track.GetSectors();
+		//cout << "next " << nextsector << ", cur " << vehicle.GetSector() << ", track " << track.GetSectors() << std::endl;
+		for (int p = 0; p < 4; ++p)
+		{
+			if (vehicle.GetCurPatch(WheelPosition(p)) == track.GetSectorPatch(nextsector))
+			{
+				advance = true;
+				//info_output << "New sector " << nextsector << "/" << track.GetSectors();
+				//info_output << " patch " << vehicle.GetCurPatch(WHEEL_POSITION(p)) << std::endl;
+				//info_output <<  ", " << track.GetSectorPatch(nextsector) << std::endl;
+			}
+			//else cout << p << ". " << vehicle.GetCurPatch(p) << ", " << track.GetSectorPatch(nextsector) << std::endl;
+		}
+	}
+
+	if (advance)
+	{
+		// Only count it if the car's current sector isn't -1 which is the default value when the car is loaded...
+		Lap(carid, nextsector, (vehicle.GetSector() >= 0));
+		vehicle.SetSector(nextsector);
+	}
+
+	// Update how far the car is on the track...
+	// Find the patch under the front left wheel...
+	const Bezier * curpatch = vehicle.GetCurPatch(FRONT_LEFT);
+	if (!curpatch)
+		// Try the other wheel...
+		curpatch = vehicle.GetCurPatch(FRONT_RIGHT);
+
+	// Only update if car is on track.
+	if (curpatch)
+	{
+		Vec3 pos = vehicle.GetCenterOfMassPosition();
+		Vec3 back_left, back_right, front_left;
+		if (!track.IsReversed())
+		{
+			back_left = curpatch->GetBL();
+			back_right = curpatch->GetBR();
+			front_left = curpatch->GetFL();
+		}
+		else
+		{
+			back_left = curpatch->GetFL();
+			back_right = curpatch->GetFR();
+			front_left = curpatch->GetBL();
+		}
+
+		Vec3 forwardvec = front_left - back_left;
+		Vec3 relative_pos = pos - back_left;
+		float dist_from_back = 0;
+
+		if (forwardvec.Magnitude() > 0.0001)
+			dist_from_back = relative_pos.dot(forwardvec.Normalize());
+
+		UpdateDistance(carid, curpatch->GetDistFromStart() + dist_from_back);
+		//std::cout << curpatch->GetDistFromStart() << ", " << dist_from_back << std::endl;
+		//std::cout << curpatch->GetDistFromStart() + dist_from_back << std::endl;
+	}
+}
+
 void Timer::DebugPrint(std::ostream & out) const
 {
 	for (unsigned int i = 0; i < car.size(); ++i)
@@ -30,6 +30,9 @@
 #include <vector>
 #include <map>
 
+class Car;
+class Track;
+
 class Timer
 {
 public:
@@ -54,6 +57,9 @@ public:
 
 	void UpdateDistance(const unsigned int carid, const double newdistance);
 
+	/// advance the car sector and update its lap distance from the road patch under the car
+	void UpdateCar(const unsigned int carid, Car & vehicle, const Track & track);
+
 	void DebugPrint(std::ostream & out) const;
 
 	float GetPlayerTime() {assert(playercarindex<car.size());return car[playercarindex].GetTime();}
@@ -42,6 +42,7 @@ bool Track::DeferredLoad(
 	const std::string & trackdir,
 	const std::string & texturedir,
 	const std::string & sharedobjectpath,
+	const std::string & cachepath,
 	const int anisotropy,
 	const bool reverse,
 	const bool dynamicobjects,
@@ -58,6 +59,7 @@ bool Track::DeferredLoad(
 			info_output, error_output,
 			trackpath, trackdir,
 			texturedir,	sharedobjectpath,
+			cachepath,
 			anisotropy, reverse,
 			dynamicobjects,
 			dynamicshadows));
@@ -104,6 +106,9 @@ void Track::Clear()
 	}
 	data.shapes.clear();
 
+	// cached bvhs are mapped, release them after the shapes
+	data.bvh_files.clear();
+
 	for (int i = 0, n = data.meshes.size(); i < n; ++i)
 		delete data.meshes[i];
 	data.meshes.clear();
@@ -116,7 +121,10 @@ void Track::Clear()
 	data.body_transforms.clear();
 	data.lap.clear();
 	data.roads.clear();
+	data.road_patches.clear();
+	data.road_index.Clear();
 	data.start_positions.clear();
+	data.length = 0;
 	data.racingline_node.Clear();
 	data.loaded = false;
 }
@@ -130,23 +138,29 @@ bool Track::CastRay(
 	const Bezier * & colpatch,
 	Vec3 & normal) const
 {
-	bool col = false;
-	for (std::list <RoadStrip>::const_iterator i = data.roads.begin(); i != data.roads.end(); ++i)
+	const std::vector<const RoadPatch*> & patches = data.road_patches;
+	if (patch_id >= 0 && patch_id < (int)patches.size())
 	{
 		Vec3 coltri, colnorm;
-		const Bezier * colbez = NULL;
-		if (i->Collide(origin, direction, seglen, patch_id, coltri, colbez, colnorm))
+		if (patches[patch_id]->Collide(origin, direction, seglen, coltri, colnorm))
 		{
-			if (!col || (coltri - origin).MagnitudeSquared() < (outtri - origin).MagnitudeSquared())
-			{
-				outtri = coltri;
-				normal = colnorm;
-				colpatch = colbez;
-			}
-			col = true;
+			outtri = coltri;
+			normal = colnorm;
+			colpatch = &patches[patch_id]->GetPatch();
+			return true;
 		}
 	}
-	return col;
+
+	RoadPatchRayTest<std::vector<const RoadPatch*> > ray(patches, origin, direction, seglen);
+	data.road_index.Query(Aabb<float>::Ray(origin, direction, seglen), ray);
+	if (ray.Hit())
+	{
+		outtri = ray.point;
+		normal = ray.normal;
+		colpatch = &patches[ray.id]->GetPatch();
+		patch_id = ray.id;
+	}
+	return ray.Hit();
 }
 
 void Track::Update()
@@ -179,6 +193,7 @@ std::pair <Vec3, Quat > Track::GetStart(unsigned int index) const
 
 Track::Data::Data() :
 	world(0),
+	length(0),
 	reverse(false),
 	loaded(false),
 	cull(true)
@@ -21,6 +21,7 @@
 #define _TRACK_H
 
 #include "roadstrip.h"
+#include "aabbbvh.h"
 #include "mathvector.h"
 #include "quaternion.h"
 #include "graphics/scenenode.h"
@@ -38,6 +39,7 @@ class Texture;
 class RoadStrip;
 class DynamicsWorld;
 class ContentManager;
+class MappedFile;
 class btStridingMeshInterface;
 class btCollisionShape;
 class btCollisionObject;
@@ -61,6 +63,7 @@ public:
 		const std::string & trackdir,
 		const std::string & effects_texturepath,
 		const std::string & sharedobjectpath,
+		const std::string & cachepath,
 		const int anisotropy,
 		const bool reverse,
 		const bool dynamicobjects,
@@ -82,6 +85,8 @@ public:
 
 	void Clear();
 
+	/// Find the closest road patch hit by the ray.
+	/// patch_id is a track-wide patch index, it is tested first if valid.
 	bool CastRay(
 		const Vec3 & origin,
 		const Vec3 & direction,
@@ -117,6 +122,12 @@ public:
 		return data.lap[sector];
 	}
 
+	/// Lap length of a circuit, zero if the road isn't closed.
+	float GetLength() const
+	{
+		return data.length;
+	}
+
 	void SetRacingLineVisibility(bool newvis)
 	{
 		racingline_visible = newvis;
@@ -165,6 +176,7 @@ private:
 		std::vector<btStridingMeshInterface*> meshes;
 		std::vector<btCollisionShape*> shapes;
 		std::vector<btCollisionObject*> objects;
+		std::vector<std::tr1::shared_ptr<MappedFile> > bvh_files;
 
 		// dynamic track objects
 		SceneNode dynamic_node;
@@ -174,7 +186,10 @@ private:
 		// road information
 		std::vector<const Bezier*> lap;
 		std::list<RoadStrip> roads;
+		std::vector<const RoadPatch*> road_patches;
+		AabbBvh<int> road_index;
 		std::vector<std::pair<Vec3, Quat > > start_positions;
+		float length;
 
 		// racing line data
 		SceneNode racingline_node;
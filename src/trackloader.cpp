@@ -19,13 +19,20 @@
 
 #include "trackloader.h"
 #include "loadcollisionshape.h"
+#include "mappedfile.h"
+#include "physics/bvhcache.h"
 #include "physics/dynamicsworld.h"
 #include "coordinatesystem.h"
 #include "tobullet.h"
 #include "k1999.h"
 #include "content/contentmanager.h"
 #include "graphics/texture.h"
-#include "graphics/model.h"
+#include "graphics/model_joe03.h"
+#include "graphics/meshfile.h"
+#include "quickmp.h"
+
+#include <fstream>
+#include <set>
 
 #define EXTBULLET
 
@@ -55,12 +62,12 @@ static inline std::istream & operator >> (std::istream & lhs, std::vector<std::s
 
 static btIndexedMesh GetIndexedMesh(const Model & model)
 {
-	const float * vertices;
-	int vcount;
-	const int * faces;
-	int fcount;
-	model.GetVertexArray().GetVertices(vertices, vcount);
-	model.GetVertexArray().GetFaces(faces, fcount);
+	// mesh data is used in place, mapped mesh files included
+	const Model::MeshData data = model.GetMeshData();
+	const float * vertices = data.vertices;
+	int vcount = data.vertcount;
+	const int * faces = data.faces;
+	int fcount = data.facecount;
 
 	assert(fcount % 3 == 0); //Face count is not a multiple of 3
 
@@ -89,6 +96,32 @@ struct Track::Loader::Object
 	bool cached;
 };
 
+struct Track::Loader::BodyLoad
+{
+	BodyLoad(const PTree & cfg) :
+		cfg(&cfg), texture_names(3), clampuv(0), mipmap(true),
+		alphablend(false), doublesided(false), decode_model(false)
+	{
+		// ctor
+	}
+	const PTree * cfg;
+	std::string name;
+	std::string model_name;
+	std::vector<std::string> texture_names;
+	int clampuv;
+	bool mipmap;
+	bool alphablend;
+	bool doublesided;
+
+	// set up by LoadBodies, filled in by DecodeBody on a worker thread
+	bool decode_model;
+	std::string model_file;
+	std::tr1::shared_ptr<ModelJoe03> mesh;
+	std::string texture_files[3];
+	std::vector<unsigned char> pixels[3];
+	TextureInfo decoded[3];
+};
+
 Track::Loader::Loader(
 	ContentManager & content,
 	DynamicsWorld & world,
@@ -99,6 +132,7 @@ Track::Loader::Loader(
 	const std::string & trackdir,
 	const std::string & texturedir,
 	const std::string & sharedobjectpath,
+	const std::string & cachepath,
 	const int anisotropy,
 	const bool reverse,
 	const bool dynamic_objects,
@@ -112,6 +146,7 @@ Track::Loader::Loader(
 	trackdir(trackdir),
 	texturedir(texturedir),
 	sharedobjectpath(sharedobjectpath),
+	cachepath(cachepath),
 	anisotropy(anisotropy),
 	dynamic_objects(dynamic_objects),
 	dynamic_shadows(dynamic_shadows),
@@ -139,6 +174,13 @@ void Track::Loader::Clear()
 {
 	bodies.clear();
 	objectfile.close();
+
+	// prefetched pack models have to be decoded before the pack is closed
+	if (packload)
+	{
+		content.finish();
+		packload = false;
+	}
 	pack.Close();
 }
 
@@ -292,179 +334,331 @@ std::pair<bool, bool> Track::Loader::Continue()
 		return std::make_pair(false, false);
 	}
 
-	if (!LoadNode(node_it->second))
+	// parse a batch of nodes, collect bodies not loaded yet
+	std::vector<std::pair<const PTree *, std::string> > batch;
+	std::vector<BodyLoad> loads;
+	std::set<std::string> names;
+	for (size_t n = 0; node_it != nodes->end() && n < nodes_per_batch; ++node_it, ++n)
 	{
-		return std::make_pair(true, false);
+		const PTree & sec = node_it->second;
+		const PTree * sec_body;
+		if (!sec.get("body", sec_body, error_output))
+		{
+			return std::make_pair(true, false);
+		}
+
+		numloaded++;
+		BodyLoad load(*sec_body);
+		if (ParseBody(load))
+		{
+			batch.push_back(std::make_pair(&sec, load.name));
+			if (bodies.find(load.name) == bodies.end() && names.insert(load.name).second)
+			{
+				loads.push_back(load);
+			}
+		}
 	}
 
-	node_it++;
+	LoadBodies(loads);
+
+	// place nodes, bodies that failed to load are skipped
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		body_iterator ib = bodies.find(batch[i].second);
+		if (ib != bodies.end() && !LoadNode(*batch[i].first, ib->second))
+		{
+			return std::make_pair(true, false);
+		}
+	}
 
 	return std::make_pair(false, true);
 }
 
 bool Track::Loader::LoadShape(const PTree & cfg, const Model & model, Body & body)
 {
-	if (body.mass < 1E-3)
-	{
-		btTriangleIndexVertexArray * mesh = new btTriangleIndexVertexArray();
-		mesh->addIndexedMesh(GetIndexedMesh(model));
-		data.meshes.push_back(mesh);
-		body.mesh = mesh;
+	assert(body.mass >= 1E-3); // static shapes are built by LoadBodies
 
-		int surface = 0;
-		cfg.get("surface", surface);
-		if (surface >= (int)data.surfaces.size())
-		{
-			surface = 0;
-		}
+	btVector3 center(0, 0, 0);
+	cfg.get("mass-center", center);
+	btTransform transform = btTransform::getIdentity();
+	transform.getOrigin() -= center;
 
-		btBvhTriangleMeshShape * shape = new btBvhTriangleMeshShape(mesh, true);
-		shape->setUserPointer((void*)&data.surfaces[surface]);
-		data.shapes.push_back(shape);
-		body.shape = shape;
+	btCompoundShape * compound = 0;
+	btCollisionShape * shape = 0;
+	LoadCollisionShape(cfg, transform, shape, compound);
+
+	if (!shape)
+	{
+		// fall back to model bounding box
+		btVector3 size = ToBulletVector(model.GetSize());
+		shape = new btBoxShape(size * 0.5);
+		center = center + ToBulletVector(model.GetCenter());
 	}
-	else
+	if (compound)
 	{
-		btVector3 center(0, 0, 0);
-		cfg.get("mass-center", center);
-		btTransform transform = btTransform::getIdentity();
-		transform.getOrigin() -= center;
-
-		btCompoundShape * compound = 0;
-		btCollisionShape * shape = 0;
-		LoadCollisionShape(cfg, transform, shape, compound);
-
-		if (!shape)
-		{
-			// fall back to model bounding box
-			btVector3 size = ToBulletVector(model.GetSize());
-			shape = new btBoxShape(size * 0.5);
-			center = center + ToBulletVector(model.GetCenter());
-		}
-		if (compound)
-		{
-			shape = compound;
-		}
-		data.shapes.push_back(shape);
-
-		shape->calculateLocalInertia(body.mass, body.inertia);
-		body.shape = shape;
-		body.center = center;
+		shape = compound;
 	}
+	data.shapes.push_back(shape);
+
+	shape->calculateLocalInertia(body.mass, body.inertia);
+	body.shape = shape;
+	body.center = center;
 
 	return true;
 }
 
-Track::Loader::body_iterator Track::Loader::LoadBody(const PTree & cfg)
+bool Track::Loader::ParseBody(BodyLoad & load) const
 {
-	Body body;
+	const PTree & cfg = *load.cfg;
 	std::string texture_str;
-	std::string model_name;
-	int clampuv = 0;
-	bool mipmap = true;
-	bool skybox = false;
-	bool alphablend = false;
-	bool doublesided = false;
 	bool isashadow = false;
 
 	cfg.get("texture", texture_str, error_output);
-	cfg.get("model", model_name, error_output);
-	cfg.get("clampuv", clampuv);
-	cfg.get("mipmap", mipmap);
-	cfg.get("alphablend", alphablend);
-	cfg.get("doublesided", doublesided);
+	cfg.get("model", load.model_name, error_output);
+	cfg.get("clampuv", load.clampuv);
+	cfg.get("mipmap", load.mipmap);
+	cfg.get("alphablend", load.alphablend);
+	cfg.get("doublesided", load.doublesided);
 	cfg.get("isashadow", isashadow);
-	cfg.get("skybox", body.skybox);
-	cfg.get("nolighting", body.nolighting);
 
-	std::vector<std::string> texture_names(3);
 	std::stringstream s(texture_str);
-	s >> texture_names;
+	s >> load.texture_names;
 
 	// set relative path for models and textures, ugly hack
 	// need to identify body references
-	std::string name;
 	if (cfg.value() == "body" && cfg.parent())
 	{
-		name = cfg.parent()->value();
+		load.name = cfg.parent()->value();
 	}
 	else
 	{
-		name = cfg.value();
-		size_t npos = name.rfind("/");
-		if (npos < name.length())
+		load.name = cfg.value();
+		size_t npos = load.name.rfind("/");
+		if (npos < load.name.length())
 		{
-			std::string rel_path = name.substr(0, npos+1);
-			model_name = rel_path + model_name;
-			texture_names[0] = rel_path + texture_names[0];
-			if (!texture_names[1].empty())
-				texture_names[1] = rel_path + texture_names[1];
-			if (!texture_names[2].empty())
-				texture_names[2] = rel_path + texture_names[2];
+			std::string rel_path = load.name.substr(0, npos+1);
+			load.model_name = rel_path + load.model_name;
+			load.texture_names[0] = rel_path + load.texture_names[0];
+			if (!load.texture_names[1].empty())
+				load.texture_names[1] = rel_path + load.texture_names[1];
+			if (!load.texture_names[2].empty())
+				load.texture_names[2] = rel_path + load.texture_names[2];
 		}
 	}
 
-	if (dynamic_shadows && isashadow)
+	return !(dynamic_shadows && isashadow);
+}
+
+void Track::Loader::DecodeBody(BodyLoad & load, const JoePack * pack)
+{
+	std::ostringstream error;
+	if (load.decode_model)
 	{
-		return bodies.end();
+		std::tr1::shared_ptr<ModelJoe03> mesh(new ModelJoe03());
+		bool loaded = false;
+		if (pack)
+		{
+			loaded = mesh->LoadMesh(load.model_name, error, pack);
+		}
+		if (!loaded && !load.model_file.empty())
+		{
+			loaded = mesh->LoadMesh(load.model_file, error);
+		}
+		if (loaded)
+		{
+			load.mesh = mesh;
+		}
 	}
 
-	std::tr1::shared_ptr<Model> model;
-	if ((packload && content.load(model, objectdir, model_name, pack)) ||
-		content.load(model, objectdir, model_name))
+	for (int i = 0; i < 3; ++i)
 	{
-		data.models.insert(model);
+		if (!load.texture_files[i].empty())
+		{
+			Texture::Decode(load.texture_files[i], load.decoded[i], load.pixels[i]);
+		}
 	}
-	else
+}
+
+void Track::Loader::LoadBodies(std::vector<BodyLoad> & loads)
+{
+	if (loads.empty())
 	{
-		info_output << "Failed to load body " << cfg.value() << " model " << model_name << std::endl;
-		return bodies.end();
+		return;
 	}
 
-	body.collidable = cfg.get("mass", body.mass);
-	if (body.collidable)
+	// queue uncached models and textures, each file is decoded once per batch
+	std::set<std::string> queued;
+	const bool decode_textures = !content.getFactory<Texture>().isHeadless();
+	for (size_t i = 0; i < loads.size(); ++i)
 	{
-		LoadShape(cfg, *model, body);
+		BodyLoad & load = loads[i];
+		std::tr1::shared_ptr<Model> model;
+		if (!content.get(model, objectdir, load.model_name) &&
+			queued.insert(load.model_name).second)
+		{
+			// converted mesh files are mapped by the model factory, no decoding needed
+			content.findFile(objectdir, load.model_name, load.model_file);
+			load.decode_model = load.model_file.empty() ||
+				!std::ifstream(MeshFile::GetPath(load.model_file).c_str());
+		}
+		for (int n = 0; n < 3 && decode_textures; ++n)
+		{
+			const std::string & texture_name = load.texture_names[n];
+			std::tr1::shared_ptr<Texture> texture;
+			if (!texture_name.empty() &&
+				!content.get(texture, objectdir, texture_name) &&
+				queued.insert(texture_name).second)
+			{
+				content.findFile(objectdir, texture_name, load.texture_files[n]);
+			}
+		}
 	}
 
-	// load textures
-	std::tr1::shared_ptr<Texture> tex[3];
-	TextureInfo texinfo;
-	texinfo.mipmap = mipmap || anisotropy; //always mipmap if anisotropy is on
-	texinfo.anisotropy = anisotropy;
-	texinfo.repeatu = clampuv != 1 && clampuv != 2;
-	texinfo.repeatv = clampuv != 1 && clampuv != 3;
-	content.load(tex[0], objectdir, texture_names[0], texinfo);
-	if (!texture_names[1].empty())
+	// read and decode on the worker threads
+	BodyLoad * body_loads = &loads[0];
+	const JoePack * body_pack = packload ? &pack : 0;
+	QMP_SHARE(body_loads);
+	QMP_SHARE(body_pack);
+	QMP_PARALLEL_FOR(i, 0, loads.size(), quickmp::INTERLEAVED)
+		QMP_USE_SHARED(body_loads, BodyLoad *);
+		QMP_USE_SHARED(body_pack, const JoePack *);
+		DecodeBody(body_loads[i], body_pack);
+	QMP_END_PARALLEL_FOR;
+
+	// gl uploads on the main thread
+	std::vector<MeshShape> meshes;
+	for (size_t i = 0; i < loads.size(); ++i)
 	{
-		content.load(tex[1], objectdir, texture_names[1], texinfo);
-		data.textures.insert(tex[1]);
+		FinalizeBody(loads[i], meshes);
 	}
-	else
+	if (meshes.empty())
 	{
-		tex[1] = content.getFactory<Texture>().getZero();
+		return;
 	}
-	if (!texture_names[2].empty())
+
+	// build or load cached static mesh bvhs on the worker threads
+	MeshShape * mesh_shapes = &meshes[0];
+	const std::string * bvh_cachepath = &cachepath;
+	QMP_SHARE(mesh_shapes);
+	QMP_SHARE(bvh_cachepath);
+	QMP_PARALLEL_FOR(i, 0, meshes.size(), quickmp::INTERLEAVED)
+		QMP_USE_SHARED(mesh_shapes, MeshShape *);
+		QMP_USE_SHARED(bvh_cachepath, const std::string *);
+		MeshShape & ms = mesh_shapes[i];
+		btTriangleIndexVertexArray * mesh = new btTriangleIndexVertexArray();
+		mesh->addIndexedMesh(GetIndexedMesh(*ms.model));
+		ms.mesh = mesh;
+		ms.shape = LoadBvhTriangleMeshShape(mesh, *bvh_cachepath, ms.cachefile);
+	QMP_END_PARALLEL_FOR;
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		MeshShape & ms = meshes[i];
+		ms.shape->setUserPointer((void*)&data.surfaces[ms.surface]);
+		data.meshes.push_back(ms.mesh);
+		data.shapes.push_back(ms.shape);
+		if (ms.cachefile.get())
+		{
+			data.bvh_files.push_back(ms.cachefile);
+		}
+		ms.body->mesh = ms.mesh;
+		ms.body->shape = ms.shape;
+	}
+}
+
+void Track::Loader::FinalizeBody(BodyLoad & load, std::vector<MeshShape> & meshes)
+{
+	const PTree & cfg = *load.cfg;
+	Body body;
+	cfg.get("skybox", body.skybox);
+	cfg.get("nolighting", body.nolighting);
+
+	// the decoded mesh is handed to the model factory as is
+	Factory<Model>::decoded decoded;
+	decoded.model = load.mesh;
+
+	std::tr1::shared_ptr<Model> model;
+	if ((load.mesh.get() && content.load(model, objectdir, load.model_name, decoded)) ||
+		(packload && content.load(model, objectdir, load.model_name, pack)) ||
+		content.load(model, objectdir, load.model_name))
 	{
-		texinfo.compress = false;
-		content.load(tex[2], objectdir, texture_names[2], texinfo);
-		data.textures.insert(tex[2]);
+		data.models.insert(model);
 	}
 	else
 	{
-		tex[2] = content.getFactory<Texture>().getZero();
+		info_output << "Failed to load body " << cfg.value() << " model " << load.model_name << std::endl;
+		return;
+	}
+
+	// load textures
+	std::tr1::shared_ptr<Texture> tex[3];
+	TextureInfo texinfo;
+	texinfo.mipmap = load.mipmap || anisotropy; //always mipmap if anisotropy is on
+	texinfo.anisotropy = anisotropy;
+	texinfo.repeatu = load.clampuv != 1 && load.clampuv != 2;
+	texinfo.repeatv = load.clampuv != 1 && load.clampuv != 3;
+	for (int i = 0; i < 3; ++i)
+	{
+		const std::string & texture_name = load.texture_names[i];
+		if (i > 0 && texture_name.empty())
+		{
+			tex[i] = content.getFactory<Texture>().getZero();
+			continue;
+		}
+
+		texinfo.compress = (i < 2);
+		if (!load.pixels[i].empty())
+		{
+			TextureInfo info = texinfo;
+			info.data = &load.pixels[i][0];
+			info.width = load.decoded[i].width;
+			info.height = load.decoded[i].height;
+			info.bytespp = load.decoded[i].bytespp;
+			content.load(tex[i], objectdir, texture_name, info);
+		}
+		else
+		{
+			content.load(tex[i], objectdir, texture_name, texinfo);
+		}
+		if (i > 0)
+		{
+			data.textures.insert(tex[i]);
+		}
 	}
 
 	// setup drawable
 	Drawable & drawable = body.drawable;
 	drawable.SetModel(*model);
 	drawable.SetTextures(tex[0]->GetID(), tex[1]->GetID(), tex[2]->GetID());
-	drawable.SetDecal(alphablend);
-	drawable.SetCull(data.cull && !doublesided, false);
+	drawable.SetDecal(load.alphablend);
+	drawable.SetCull(data.cull && !load.doublesided, false);
 	drawable.SetObjectCenter(model->GetCenter());
-	drawable.SetRadius(!skybox ? model->GetRadius() : 0.0f);
+	drawable.SetRadius(model->GetRadius());
+
+	body.collidable = cfg.get("mass", body.mass);
+	if (body.collidable && body.mass >= 1E-3)
+	{
+		LoadShape(cfg, *model, body);
+	}
 
-	return bodies.insert(std::make_pair(name, body)).first;
+	Body & inserted = bodies.insert(std::make_pair(load.name, body)).first->second;
+	if (body.collidable && body.mass < 1E-3)
+	{
+		int surface = 0;
+		cfg.get("surface", surface);
+		if (surface >= (int)data.surfaces.size())
+		{
+			surface = 0;
+		}
+
+		MeshShape ms;
+		ms.body = &inserted;
+		ms.model = model;
+		ms.surface = surface;
+		ms.mesh = 0;
+		ms.shape = 0;
+		meshes.push_back(ms);
+	}
 }
 
 void Track::Loader::AddBody(SceneNode & scene, const Body & body)
@@ -497,26 +691,12 @@ void Track::Loader::AddBody(SceneNode & scene, const Body & body)
 	dlist->insert(body.drawable);
 }
 
-bool Track::Loader::LoadNode(const PTree & sec)
+bool Track::Loader::LoadNode(const PTree & sec, const Body & body)
 {
-	const PTree * sec_body;
-	if (!sec.get("body", sec_body, error_output))
-	{
-		return false;
-	}
-
-	body_iterator ib = LoadBody(*sec_body);
-	if (ib == bodies.end())
-	{
-		//info_output << "Object " << sec.value() << " failed to load body" << std::endl;
-		return true;
-	}
-
 	Vec3 position, angle;
 	bool has_transform = sec.get("position",  position) | sec.get("rotation", angle);
 	Quat rotation(angle[0]/180*M_PI, angle[1]/180*M_PI, angle[2]/180*M_PI);
 
-	const Body & body = ib->second;
 	if (body.mass < 1E-3)
 	{
 		// static geometry
@@ -670,9 +850,50 @@ bool Track::Loader::BeginOld()
 		return false;
 	}
 
+	if (packload)
+	{
+		PrefetchOld();
+	}
+
 	return true;
 }
 
+void Track::Loader::PrefetchOld()
+{
+	std::string objectlist = objectpath + "/list.txt";
+	std::ifstream f(objectlist.c_str());
+	int params_per_object;
+	if (!get(f, params_per_object))
+	{
+		return;
+	}
+
+	// model name is followed by the params read by ContinueOld, isashadow is the 14th
+	const int shadow_param = 14;
+	const JoePack * model_pack = &pack;
+	std::string model_name, junk;
+	while (get(f, model_name))
+	{
+		bool isashadow = false;
+		for (int i = 1; i < params_per_object; ++i)
+		{
+			if (i == shadow_param)
+				get(f, isashadow);
+			else
+				get(f, junk);
+		}
+
+		if (dynamic_shadows && isashadow)
+		{
+			continue;
+		}
+
+		// pending loads are shared with the content.load in ContinueOld
+		ContentManager::Future<Model> future;
+		content.loadAsync(future, objectdir, model_name, model_pack);
+	}
+}
+
 bool Track::Loader::AddObject(const Object & object)
 {
 	data.models.insert(object.model);
@@ -754,9 +975,14 @@ bool Track::Loader::AddObject(const Object & object)
 		data.meshes.push_back(mesh);
 
 		assert(object.surface >= 0 && object.surface < (int)data.surfaces.size());
-		btBvhTriangleMeshShape * shape = new btBvhTriangleMeshShape(mesh, true);
+		std::tr1::shared_ptr<MappedFile> cachefile;
+		btBvhTriangleMeshShape * shape = LoadBvhTriangleMeshShape(mesh, cachepath, cachefile);
 		shape->setUserPointer((void*)&data.surfaces[object.surface]);
 		data.shapes.push_back(shape);
+		if (cachefile.get())
+		{
+			data.bvh_files.push_back(cachefile);
+		}
 
 #ifndef EXTBULLET
 		btTransform transform = btTransform::getIdentity();
@@ -806,6 +1032,7 @@ std::pair<bool, bool> Track::Loader::ContinueOld()
 		get(objectfile, junk);
 	}
 
+	numloaded++;
 	if (dynamic_shadows && isashadow)
 	{
 		return std::make_pair(false, true);
@@ -887,6 +1114,8 @@ bool Track::Loader::LoadSurfaces()
 bool Track::Loader::LoadRoads()
 {
 	data.roads.clear();
+	data.road_patches.clear();
+	data.road_index.Clear();
 
 	std::string roadpath = trackpath + "/roads.trk";
 	std::ifstream trackfile(roadpath.c_str());
@@ -904,6 +1133,18 @@ bool Track::Loader::LoadRoads()
 		data.roads.back().ReadFrom(trackfile, data.reverse, error_output);
 	}
 
+	// track-wide road patch index used by Track::CastRay
+	for (std::list <RoadStrip>::const_iterator i = data.roads.begin(); i != data.roads.end(); ++i)
+	{
+		const std::vector<RoadPatch> & patches = i->GetPatches();
+		for (std::vector<RoadPatch>::const_iterator p = patches.begin(); p != patches.end(); ++p)
+		{
+			data.road_index.Add(data.road_patches.size(), p->GetPatch().GetAABB());
+			data.road_patches.push_back(&*p);
+		}
+	}
+	data.road_index.Optimize();
+
 	return true;
 }
 
@@ -912,16 +1153,38 @@ bool Track::Loader::CreateRacingLines()
 	TextureInfo texinfo;
 	content.load(data.racingline_texture, texturedir, "racingline.png", texinfo);
 
-	K1999 k1999data;
+	std::vector <RoadStrip *> roads;
 	for (std::list <RoadStrip>::iterator i = data.roads.begin(); i != data.roads.end(); ++i)
 	{
-		if (k1999data.LoadData(*i))
-		{
-			k1999data.CalcRaceLine();
-			k1999data.UpdateRoadStrip(*i);
-		}
-		//else error_output << "Couldn't create racing line for roadstrip " << n << std::endl;
+		roads.push_back(&*i);
+	}
 
+	// roads are independent, load cached or compute their racing lines on the worker threads
+	if (!roads.empty())
+	{
+		RoadStrip ** racingline_roads = &roads[0];
+		const std::string * racingline_cachepath = &cachepath;
+		QMP_SHARE(racingline_roads);
+		QMP_SHARE(racingline_cachepath);
+		QMP_PARALLEL_FOR(i, 0, roads.size(), quickmp::INTERLEAVED)
+			QMP_USE_SHARED(racingline_roads, RoadStrip **);
+			QMP_USE_SHARED(racingline_cachepath, const std::string *);
+			K1999 k1999data;
+			if (k1999data.LoadData(*racingline_roads[i]))
+			{
+				if (!k1999data.LoadCached(*racingline_cachepath))
+				{
+					k1999data.CalcRaceLine();
+					k1999data.WriteCached(*racingline_cachepath);
+				}
+				k1999data.UpdateRoadStrip(*racingline_roads[i]);
+			}
+			//else error_output << "Couldn't create racing line for roadstrip " << n << std::endl;
+		QMP_END_PARALLEL_FOR;
+	}
+
+	for (std::list <RoadStrip>::iterator i = data.roads.begin(); i != data.roads.end(); ++i)
+	{
 		i->CreateRacingLine(data.racingline_node, data.racingline_texture);
 	}
 
@@ -1072,6 +1335,7 @@ bool Track::Loader::LoadLapSections(const PTree & info)
 		total_dist += curr_patch->length;
 		curr_patch = curr_patch->next_patch;
 	}
+	data.length = curr_patch ? total_dist : 0;
 
 	info_output << "Track timing sectors: " << lapmarkers << std::endl;
 	return true;
@@ -47,6 +47,7 @@ model = body.joe
 
 class DynamicsWorld;
 class ContentManager;
+class MappedFile;
 class btStridingMeshInterface;
 class btCompoundShape;
 class btCollisionShape;
@@ -65,6 +66,7 @@ public:
 		const std::string & trackdir,
 		const std::string & texturedir,
 		const std::string & sharedobjectpath,
+		const std::string & cachepath,
 		const int anisotropy,
 		const bool reverse,
 		const bool dynamic_shadows,
@@ -91,6 +93,7 @@ private:
 	const std::string & trackdir;
 	const std::string & texturedir;
 	const std::string & sharedobjectpath;
+	const std::string cachepath;
 	const int anisotropy;
 	const bool dynamic_objects;
 	const bool dynamic_shadows;
@@ -162,11 +165,44 @@ private:
 
 	void CalculateNumOld();
 
-	bool LoadNode(const PTree & sec);
+	/// queue async loads of the pack models in the object list,
+	/// they are decoded on the loader threads while ContinueOld runs
+	void PrefetchOld();
 
+	// nodes placed per Continue call, bodies of a batch are loaded in parallel
+	static const size_t nodes_per_batch = 64;
+
+	// body being loaded, see LoadBodies
+	struct BodyLoad;
+
+	// static body mesh shape, built on a worker thread
+	struct MeshShape
+	{
+		Body * body;
+		std::tr1::shared_ptr<Model> model;
+		btStridingMeshInterface * mesh;
+		btCollisionShape * shape;
+		std::tr1::shared_ptr<MappedFile> cachefile;
+		int surface;
+	};
+
+	bool LoadNode(const PTree & sec, const Body & body);
+
+	/// dynamic body shape
 	bool LoadShape(const PTree & body_cfg, const Model & body_model, Body & body);
 
-	body_iterator LoadBody(const PTree & cfg);
+	/// read body config, return false if the body is skipped
+	bool ParseBody(BodyLoad & load) const;
+
+	/// decode models and textures of a body, runs on a worker thread
+	static void DecodeBody(BodyLoad & load, const JoePack * pack);
+
+	/// upload decoded content and create the body, queue static mesh shapes
+	void FinalizeBody(BodyLoad & load, std::vector<MeshShape> & meshes);
+
+	/// load a batch of bodies, file reads, decoding and static mesh bvh builds
+	/// run on the quickmp worker threads, gl uploads stay on the main thread
+	void LoadBodies(std::vector<BodyLoad> & loads);
 
 	void AddBody(SceneNode & scene, const Body & body);
 
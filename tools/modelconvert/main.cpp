@@ -10,8 +10,9 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 
-#include "model_joe03.h"
-#include "model_obj.h"
+#include "graphics/model_joe03.h"
+#include "graphics/model_obj.h"
+#include "graphics/meshfile.h"
 
 using namespace std;
 
@@ -51,9 +52,9 @@ int main(int argc, char ** argv)
       assert(glew_err == GLEW_OK);
   }
 
-  map <string, MODEL *> typemap;
-  typemap["joe"] = new MODEL_JOE03;
-  typemap["obj"] = new MODEL_OBJ;
+  map <string, Model *> typemap;
+  typemap["joe"] = new ModelJoe03;
+  typemap["obj"] = new ModelObj("", cerr);
   
   string infile = argmap["-in"];
   string outfile = argmap["-out"];
@@ -61,14 +62,14 @@ int main(int argc, char ** argv)
   if (infile.empty() || outfile.empty())
   {
 	  cout << "Usage: -in <INPUTFILE> -out <OUTPUTFILE>" << endl << endl;
-	  cout << "Input file formats supported: ova";
-	  for (map <string, MODEL *>::iterator i = typemap.begin(); i != typemap.end(); ++i)
+	  cout << "Input file formats supported: ova, vmf";
+	  for (map <string, Model *>::iterator i = typemap.begin(); i != typemap.end(); ++i)
 	  {
 		  cout << ", " << i->first;
 	  }
 	  cout << endl;
-	  cout << "Output file formats supported: ova";
-	  for (map <string, MODEL *>::iterator i = typemap.begin(); i != typemap.end(); ++i)
+	  cout << "Output file formats supported: ova, vmf";
+	  for (map <string, Model *>::iterator i = typemap.begin(); i != typemap.end(); ++i)
 	  {
 		  if (i->second->CanSave())
 			  cout << ", " << i->first;
@@ -80,17 +81,26 @@ int main(int argc, char ** argv)
   string inext = infile.substr(max(infile.size()*0,infile.size()-3));
   string outext = outfile.substr(max(outfile.size()*0,outfile.size()-3));
 
-  MODEL * inmodel(NULL);  
+  Model * inmodel(NULL);  
 
   if (inext == "ova")
   {
-	  inmodel = new MODEL_OBJ();
+	  inmodel = new ModelObj("", cerr);
 	  if (!inmodel->ReadFromFile(infile, cerr, false))
 	  {
 		  cerr << "Error loading " << infile << endl;
 		  return 0;
 	  }
   }
+  else if (inext == "vmf")
+  {
+	  inmodel = new Model();
+	  if (!inmodel->LoadMeshFile(infile, cerr))
+	  {
+		  cerr << "Error loading " << infile << endl;
+		  return 0;
+	  }
+  }
   else
   {
 	  if (typemap.find(inext) == typemap.end())
@@ -100,31 +110,45 @@ int main(int argc, char ** argv)
 	  }
 	  
 	  inmodel = typemap[inext];
-	  if (!inmodel->Load(infile, cerr))
+	  if (!inmodel->Load(infile, cerr, true))
 	  {
 		  cerr << "Error loading " << infile << endl;
 		  return 0;
 	  }
   }
   
+  VertexArray varray;
+  inmodel->CopyVertexArray(varray);
+
   if (outext == "ova")
   {
-    if (!inmodel->WriteToFile(outfile))
+    Model outmodel;
+    outmodel.SetVertexArray(varray);
+    if (!outmodel.WriteToFile(outfile))
     {
       cerr << "Error writing to ova file" << endl;
       return 0;
     }
   }
+  else if (outext == "vmf")
+  {
+    // aligned mesh blocks, memory mapped by the game in place of the source model
+    if (!MeshFile::Write(outfile, varray, cerr, infile))
+    {
+      cerr << "Error writing to vmf file" << endl;
+      return 0;
+    }
+  }
   else if (typemap.find(outext) != typemap.end())
   {
-	  MODEL * outmodel = typemap[outext];
+	  Model * outmodel = typemap[outext];
 	  if (!outmodel->CanSave())
 	  {
 		  cerr << "File format " << outext << " doesn't support saving" << endl;
 		  return 0;
 	  }
 	  if (inmodel != outmodel)
-		  outmodel->SetVertexArray(inmodel->GetVertexArray());
+		  outmodel->SetVertexArray(varray);
 	  if (!outmodel->Save(outfile, cerr))
 	  {
 		  cerr << "Error converting to " << outfile << endl;